@@ -5,11 +5,22 @@ namespace ImageLib.Support
     public sealed class ImagePackage
     {
         public ImagePackage(IImageDecoder decoder, ImageSource source, double width, double height)
+            : this(decoder, source, width, height, width, height)
+        {
+        }
+
+        /// <summary>
+        /// 解码尺寸小于原始尺寸时使用(缩略图)
+        /// </summary>
+        public ImagePackage(IImageDecoder decoder, ImageSource source, double width, double height,
+            double decodeWidth, double decodeHeight)
         {
             this.Decoder = decoder;
             this.ImageSource = source;
             this.PixelWidth = width;
             this.PixelHeight = height;
+            this.DecodePixelWidth = decodeWidth;
+            this.DecodePixelHeight = decodeHeight;
         }
 
         public void UpdateSource(ImageSource source)
@@ -34,5 +45,12 @@ namespace ImageLib.Support
         public double PixelWidth { get; private set; }
 
         public double PixelHeight { get; private set; }
+
+        /// <summary>
+        /// ImageSource的实际像素尺寸
+        /// </summary>
+        public double DecodePixelWidth { get; private set; }
+
+        public double DecodePixelHeight { get; private set; }
     }
 }
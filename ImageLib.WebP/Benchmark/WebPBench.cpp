@@ -0,0 +1,408 @@
+// Runs a corpus of WebP files through the native engine and reports decode
+// throughput in megapixels per second.
+//
+//   webp_bench [-n iterations] [-w warmup] [-s WxH] [-t] [-p workers] [--isolated] [--preview] [--batch] [--profile] [--trace file.json] <file|directory>...
+//
+// By default every frame is composited onto a persistent canvas, as animation
+// playback does. --isolated decodes each frame on its own like
+// WebPBitmapFrame::RenderFrame. -s decodes straight to the largest size that
+// fits in WxH; throughput is still counted in source pixels. -t lets libwebp
+// filter on a worker thread, and -p runs those workers on a WebPThreadPool
+// of the given size instead of a new thread per decode. --batch decodes the
+// first frame of every file together through DecodeBatch, on the -p pool.
+// --preview decodes each frame on its own as a quarter-size preview, within
+// the -s size if any.
+// --profile splits the time of the timed iterations between libwebp's
+// stages, summed over the threads that ran them, and --trace writes those
+// stage runs to a Chrome trace-event file.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Engine/WebPBatchDecoder.h"
+#include "../Engine/WebPCompositor.h"
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "../Engine/WebPSource.h"
+#include "../Engine/WebPThreadPool.h"
+
+using namespace ImageLib::WebP::Engine;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	struct Options
+	{
+		int iterations = 10;
+		int warmup = 1;
+		int maxWidth = 0;
+		int maxHeight = 0;
+		bool useThreads = false;
+		int poolWorkers = 0;
+		bool isolated = false;
+		bool preview = false;
+		bool batch = false;
+		bool profile = false;
+		std::string tracePath;
+		std::vector<std::string> inputs;
+	};
+
+	struct Result
+	{
+		double seconds = 0;
+		double megapixels = 0;
+	};
+
+	void PrintUsage()
+	{
+		std::fprintf(stderr, "usage: webp_bench [-n iterations] [-w warmup] [-s WxH] [-t] [-p workers] [--isolated] [--preview] [--batch] [--profile] [--trace file.json] <file|directory>...\n");
+	}
+
+	bool ParseOptions(int argc, char** argv, Options* options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			if (!std::strcmp(argv[i], "-n") && i + 1 < argc)
+			{
+				options->iterations = std::max(1, std::atoi(argv[++i]));
+			}
+			else if (!std::strcmp(argv[i], "-w") && i + 1 < argc)
+			{
+				options->warmup = std::max(0, std::atoi(argv[++i]));
+			}
+			else if (!std::strcmp(argv[i], "-s") && i + 1 < argc)
+			{
+				if (std::sscanf(argv[++i], "%dx%d", &options->maxWidth, &options->maxHeight) != 2)
+				{
+					return false;
+				}
+			}
+			else if (!std::strcmp(argv[i], "-t"))
+			{
+				options->useThreads = true;
+			}
+			else if (!std::strcmp(argv[i], "-p") && i + 1 < argc)
+			{
+				options->poolWorkers = std::max(1, std::atoi(argv[++i]));
+			}
+			else if (!std::strcmp(argv[i], "--isolated"))
+			{
+				options->isolated = true;
+			}
+			else if (!std::strcmp(argv[i], "--preview"))
+			{
+				options->preview = true;
+			}
+			else if (!std::strcmp(argv[i], "--batch"))
+			{
+				options->batch = true;
+			}
+			else if (!std::strcmp(argv[i], "--profile"))
+			{
+				options->profile = true;
+			}
+			else if (!std::strcmp(argv[i], "--trace") && i + 1 < argc)
+			{
+				options->tracePath = argv[++i];
+			}
+			else if (argv[i][0] == '-')
+			{
+				return false;
+			}
+			else
+			{
+				options->inputs.push_back(argv[i]);
+			}
+		}
+		return !options->inputs.empty();
+	}
+
+	std::vector<std::string> CollectCorpus(const std::vector<std::string>& inputs)
+	{
+		namespace fs = std::filesystem;
+		std::vector<std::string> files;
+		for (const auto& input : inputs)
+		{
+			if (fs::is_directory(input))
+			{
+				for (const auto& entry : fs::recursive_directory_iterator(input))
+				{
+					if (entry.is_regular_file() && entry.path().extension() == ".webp")
+					{
+						files.push_back(entry.path().string());
+					}
+				}
+			}
+			else
+			{
+				files.push_back(input);
+			}
+		}
+		std::sort(files.begin(), files.end());
+		return files;
+	}
+
+	// Demuxes the file and decodes every frame on its own, like WebPBitmapFrame::RenderFrame.
+	double DecodeIsolated(const std::shared_ptr<WebPSource>& source, const Options& options, PixelBuffer* scratch)
+	{
+		auto container = WebPContainer::Create(source);
+		double pixels = 0;
+		for (const auto& frame : container->Frames())
+		{
+			DecodeOptions decodeOptions;
+			decodeOptions.useThreads = options.useThreads;
+			decodeOptions.preview = options.preview;
+			int width, height;
+			OutputSize(frame.width, frame.height, decodeOptions, &width, &height);
+			FitSize(width, height, options.maxWidth, options.maxHeight, &decodeOptions.scaledWidth, &decodeOptions.scaledHeight);
+			OutputSize(frame.width, frame.height, decodeOptions, &width, &height);
+			if (width > scratch->Width() || height > scratch->Height())
+			{
+				*scratch = PixelBuffer(std::max(width, scratch->Width()), std::max(height, scratch->Height()));
+			}
+			DecodeFrame(frame, scratch->Surface(), decodeOptions);
+			pixels += static_cast<double>(frame.width) * frame.height;
+		}
+		return pixels;
+	}
+
+	// Demuxes the file and plays one loop of it through the compositor.
+	double DecodeComposited(const std::shared_ptr<WebPSource>& source, const Options& options)
+	{
+		auto container = WebPContainer::Create(source);
+		DecodeOptions decodeOptions;
+		decodeOptions.useThreads = options.useThreads;
+		FitSize(container->CanvasWidth(), container->CanvasHeight(), options.maxWidth, options.maxHeight, &decodeOptions.scaledWidth, &decodeOptions.scaledHeight);
+		WebPCompositor compositor(container, decodeOptions);
+		double pixels = 0;
+		for (size_t i = 0; i < container->Frames().size(); ++i)
+		{
+			compositor.RenderFrame(static_cast<int>(i));
+			pixels += static_cast<double>(container->CanvasWidth()) * container->CanvasHeight();
+		}
+		return pixels;
+	}
+
+	double DecodeOnce(const std::shared_ptr<WebPSource>& source, const Options& options, PixelBuffer* scratch)
+	{
+		return options.isolated || options.preview ? DecodeIsolated(source, options, scratch) : DecodeComposited(source, options);
+	}
+
+	// Prints the statistics of the -p pool, if any, and shuts it down.
+	void ReportPool()
+	{
+		if (WebPThreadPool* pool = WebPThreadPool::Installed())
+		{
+			const WebPThreadPool::Stats stats = pool->GetStats();
+			std::printf("pool: %d workers, %llu tasks (%llu stolen, %llu run while waiting), peak queue %d, %.1f%% busy\n",
+				stats.workers,
+				static_cast<unsigned long long>(stats.tasksRun),
+				static_cast<unsigned long long>(stats.tasksStolen),
+				static_cast<unsigned long long>(stats.tasksHelped),
+				stats.peakQueueDepth,
+				stats.utilization * 100);
+			if (!WebPThreadPool::Uninstall())
+			{
+				std::printf("pool: workers still hold jobs, left installed\n");
+			}
+		}
+	}
+
+	// Decodes the first frame of every file in one DecodeBatch call per
+	// iteration and reports the aggregate throughput in source pixels.
+	int RunBatch(const std::vector<std::string>& files, const Options& options)
+	{
+		std::vector<std::shared_ptr<WebPSource>> sources;
+		std::vector<BatchItem> items;
+		double pixels = 0;
+		for (const auto& path : files)
+		{
+			sources.push_back(WebPSource::MapFile(path.c_str()));
+			items.push_back(BatchItem{ sources.back()->Data(), sources.back()->Size(), options.maxWidth, options.maxHeight });
+			WebPBitstreamFeatures features;
+			if (WebPGetFeatures(items.back().data, items.back().size, &features) == VP8_STATUS_OK)
+			{
+				pixels += static_cast<double>(features.width) * features.height;
+			}
+		}
+
+		DecodeOptions decodeOptions;
+		decodeOptions.useThreads = options.useThreads;
+		for (int i = 0; i < options.warmup; ++i)
+		{
+			DecodeBatch(items, decodeOptions);
+		}
+		int failures = 0;
+		auto start = Clock::now();
+		for (int i = 0; i < options.iterations; ++i)
+		{
+			for (const auto& result : DecodeBatch(items, decodeOptions))
+			{
+				failures += result.error != nullptr;
+			}
+		}
+		const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		const double megapixels = pixels * options.iterations / 1e6;
+		std::printf("batch: %zu images, %.3f ms/iter, %.2f MP/s\n",
+			items.size(), seconds * 1e3 / options.iterations, megapixels / seconds);
+		return failures ? 1 : 0;
+	}
+
+	// Prints the time per iteration of the stages that 'after' spent more
+	// time in than 'before'.
+	void PrintStages(const char* label, const WebPProfile& before, const WebPProfile& after, int iterations)
+	{
+		uint64_t total = 0;
+		for (int stage = 0; stage < WEBP_STAGE_COUNT; ++stage)
+		{
+			total += after.nanoseconds[stage] - before.nanoseconds[stage];
+		}
+		std::printf("  %s ms/iter:", label);
+		for (int stage = 0; stage < WEBP_STAGE_COUNT; ++stage)
+		{
+			const uint64_t ns = after.nanoseconds[stage] - before.nanoseconds[stage];
+			if (ns > 0)
+			{
+				std::printf(" %s %.3f (%.0f%%)", WebPProfileStageName(stage), ns / 1e6 / iterations, 100.0 * ns / total);
+			}
+		}
+		std::printf("\n");
+	}
+
+	// Profiles the timed iterations into 'profile', if not null.
+	Result Benchmark(const std::shared_ptr<WebPSource>& source, const Options& options, StageProfile* profile)
+	{
+		PixelBuffer scratch;
+		for (int i = 0; i < options.warmup; ++i)
+		{
+			DecodeOnce(source, options, &scratch);
+		}
+
+		Result result;
+		ProfileScope scope(profile);
+		auto start = Clock::now();
+		for (int i = 0; i < options.iterations; ++i)
+		{
+			result.megapixels += DecodeOnce(source, options, &scratch) / 1e6;
+		}
+		result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!ParseOptions(argc, argv, &options))
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	auto files = CollectCorpus(options.inputs);
+	if (files.empty())
+	{
+		std::fprintf(stderr, "no .webp files found\n");
+		return 2;
+	}
+	if (options.poolWorkers > 0)
+	{
+		WebPThreadPool::Install(options.poolWorkers);
+	}
+
+	if (options.batch)
+	{
+		const int status = RunBatch(files, options);
+		ReportPool();
+		return status;
+	}
+
+	// Enough events for a few seconds of decoding; the rest are only counted.
+	const size_t kTraceEvents = 1 << 18;
+	std::unique_ptr<StageProfile> profile;
+	if (options.profile || !options.tracePath.empty())
+	{
+		profile.reset(new StageProfile(options.tracePath.empty() ? 0 : kTraceEvents));
+	}
+
+	std::printf("%-40s %7s %11s %10s %10s %10s\n", "file", "frames", "canvas", "ms/iter", "MP/s", "peak KiB");
+	Result total;
+	int failures = 0;
+	for (const auto& path : files)
+	{
+		try
+		{
+			auto source = WebPSource::MapFile(path.c_str());
+			auto container = WebPContainer::Create(source);
+			// Counts what libwebp holds at most while the file is decoded.
+			MemoryAccount memory;
+			Result result;
+			const WebPProfile before = profile ? *profile->Get() : WebPProfile();
+			{
+				MemoryScope scope(&memory);
+				result = Benchmark(source, options, profile.get());
+			}
+			total.seconds += result.seconds;
+			total.megapixels += result.megapixels;
+
+			char canvas[32];
+			std::snprintf(canvas, sizeof(canvas), "%dx%d", container->CanvasWidth(), container->CanvasHeight());
+			std::printf("%-40s %7zu %11s %10.3f %10.2f %10llu\n",
+				std::filesystem::path(path).filename().string().c_str(),
+				container->Frames().size(),
+				canvas,
+				result.seconds * 1e3 / options.iterations,
+				result.megapixels / result.seconds,
+				static_cast<unsigned long long>((memory.PeakBytes() + 1023) / 1024));
+			if (options.profile)
+			{
+				PrintStages("stage", before, *profile->Get(), options.iterations);
+			}
+		}
+		catch (const std::exception& e)
+		{
+			std::fprintf(stderr, "%s: %s\n", path.c_str(), e.what());
+			++failures;
+		}
+	}
+
+	if (total.seconds > 0)
+	{
+		std::printf("total: %.2f MP in %.3f s, %.2f MP/s\n",
+			total.megapixels, total.seconds, total.megapixels / total.seconds);
+	}
+	if (options.profile)
+	{
+		PrintStages("all files,", WebPProfile(), *profile->Get(), options.iterations);
+	}
+	if (!options.tracePath.empty())
+	{
+		const std::string trace = profile->ChromeTrace();
+		FILE* file = std::fopen(options.tracePath.c_str(), "wb");
+		if (file == nullptr || std::fwrite(trace.data(), 1, trace.size(), file) != trace.size())
+		{
+			std::fprintf(stderr, "%s: cannot write the trace\n", options.tracePath.c_str());
+			++failures;
+		}
+		if (file != nullptr)
+		{
+			std::fclose(file);
+		}
+		if (profile->DroppedEvents() > 0)
+		{
+			std::fprintf(stderr, "trace: %llu stage runs past the first %zu were not recorded\n",
+				static_cast<unsigned long long>(profile->DroppedEvents()), kTraceEvents);
+		}
+	}
+	ReportPool();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,195 @@
+#include "AlphaBlend.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGELIB_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace ImageLib::WebP::Engine;
+
+namespace
+{
+	// (1 << 24) / alpha, indexed by the blended alpha of a non-premultiplied pixel.
+	struct ScaleTable
+	{
+		uint32_t values[256];
+
+		ScaleTable()
+		{
+			values[0] = 0;
+			for (uint32_t a = 1; a < 256; ++a)
+			{
+				values[a] = (1u << 24) / a;
+			}
+		}
+	};
+
+	const ScaleTable& Scales()
+	{
+		static const ScaleTable table;
+		return table;
+	}
+
+	inline uint8_t BlendChannelNonPremult(uint32_t src, uint8_t srcA, uint32_t dst, uint8_t dstA, uint32_t scale, int shift)
+	{
+		const uint8_t srcChannel = (src >> shift) & 0xff;
+		const uint8_t dstChannel = (dst >> shift) & 0xff;
+		const uint32_t blendUnscaled = srcChannel * srcA + dstChannel * dstA;
+		return static_cast<uint8_t>((blendUnscaled * scale) >> 24);
+	}
+
+	inline uint32_t BlendPixelNonPremult(uint32_t src, uint32_t dst)
+	{
+		const uint8_t srcA = (src >> 24) & 0xff;
+		if (srcA == 0)
+		{
+			return dst;
+		}
+		const uint8_t dstA = (dst >> 24) & 0xff;
+		// Approximates dstFactorA = (dstA * (255 - srcA)) / 255.
+		const uint8_t dstFactorA = (dstA * (256 - srcA)) >> 8;
+		const uint8_t blendA = srcA + dstFactorA;
+		const uint32_t scale = Scales().values[blendA];
+
+		const uint8_t blendR = BlendChannelNonPremult(src, srcA, dst, dstFactorA, scale, 0);
+		const uint8_t blendG = BlendChannelNonPremult(src, srcA, dst, dstFactorA, scale, 8);
+		const uint8_t blendB = BlendChannelNonPremult(src, srcA, dst, dstFactorA, scale, 16);
+		return (blendR << 0) | (blendG << 8) | (blendB << 16) | (static_cast<uint32_t>(blendA) << 24);
+	}
+
+	inline uint32_t ChannelwiseMultiply(uint32_t pix, uint32_t scale)
+	{
+		const uint32_t mask = 0x00FF00FF;
+		const uint32_t rb = ((pix & mask) * scale) >> 8;
+		const uint32_t ag = ((pix >> 8) & mask) * scale;
+		return (rb & mask) | (ag & ~mask);
+	}
+
+	inline uint32_t BlendPixelPremult(uint32_t src, uint32_t dst)
+	{
+		const uint8_t srcA = (src >> 24) & 0xff;
+		return src + ChannelwiseMultiply(dst, 256 - srcA);
+	}
+
+#if defined(IMAGELIB_USE_SSE2)
+	// Broadcasts the alpha word of each of the two pixels held in 16-bit lanes.
+	inline __m128i BroadcastAlpha16(__m128i pixels)
+	{
+		const __m128i lo = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+		return _mm_shufflehi_epi16(lo, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+
+	// Four premultiplied pixels at a time: dst = src + (dst * (256 - srcA)) >> 8,
+	// or src where it is opaque.
+	int BlendPixelRowPremultSSE2(const uint32_t* src, uint32_t* dst, int numPixels)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xff000000u));
+		const __m128i k256 = _mm_set1_epi16(256);
+		int i = 0;
+		for (; i + 4 <= numPixels; i += 4)
+		{
+			const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+			const __m128i opaque = _mm_cmpeq_epi32(_mm_and_si128(s, alphaMask), alphaMask);
+			const __m128i sLo = _mm_unpacklo_epi8(s, zero);
+			const __m128i sHi = _mm_unpackhi_epi8(s, zero);
+			const __m128i scaleLo = _mm_sub_epi16(k256, BroadcastAlpha16(sLo));
+			const __m128i scaleHi = _mm_sub_epi16(k256, BroadcastAlpha16(sHi));
+			const __m128i dLo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), scaleLo), 8);
+			const __m128i dHi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), scaleHi), 8);
+			const __m128i blended = _mm_add_epi8(s, _mm_packus_epi16(dLo, dHi));
+			const __m128i out = _mm_or_si128(_mm_and_si128(opaque, s), _mm_andnot_si128(opaque, blended));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+		}
+		return i;
+	}
+
+	// Low 32 bits of a 32x32-bit product, shifted right by 24. The product of
+	// each lane must fit in 32 bits.
+	inline __m128i MulShift24(__m128i a, __m128i b)
+	{
+		const __m128i even = _mm_srli_epi64(_mm_mul_epu32(a, b), 24);
+		const __m128i odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32)), 24);
+		return _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+	}
+
+	template <int shift>
+	inline __m128i BlendChannelNonPremultSSE2(__m128i s, __m128i srcA, __m128i d, __m128i dstA, __m128i scale)
+	{
+		const __m128i mask = _mm_set1_epi32(0xff);
+		const __m128i srcChannel = _mm_and_si128(_mm_srli_epi32(s, shift), mask);
+		const __m128i dstChannel = _mm_and_si128(_mm_srli_epi32(d, shift), mask);
+		// Both products fit in 16 bits, and the upper half of each 32-bit lane is zero.
+		const __m128i unscaled = _mm_add_epi32(_mm_mullo_epi16(srcChannel, srcA), _mm_mullo_epi16(dstChannel, dstA));
+		return _mm_slli_epi32(MulShift24(unscaled, scale), shift);
+	}
+
+	// Four non-premultiplied pixels at a time, bit-exact with BlendPixelNonPremult().
+	int BlendPixelRowNonPremultSSE2(const uint32_t* src, uint32_t* dst, int numPixels)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i k255 = _mm_set1_epi32(255);
+		const __m128i k256 = _mm_set1_epi32(256);
+		const uint32_t* scales = Scales().values;
+		int i = 0;
+		for (; i + 4 <= numPixels; i += 4)
+		{
+			const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+			const __m128i srcA = _mm_srli_epi32(s, 24);
+			const __m128i dstA = _mm_srli_epi32(d, 24);
+			const __m128i opaque = _mm_cmpeq_epi32(srcA, k255);
+			const __m128i transparent = _mm_cmpeq_epi32(srcA, zero);
+			if (_mm_movemask_epi8(_mm_or_si128(opaque, transparent)) == 0xffff)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_or_si128(_mm_and_si128(opaque, s), _mm_andnot_si128(opaque, d)));
+				continue;
+			}
+
+			const __m128i dstFactorA = _mm_srli_epi32(_mm_mullo_epi16(dstA, _mm_sub_epi32(k256, srcA)), 8);
+			const __m128i blendA = _mm_add_epi32(srcA, dstFactorA);
+			uint32_t alphas[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(alphas), blendA);
+			const __m128i scale = _mm_setr_epi32(
+				static_cast<int>(scales[alphas[0]]), static_cast<int>(scales[alphas[1]]),
+				static_cast<int>(scales[alphas[2]]), static_cast<int>(scales[alphas[3]]));
+
+			__m128i out = _mm_slli_epi32(blendA, 24);
+			out = _mm_or_si128(out, BlendChannelNonPremultSSE2<0>(s, srcA, d, dstFactorA, scale));
+			out = _mm_or_si128(out, BlendChannelNonPremultSSE2<8>(s, srcA, d, dstFactorA, scale));
+			out = _mm_or_si128(out, BlendChannelNonPremultSSE2<16>(s, srcA, d, dstFactorA, scale));
+			out = _mm_or_si128(_mm_andnot_si128(transparent, out), _mm_and_si128(transparent, d));
+			out = _mm_or_si128(_mm_andnot_si128(opaque, out), _mm_and_si128(opaque, s));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), out);
+		}
+		return i;
+	}
+#endif
+}
+
+void ImageLib::WebP::Engine::BlendPixelRowPremult(const uint32_t* src, uint32_t* dst, int numPixels)
+{
+	int i = 0;
+#if defined(IMAGELIB_USE_SSE2)
+	i = BlendPixelRowPremultSSE2(src, dst, numPixels);
+#endif
+	for (; i < numPixels; ++i)
+	{
+		const uint8_t srcAlpha = (src[i] >> 24) & 0xff;
+		dst[i] = (srcAlpha == 0xff) ? src[i] : BlendPixelPremult(src[i], dst[i]);
+	}
+}
+
+void ImageLib::WebP::Engine::BlendPixelRowNonPremult(const uint32_t* src, uint32_t* dst, int numPixels)
+{
+	int i = 0;
+#if defined(IMAGELIB_USE_SSE2)
+	i = BlendPixelRowNonPremultSSE2(src, dst, numPixels);
+#endif
+	for (; i < numPixels; ++i)
+	{
+		const uint8_t srcAlpha = (src[i] >> 24) & 0xff;
+		dst[i] = (srcAlpha == 0xff) ? src[i] : BlendPixelNonPremult(src[i], dst[i]);
+	}
+}
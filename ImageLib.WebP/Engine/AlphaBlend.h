@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			// Blends 'numPixels' of 'src' over 'dst' in place. Both rows hold 32-bit
+			// pixels with alpha in the top byte and are pre-multiplied by alpha.
+			// Matches BlendPixelRowPremult() in libwebp's demux/anim_decode.c.
+			void BlendPixelRowPremult(const uint32_t* src, uint32_t* dst, int numPixels);
+
+			// Same as BlendPixelRowPremult() for pixels NOT pre-multiplied by alpha.
+			// Matches BlendPixelRowNonPremult() in libwebp's demux/anim_decode.c.
+			void BlendPixelRowNonPremult(const uint32_t* src, uint32_t* dst, int numPixels);
+		}
+	}
+}
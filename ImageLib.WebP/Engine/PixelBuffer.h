@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			// Non-owning view over 32bpp premultiplied BGRA pixels.
+			struct PixelSurface
+			{
+				uint8_t* pixels;
+				int width;
+				int height;
+				int stride;
+
+				size_t Size() const
+				{
+					return static_cast<size_t>(stride) * height;
+				}
+
+				uint8_t* Row(int y) const
+				{
+					return pixels + static_cast<size_t>(stride) * y;
+				}
+			};
+
+			// Owning, tightly packed 32bpp premultiplied BGRA pixels.
+			class PixelBuffer
+			{
+			public:
+				PixelBuffer() :
+					width(0),
+					height(0) {
+				}
+
+				PixelBuffer(int width, int height) :
+					width(width),
+					height(height),
+					pixels(static_cast<size_t>(width) * height * 4) {
+				}
+
+				int Width() const { return width; }
+
+				int Height() const { return height; }
+
+				int Stride() const { return width * 4; }
+
+				uint8_t* Data() { return pixels.data(); }
+
+				const uint8_t* Data() const { return pixels.data(); }
+
+				size_t Size() const { return pixels.size(); }
+
+				PixelSurface Surface()
+				{
+					return PixelSurface{ pixels.data(), width, height, Stride() };
+				}
+
+				// Copies the top-left Width() x Height() pixels of 'source'.
+				static PixelBuffer CopyOf(const PixelSurface& source)
+				{
+					PixelBuffer buffer(source.width, source.height);
+					for (int y = 0; y < source.height; ++y)
+					{
+						std::memcpy(buffer.pixels.data() + static_cast<size_t>(buffer.Stride()) * y, source.Row(y), buffer.Stride());
+					}
+					return buffer;
+				}
+
+				// Copies the pixels into the top-left corner of 'target', which must be
+				// at least as large.
+				void CopyTo(const PixelSurface& target) const
+				{
+					for (int y = 0; y < height; ++y)
+					{
+						std::memcpy(target.Row(y), pixels.data() + static_cast<size_t>(Stride()) * y, Stride());
+					}
+				}
+
+			private:
+				int width;
+				int height;
+				std::vector<uint8_t> pixels;
+			};
+		}
+	}
+}
@@ -0,0 +1,140 @@
+#include "WebPBatchDecoder.h"
+
+#include <algorithm>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include "WebPContainer.h"
+
+using namespace ImageLib::WebP::Engine;
+
+namespace
+{
+	// Receives the output size and returns where to decode to.
+	typedef std::function<PixelSurface(int index, int width, int height)> TargetCallback;
+
+	typedef std::function<void(int index, const PixelSurface& target, const WebPFrameInfo& frame, std::exception_ptr error)> DoneCallback;
+
+	// Indices of 'items' by decreasing pixel count, from the headers alone.
+	std::vector<int> LargestFirst(const std::vector<BatchItem>& items)
+	{
+		std::vector<uint64_t> areas(items.size());
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			WebPBitstreamFeatures features;
+			if (WebPGetFeatures(items[i].data, items[i].size, &features) == VP8_STATUS_OK)
+			{
+				int width, height;
+				FitSize(features.width, features.height, items[i].maxWidth, items[i].maxHeight, &width, &height);
+				// Decoding time follows the source size more than the output size.
+				areas[i] = static_cast<uint64_t>(features.width) * features.height + static_cast<uint64_t>(width) * height;
+			}
+		}
+		std::vector<int> order(items.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&areas](int a, int b) { return areas[a] > areas[b]; });
+		return order;
+	}
+
+	void RunBatch(const std::vector<BatchItem>& items, const DecodeOptions& options, WebPThreadPool* pool, const TargetCallback& onTarget, const DoneCallback& onDone)
+	{
+		const std::vector<int> order = LargestFirst(items);
+		auto decodeOne = [&](int position)
+		{
+			const int index = order[position];
+			const BatchItem& item = items[index];
+			WebPFrameInfo frame = {};
+			PixelSurface target = {};
+			std::exception_ptr error;
+			try
+			{
+				if (!FindFirstFrame(item.data, item.size, &frame))
+				{
+					throw std::invalid_argument("Image has no frames");
+				}
+				DecodeOptions itemOptions = options;
+				FitSize(frame.width, frame.height, item.maxWidth, item.maxHeight, &itemOptions.scaledWidth, &itemOptions.scaledHeight);
+				target = onTarget(index, itemOptions.scaledWidth, itemOptions.scaledHeight);
+				DecodeFrame(frame, target, itemOptions);
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+			onDone(index, target, frame, error);
+		};
+
+		const int count = static_cast<int>(items.size());
+		if (pool == nullptr)
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				decodeOne(i);
+			}
+			return;
+		}
+		pool->ParallelFor(count, decodeOne);
+	}
+}
+
+std::vector<BatchResult> ImageLib::WebP::Engine::DecodeBatch(const std::vector<BatchItem>& items, const DecodeOptions& options, WebPThreadPool* pool)
+{
+	// Every image has its own slot, so the callbacks need no locking.
+	std::vector<BatchResult> results(items.size());
+	RunBatch(items, options, pool,
+		[&results](int index, int width, int height)
+		{
+			results[index].pixels = PixelBuffer(width, height);
+			return results[index].pixels.Surface();
+		},
+		[&results](int index, const PixelSurface&, const WebPFrameInfo& frame, std::exception_ptr error)
+		{
+			BatchResult& result = results[index];
+			result.width = frame.width;
+			result.height = frame.height;
+			result.error = error;
+			if (error)
+			{
+				result.pixels = PixelBuffer();
+			}
+		});
+	return results;
+}
+
+void ImageLib::WebP::Engine::DecodeBatch(const std::vector<BatchItem>& items, const DecodeOptions& options, const BatchCallback& onDecoded, WebPThreadPool* pool)
+{
+	// Buffers go back to 'spare' once their image has been handed over, so
+	// there are never more of them than decodes at once, and all of them are
+	// released with the batch.
+	std::mutex mutex;
+	std::vector<std::vector<uint8_t>> spare;
+	std::vector<std::vector<uint8_t>> inUse(items.size());
+	RunBatch(items, options, pool,
+		[&](int index, int width, int height)
+		{
+			std::vector<uint8_t>& scratch = inUse[index];
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (!spare.empty())
+				{
+					scratch = std::move(spare.back());
+					spare.pop_back();
+				}
+			}
+			const size_t size = static_cast<size_t>(width) * height * 4;
+			if (scratch.size() < size)
+			{
+				scratch.resize(size);
+			}
+			return PixelSurface{ scratch.data(), width, height, width * 4 };
+		},
+		[&](int index, const PixelSurface& target, const WebPFrameInfo&, std::exception_ptr error)
+		{
+			onDecoded(index, target, error);
+			if (!inUse[index].empty())
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				spare.push_back(std::move(inUse[index]));
+			}
+		});
+}
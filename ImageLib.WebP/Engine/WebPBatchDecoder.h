@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <vector>
+#include "PixelBuffer.h"
+#include "WebPFrameDecoder.h"
+#include "WebPThreadPool.h"
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			// One encoded image of a batch. The bytes are only read during the call.
+			struct BatchItem
+			{
+				const uint8_t* data;
+				size_t size;
+				// Bounds the output like FitSize(); 0 leaves a dimension free.
+				int maxWidth;
+				int maxHeight;
+			};
+
+			struct BatchResult
+			{
+				// The first frame at its output size; empty on failure.
+				PixelBuffer pixels;
+				// Natural size of the first frame.
+				int width = 0;
+				int height = 0;
+				std::exception_ptr error;
+			};
+
+			// Receives each image as it finishes, on the thread that decoded it.
+			// 'pixels' is scratch memory of the batch and is only valid during the
+			// call; 'error' is set instead if the image failed.
+			typedef std::function<void(int index, const PixelSurface& pixels, std::exception_ptr error)> BatchCallback;
+
+			// Decodes the first frame of every item on 'pool', largest first so that
+			// the long decodes do not end up last, with the calling thread helping.
+			// Without a pool everything runs on the calling thread. Results are in
+			// the order of 'items'.
+			std::vector<BatchResult> DecodeBatch(const std::vector<BatchItem>& items, const DecodeOptions& options = DecodeOptions(), WebPThreadPool* pool = WebPThreadPool::Installed());
+
+			// As above, but hands each image to 'onDecoded' as soon as it is done
+			// instead of keeping it. Decoding goes through scratch memory that is
+			// reused from one image to the next and released when the batch ends.
+			void DecodeBatch(const std::vector<BatchItem>& items, const DecodeOptions& options, const BatchCallback& onDecoded, WebPThreadPool* pool = WebPThreadPool::Installed());
+		}
+	}
+}
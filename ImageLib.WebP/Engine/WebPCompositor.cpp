@@ -0,0 +1,207 @@
+#include "WebPCompositor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "AlphaBlend.h"
+#include "WebPFrameDecoder.h"
+
+using namespace ImageLib::WebP::Engine;
+
+WebPCompositor::WebPCompositor(std::shared_ptr<WebPContainer> container, const DecodeOptions& options) :
+	container(std::move(container)),
+	decoderContext(std::make_unique<DecoderContext>()),
+	options(options),
+	currentFrame(-1)
+{
+	this->options.context = decoderContext.get();
+	int width, height;
+	CanvasSize(*this->container, options, &width, &height);
+	ownedCanvas = PixelBuffer(width, height);
+	canvas = ownedCanvas.Surface();
+}
+
+WebPCompositor::WebPCompositor(std::shared_ptr<WebPContainer> container, const PixelSurface& canvas, const DecodeOptions& options) :
+	container(std::move(container)),
+	canvas(canvas),
+	decoderContext(std::make_unique<DecoderContext>()),
+	options(options),
+	currentFrame(-1)
+{
+	this->options.context = decoderContext.get();
+	int width, height;
+	CanvasSize(*this->container, options, &width, &height);
+	if (canvas.width < width || canvas.height < height)
+	{
+		throw std::invalid_argument("Canvas is smaller than the animation");
+	}
+}
+
+const PixelSurface& WebPCompositor::RenderFrame(int index)
+{
+	if (index < 0 || index >= static_cast<int>(container->Frames().size()))
+	{
+		throw std::out_of_range("Frame index out of range");
+	}
+	// Frames before a key frame do not show through it, so start there.
+	const int keyFrame = container->KeyFrameFor(index);
+	if (index < currentFrame || keyFrame > currentFrame)
+	{
+		currentFrame = keyFrame - 1;
+	}
+	try
+	{
+		while (currentFrame < index)
+		{
+			ComposeNext();
+		}
+	}
+	catch (...)
+	{
+		Reset();
+		throw;
+	}
+	return canvas;
+}
+
+void WebPCompositor::Reset()
+{
+	currentFrame = -1;
+}
+
+void WebPCompositor::SetContainer(std::shared_ptr<WebPContainer> container)
+{
+	if (container == nullptr || container->Frames().size() < this->container->Frames().size())
+	{
+		throw std::invalid_argument("Container is not a later snapshot of the same file");
+	}
+	this->container = std::move(container);
+}
+
+void WebPCompositor::CanvasSize(const WebPContainer& container, const DecodeOptions& options, int* width, int* height)
+{
+	OutputSize(container.CanvasWidth(), container.CanvasHeight(), options, width, height);
+}
+
+void WebPCompositor::ComposeNext()
+{
+	const auto& frames = container->Frames();
+	const WebPFrameInfo& frame = frames[currentFrame + 1];
+	const WebPFrameInfo* previous = currentFrame >= 0 ? &frames[currentFrame] : nullptr;
+	const bool keyFrame = container->IsKeyFrame(currentFrame + 1);
+
+	if (previous != nullptr && previous->disposeToBackgroundColor)
+	{
+		const PixelSurface rect = CanvasRect(ScaledRect(*previous));
+		for (int y = 0; y < rect.height; ++y)
+		{
+			std::memset(rect.Row(y), 0, static_cast<size_t>(rect.width) * 4);
+		}
+	}
+
+	const Rect frameRect = ScaledRect(frame);
+	const PixelSurface target = CanvasRect(frameRect);
+	DecodeOptions frameOptions = options;
+	frameOptions.scaledWidth = frameRect.width;
+	frameOptions.scaledHeight = frameRect.height;
+	if (keyFrame || !frame.blendWithPreviousFrame || !frame.hasAlpha)
+	{
+		// Nothing underneath shows through: decode straight onto the canvas.
+		if (keyFrame && !IsFullFrame(frame))
+		{
+			for (int y = 0; y < canvas.height; ++y)
+			{
+				std::memset(canvas.Row(y), 0, static_cast<size_t>(canvas.width) * 4);
+			}
+		}
+		DecodeFrame(frame, target, frameOptions);
+	}
+	else
+	{
+		const size_t frameSize = static_cast<size_t>(frameRect.width) * frameRect.height * 4;
+		if (scratch.size() < frameSize)
+		{
+			scratch.resize(frameSize);
+		}
+		const PixelSurface decoded{ scratch.data(), frameRect.width, frameRect.height, frameRect.width * 4 };
+		DecodeFrame(frame, decoded, frameOptions);
+
+		// Pixels inside a rectangle that was just disposed to transparent are
+		// copied rather than blended, as WebPAnimDecoder does.
+		const bool disposed = previous != nullptr && previous->disposeToBackgroundColor;
+		const Rect disposedRect = disposed ? ScaledRect(*previous) : Rect{ 0, 0, 0, 0 };
+		const int frameRight = frameRect.x + frameRect.width;
+		for (int y = 0; y < frameRect.height; ++y)
+		{
+			const uint32_t* src = reinterpret_cast<const uint32_t*>(decoded.Row(y));
+			uint32_t* dst = reinterpret_cast<uint32_t*>(target.Row(y));
+			const int canvasY = frameRect.y + y;
+			int left = frameRight;
+			int right = frameRight;
+			if (disposed && canvasY >= disposedRect.y && canvasY < disposedRect.y + disposedRect.height)
+			{
+				left = std::max(frameRect.x, std::min(disposedRect.x, frameRight));
+				right = std::max(left, std::min(disposedRect.x + disposedRect.width, frameRight));
+			}
+			const int leftWidth = left - frameRect.x;
+			const int copyWidth = right - left;
+			const int rightWidth = frameRight - right;
+			BlendRow(src, dst, leftWidth);
+			std::memcpy(dst + leftWidth, src + leftWidth, static_cast<size_t>(copyWidth) * 4);
+			BlendRow(src + leftWidth + copyWidth, dst + leftWidth + copyWidth, rightWidth);
+		}
+	}
+
+	++currentFrame;
+}
+
+bool WebPCompositor::IsFullFrame(const WebPFrameInfo& frame) const
+{
+	return frame.width == container->CanvasWidth() && frame.height == container->CanvasHeight();
+}
+
+WebPCompositor::Rect WebPCompositor::ScaledRect(const WebPFrameInfo& frame) const
+{
+	const int canvasWidth = container->CanvasWidth();
+	const int canvasHeight = container->CanvasHeight();
+	int width, height;
+	CanvasSize(*container, options, &width, &height);
+	if (width == canvasWidth && height == canvasHeight)
+	{
+		return Rect{ frame.xOffset, frame.yOffset, frame.width, frame.height };
+	}
+
+	// Round both edges to the nearest scaled pixel so that adjacent frames
+	// still tile the canvas, and keep at least one pixel per frame.
+	auto scale = [](int value, int to, int from)
+	{
+		return static_cast<int>((static_cast<int64_t>(value) * to + from / 2) / from);
+	};
+	Rect rect;
+	rect.x = std::min(scale(frame.xOffset, width, canvasWidth), width - 1);
+	rect.y = std::min(scale(frame.yOffset, height, canvasHeight), height - 1);
+	rect.width = std::max(1, std::min(scale(frame.xOffset + frame.width, width, canvasWidth), width) - rect.x);
+	rect.height = std::max(1, std::min(scale(frame.yOffset + frame.height, height, canvasHeight), height) - rect.y);
+	return rect;
+}
+
+PixelSurface WebPCompositor::CanvasRect(const Rect& rect) const
+{
+	return PixelSurface{ canvas.Row(rect.y) + rect.x * 4, rect.width, rect.height, canvas.stride };
+}
+
+void WebPCompositor::BlendRow(const uint32_t* src, uint32_t* dst, int numPixels) const
+{
+	if (numPixels <= 0)
+	{
+		return;
+	}
+	if (WebPIsPremultipliedMode(options.colorspace))
+	{
+		BlendPixelRowPremult(src, dst, numPixels);
+	}
+	else
+	{
+		BlendPixelRowNonPremult(src, dst, numPixels);
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "PixelBuffer.h"
+#include "WebPContainer.h"
+#include "WebPFrameDecoder.h"
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			// Plays an animation onto a single reusable canvas. Each step decodes only
+			// the rectangle the frame covers and applies the previous frame's dispose
+			// method and the current frame's blend method in place, with the same
+			// results as libwebp's WebPAnimDecoder.
+			class WebPCompositor
+			{
+			public:
+				// Composites onto a canvas owned by the compositor. When 'options' asks
+				// for a scaled size, each frame is decoded straight to its share of the
+				// scaled canvas.
+				explicit WebPCompositor(std::shared_ptr<WebPContainer> container, const DecodeOptions& options = DecodeOptions());
+
+				// Composites onto 'canvas', which must be at least as large as the
+				// output canvas and outlive the compositor.
+				WebPCompositor(std::shared_ptr<WebPContainer> container, const PixelSurface& canvas, const DecodeOptions& options = DecodeOptions());
+
+				// Brings the canvas to frame 'index' and returns it. Composites from the
+				// current frame, or from the nearest key frame at or before 'index' when
+				// that is closer or the target lies behind. Throws std::out_of_range or
+				// std::runtime_error.
+				const PixelSurface& RenderFrame(int index);
+
+				// Forgets the composited state; the next frame starts from a clear canvas.
+				void Reset();
+
+				// Moves on to a later snapshot of the same file, as published by
+				// WebPStreamingDemuxer. Its frames extend the current ones, so the canvas
+				// stays valid.
+				void SetContainer(std::shared_ptr<WebPContainer> container);
+
+				const PixelSurface& Canvas() const { return canvas; }
+
+				// Index of the frame currently on the canvas, or -1.
+				int CurrentFrame() const { return currentFrame; }
+
+				const std::shared_ptr<WebPContainer>& Container() const { return container; }
+
+				// Size of the canvas that frames are composited onto.
+				static void CanvasSize(const WebPContainer& container, const DecodeOptions& options, int* width, int* height);
+
+			private:
+				struct Rect
+				{
+					int x;
+					int y;
+					int width;
+					int height;
+				};
+
+				void ComposeNext();
+				bool IsFullFrame(const WebPFrameInfo& frame) const;
+				Rect ScaledRect(const WebPFrameInfo& frame) const;
+				PixelSurface CanvasRect(const Rect& rect) const;
+				void BlendRow(const uint32_t* src, uint32_t* dst, int numPixels) const;
+
+				std::shared_ptr<WebPContainer> container;
+				PixelBuffer ownedCanvas;
+				PixelSurface canvas;
+				std::vector<uint8_t> scratch;
+				// Frames decode one after the other, so they share one context.
+				std::unique_ptr<DecoderContext> decoderContext;
+				DecodeOptions options;
+				int currentFrame;
+			};
+		}
+	}
+}
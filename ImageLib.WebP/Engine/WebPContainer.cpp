@@ -0,0 +1,258 @@
+#include "WebPContainer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace ImageLib::WebP::Engine;
+
+namespace
+{
+	typedef std::unique_ptr<WebPDemuxer, decltype(&WebPDemuxDelete)> DemuxerPtr;
+
+	DemuxerPtr Demux(const uint8_t* data, size_t size)
+	{
+		WebPData webPData;
+		webPData.bytes = data;
+		webPData.size = size;
+
+		auto spDemuxer = DemuxerPtr
+		{
+			WebPDemux(&webPData),
+			WebPDemuxDelete
+		};
+		if (!spDemuxer)
+		{
+			throw std::invalid_argument("Failed to create demuxer");
+		}
+		return spDemuxer;
+	}
+
+	// Demuxes as much of a file as has arrived; the demuxer is null while
+	// 'state' is still WEBP_DEMUX_PARSING_HEADER.
+	DemuxerPtr DemuxPartial(const uint8_t* data, size_t size, WebPDemuxState* state)
+	{
+		WebPData webPData;
+		webPData.bytes = data;
+		webPData.size = size;
+
+		auto spDemuxer = DemuxerPtr
+		{
+			WebPDemuxPartial(&webPData, state),
+			WebPDemuxDelete
+		};
+		if (*state == WEBP_DEMUX_PARSE_ERROR)
+		{
+			throw std::invalid_argument("Failed to create demuxer");
+		}
+		return spDemuxer;
+	}
+
+	bool IsFullFrame(const WebPFrameInfo& frame, int canvasWidth, int canvasHeight)
+	{
+		return frame.width == canvasWidth && frame.height == canvasHeight;
+	}
+}
+
+WebPContainer::WebPContainer() :
+	complete(false),
+	canvasWidth(0),
+	canvasHeight(0),
+	loopCount(0),
+	totalDuration(0),
+	backgroundColor(0)
+{
+}
+
+std::shared_ptr<WebPContainer> WebPContainer::Create(std::shared_ptr<WebPSource> source)
+{
+	if (source == nullptr)
+	{
+		throw std::invalid_argument("Source is null");
+	}
+	auto spDemuxer = Demux(source->Data(), source->Size());
+
+	std::shared_ptr<WebPContainer> container(new WebPContainer());
+	container->complete = true;
+	container->Read(spDemuxer.get(), *source, nullptr);
+	container->spDemuxer = std::make_shared<WebPDemuxerWrapper>(std::move(spDemuxer), std::move(source));
+	return container;
+}
+
+std::shared_ptr<WebPContainer> WebPContainer::CreatePartial(std::shared_ptr<WebPSource> source, const WebPContainer* previous)
+{
+	if (source == nullptr)
+	{
+		throw std::invalid_argument("Source is null");
+	}
+	WebPDemuxState state;
+	auto spDemuxer = DemuxPartial(source->Data(), source->Size(), &state);
+	if (state == WEBP_DEMUX_PARSING_HEADER)
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<WebPContainer> container(new WebPContainer());
+	container->complete = state == WEBP_DEMUX_DONE;
+	container->Read(spDemuxer.get(), *source, previous);
+	container->spDemuxer = std::make_shared<WebPDemuxerWrapper>(std::move(spDemuxer), std::move(source));
+	return container;
+}
+
+void WebPContainer::Read(WebPDemuxer* demuxer, const WebPSource& source, const WebPContainer* previous)
+{
+	canvasWidth = WebPDemuxGetI(demuxer, WEBP_FF_CANVAS_WIDTH);
+	canvasHeight = WebPDemuxGetI(demuxer, WEBP_FF_CANVAS_HEIGHT);
+	loopCount = WebPDemuxGetI(demuxer, WEBP_FF_LOOP_COUNT);
+	backgroundColor = WebPDemuxGetI(demuxer, WEBP_FF_BACKGROUND_COLOR);
+
+	// Frames that were complete before still are, at the same offsets; only
+	// the bytes they point into may have moved.
+	size_t firstNew = 0;
+	if (previous != nullptr)
+	{
+		const uint8_t* previousData = previous->spDemuxer->getSource()->Data();
+		frames = previous->frames;
+		for (auto& frame : frames)
+		{
+			frame.payload = source.Data() + (frame.payload - previousData);
+		}
+		frameEnds = previous->frameEnds;
+		keyFrames = previous->keyFrames;
+		firstNew = frames.size();
+	}
+
+	int durationMs = frameEnds.empty() ? 0 : frameEnds.back();
+	WebPIterator iter;
+	if (WebPDemuxGetFrame(demuxer, static_cast<int>(firstNew) + 1, &iter))
+	{
+		frames.reserve(iter.num_frames);
+		do
+		{
+			// A partial file ends with at most one incomplete frame.
+			if (!iter.complete)
+			{
+				break;
+			}
+			WebPFrameInfo frame;
+			ReadFrameInfo(iter, &frame);
+			durationMs += frame.duration;
+			frameEnds.push_back(durationMs);
+			frames.push_back(frame);
+		} while (WebPDemuxNextFrame(&iter));
+
+		WebPDemuxReleaseIterator(&iter);
+	}
+	totalDuration = durationMs;
+
+	// A frame is a key frame when nothing composited before it shows through,
+	// as in anim_decode.c's IsKeyFrame().
+	bool previousWasKeyFrame = firstNew > 0 && IsKeyFrame(static_cast<int>(firstNew) - 1);
+	for (size_t i = firstNew; i < frames.size(); ++i)
+	{
+		const WebPFrameInfo& frame = frames[i];
+		bool keyFrame = i == 0;
+		if (!keyFrame)
+		{
+			const WebPFrameInfo& previousFrame = frames[i - 1];
+			keyFrame = ((!frame.hasAlpha || !frame.blendWithPreviousFrame) && IsFullFrame(frame, canvasWidth, canvasHeight))
+				|| (previousFrame.disposeToBackgroundColor && (IsFullFrame(previousFrame, canvasWidth, canvasHeight) || previousWasKeyFrame));
+		}
+		if (keyFrame)
+		{
+			keyFrames.push_back(static_cast<int>(i));
+		}
+		previousWasKeyFrame = keyFrame;
+	}
+}
+
+std::shared_ptr<WebPContainer> WebPContainer::Create(std::vector<uint8_t>&& buffer)
+{
+	return Create(WebPSource::FromVector(std::move(buffer)));
+}
+
+bool WebPContainer::IsKeyFrame(int index) const
+{
+	return std::binary_search(keyFrames.begin(), keyFrames.end(), index);
+}
+
+int WebPContainer::KeyFrameFor(int index) const
+{
+	auto next = std::upper_bound(keyFrames.begin(), keyFrames.end(), index);
+	return next == keyFrames.begin() ? 0 : *(next - 1);
+}
+
+int WebPContainer::FrameAtTime(int timeMs) const
+{
+	if (frameEnds.empty())
+	{
+		return 0;
+	}
+	// The first frame that has not ended yet; zero-length frames never show.
+	auto end = std::upper_bound(frameEnds.begin(), frameEnds.end(), timeMs);
+	return static_cast<int>(std::min(end - frameEnds.begin(), static_cast<ptrdiff_t>(frameEnds.size()) - 1));
+}
+
+int WebPContainer::FrameStartTime(int index) const
+{
+	if (index < 0 || index >= static_cast<int>(frameEnds.size()))
+	{
+		throw std::out_of_range("Frame index out of range");
+	}
+	return frameEnds[index] - frames[index].duration;
+}
+
+void ImageLib::WebP::Engine::ReadFrameInfo(const WebPIterator& iter, WebPFrameInfo* frame)
+{
+	frame->frameNum = iter.frame_num;
+	frame->xOffset = iter.x_offset;
+	frame->yOffset = iter.y_offset;
+	frame->width = iter.width;
+	frame->height = iter.height;
+	frame->duration = iter.duration;
+	frame->disposeToBackgroundColor = iter.dispose_method == WEBP_MUX_DISPOSE_BACKGROUND;
+	frame->blendWithPreviousFrame = iter.blend_method == WEBP_MUX_BLEND;
+	frame->hasAlpha = iter.has_alpha != 0;
+	frame->payload = iter.fragment.bytes;
+	frame->payloadSize = iter.fragment.size;
+	ParseFrameHeader(frame->payload, frame->payloadSize, &frame->header);
+}
+
+bool ImageLib::WebP::Engine::FindFirstFrame(const uint8_t* data, size_t size, WebPFrameInfo* frame)
+{
+	WebPFrameHeader header;
+	if (ParseFrameHeader(data, size, &header) && StillFrameInfo(data, size, header, frame))
+	{
+		return true;
+	}
+	auto spDemuxer = Demux(data, size);
+
+	WebPIterator iter;
+	if (!WebPDemuxGetFrame(spDemuxer.get(), 1, &iter))
+	{
+		return false;
+	}
+	ReadFrameInfo(iter, frame);
+	WebPDemuxReleaseIterator(&iter);
+	return true;
+}
+
+bool ImageLib::WebP::Engine::StillFrameInfo(const uint8_t* data, size_t size, const WebPFrameHeader& header, WebPFrameInfo* frame)
+{
+	if (!header.valid || header.features.has_animation)
+	{
+		return false;
+	}
+	frame->frameNum = 1;
+	frame->xOffset = 0;
+	frame->yOffset = 0;
+	frame->width = header.features.width;
+	frame->height = header.features.height;
+	frame->duration = 0;
+	frame->disposeToBackgroundColor = false;
+	frame->blendWithPreviousFrame = false;
+	frame->hasAlpha = header.features.has_alpha != 0;
+	frame->payload = data;
+	frame->payloadSize = size;
+	frame->header = header;
+	return true;
+}
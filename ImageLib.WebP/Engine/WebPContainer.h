@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "WebPDemuxerWrapper.h"
+#include "WebPFrameHeader.h"
+#include "WebPSource.h"
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			// Placement, timing and payload of one frame as reported by the demuxer.
+			// 'payload' points into the source held by the container's demuxer.
+			struct WebPFrameInfo
+			{
+				int frameNum;
+				int xOffset;
+				int yOffset;
+				int width;
+				int height;
+				int duration;
+				bool disposeToBackgroundColor;
+				bool blendWithPreviousFrame;
+				bool hasAlpha;
+				const uint8_t* payload;
+				size_t payloadSize;
+				// Headers of 'payload', parsed while demuxing.
+				WebPFrameHeader header;
+			};
+
+			// A demuxed WebP file: canvas properties plus the metadata of every frame.
+			class WebPContainer
+			{
+			public:
+				// Demuxes 'source' in place and keeps it alive. Throws
+				// std::invalid_argument if it cannot be demuxed.
+				static std::shared_ptr<WebPContainer> Create(std::shared_ptr<WebPSource> source);
+
+				// Takes ownership of 'buffer' without copying it.
+				static std::shared_ptr<WebPContainer> Create(std::vector<uint8_t>&& buffer);
+
+				// Demuxes the start of a file that is still arriving, keeping only the
+				// frames that are complete. 'previous', an earlier snapshot of the same
+				// file, lends its frames so that only new ones are parsed. Returns
+				// nullptr while the file headers are incomplete. Throws
+				// std::invalid_argument if what has arrived cannot be demuxed.
+				static std::shared_ptr<WebPContainer> CreatePartial(std::shared_ptr<WebPSource> source, const WebPContainer* previous = nullptr);
+
+				// False for a partial container that more of the file may add frames to.
+				bool IsComplete() const { return complete; }
+
+				int CanvasWidth() const { return canvasWidth; }
+
+				int CanvasHeight() const { return canvasHeight; }
+
+				int LoopCount() const { return loopCount; }
+
+				int TotalDuration() const { return totalDuration; }
+
+				uint32_t BackgroundColor() const { return backgroundColor; }
+
+				const std::vector<WebPFrameInfo>& Frames() const { return frames; }
+
+				// Whether frame 'index' can be composited without the frames before it,
+				// by the same rules as WebPAnimDecoder.
+				bool IsKeyFrame(int index) const;
+
+				// Nearest key frame at or before frame 'index'.
+				int KeyFrameFor(int index) const;
+
+				// Frame on screen 'timeMs' into a loop. Times before the start map to the
+				// first frame and times past the end to the last one.
+				int FrameAtTime(int timeMs) const;
+
+				// Time frame 'index' appears, in milliseconds from the start of a loop.
+				int FrameStartTime(int index) const;
+
+				const std::shared_ptr<WebPDemuxerWrapper>& Demuxer() const { return spDemuxer; }
+
+			private:
+				WebPContainer();
+
+				// Reads the canvas and the complete frames from 'demuxer', over
+				// 'source', taking over the frames 'previous' already has.
+				void Read(WebPDemuxer* demuxer, const WebPSource& source, const WebPContainer* previous);
+
+				bool complete;
+				int canvasWidth;
+				int canvasHeight;
+				int loopCount;
+				int totalDuration;
+				uint32_t backgroundColor;
+				std::vector<WebPFrameInfo> frames;
+				// Indices of the key frames, ascending.
+				std::vector<int> keyFrames;
+				// Time each frame ends: the running sum of the durations.
+				std::vector<int> frameEnds;
+				std::shared_ptr<WebPDemuxerWrapper> spDemuxer;
+			};
+
+			// Fills 'frame' from the demuxer iterator and parses its headers.
+			void ReadFrameInfo(const WebPIterator& iter, WebPFrameInfo* frame);
+
+			// Locates the first frame of the WebP in 'data' without decoding it; the
+			// payload pointer borrows 'data'. Still images are not demuxed. Returns
+			// false if the file has no frames. Throws std::invalid_argument if it
+			// cannot be demuxed.
+			bool FindFirstFrame(const uint8_t* data, size_t size, WebPFrameInfo* frame);
+
+			// Describes the still image in 'data', whose headers are already parsed
+			// into 'header', as its only frame. Returns false for animations and
+			// invalid headers.
+			bool StillFrameInfo(const uint8_t* data, size_t size, const WebPFrameHeader& header, WebPFrameInfo* frame);
+		}
+	}
+}
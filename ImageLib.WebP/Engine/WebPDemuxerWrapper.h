@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include "../../libwebp/webp/demux.h"
+#include "WebPSource.h"
+
+class WebPDemuxerWrapper
+{
+
+public:
+	WebPDemuxerWrapper(
+		std::unique_ptr<WebPDemuxer, decltype(&WebPDemuxDelete)>&& pDemuxer,
+		std::shared_ptr<ImageLib::WebP::Engine::WebPSource> pSource) :
+		m_pDemuxer(std::move(pDemuxer)),
+		m_pSource(std::move(pSource)) {
+	}
+
+	virtual ~WebPDemuxerWrapper() {
+		//FBLOGD("Deleting Demuxer");
+	}
+
+	WebPDemuxer* get() {
+		return m_pDemuxer.get();
+	}
+
+	size_t getBufferSize() {
+		return m_pSource->Size();
+	}
+
+	const std::shared_ptr<ImageLib::WebP::Engine::WebPSource>& getSource() {
+		return m_pSource;
+	}
+
+private:
+	std::unique_ptr<WebPDemuxer, decltype(&WebPDemuxDelete)> m_pDemuxer;
+	// The demuxer and every frame payload point into this.
+	std::shared_ptr<ImageLib::WebP::Engine::WebPSource> m_pSource;
+};
@@ -0,0 +1,239 @@
+#include "WebPFrameDecoder.h"
+#include "WebPThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <new>
+#include <stdexcept>
+
+using namespace ImageLib::WebP::Engine;
+
+DecoderContext::DecoderContext() :
+	context(WebPNewDecoderContext())
+{
+	if (context == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+}
+
+DecoderContext::~DecoderContext()
+{
+	WebPDeleteDecoderContext(context);
+}
+
+MemoryAccount::MemoryAccount(uint64_t limit)
+{
+	WebPInitAllocator(&allocator);
+	allocator.limit = limit;
+}
+
+MemoryScope::MemoryScope(MemoryAccount* account) :
+	active(account != nullptr),
+	previous(active ? WebPSetThreadAllocator(account->Get()) : nullptr)
+{
+}
+
+MemoryScope::~MemoryScope()
+{
+	if (active)
+	{
+		WebPSetThreadAllocator(previous);
+	}
+}
+
+StageProfile::StageProfile(size_t maxEvents) :
+	events(maxEvents)
+{
+	Reset();
+}
+
+uint64_t StageProfile::TotalNanoseconds() const
+{
+	uint64_t total = 0;
+	for (int stage = 0; stage < WEBP_STAGE_COUNT; ++stage)
+	{
+		total += profile.nanoseconds[stage];
+	}
+	return total;
+}
+
+uint64_t StageProfile::DroppedEvents() const
+{
+	return profile.num_events > events.size() ? profile.num_events - events.size() : 0;
+}
+
+void StageProfile::Reset()
+{
+	WebPInitProfile(&profile);
+	profile.events = events.empty() ? nullptr : events.data();
+	profile.max_events = events.size();
+}
+
+std::string StageProfile::ChromeTrace() const
+{
+	const size_t count = std::min<uint64_t>(profile.num_events, events.size());
+	uint64_t origin = UINT64_MAX;
+	for (size_t i = 0; i < count; ++i)
+	{
+		origin = std::min(origin, events[i].start);
+	}
+
+	std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	char line[160];
+	for (size_t i = 0; i < count; ++i)
+	{
+		const WebPProfileEvent& event = events[i];
+		// Timestamps are in microseconds; keep the nanoseconds as decimals.
+		snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"cat\":\"libwebp\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			i > 0 ? "," : "", WebPProfileStageName(static_cast<int>(event.stage)), event.thread,
+			(event.start - origin) / 1000.0, event.duration / 1000.0);
+		json += line;
+	}
+	json += "\n]}\n";
+	return json;
+}
+
+ProfileScope::ProfileScope(StageProfile* profile) :
+	active(profile != nullptr),
+	previous(active ? WebPSetThreadProfile(profile->Get()) : nullptr)
+{
+}
+
+ProfileScope::~ProfileScope()
+{
+	if (active)
+	{
+		WebPSetThreadProfile(previous);
+	}
+}
+
+void ImageLib::WebP::Engine::OutputSize(int width, int height, const DecodeOptions& options, int* outWidth, int* outHeight)
+{
+	if (options.scaledWidth > 0 && options.scaledHeight > 0)
+	{
+		*outWidth = options.scaledWidth;
+		*outHeight = options.scaledHeight;
+	}
+	else if (options.preview)
+	{
+		*outWidth = (width + 3) / 4;
+		*outHeight = (height + 3) / 4;
+	}
+	else
+	{
+		*outWidth = width;
+		*outHeight = height;
+	}
+}
+
+void ImageLib::WebP::Engine::FitSize(int width, int height, int maxWidth, int maxHeight, int* outWidth, int* outHeight)
+{
+	*outWidth = width;
+	*outHeight = height;
+	if (width <= 0 || height <= 0)
+	{
+		return;
+	}
+	if (maxWidth > 0 && *outWidth > maxWidth)
+	{
+		*outWidth = maxWidth;
+		*outHeight = std::max(1, static_cast<int>((static_cast<int64_t>(height) * maxWidth + width / 2) / width));
+	}
+	if (maxHeight > 0 && *outHeight > maxHeight)
+	{
+		*outHeight = maxHeight;
+		*outWidth = std::max(1, static_cast<int>((static_cast<int64_t>(width) * maxHeight + height / 2) / height));
+	}
+}
+
+void ImageLib::WebP::Engine::ConfigureOutput(const PixelSurface& target, const DecodeOptions& options, WebPDecoderConfig* config)
+{
+	int width, height;
+	OutputSize(config->input.width, config->input.height, options, &width, &height);
+	if (width > target.width || height > target.height)
+	{
+		throw std::runtime_error("Target surface is smaller than the frame");
+	}
+
+	config->options.no_fancy_upsampling = !options.fancyUpsampling;
+	if (options.useThreads)
+	{
+		// With a pool, let the token partitions of lossy frames parse on all
+		// its workers.
+		WebPThreadPool* pool = WebPThreadPool::Installed();
+		config->options.use_threads = pool ? pool->Workers() + 1 : 1;
+	}
+	int naturalWidth = config->input.width;
+	int naturalHeight = config->input.height;
+	if (options.preview)
+	{
+		config->options.use_preview = 1;
+		naturalWidth = (naturalWidth + 3) / 4;
+		naturalHeight = (naturalHeight + 3) / 4;
+	}
+	if (width != naturalWidth || height != naturalHeight)
+	{
+		// Rescale while emitting rows instead of decoding at full size first.
+		config->options.use_scaling = 1;
+		config->options.scaled_width = width;
+		config->options.scaled_height = height;
+		config->options.use_reduced_scaling = options.reducedScaling;
+	}
+	config->output.colorspace = options.colorspace;
+	config->output.is_external_memory = 1;
+	config->output.u.RGBA.rgba = target.pixels;
+	config->output.u.RGBA.stride = target.stride;
+	// 'target' may be a sub-rectangle of a larger canvas, so only claim the
+	// bytes the decoder actually writes.
+	config->output.u.RGBA.size = static_cast<size_t>(target.stride) * (height - 1) + width * 4;
+}
+
+void ImageLib::WebP::Engine::DecodeFrame(const uint8_t* payload, size_t payloadSize, const PixelSurface& target, const DecodeOptions& options)
+{
+	DecodeFrame(payload, payloadSize, WebPFrameHeader(), target, options);
+}
+
+void ImageLib::WebP::Engine::DecodeFrame(const uint8_t* payload, size_t payloadSize, const WebPFrameHeader& header, const PixelSurface& target, const DecodeOptions& options)
+{
+	WebPDecoderConfig config;
+	int ret = WebPInitDecoderConfig(&config);
+	if (!ret)
+	{
+		throw std::runtime_error("WebPInitDecoderConfig failed");
+	}
+
+	ProfileScope profileScope(options.profile);
+	if (header.valid)
+	{
+		config.input = header.features;
+	}
+	else if (WebPGetFeatures(payload, payloadSize, &config.input) != VP8_STATUS_OK)
+	{
+		throw std::runtime_error("WebPGetFeatures failed");
+	}
+	ConfigureOutput(target, options, &config);
+
+	MemoryScope scope(options.memory);
+	const VP8StatusCode status = WebPDecodeWithContext(options.context ? options.context->Get() : nullptr, payload, payloadSize, &config);
+	if (status == VP8_STATUS_OUT_OF_MEMORY)
+	{
+		throw std::bad_alloc();
+	}
+	if (status != VP8_STATUS_OK)
+	{
+		throw std::runtime_error("Failed to decode frame");
+	}
+}
+
+void ImageLib::WebP::Engine::DecodeFrame(const WebPFrameInfo& frame, const PixelSurface& target, const DecodeOptions& options)
+{
+	DecodeFrame(frame.payload, frame.payloadSize, frame.header, target, options);
+}
+
+PixelBuffer ImageLib::WebP::Engine::DecodeFrame(const WebPFrameInfo& frame)
+{
+	PixelBuffer buffer(frame.width, frame.height);
+	DecodeFrame(frame, buffer.Surface());
+	return buffer;
+}
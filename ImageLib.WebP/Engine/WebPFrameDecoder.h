@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../../libwebp/webp/decode.h"
+#include "PixelBuffer.h"
+#include "WebPContainer.h"
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			// Owns a WebPDecoderContext: libwebp's decoder objects and scratch
+			// memory, kept from one decode to the next. Decodes sharing it must
+			// not overlap.
+			class DecoderContext
+			{
+			public:
+				// Throws std::bad_alloc.
+				DecoderContext();
+				~DecoderContext();
+				DecoderContext(const DecoderContext&) = delete;
+				DecoderContext& operator=(const DecoderContext&) = delete;
+
+				WebPDecoderContext* Get() const { return context; }
+
+			private:
+				WebPDecoderContext* context;
+			};
+
+			// Counts the memory libwebp allocates for the decodes it is handed to,
+			// and optionally caps it. Decodes on several threads may share one. It
+			// must outlive every decoder, context and buffer that allocated from it.
+			class MemoryAccount
+			{
+			public:
+				// Allows 'limit' bytes at any one time, or any amount if 0.
+				explicit MemoryAccount(uint64_t limit = 0);
+				MemoryAccount(const MemoryAccount&) = delete;
+				MemoryAccount& operator=(const MemoryAccount&) = delete;
+
+				// Exact once the decodes using the account have finished.
+				uint64_t CurrentBytes() const { return allocator.stats.current_bytes; }
+				uint64_t PeakBytes() const { return allocator.stats.peak_bytes; }
+				uint64_t Allocations() const { return allocator.stats.num_allocs; }
+				// Allocations refused because of the limit or by the system.
+				uint64_t Failures() const { return allocator.stats.num_failures; }
+
+				// Restarts the peak from the current usage.
+				void ResetPeak() { allocator.stats.peak_bytes = allocator.stats.current_bytes; }
+
+				// Replaces the limit given to the constructor. Decodes read it without
+				// synchronisation, so it should be set before any of them starts.
+				uint64_t Limit() const { return allocator.limit; }
+				void SetLimit(uint64_t limit) { allocator.limit = limit; }
+
+				WebPAllocator* Get() { return &allocator; }
+
+			private:
+				WebPAllocator allocator;
+			};
+
+			// Serves libwebp's allocations on the calling thread, and on the workers
+			// it launches, from 'account' until destroyed. Does nothing if null.
+			class MemoryScope
+			{
+			public:
+				explicit MemoryScope(MemoryAccount* account);
+				~MemoryScope();
+				MemoryScope(const MemoryScope&) = delete;
+				MemoryScope& operator=(const MemoryScope&) = delete;
+
+			private:
+				bool active;
+				WebPAllocator* previous;
+			};
+
+			// Times the stages libwebp goes through (headers, parsing, filtering,
+			// output...) for the decodes it is handed to, on every thread they use.
+			// Decodes on several threads may share one.
+			class StageProfile
+			{
+			public:
+				// Also records the first 'maxEvents' runs of a stage for ChromeTrace().
+				explicit StageProfile(size_t maxEvents = 0);
+				StageProfile(const StageProfile&) = delete;
+				StageProfile& operator=(const StageProfile&) = delete;
+
+				// Exact once the decodes using the profile have finished. A thread's
+				// time counts towards its innermost stage only.
+				uint64_t Nanoseconds(WebPProfileStage stage) const { return profile.nanoseconds[stage]; }
+				uint64_t Calls(WebPProfileStage stage) const { return profile.calls[stage]; }
+				uint64_t TotalNanoseconds() const;
+				// Runs that did not fit in the event buffer.
+				uint64_t DroppedEvents() const;
+
+				// Clears the counters and the recorded runs.
+				void Reset();
+
+				// The recorded runs as Chrome trace-event JSON, for chrome://tracing or
+				// Perfetto: one complete event per run, on one track per thread, with
+				// times relative to the first run.
+				std::string ChromeTrace() const;
+
+				WebPProfile* Get() { return &profile; }
+
+			private:
+				std::vector<WebPProfileEvent> events;
+				WebPProfile profile;
+			};
+
+			// Profiles libwebp's work on the calling thread, and on the workers it
+			// launches, into 'profile' until destroyed. Does nothing if null.
+			class ProfileScope
+			{
+			public:
+				explicit ProfileScope(StageProfile* profile);
+				~ProfileScope();
+				ProfileScope(const ProfileScope&) = delete;
+				ProfileScope& operator=(const ProfileScope&) = delete;
+
+			private:
+				bool active;
+				WebPProfile* previous;
+			};
+
+			struct DecodeOptions
+			{
+				// Must be one of the 32bpp RGBA/BGRA modes.
+				WEBP_CSP_MODE colorspace = MODE_bgrA;
+				// Off by default: playback trades chroma quality for speed.
+				bool fancyUpsampling = false;
+				// Lets libwebp hand in-loop filtering (lossy) or inverse transforms
+				// and output (lossless) to a WebPWorker; cheap once a WebPThreadPool
+				// is installed. With a pool, lossy frames also spread parsing and
+				// reconstruction over its workers.
+				bool useThreads = false;
+				// Output size for libwebp's built-in rescaler, or 0 to decode at the
+				// natural size. The compositor applies it to the whole canvas.
+				int scaledWidth = 0;
+				int scaledHeight = 0;
+				// Lets lossy frames be averaged down by 2 or 4 before the rescaler;
+				// see use_reduced_scaling. Off by default: parsing dominates small
+				// decodes, so this only saves a small part of them.
+				bool reducedScaling = false;
+				// Decodes a preview at a quarter of the width and height, rounded up,
+				// which the scaled size then applies to. Lossy images skip loop
+				// filtering and are averaged before upsampling and colour conversion.
+				bool preview = false;
+				// If set, the decode reuses its memory instead of allocating afresh.
+				DecoderContext* context = nullptr;
+				// If set, libwebp allocates from it, and a decode that would take it
+				// over its limit throws std::bad_alloc.
+				MemoryAccount* memory = nullptr;
+				// If set, the time the decode spends in each stage is added to it.
+				StageProfile* profile = nullptr;
+			};
+
+			// Size that 'width' x 'height' decodes to under 'options'.
+			void OutputSize(int width, int height, const DecodeOptions& options, int* outWidth, int* outHeight);
+
+			// Largest size with the aspect ratio of 'width' x 'height' that fits in
+			// 'maxWidth' x 'maxHeight' without upscaling. A bound of 0 leaves that
+			// dimension free, like BitmapImage.DecodePixelWidth/Height.
+			void FitSize(int width, int height, int maxWidth, int maxHeight, int* outWidth, int* outHeight);
+
+			// Points the output of 'config', whose 'input' features are already
+			// filled in, at 'target' and applies 'options' to it. Throws
+			// std::runtime_error if 'target' is too small.
+			void ConfigureOutput(const PixelSurface& target, const DecodeOptions& options, WebPDecoderConfig* config);
+
+			// Decodes a single-image payload (VP8/VP8L with optional ALPH) into
+			// 'target', which must be at least as large as the output size.
+			// Throws std::runtime_error on failure, or std::bad_alloc if libwebp
+			// runs out of memory.
+			void DecodeFrame(const uint8_t* payload, size_t payloadSize, const PixelSurface& target, const DecodeOptions& options = DecodeOptions());
+
+			// As above, with the headers of 'payload' already parsed; an invalid
+			// 'header' is parsed again.
+			void DecodeFrame(const uint8_t* payload, size_t payloadSize, const WebPFrameHeader& header, const PixelSurface& target, const DecodeOptions& options = DecodeOptions());
+
+			// Decodes 'frame' in isolation, ignoring its canvas offset.
+			void DecodeFrame(const WebPFrameInfo& frame, const PixelSurface& target, const DecodeOptions& options = DecodeOptions());
+
+			// Decodes 'frame' into a freshly allocated buffer of the frame's size.
+			PixelBuffer DecodeFrame(const WebPFrameInfo& frame);
+		}
+	}
+}
@@ -0,0 +1,111 @@
+#include "WebPFrameHeader.h"
+
+#include <cstring>
+#include <stdexcept>
+#include "../../libwebp/webp/format_constants.h"
+
+using namespace ImageLib::WebP::Engine;
+
+namespace
+{
+	uint32_t ReadLE24(const uint8_t* data)
+	{
+		return data[0] | (data[1] << 8) | (data[2] << 16);
+	}
+
+	uint32_t ReadLE32(const uint8_t* data)
+	{
+		return ReadLE24(data) | (static_cast<uint32_t>(data[3]) << 24);
+	}
+
+	bool IsTag(const uint8_t* data, const char* tag)
+	{
+		return !std::memcmp(data, tag, TAG_SIZE);
+	}
+
+	// Finds the ALPH and VP8/VP8L chunks. Returns false if the data ends first.
+	bool FindChunks(const uint8_t* data, size_t size, WebPFrameHeader* header)
+	{
+		size_t offset = 0;
+		if (size >= RIFF_HEADER_SIZE && IsTag(data, "RIFF") && IsTag(data + CHUNK_HEADER_SIZE, "WEBP"))
+		{
+			offset = RIFF_HEADER_SIZE;
+		}
+		while (offset + CHUNK_HEADER_SIZE <= size)
+		{
+			const uint8_t* chunk = data + offset;
+			const size_t chunkSize = ReadLE32(chunk + TAG_SIZE);
+			const size_t payload = offset + CHUNK_HEADER_SIZE;
+			if (chunkSize > size - payload)
+			{
+				return false;
+			}
+			if (IsTag(chunk, "ALPH"))
+			{
+				header->alphaOffset = payload;
+				header->alphaSize = chunkSize;
+			}
+			else if (IsTag(chunk, "VP8 ") || IsTag(chunk, "VP8L"))
+			{
+				header->bitstreamOffset = payload;
+				header->bitstreamSize = chunkSize;
+				header->lossless = IsTag(chunk, "VP8L");
+				return true;
+			}
+			offset = payload + chunkSize + (chunkSize & 1);
+		}
+		if (offset == 0 && size > 0)
+		{
+			// A bare bitstream without chunk headers.
+			header->bitstreamSize = size;
+			header->lossless = data[0] == VP8L_MAGIC_BYTE;
+			return true;
+		}
+		return false;
+	}
+}
+
+bool ImageLib::WebP::Engine::ParseFrameHeader(const uint8_t* data, size_t size, WebPFrameHeader* header)
+{
+	*header = WebPFrameHeader();
+	if (WebPGetFeatures(data, size, &header->features) != VP8_STATUS_OK)
+	{
+		return false;
+	}
+	if (header->features.has_animation)
+	{
+		header->valid = true;
+		return true;
+	}
+	if (!FindChunks(data, size, header))
+	{
+		return false;
+	}
+
+	if (!header->lossless)
+	{
+		if (header->bitstreamSize < VP8_FRAME_HEADER_SIZE)
+		{
+			return false;
+		}
+		const uint32_t bits = ReadLE24(data + header->bitstreamOffset);
+		header->vp8Profile = (bits >> 1) & 7;
+		header->firstPartitionSize = bits >> 5;
+	}
+	header->valid = true;
+	return true;
+}
+
+bool ImageLib::WebP::Engine::ProbeImage(const uint8_t* data, size_t size, WebPBitstreamFeatures* features)
+{
+	const VP8StatusCode status = WebPGetFeatures(data, size, features);
+	if (status == VP8_STATUS_NOT_ENOUGH_DATA)
+	{
+		return false;
+	}
+	if (status != VP8_STATUS_OK)
+	{
+		throw std::invalid_argument("Not a WebP image");
+	}
+	return true;
+}
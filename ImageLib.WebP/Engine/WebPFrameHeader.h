@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "../../libwebp/webp/decode.h"
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			// The headers of one image, parsed once so that every later decode of it
+			// can skip WebPGetFeatures(). Works on a whole still file as well as on a
+			// frame payload from the demuxer (ALPH + VP8, or VP8L).
+			struct WebPFrameHeader
+			{
+				// False if the headers could not be parsed; decoding then parses them
+				// itself and reports the error.
+				bool valid = false;
+				WebPBitstreamFeatures features = {};
+				// Offsets of the chunk payloads from the start of the data, with size
+				// 0 for a chunk that is absent.
+				size_t alphaOffset = 0;
+				size_t alphaSize = 0;
+				size_t bitstreamOffset = 0;
+				size_t bitstreamSize = 0;
+				bool lossless = false;
+				// VP8 frame header: profile and the size of the first partition,
+				// which holds the modes and is needed before any token partition.
+				int vp8Profile = 0;
+				uint32_t firstPartitionSize = 0;
+			};
+
+			// Parses the headers of 'data' without decoding pixels. Returns false if
+			// more data is needed or they are invalid. For an animation only
+			// 'features' is filled in; its frames have headers of their own.
+			bool ParseFrameHeader(const uint8_t* data, size_t size, WebPFrameHeader* header);
+
+			// Canvas size, alpha and animation flags of a WebP file, from its first
+			// chunks. Returns false if more data is needed; throws
+			// std::invalid_argument if the data is not WebP.
+			bool ProbeImage(const uint8_t* data, size_t size, WebPBitstreamFeatures* features);
+		}
+	}
+}
@@ -0,0 +1,217 @@
+#include "WebPFrameRing.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace ImageLib::WebP::Engine;
+
+namespace
+{
+	void CopySurface(const PixelSurface& src, const PixelSurface& dst)
+	{
+		const size_t rowSize = static_cast<size_t>(src.width) * 4;
+		for (int y = 0; y < src.height; ++y)
+		{
+			std::memcpy(dst.Row(y), src.Row(y), rowSize);
+		}
+	}
+}
+
+WebPFrameRing::WebPFrameRing(std::shared_ptr<WebPContainer> container, size_t budgetBytes, const DecodeOptions& options) :
+	container(container),
+	compositor(container, options),
+	currentSlot(-1),
+	nextIndex(0),
+	stopping(false)
+{
+	const int depth = DepthForBudget(*container, budgetBytes, options);
+	const PixelSurface& canvas = compositor.Canvas();
+	ownedSlots.reserve(depth);
+	for (int i = 0; i < depth; ++i)
+	{
+		ownedSlots.emplace_back(canvas.width, canvas.height);
+		slots.push_back(ownedSlots.back().Surface());
+	}
+}
+
+WebPFrameRing::WebPFrameRing(std::shared_ptr<WebPContainer> container, const std::vector<PixelSurface>& slots, const DecodeOptions& options) :
+	container(container),
+	compositor(container, options),
+	slots(slots),
+	currentSlot(-1),
+	nextIndex(0),
+	stopping(false)
+{
+	if (slots.size() < static_cast<size_t>(MinDepth))
+	{
+		throw std::invalid_argument("Frame ring needs at least two slots");
+	}
+	const PixelSurface& canvas = compositor.Canvas();
+	for (const auto& slot : slots)
+	{
+		if (slot.width < canvas.width || slot.height < canvas.height)
+		{
+			throw std::invalid_argument("Frame ring slot is smaller than the animation");
+		}
+	}
+}
+
+WebPFrameRing::~WebPFrameRing()
+{
+	Stop();
+}
+
+int WebPFrameRing::DepthForBudget(const WebPContainer& container, size_t budgetBytes, const DecodeOptions& options)
+{
+	int width, height;
+	WebPCompositor::CanvasSize(container, options, &width, &height);
+	const size_t slotSize = std::max<size_t>(1, static_cast<size_t>(width) * height * 4);
+	size_t depth = budgetBytes / slotSize;
+	if (container.IsComplete())
+	{
+		depth = std::min(depth, container.Frames().size() + 1);
+	}
+	return static_cast<int>(std::max(static_cast<size_t>(MinDepth), depth));
+}
+
+void WebPFrameRing::Start(int firstFrame)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		const int frameCount = static_cast<int>(container->Frames().size());
+		if (firstFrame < 0 || firstFrame > frameCount || (firstFrame == frameCount && container->IsComplete()))
+		{
+			throw std::out_of_range("Frame index out of range");
+		}
+	}
+	Stop();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	freeSlots.clear();
+	for (int i = 0; i < static_cast<int>(slots.size()); ++i)
+	{
+		// The slot on screen stays untouched until the next Advance().
+		if (i != currentSlot)
+		{
+			freeSlots.push_back(i);
+		}
+	}
+	error = nullptr;
+	nextIndex = firstFrame;
+	stopping = false;
+	worker = std::thread(&WebPFrameRing::Run, this);
+}
+
+void WebPFrameRing::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		ready.clear();
+	}
+	wake.notify_all();
+	if (worker.joinable())
+	{
+		worker.join();
+	}
+}
+
+void WebPFrameRing::Update(std::shared_ptr<WebPContainer> container)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (container == nullptr || container->Frames().size() < this->container->Frames().size())
+		{
+			throw std::invalid_argument("Container is not a later snapshot of the same file");
+		}
+		this->container = std::move(container);
+		// A decoder waiting past the last frame wraps around once there are no
+		// more to come.
+		if (this->container->IsComplete() && nextIndex >= static_cast<int>(this->container->Frames().size()))
+		{
+			nextIndex = 0;
+		}
+	}
+	wake.notify_all();
+}
+
+bool WebPFrameRing::Advance(Frame* frame)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (ready.empty())
+		{
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+			return false;
+		}
+		const ReadyFrame next = ready.front();
+		ready.pop_front();
+		if (currentSlot >= 0)
+		{
+			freeSlots.push_back(currentSlot);
+		}
+		currentSlot = next.slot;
+		frame->index = next.index;
+		frame->slot = next.slot;
+		frame->surface = &slots[next.slot];
+	}
+	wake.notify_one();
+	return true;
+}
+
+int WebPFrameRing::ReadyCount() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return static_cast<int>(ready.size());
+}
+
+void WebPFrameRing::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;)
+	{
+		wake.wait(lock, [this]
+		{
+			return stopping || (!freeSlots.empty() && nextIndex < static_cast<int>(container->Frames().size()));
+		});
+		if (stopping)
+		{
+			return;
+		}
+		const int slot = freeSlots.front();
+		freeSlots.pop_front();
+		const int index = nextIndex;
+		const int frameCount = static_cast<int>(container->Frames().size());
+		nextIndex = index + 1 < frameCount || !container->IsComplete() ? index + 1 : 0;
+		std::shared_ptr<WebPContainer> current = container;
+		lock.unlock();
+
+		try
+		{
+			if (compositor.Container() != current)
+			{
+				compositor.SetContainer(std::move(current));
+			}
+			CopySurface(compositor.RenderFrame(index), slots[slot]);
+		}
+		catch (...)
+		{
+			lock.lock();
+			error = std::current_exception();
+			freeSlots.push_front(slot);
+			return;
+		}
+
+		lock.lock();
+		if (stopping)
+		{
+			freeSlots.push_front(slot);
+			return;
+		}
+		ready.push_back(ReadyFrame{ index, slot });
+	}
+}
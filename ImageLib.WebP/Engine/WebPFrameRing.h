@@ -0,0 +1,102 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "PixelBuffer.h"
+#include "WebPCompositor.h"
+#include "WebPContainer.h"
+#include "WebPFrameDecoder.h"
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			// Composites the frames of an animation ahead of playback on a background
+			// thread, into a bounded ring of canvas-sized slots. The consumer takes
+			// frames with Advance(), which never decodes: it only hands over a slot
+			// that is already filled.
+			class WebPFrameRing
+			{
+			public:
+				struct Frame
+				{
+					int index;
+					int slot;
+					const PixelSurface* surface;
+				};
+
+				// One slot on screen plus at least one being decoded.
+				static const int MinDepth = 2;
+
+				// Owns as many canvas-sized slots as fit in 'budgetBytes'. The canvas
+				// size is the compositor's, so it follows any scaling in 'options'.
+				WebPFrameRing(std::shared_ptr<WebPContainer> container, size_t budgetBytes, const DecodeOptions& options = DecodeOptions());
+
+				// Fills the caller's slots, each at least canvas-sized; they must
+				// outlive the ring.
+				WebPFrameRing(std::shared_ptr<WebPContainer> container, const std::vector<PixelSurface>& slots, const DecodeOptions& options = DecodeOptions());
+
+				~WebPFrameRing();
+
+				// Number of canvas-sized slots that fit in 'budgetBytes', clamped to
+				// [MinDepth, frame count + 1] once the frame count is final.
+				static int DepthForBudget(const WebPContainer& container, size_t budgetBytes, const DecodeOptions& options = DecodeOptions());
+
+				// (Re)starts the background decoder at frame 'firstFrame'. Frames follow
+				// in playback order and wrap around to the first frame. While the
+				// container is partial, the decoder waits after its last frame for
+				// Update() instead, and may also start there.
+				void Start(int firstFrame);
+
+				// Moves on to a later snapshot of the same file, as published by
+				// WebPStreamingDemuxer, waking the decoder if it was waiting for frames.
+				void Update(std::shared_ptr<WebPContainer> container);
+
+				// Stops the background decoder and drops frames that were not consumed.
+				void Stop();
+
+				// If the next frame is ready, makes its slot current and recycles the
+				// previously current slot; returns false when the decoder is behind.
+				// Rethrows any error raised by the background decoder.
+				bool Advance(Frame* frame);
+
+				int Depth() const { return static_cast<int>(slots.size()); }
+
+				int ReadyCount() const;
+
+			private:
+				struct ReadyFrame
+				{
+					int index;
+					int slot;
+				};
+
+				void Run();
+
+				// Guarded by 'mutex'; the compositor follows it on the decoder thread.
+				std::shared_ptr<WebPContainer> container;
+				WebPCompositor compositor;
+				std::vector<PixelBuffer> ownedSlots;
+				std::vector<PixelSurface> slots;
+
+				mutable std::mutex mutex;
+				std::condition_variable wake;
+				std::deque<int> freeSlots;
+				std::deque<ReadyFrame> ready;
+				std::exception_ptr error;
+				int currentSlot;
+				int nextIndex;
+				bool stopping;
+				std::thread worker;
+			};
+		}
+	}
+}
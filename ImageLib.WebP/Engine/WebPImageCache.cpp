@@ -0,0 +1,312 @@
+#include "WebPImageCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+using namespace ImageLib::WebP::Engine;
+
+namespace
+{
+	// Budget of WebPImageCache::Shared() until the app sets one.
+	const size_t DefaultSharedBudget = 32 * 1024 * 1024;
+
+	const uint64_t Prime1 = 0x87c37b91114253d5ULL;
+	const uint64_t Prime2 = 0x4cf5ad432745937fULL;
+
+	uint64_t RotateLeft(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	uint64_t Finalize(uint64_t value)
+	{
+		value ^= value >> 33;
+		value *= 0xff51afd7ed558ccdULL;
+		value ^= value >> 33;
+		value *= 0xc4ceb9fe1a85ec53ULL;
+		value ^= value >> 33;
+		return value;
+	}
+}
+
+ContentHasher::ContentHasher() :
+	state(0x9e3779b97f4a7c15ULL),
+	length(0),
+	tailSize(0)
+{
+}
+
+void ContentHasher::Mix(const uint8_t* word)
+{
+	uint64_t value;
+	std::memcpy(&value, word, sizeof(value));
+	value *= Prime1;
+	value = RotateLeft(value, 31);
+	value *= Prime2;
+	state ^= value;
+	state = RotateLeft(state, 27) * 5 + 0x52dce729;
+}
+
+void ContentHasher::Update(const uint8_t* data, size_t size)
+{
+	length += size;
+	if (tailSize > 0)
+	{
+		const size_t take = std::min(size, sizeof(tail) - tailSize);
+		std::memcpy(tail + tailSize, data, take);
+		tailSize += take;
+		data += take;
+		size -= take;
+		if (tailSize < sizeof(tail))
+		{
+			return;
+		}
+		Mix(tail);
+		tailSize = 0;
+	}
+	for (; size >= sizeof(tail); data += sizeof(tail), size -= sizeof(tail))
+	{
+		Mix(data);
+	}
+	std::memcpy(tail, data, size);
+	tailSize = size;
+}
+
+uint64_t ContentHasher::Finish() const
+{
+	uint64_t last = 0;
+	for (size_t i = 0; i < tailSize; ++i)
+	{
+		last |= static_cast<uint64_t>(tail[i]) << (8 * i);
+	}
+	uint64_t result = state ^ (RotateLeft(last * Prime2, 33) * Prime1);
+	result ^= length;
+	return Finalize(result);
+}
+
+uint64_t ContentHasher::Hash(const uint8_t* data, size_t size)
+{
+	ContentHasher hasher;
+	hasher.Update(data, size);
+	return hasher.Finish();
+}
+
+size_t WebPImageCache::KeyHasher::operator()(const Key& key) const
+{
+	uint64_t value = key.contentHash;
+	value ^= (static_cast<uint64_t>(key.width) << 32 | static_cast<uint32_t>(key.height)) * Prime1;
+	value ^= static_cast<uint64_t>(key.colorspace) * Prime2;
+	return static_cast<size_t>(Finalize(value));
+}
+
+WebPImageCache::WebPImageCache(size_t budgetBytes, int shardCount) :
+	budget(budgetBytes),
+	used(0),
+	count(0),
+	hits(0),
+	misses(0),
+	insertions(0),
+	evictions(0),
+	rejections(0)
+{
+	shardCount = std::max(1, shardCount);
+	for (int i = 0; i < shardCount; ++i)
+	{
+		shards.emplace_back(new Shard());
+	}
+}
+
+WebPImageCache::~WebPImageCache()
+{
+}
+
+WebPImageCache::Shard& WebPImageCache::ShardOf(const Key& key)
+{
+	// The low bits pick the bucket inside the shard's table, so use high ones.
+	return *shards[(KeyHasher()(key) >> 40) % shards.size()];
+}
+
+void WebPImageCache::Touch(Shard& shard, const Key& key, Entry& entry)
+{
+	if (entry.order != shard.order.end())
+	{
+		shard.order.erase(entry.order);
+	}
+	const double priority = shard.inflation + entry.cost / static_cast<double>(entry.bytes);
+	entry.order = shard.order.emplace(priority, key);
+}
+
+std::shared_ptr<const PixelBuffer> WebPImageCache::Remove(Shard& shard, const Key& key)
+{
+	auto found = shard.entries.find(key);
+	if (found == shard.entries.end())
+	{
+		return nullptr;
+	}
+	std::shared_ptr<const PixelBuffer> pixels = std::move(found->second.pixels);
+	used.fetch_sub(found->second.bytes);
+	count.fetch_sub(1, std::memory_order_relaxed);
+	shard.order.erase(found->second.order);
+	shard.entries.erase(found);
+	return pixels;
+}
+
+std::shared_ptr<const PixelBuffer> WebPImageCache::Find(const Key& key)
+{
+	Shard& shard = ShardOf(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	auto found = shard.entries.find(key);
+	if (found == shard.entries.end())
+	{
+		misses.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	hits.fetch_add(1, std::memory_order_relaxed);
+	Touch(shard, key, found->second);
+	return found->second.pixels;
+}
+
+bool WebPImageCache::Insert(const Key& key, std::shared_ptr<const PixelBuffer> pixels, double cost)
+{
+	const size_t bytes = std::max<size_t>(1, pixels->Size());
+	Shard& shard = ShardOf(key);
+	std::shared_ptr<const PixelBuffer> replaced;
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		replaced = Remove(shard, key);
+	}
+	if (bytes > Budget() || !Reserve(bytes))
+	{
+		rejections.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	std::shared_ptr<const PixelBuffer> raced;
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	// Another thread may have stored the same key since it was removed above.
+	raced = Remove(shard, key);
+	Entry& entry = shard.entries[key];
+	entry.pixels = std::move(pixels);
+	entry.bytes = bytes;
+	entry.cost = std::max(0.0, cost);
+	entry.order = shard.order.end();
+	Touch(shard, key, entry);
+	count.fetch_add(1, std::memory_order_relaxed);
+	insertions.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void WebPImageCache::Erase(const Key& key)
+{
+	Shard& shard = ShardOf(key);
+	std::shared_ptr<const PixelBuffer> removed;
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	removed = Remove(shard, key);
+}
+
+void WebPImageCache::Clear()
+{
+	for (auto& shard : shards)
+	{
+		std::unordered_map<Key, Entry, KeyHasher> removed;
+		{
+			std::lock_guard<std::mutex> lock(shard->mutex);
+			for (const auto& entry : shard->entries)
+			{
+				used.fetch_sub(entry.second.bytes);
+				count.fetch_sub(1, std::memory_order_relaxed);
+			}
+			removed.swap(shard->entries);
+			shard->order.clear();
+			shard->inflation = 0;
+		}
+	}
+}
+
+void WebPImageCache::SetBudget(size_t budgetBytes)
+{
+	budget.store(budgetBytes);
+	while (used.load() > budgetBytes && EvictOne())
+	{
+	}
+}
+
+bool WebPImageCache::Reserve(size_t bytes)
+{
+	size_t current = used.load();
+	for (;;)
+	{
+		if (current + bytes <= Budget())
+		{
+			if (used.compare_exchange_weak(current, current + bytes))
+			{
+				return true;
+			}
+		}
+		else if (!EvictOne())
+		{
+			return false;
+		}
+		else
+		{
+			current = used.load();
+		}
+	}
+}
+
+bool WebPImageCache::EvictOne()
+{
+	for (;;)
+	{
+		// Only one shard is locked at a time; the choice may be stale by the
+		// time the victim's shard is locked, which only makes it approximate.
+		Shard* victim = nullptr;
+		double lowest = std::numeric_limits<double>::infinity();
+		for (auto& shard : shards)
+		{
+			std::lock_guard<std::mutex> lock(shard->mutex);
+			if (!shard->order.empty() && (victim == nullptr || shard->order.begin()->first < lowest))
+			{
+				victim = shard.get();
+				lowest = shard->order.begin()->first;
+			}
+		}
+		if (victim == nullptr)
+		{
+			return false;
+		}
+
+		std::shared_ptr<const PixelBuffer> evicted;
+		std::lock_guard<std::mutex> lock(victim->mutex);
+		if (victim->order.empty())
+		{
+			continue;
+		}
+		victim->inflation = victim->order.begin()->first;
+		const Key key = victim->order.begin()->second;
+		evicted = Remove(*victim, key);
+		evictions.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+}
+
+WebPImageCache::Stats WebPImageCache::GetStats() const
+{
+	Stats stats;
+	stats.budgetBytes = Budget();
+	stats.bytes = used.load();
+	stats.entries = count.load(std::memory_order_relaxed);
+	stats.hits = hits.load(std::memory_order_relaxed);
+	stats.misses = misses.load(std::memory_order_relaxed);
+	stats.insertions = insertions.load(std::memory_order_relaxed);
+	stats.evictions = evictions.load(std::memory_order_relaxed);
+	stats.rejections = rejections.load(std::memory_order_relaxed);
+	return stats;
+}
+
+WebPImageCache& WebPImageCache::Shared()
+{
+	static WebPImageCache cache(DefaultSharedBudget);
+	return cache;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "../../libwebp/webp/decode.h"
+#include "PixelBuffer.h"
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			// 64-bit hash of file contents, fed in any number of pieces. Not
+			// cryptographic; collisions are only as unlikely as for any 64-bit hash.
+			class ContentHasher
+			{
+			public:
+				ContentHasher();
+
+				void Update(const uint8_t* data, size_t size);
+
+				uint64_t Finish() const;
+
+				static uint64_t Hash(const uint8_t* data, size_t size);
+
+			private:
+				void Mix(const uint8_t* word);
+
+				uint64_t state;
+				uint64_t length;
+				uint8_t tail[8];
+				size_t tailSize;
+			};
+
+			// Decoded images kept in memory, bounded by a byte budget rather than an
+			// entry count. Entries are immutable and shared, so a caller can keep
+			// using pixels after they have been evicted.
+			//
+			// The table is split into shards with a lock each. Eviction follows
+			// GreedyDual-Size: an entry's priority is the cost of producing it per
+			// byte, plus the priority of the last entry evicted from its shard, so
+			// cheap large images go first and entries that are not used age out.
+			class WebPImageCache
+			{
+			public:
+				struct Key
+				{
+					uint64_t contentHash;
+					int width;
+					int height;
+					WEBP_CSP_MODE colorspace;
+
+					bool operator==(const Key& other) const
+					{
+						return contentHash == other.contentHash && width == other.width && height == other.height && colorspace == other.colorspace;
+					}
+				};
+
+				struct Stats
+				{
+					size_t budgetBytes;
+					size_t bytes;
+					size_t entries;
+					uint64_t hits;
+					uint64_t misses;
+					uint64_t insertions;
+					uint64_t evictions;
+					// Insertions refused because the entry alone exceeds the budget.
+					uint64_t rejections;
+				};
+
+				explicit WebPImageCache(size_t budgetBytes, int shards = 16);
+
+				~WebPImageCache();
+
+				// Returns the pixels stored under 'key', or nullptr.
+				std::shared_ptr<const PixelBuffer> Find(const Key& key);
+
+				// Stores 'pixels' under 'key', replacing any previous entry, and evicts
+				// until the cache is within budget again. 'cost' is what producing the
+				// pixels took, in any unit as long as it is the same for every entry
+				// (the decoders use microseconds). Returns false if the entry alone is
+				// larger than the budget.
+				bool Insert(const Key& key, std::shared_ptr<const PixelBuffer> pixels, double cost);
+
+				void Erase(const Key& key);
+
+				void Clear();
+
+				// Evicts as needed to fit a new budget; 0 turns the cache off.
+				void SetBudget(size_t budgetBytes);
+
+				size_t Budget() const { return budget.load(std::memory_order_relaxed); }
+
+				Stats GetStats() const;
+
+				// The process-wide cache used by WebPImage.
+				static WebPImageCache& Shared();
+
+			private:
+				struct KeyHasher
+				{
+					size_t operator()(const Key& key) const;
+				};
+
+				struct Entry
+				{
+					std::shared_ptr<const PixelBuffer> pixels;
+					size_t bytes;
+					double cost;
+					std::multimap<double, Key>::iterator order;
+				};
+
+				struct Shard
+				{
+					std::mutex mutex;
+					std::unordered_map<Key, Entry, KeyHasher> entries;
+					// Entries by priority, lowest first.
+					std::multimap<double, Key> order;
+					// Priority of the last entry evicted.
+					double inflation = 0;
+				};
+
+				WebPImageCache(const WebPImageCache&) = delete;
+				WebPImageCache& operator=(const WebPImageCache&) = delete;
+
+				Shard& ShardOf(const Key& key);
+
+				// Moves 'entry' to the back of the eviction order. Called with the
+				// shard locked.
+				static void Touch(Shard& shard, const Key& key, Entry& entry);
+
+				// Removes 'key' from 'shard' and returns its pixels so they are released
+				// after the lock. Called with the shard locked.
+				std::shared_ptr<const PixelBuffer> Remove(Shard& shard, const Key& key);
+
+				// Makes room for 'bytes' more, evicting as needed.
+				bool Reserve(size_t bytes);
+
+				// Evicts the entry with the lowest priority across all shards. Returns
+				// false when the cache is empty.
+				bool EvictOne();
+
+				std::vector<std::unique_ptr<Shard>> shards;
+				std::atomic<size_t> budget;
+				std::atomic<size_t> used;
+				std::atomic<size_t> count;
+				std::atomic<uint64_t> hits;
+				std::atomic<uint64_t> misses;
+				std::atomic<uint64_t> insertions;
+				std::atomic<uint64_t> evictions;
+				std::atomic<uint64_t> rejections;
+			};
+		}
+	}
+}
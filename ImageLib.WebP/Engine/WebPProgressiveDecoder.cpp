@@ -0,0 +1,148 @@
+#include "WebPProgressiveDecoder.h"
+
+#include <new>
+#include <stdexcept>
+
+using namespace ImageLib::WebP::Engine;
+
+WebPProgressiveDecoder::WebPProgressiveDecoder(TargetCallback onTarget, RowsCallback onRows, const ProgressiveOptions& options) :
+	onTarget(std::move(onTarget)),
+	onRows(std::move(onRows)),
+	options(options),
+	features(),
+	target(),
+	idec(nullptr, WebPIDelete),
+	hasHeader(false),
+	complete(false),
+	decodedRows(0),
+	publishedRows(0)
+{
+	if (!WebPInitDecoderConfig(&config))
+	{
+		throw std::runtime_error("WebPInitDecoderConfig failed");
+	}
+}
+
+WebPProgressiveDecoder::~WebPProgressiveDecoder()
+{
+}
+
+bool WebPProgressiveDecoder::Append(const uint8_t* data, size_t size)
+{
+	if (complete || IsAnimated() || size == 0)
+	{
+		return complete;
+	}
+	if (!hasHeader)
+	{
+		pending.insert(pending.end(), data, data + size);
+		if (!ParseHeader(pending.data(), pending.size()) || IsAnimated())
+		{
+			return false;
+		}
+		chunks.push_back(std::move(pending));
+		pending = std::vector<uint8_t>();
+	}
+	else
+	{
+		// Each chunk is copied once: libwebp's own copy, with WebPIAppend(),
+		// reallocates the whole pending input as it grows.
+		chunks.emplace_back(data, data + size);
+	}
+
+	VP8StatusCode status;
+	{
+		MemoryScope scope(options.decode.memory);
+		ProfileScope profileScope(options.decode.profile);
+		status = WebPIAppendSegment(idec.get(), chunks.back().data(), chunks.back().size());
+	}
+	if (status == VP8_STATUS_OUT_OF_MEMORY)
+	{
+		throw std::bad_alloc();
+	}
+	if (status != VP8_STATUS_OK && status != VP8_STATUS_SUSPENDED)
+	{
+		throw std::runtime_error("Failed to decode image");
+	}
+	complete = status == VP8_STATUS_OK;
+	if (complete)
+	{
+		decodedRows = target.height;
+		idec.reset();
+		chunks.clear();
+	}
+	else
+	{
+		int left, top, width, height;
+		if (WebPIDecodedArea(idec.get(), &left, &top, &width, &height) != nullptr)
+		{
+			decodedRows = height;
+		}
+	}
+	Publish(complete);
+	return complete;
+}
+
+bool WebPProgressiveDecoder::ParseHeader(const uint8_t* data, size_t size)
+{
+	const VP8StatusCode status = WebPGetFeatures(data, size, &features);
+	if (status == VP8_STATUS_NOT_ENOUGH_DATA)
+	{
+		return false;
+	}
+	if (status != VP8_STATUS_OK)
+	{
+		throw std::runtime_error("WebPGetFeatures failed");
+	}
+	hasHeader = true;
+	if (features.has_animation)
+	{
+		return true;
+	}
+
+	config.input = features;
+	DecodeOptions decode = options.decode;
+	decode.preview = false;    // not supported by the incremental decoder
+	FitSize(features.width, features.height, options.maxWidth, options.maxHeight, &decode.scaledWidth, &decode.scaledHeight);
+	target = onTarget(decode.scaledWidth, decode.scaledHeight);
+	ConfigureOutput(target, decode, &config);
+	target.width = decode.scaledWidth;
+	target.height = decode.scaledHeight;
+
+	// Parses nothing yet: the data is appended by the caller, from the
+	// chunks kept alive for the decoder.
+	{
+		MemoryScope scope(decode.memory);
+		ProfileScope profileScope(decode.profile);
+		idec.reset(WebPIDecode(nullptr, 0, &config));
+	}
+	if (!idec)
+	{
+		throw std::runtime_error("WebPIDecode failed");
+	}
+	lastPublished = Clock::now();
+	return true;
+}
+
+void WebPProgressiveDecoder::Publish(bool force)
+{
+	const int newRows = decodedRows - publishedRows;
+	if (newRows <= 0)
+	{
+		return;
+	}
+	const Clock::time_point now = Clock::now();
+	if (!force)
+	{
+		if (newRows < options.minRows || now - lastPublished < std::chrono::milliseconds(options.minIntervalMs))
+		{
+			return;
+		}
+	}
+	publishedRows = decodedRows;
+	lastPublished = now;
+	if (onRows)
+	{
+		onRows(target, decodedRows);
+	}
+}
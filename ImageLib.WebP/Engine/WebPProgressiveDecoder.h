@@ -0,0 +1,106 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "../../libwebp/webp/decode.h"
+#include "PixelBuffer.h"
+#include "WebPFrameDecoder.h"
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			struct ProgressiveOptions
+			{
+				DecodeOptions decode;
+				// Bounds the output like FitSize(); 0 leaves a dimension free. The
+				// scaled size in 'decode' is derived from these once the header arrives.
+				int maxWidth = 0;
+				int maxHeight = 0;
+				// Rows are published when at least 'minRows' new rows are ready and
+				// 'minIntervalMs' have passed since the previous publication. The
+				// last rows are always published.
+				int minRows = 16;
+				int minIntervalMs = 100;
+			};
+
+			// Decodes a still image while its bytes are still arriving, on top of
+			// libwebp's incremental decoder. Chunks are fed with Append() in file
+			// order; rows are decoded as soon as their data is complete and handed
+			// to the consumer at the cadence set in ProgressiveOptions.
+			//
+			// Animations are not supported by the incremental decoder: once the
+			// header shows one, IsAnimated() turns true and Append() stops decoding.
+			// They stream through WebPStreamingDemuxer instead.
+			class WebPProgressiveDecoder
+			{
+			public:
+				// Returns the surface to decode into, given the output size. Called
+				// once, when the header has arrived. The surface must outlive the
+				// decoder.
+				typedef std::function<PixelSurface(int width, int height)> TargetCallback;
+
+				// Receives the target surface and the number of rows from the top
+				// that are final.
+				typedef std::function<void(const PixelSurface& target, int rows)> RowsCallback;
+
+				WebPProgressiveDecoder(TargetCallback onTarget, RowsCallback onRows, const ProgressiveOptions& options = ProgressiveOptions());
+
+				~WebPProgressiveDecoder();
+
+				// Feeds the next 'size' bytes of the file. Returns true once the image
+				// is complete. Throws std::runtime_error on a malformed bitstream, or
+				// std::bad_alloc when out of memory.
+				bool Append(const uint8_t* data, size_t size);
+
+				bool HasHeader() const { return hasHeader; }
+
+				bool IsAnimated() const { return hasHeader && features.has_animation != 0; }
+
+				bool IsComplete() const { return complete; }
+
+				// Natural size of the image; valid once HasHeader().
+				int Width() const { return features.width; }
+
+				int Height() const { return features.height; }
+
+				// Number of rows from the top that are final.
+				int DecodedRows() const { return decodedRows; }
+
+			private:
+				typedef std::chrono::steady_clock Clock;
+
+				WebPProgressiveDecoder(const WebPProgressiveDecoder&) = delete;
+				WebPProgressiveDecoder& operator=(const WebPProgressiveDecoder&) = delete;
+
+				bool ParseHeader(const uint8_t* data, size_t size);
+				void Publish(bool force);
+
+				TargetCallback onTarget;
+				RowsCallback onRows;
+				ProgressiveOptions options;
+				WebPDecoderConfig config;
+				WebPBitstreamFeatures features;
+				PixelSurface target;
+				// The bytes fed to 'idec', which reads them in place until the image
+				// is complete. Declared first, so that they outlive it.
+				std::deque<std::vector<uint8_t>> chunks;
+				std::unique_ptr<WebPIDecoder, decltype(&WebPIDelete)> idec;
+				// Bytes received before the header was complete.
+				std::vector<uint8_t> pending;
+				bool hasHeader;
+				bool complete;
+				int decodedRows;
+				int publishedRows;
+				Clock::time_point lastPublished;
+			};
+		}
+	}
+}
@@ -0,0 +1,152 @@
+#include "WebPSource.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace ImageLib::WebP::Engine;
+
+namespace
+{
+	class VectorSource : public WebPSource
+	{
+	public:
+		explicit VectorSource(std::vector<uint8_t>&& buffer) :
+			buffer(std::move(buffer))
+		{
+			data = this->buffer.data();
+			size = this->buffer.size();
+		}
+
+	private:
+		std::vector<uint8_t> buffer;
+	};
+
+	class BorrowedSource : public WebPSource
+	{
+	public:
+		BorrowedSource(const uint8_t* data, size_t size, std::shared_ptr<void> owner) :
+			owner(std::move(owner))
+		{
+			this->data = data;
+			this->size = size;
+		}
+
+	private:
+		std::shared_ptr<void> owner;
+	};
+
+	class MappedSource : public WebPSource
+	{
+	public:
+#ifdef _WIN32
+		explicit MappedSource(const wchar_t* path)
+		{
+			HANDLE file = CreateFile2(path, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				throw std::runtime_error("Failed to open file");
+			}
+			FILE_STANDARD_INFO info;
+			if (!GetFileInformationByHandleEx(file, FileStandardInfo, &info, sizeof(info)))
+			{
+				CloseHandle(file);
+				throw std::runtime_error("Failed to query file size");
+			}
+			size = static_cast<size_t>(info.EndOfFile.QuadPart);
+			if (size > 0)
+			{
+				HANDLE mapping = CreateFileMappingFromApp(file, nullptr, PAGE_READONLY, 0, nullptr);
+				CloseHandle(file);
+				if (mapping == nullptr)
+				{
+					throw std::runtime_error("Failed to map file");
+				}
+				data = static_cast<const uint8_t*>(MapViewOfFileFromApp(mapping, FILE_MAP_READ, 0, 0));
+				CloseHandle(mapping);
+				if (data == nullptr)
+				{
+					throw std::runtime_error("Failed to map file");
+				}
+			}
+			else
+			{
+				CloseHandle(file);
+			}
+		}
+
+		~MappedSource()
+		{
+			if (data != nullptr)
+			{
+				UnmapViewOfFile(data);
+			}
+		}
+#else
+		explicit MappedSource(const char* path)
+		{
+			const int fd = open(path, O_RDONLY);
+			if (fd < 0)
+			{
+				throw std::runtime_error("Failed to open file");
+			}
+			struct stat info;
+			if (fstat(fd, &info) != 0)
+			{
+				close(fd);
+				throw std::runtime_error("Failed to query file size");
+			}
+			size = static_cast<size_t>(info.st_size);
+			if (size > 0)
+			{
+				void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+				close(fd);
+				if (view == MAP_FAILED)
+				{
+					throw std::runtime_error("Failed to map file");
+				}
+				data = static_cast<const uint8_t*>(view);
+			}
+			else
+			{
+				close(fd);
+			}
+		}
+
+		~MappedSource()
+		{
+			if (data != nullptr)
+			{
+				munmap(const_cast<uint8_t*>(data), size);
+			}
+		}
+#endif
+	};
+}
+
+std::shared_ptr<WebPSource> WebPSource::FromVector(std::vector<uint8_t>&& buffer)
+{
+	return std::make_shared<VectorSource>(std::move(buffer));
+}
+
+std::shared_ptr<WebPSource> WebPSource::Borrow(const uint8_t* data, size_t size, std::shared_ptr<void> owner)
+{
+	return std::make_shared<BorrowedSource>(data, size, std::move(owner));
+}
+
+#ifdef _WIN32
+std::shared_ptr<WebPSource> WebPSource::MapFile(const wchar_t* path)
+#else
+std::shared_ptr<WebPSource> WebPSource::MapFile(const char* path)
+#endif
+{
+	return std::make_shared<MappedSource>(path);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			// The encoded bytes of a WebP file. A container and every frame payload
+			// it hands out point into the source, so the source stays alive for as
+			// long as any of them does. Sources are created by one of the factories
+			// below, which make the ownership of the bytes explicit.
+			class WebPSource
+			{
+			public:
+				virtual ~WebPSource() {}
+
+				const uint8_t* Data() const { return data; }
+
+				size_t Size() const { return size; }
+
+				// Takes ownership of 'buffer' without copying it.
+				static std::shared_ptr<WebPSource> FromVector(std::vector<uint8_t>&& buffer);
+
+				// Borrows 'size' bytes at 'data' without copying them. 'owner' is
+				// released together with the source and is what keeps the bytes alive;
+				// pass nullptr only if the caller guarantees they outlive the source.
+				static std::shared_ptr<WebPSource> Borrow(const uint8_t* data, size_t size, std::shared_ptr<void> owner);
+
+				// Maps the file at 'path' read-only; the mapping lasts as long as the
+				// source. Throws std::runtime_error if the file cannot be mapped.
+#ifdef _WIN32
+				static std::shared_ptr<WebPSource> MapFile(const wchar_t* path);
+#else
+				static std::shared_ptr<WebPSource> MapFile(const char* path);
+#endif
+
+			protected:
+				WebPSource() : data(nullptr), size(0) {}
+
+				const uint8_t* data;
+				size_t size;
+
+			private:
+				WebPSource(const WebPSource&) = delete;
+				WebPSource& operator=(const WebPSource&) = delete;
+			};
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#include "WebPStreamingDemuxer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace ImageLib::WebP::Engine;
+
+namespace
+{
+	const size_t MinCapacity = 64 * 1024;
+	const char RiffTag[] = "RIFF";
+}
+
+WebPStreamingDemuxer::WebPStreamingDemuxer(size_t expectedSize) :
+	buffer(std::make_shared<std::vector<uint8_t>>(std::max(expectedSize, MinCapacity))),
+	received(0)
+{
+}
+
+bool WebPStreamingDemuxer::Append(const uint8_t* data, size_t size)
+{
+	if (size == 0 || IsComplete())
+	{
+		return false;
+	}
+	for (size_t i = received; i < 4 && i < received + size; ++i)
+	{
+		if (data[i - received] != static_cast<uint8_t>(RiffTag[i]))
+		{
+			throw std::invalid_argument("Streaming needs a WebP file with a RIFF header");
+		}
+	}
+
+	if (received + size > buffer->size())
+	{
+		// Snapshots point into the current buffer, so it is replaced rather than
+		// reallocated in place.
+		auto larger = std::make_shared<std::vector<uint8_t>>(std::max(received + size, buffer->size() * 2));
+		std::memcpy(larger->data(), buffer->data(), received);
+		buffer = std::move(larger);
+	}
+	std::memcpy(buffer->data() + received, data, size);
+	received += size;
+
+	auto next = WebPContainer::CreatePartial(WebPSource::Borrow(buffer->data(), received, buffer), container.get());
+	if (next == nullptr)
+	{
+		return false;
+	}
+	if (container != nullptr && next->Frames().size() == container->Frames().size() && next->IsComplete() == container->IsComplete())
+	{
+		return false;
+	}
+	container = std::move(next);
+	return true;
+}
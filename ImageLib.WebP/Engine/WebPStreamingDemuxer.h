@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "WebPContainer.h"
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			// Demuxes a WebP file while its bytes are still arriving, so that an
+			// animation can start playing from its first frames. Chunks are fed
+			// with Append() in file order; whenever that completes the headers or
+			// more frames, Container() is replaced by a new snapshot holding every
+			// frame complete so far.
+			//
+			// Received bytes never move once written: when the buffer fills up the
+			// bytes are copied to a larger one, and earlier snapshots keep the old
+			// buffer alive. A snapshot therefore stays valid, and can be used on
+			// other threads, while later chunks are appended. The demuxer itself is
+			// not thread-safe.
+			class WebPStreamingDemuxer
+			{
+			public:
+				// 'expectedSize' is the size of the whole file when known, such as the
+				// length of a download, so that it fits in one buffer; 0 if unknown.
+				explicit WebPStreamingDemuxer(size_t expectedSize = 0);
+
+				// Feeds the next 'size' bytes of the file. Returns true if Container()
+				// changed. Bytes past the end of the file are ignored. Throws
+				// std::invalid_argument if the data is not a WebP file with a RIFF
+				// header; a bare VP8/VP8L bitstream has no size to tell when it ends.
+				bool Append(const uint8_t* data, size_t size);
+
+				// The latest snapshot, or nullptr until the headers have arrived.
+				const std::shared_ptr<WebPContainer>& Container() const { return container; }
+
+				// Whether the whole file has arrived.
+				bool IsComplete() const { return container != nullptr && container->IsComplete(); }
+
+				size_t Received() const { return received; }
+
+			private:
+				WebPStreamingDemuxer(const WebPStreamingDemuxer&) = delete;
+				WebPStreamingDemuxer& operator=(const WebPStreamingDemuxer&) = delete;
+
+				// Sized to its capacity up front; only the first 'received' bytes
+				// are valid.
+				std::shared_ptr<std::vector<uint8_t>> buffer;
+				size_t received;
+				std::shared_ptr<WebPContainer> container;
+			};
+		}
+	}
+}
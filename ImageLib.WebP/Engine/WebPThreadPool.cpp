@@ -0,0 +1,446 @@
+#include "WebPThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <new>
+
+using namespace ImageLib::WebP::Engine;
+
+namespace
+{
+	// What a pooled WebPWorker keeps in 'impl_'.
+	struct PooledJob
+	{
+		std::atomic<bool> pending{ false };
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+
+	PooledJob* JobOf(WebPWorker* worker)
+	{
+		return static_cast<PooledJob*>(worker->impl_);
+	}
+
+	// One task of WebPThreadPool::ParallelFor, run as a WebPWorker hook.
+	struct ParallelTask
+	{
+		WebPWorker worker;
+		PooledJob job;
+		const std::function<void(int)>* task;
+		int index;
+		std::exception_ptr error;
+	};
+
+	int RunParallelTask(void* data1, void*)
+	{
+		ParallelTask* item = static_cast<ParallelTask*>(data1);
+		try
+		{
+			(*item->task)(item->index);
+		}
+		catch (...)
+		{
+			item->error = std::current_exception();
+		}
+		return 1;
+	}
+
+	const size_t QueueCapacity = 256;
+
+	// Guards installing and uninstalling the pool.
+	std::mutex installMutex;
+	std::unique_ptr<WebPThreadPool> installedPool;
+	WebPWorkerInterface previousInterface;
+	// WebPWorkers between Reset() and End(), whose 'impl_' belongs to the pool.
+	std::atomic<int> outstandingJobs{ 0 };
+
+	// WebPWorkerInterface over the installed pool, with the same state
+	// transitions as the default implementation in thread_utils.c.
+
+	void PoolInit(WebPWorker* const worker)
+	{
+		std::memset(worker, 0, sizeof(*worker));
+		worker->status_ = NOT_OK;
+	}
+
+	int PoolSync(WebPWorker* const worker)
+	{
+		if (worker->status_ == WORK)
+		{
+			installedPool->Wait(worker);
+			worker->status_ = OK;
+		}
+		return !worker->had_error;
+	}
+
+	int PoolReset(WebPWorker* const worker)
+	{
+		worker->had_error = 0;
+		if (worker->status_ < OK)
+		{
+			worker->impl_ = new (std::nothrow) PooledJob();
+			if (worker->impl_ == nullptr)
+			{
+				return 0;
+			}
+			outstandingJobs.fetch_add(1);
+			worker->status_ = OK;
+		}
+		else if (worker->status_ > OK)
+		{
+			return PoolSync(worker);
+		}
+		return 1;
+	}
+
+	void PoolExecute(WebPWorker* const worker)
+	{
+		if (worker->hook != nullptr)
+		{
+			worker->had_error |= !worker->hook(worker->data1, worker->data2);
+		}
+	}
+
+	void PoolLaunch(WebPWorker* const worker)
+	{
+		if (worker->impl_ == nullptr)
+		{
+			PoolExecute(worker);
+			return;
+		}
+		worker->status_ = WORK;
+		installedPool->Launch(worker);
+	}
+
+	void PoolEnd(WebPWorker* const worker)
+	{
+		if (worker->impl_ != nullptr)
+		{
+			PoolSync(worker);
+			delete JobOf(worker);
+			worker->impl_ = nullptr;
+			outstandingJobs.fetch_sub(1);
+		}
+		worker->status_ = NOT_OK;
+	}
+
+	const WebPWorkerInterface pooledInterface =
+	{
+		PoolInit, PoolReset, PoolSync, PoolLaunch, PoolExecute, PoolEnd
+	};
+
+	int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+WebPThreadPool::TaskQueue::TaskQueue(size_t capacity) :
+	cells(new Cell[capacity]),
+	mask(capacity - 1),
+	enqueuePos(0),
+	dequeuePos(0)
+{
+	for (size_t i = 0; i < capacity; ++i)
+	{
+		cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+bool WebPThreadPool::TaskQueue::TryPush(WebPWorker* worker)
+{
+	size_t pos = enqueuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Cell& cell = cells[pos & mask];
+		const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+		if (diff == 0)
+		{
+			if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				cell.worker = worker;
+				cell.sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0)
+		{
+			return false;
+		}
+		else
+		{
+			pos = enqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool WebPThreadPool::TaskQueue::TryPop(WebPWorker** worker)
+{
+	size_t pos = dequeuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Cell& cell = cells[pos & mask];
+		const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+		if (diff == 0)
+		{
+			if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				*worker = cell.worker;
+				cell.sequence.store(pos + mask + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if (diff < 0)
+		{
+			return false;
+		}
+		else
+		{
+			pos = dequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+WebPThreadPool::WebPThreadPool(int workers) :
+	nextQueue(0),
+	queued(0),
+	peakQueued(0),
+	sleepers(0),
+	tasksRun(0),
+	tasksStolen(0),
+	tasksHelped(0),
+	busyNanoseconds(0),
+	statsSince(Now()),
+	stopping(false)
+{
+	workers = std::max(1, workers);
+	for (int i = 0; i < workers; ++i)
+	{
+		queues.emplace_back(new TaskQueue(QueueCapacity));
+	}
+	for (int i = 0; i < workers; ++i)
+	{
+		threads.emplace_back(&WebPThreadPool::Run, this, i);
+	}
+}
+
+WebPThreadPool::~WebPThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+void WebPThreadPool::Launch(WebPWorker* worker)
+{
+	JobOf(worker)->pending.store(true, std::memory_order_relaxed);
+	// The hook allocates from the launching thread's allocator, and is
+	// profiled with it.
+	worker->allocator_ = WebPGetThreadAllocator();
+	worker->profile_ = WebPGetThreadProfile();
+
+	// Count the task before it becomes visible so that the depth never
+	// goes negative when it is popped straight away.
+	const int depth = queued.fetch_add(1) + 1;
+	int peak = peakQueued.load(std::memory_order_relaxed);
+	while (depth > peak && !peakQueued.compare_exchange_weak(peak, depth, std::memory_order_relaxed))
+	{
+	}
+
+	const size_t first = nextQueue.fetch_add(1, std::memory_order_relaxed);
+	bool pushed = false;
+	for (size_t i = 0; i < queues.size() && !pushed; ++i)
+	{
+		pushed = queues[(first + i) % queues.size()]->TryPush(worker);
+	}
+	if (!pushed)
+	{
+		// Every queue is full: run it here rather than block.
+		queued.fetch_sub(1);
+		Execute(worker);
+		return;
+	}
+
+	if (sleepers.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		wake.notify_one();
+	}
+}
+
+void WebPThreadPool::Wait(WebPWorker* worker)
+{
+	PooledJob* job = JobOf(worker);
+	WebPWorker* other;
+	bool stolen;
+	while (job->pending.load(std::memory_order_acquire) && TryPop(0, &other, &stolen))
+	{
+		tasksHelped.fetch_add(1, std::memory_order_relaxed);
+		Execute(other);
+	}
+
+	// Taking the lock also makes sure the thread that ran the hook has let
+	// go of the job before the caller may delete it.
+	std::unique_lock<std::mutex> lock(job->mutex);
+	job->done.wait(lock, [job] { return !job->pending.load(std::memory_order_acquire); });
+}
+
+void WebPThreadPool::ParallelFor(int count, const std::function<void(int)>& task)
+{
+	std::unique_ptr<ParallelTask[]> items(new ParallelTask[std::max(0, count)]);
+	for (int i = 0; i < count; ++i)
+	{
+		ParallelTask& item = items[i];
+		std::memset(&item.worker, 0, sizeof(item.worker));
+		item.worker.impl_ = &item.job;
+		item.worker.hook = RunParallelTask;
+		item.worker.data1 = &item;
+		item.task = &task;
+		item.index = i;
+		Launch(&item.worker);
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		Wait(&items[i].worker);
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		if (items[i].error)
+		{
+			std::rethrow_exception(items[i].error);
+		}
+	}
+}
+
+WebPThreadPool::Stats WebPThreadPool::GetStats() const
+{
+	Stats stats;
+	stats.workers = Workers();
+	stats.queueDepth = std::max(0, queued.load());
+	stats.peakQueueDepth = peakQueued.load(std::memory_order_relaxed);
+	stats.tasksRun = tasksRun.load(std::memory_order_relaxed);
+	stats.tasksStolen = tasksStolen.load(std::memory_order_relaxed);
+	stats.tasksHelped = tasksHelped.load(std::memory_order_relaxed);
+	const double elapsed = static_cast<double>(Now() - statsSince.load(std::memory_order_relaxed)) * stats.workers;
+	stats.utilization = elapsed > 0 ? busyNanoseconds.load(std::memory_order_relaxed) / elapsed : 0;
+	return stats;
+}
+
+void WebPThreadPool::ResetStats()
+{
+	peakQueued.store(std::max(0, queued.load()), std::memory_order_relaxed);
+	tasksRun.store(0, std::memory_order_relaxed);
+	tasksStolen.store(0, std::memory_order_relaxed);
+	tasksHelped.store(0, std::memory_order_relaxed);
+	busyNanoseconds.store(0, std::memory_order_relaxed);
+	statsSince.store(Now(), std::memory_order_relaxed);
+}
+
+int WebPThreadPool::DefaultWorkers()
+{
+	return std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+}
+
+void WebPThreadPool::Install(int workers)
+{
+	std::lock_guard<std::mutex> lock(installMutex);
+	if (installedPool != nullptr)
+	{
+		return;
+	}
+	previousInterface = *WebPGetWorkerInterface();
+	installedPool.reset(new WebPThreadPool(workers));
+	WebPSetWorkerInterface(&pooledInterface);
+}
+
+bool WebPThreadPool::Uninstall()
+{
+	std::lock_guard<std::mutex> lock(installMutex);
+	if (installedPool == nullptr)
+	{
+		return true;
+	}
+	// Those workers would otherwise end through the restored interface, which
+	// knows nothing of their jobs, or sync on a pool that is gone.
+	if (outstandingJobs.load() > 0)
+	{
+		return false;
+	}
+	WebPSetWorkerInterface(&previousInterface);
+	installedPool.reset();
+	return true;
+}
+
+WebPThreadPool* WebPThreadPool::Installed()
+{
+	std::lock_guard<std::mutex> lock(installMutex);
+	return installedPool.get();
+}
+
+void WebPThreadPool::Run(int self)
+{
+	for (;;)
+	{
+		WebPWorker* worker;
+		bool stolen;
+		if (TryPop(self, &worker, &stolen))
+		{
+			if (stolen)
+			{
+				tasksStolen.fetch_add(1, std::memory_order_relaxed);
+			}
+			const int64_t start = Now();
+			Execute(worker);
+			busyNanoseconds.fetch_add(static_cast<uint64_t>(Now() - start), std::memory_order_relaxed);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		sleepers.fetch_add(1);
+		wake.wait(lock, [this] { return stopping || queued.load() > 0; });
+		sleepers.fetch_sub(1);
+		if (stopping && queued.load() <= 0)
+		{
+			return;
+		}
+	}
+}
+
+bool WebPThreadPool::TryPop(int self, WebPWorker** worker, bool* stolen)
+{
+	const size_t count = queues.size();
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (queues[(self + i) % count]->TryPop(worker))
+		{
+			queued.fetch_sub(1);
+			*stolen = i != 0;
+			return true;
+		}
+	}
+	return false;
+}
+
+void WebPThreadPool::Execute(WebPWorker* worker)
+{
+	WebPAllocator* previous = WebPSetThreadAllocator(worker->allocator_);
+	WebPProfile* previousProfile = WebPSetThreadProfile(worker->profile_);
+	WebPGetWorkerInterface()->Execute(worker);
+	WebPSetThreadProfile(previousProfile);
+	WebPSetThreadAllocator(previous);
+	tasksRun.fetch_add(1, std::memory_order_relaxed);
+
+	PooledJob* job = JobOf(worker);
+	std::lock_guard<std::mutex> lock(job->mutex);
+	job->pending.store(false, std::memory_order_release);
+	job->done.notify_all();
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../../libwebp/utils/thread_utils.h"
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Engine
+		{
+			// A fixed set of threads that runs the hooks libwebp hands to its
+			// WebPWorkers, so concurrent decodes and encodes share threads instead of
+			// each starting their own. Launches go round-robin into per-thread
+			// lock-free queues; idle threads steal from the others, and a thread
+			// waiting in Sync() runs queued hooks until its own one has finished.
+			class WebPThreadPool
+			{
+			public:
+				struct Stats
+				{
+					int workers;
+					// Hooks launched but not started yet, now and at most.
+					int queueDepth;
+					int peakQueueDepth;
+					uint64_t tasksRun;
+					// Hooks a pool thread took from another thread's queue.
+					uint64_t tasksStolen;
+					// Hooks run by a thread waiting in Sync().
+					uint64_t tasksHelped;
+					// Share of the pool threads' time spent running hooks since the
+					// pool started or ResetStats() was called.
+					double utilization;
+				};
+
+				explicit WebPThreadPool(int workers);
+
+				~WebPThreadPool();
+
+				// Queues 'worker' to have its hook run.
+				void Launch(WebPWorker* worker);
+
+				// Returns once the hook of 'worker' has run.
+				void Wait(WebPWorker* worker);
+
+				// Runs task(0) ... task(count - 1) on the pool, launched in that order,
+				// with the calling thread helping until all have finished. Rethrows
+				// the first exception a task threw.
+				void ParallelFor(int count, const std::function<void(int)>& task);
+
+				int Workers() const { return static_cast<int>(threads.size()); }
+
+				Stats GetStats() const;
+
+				void ResetStats();
+
+				// One thread per core, less the one that launches the work.
+				static int DefaultWorkers();
+
+				// Creates the process-wide pool and routes every WebPWorker through it.
+				// Like WebPSetWorkerInterface() this must happen before any decoding or
+				// encoding starts. Does nothing if a pool is already installed.
+				static void Install(int workers = DefaultWorkers());
+
+				// Restores libwebp's thread-per-worker interface and stops the pool.
+				// No decoding or encoding may be in progress. Returns false, leaving
+				// the pool installed, while any WebPWorker still holds a job from it,
+				// such as one of an incremental decode that has not finished.
+				static bool Uninstall();
+
+				// The installed pool, or nullptr.
+				static WebPThreadPool* Installed();
+
+			private:
+				typedef std::chrono::steady_clock Clock;
+
+				// Bounded multi-producer multi-consumer queue (D. Vyukov's design).
+				class TaskQueue
+				{
+				public:
+					explicit TaskQueue(size_t capacity);
+
+					bool TryPush(WebPWorker* worker);
+
+					bool TryPop(WebPWorker** worker);
+
+				private:
+					struct Cell
+					{
+						std::atomic<size_t> sequence;
+						WebPWorker* worker;
+					};
+
+					std::unique_ptr<Cell[]> cells;
+					size_t mask;
+					// Keep the producer and consumer positions on separate cache lines.
+					char pad0[64];
+					std::atomic<size_t> enqueuePos;
+					char pad1[64];
+					std::atomic<size_t> dequeuePos;
+					char pad2[64];
+				};
+
+				WebPThreadPool(const WebPThreadPool&) = delete;
+				WebPThreadPool& operator=(const WebPThreadPool&) = delete;
+
+				void Run(int self);
+				bool TryPop(int self, WebPWorker** worker, bool* stolen);
+				void Execute(WebPWorker* worker);
+
+				std::vector<std::unique_ptr<TaskQueue>> queues;
+				std::vector<std::thread> threads;
+				std::atomic<size_t> nextQueue;
+				std::atomic<int> queued;
+				std::atomic<int> peakQueued;
+				std::atomic<int> sleepers;
+				std::atomic<uint64_t> tasksRun;
+				std::atomic<uint64_t> tasksStolen;
+				std::atomic<uint64_t> tasksHelped;
+				std::atomic<uint64_t> busyNanoseconds;
+				std::atomic<int64_t> statsSince;
+				std::mutex mutex;
+				std::condition_variable wake;
+				bool stopping;
+			};
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../../libwebp/dsp/dsp.h"
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Tests
+		{
+			// What libwebp detected before any test swapped it out.
+			const VP8CPUInfo systemCpuInfo = VP8GetCPUInfo;
+
+			inline int CpuInfoWithoutAVX2(CPUFeature feature)
+			{
+				return feature != kAVX2 && systemCpuInfo != nullptr && systemCpuInfo(feature);
+			}
+
+			// Replaces the CPU detection libwebp dispatches on for the lifetime of the
+			// object. Its DSP setup notices the change and picks functions again on
+			// the next decode; nullptr leaves only the plain-C code.
+			class CpuInfoOverride
+			{
+			public:
+				explicit CpuInfoOverride(VP8CPUInfo cpuInfo) : previous(VP8GetCPUInfo)
+				{
+					VP8GetCPUInfo = cpuInfo;
+				}
+
+				~CpuInfoOverride()
+				{
+					VP8GetCPUInfo = previous;
+				}
+
+				CpuInfoOverride(const CpuInfoOverride&) = delete;
+				CpuInfoOverride& operator=(const CpuInfoOverride&) = delete;
+
+			private:
+				VP8CPUInfo previous;
+			};
+		}
+	}
+}
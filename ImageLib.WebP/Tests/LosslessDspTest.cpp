@@ -0,0 +1,130 @@
+// Checks libwebp's SIMD code for lossless frames, AVX2 included, against its
+// plain-C code, kernel by kernel.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../../libwebp/dec/vp8li_dec.h"
+#include "../../libwebp/dsp/lossless.h"
+#include "CpuInfoOverride.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// The VP8L transforms and output conversions that have SIMD versions, as
+	// set up by VP8LDspInit() for one CPU.
+	struct LosslessKernels
+	{
+		VP8LPredictorAddSubFunc predictorsAdd[14];
+		VP8LProcessDecBlueAndRedFunc addGreen;
+		VP8LTransformColorInverseFunc colorInverse;
+		VP8LColorIndexInverseTransformFunc colorIndex;
+		VP8LConvertFunc convert[5];
+	};
+
+	const char* const convertNames[5] = { "RGB", "RGBA", "RGBA4444", "RGB565", "BGR" };
+
+	LosslessKernels GetLosslessKernels(VP8CPUInfo cpuInfo)
+	{
+		CpuInfoOverride cpu(cpuInfo);
+		VP8LDspInit();
+		LosslessKernels kernels = {};
+		std::copy(VP8LPredictorsAdd, VP8LPredictorsAdd + 14, kernels.predictorsAdd);
+		kernels.addGreen = VP8LAddGreenToBlueAndRed;
+		kernels.colorInverse = VP8LTransformColorInverse;
+		// Looks up through VP8LMapColor32b, so that has to be the one for this
+		// CPU too while it runs.
+		kernels.colorIndex = VP8LColorIndexInverseTransform;
+		kernels.convert[0] = VP8LConvertBGRAToRGB;
+		kernels.convert[1] = VP8LConvertBGRAToRGBA;
+		kernels.convert[2] = VP8LConvertBGRAToRGBA4444;
+		kernels.convert[3] = VP8LConvertBGRAToRGB565;
+		kernels.convert[4] = VP8LConvertBGRAToBGR;
+		return kernels;
+	}
+
+	// Runs the plain-C and the selected SIMD kernels of lossless.c on the same
+	// random rows, with lengths around the tile widths they are called with.
+	// The color-indexing transform runs for every pixel bundling, both into a
+	// separate buffer and unpacking in place.
+	void TestKernels()
+	{
+		const LosslessKernels reference = GetLosslessKernels(nullptr);
+		const LosslessKernels simd = GetLosslessKernels(systemCpuInfo);
+		std::mt19937 random(12345);
+		auto uniform = [&random](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(random); };
+		auto pixel = [&random]() { return static_cast<uint32_t>(random()); };
+
+		// Calls 'run' with the reference kernels then the SIMD ones and
+		// compares what they wrote; 'run' starts from the same buffer each time.
+		std::vector<uint32_t> input(1024), expected, actual;
+		auto same = [&](auto run)
+		{
+			expected = input;
+			actual = input;
+			run(expected.data(), reference);
+			run(actual.data(), simd);
+			return expected == actual;
+		};
+
+		for (int trial = 0; trial < 2000; ++trial)
+		{
+			for (auto& value : input)
+			{
+				value = pixel();
+			}
+			const int count = uniform(0, 3) ? uniform(1, 40) : uniform(1, 300);
+			// Upper row at 8, residuals at 320, output at 640 with out[-1] set.
+			for (int k = 0; k < 14; ++k)
+			{
+				Expect(same([&](uint32_t* p, const LosslessKernels& kernels) { kernels.predictorsAdd[k](p + 320, p + 8, count, p + 640); }),
+					"predictor %d differs on %d pixels in trial %d", k, count, trial);
+			}
+			Expect(same([&](uint32_t* p, const LosslessKernels& kernels) { kernels.addGreen(p, count, p + 320); }),
+				"add-green differs on %d pixels in trial %d", count, trial);
+			const VP8LMultipliers multipliers = { static_cast<uint8_t>(pixel()), static_cast<uint8_t>(pixel()), static_cast<uint8_t>(pixel()) };
+			Expect(same([&](uint32_t* p, const LosslessKernels& kernels) { kernels.colorInverse(&multipliers, p, count, p + 320); }),
+				"the color transform differs on %d pixels in trial %d", count, trial);
+
+			// The color map is as long as the decoder makes it.
+			const int bits = uniform(0, 3);
+			std::vector<uint32_t> colorMap(static_cast<size_t>(1) << (8 >> bits));
+			for (auto& color : colorMap)
+			{
+				color = pixel();
+			}
+			VP8LTransform transform = {};
+			transform.type_ = COLOR_INDEXING_TRANSFORM;
+			transform.bits_ = bits;
+			transform.xsize_ = uniform(1, 70);
+			transform.ysize_ = uniform(1, 4);
+			transform.data_ = colorMap.data();
+			const int packed = ((transform.xsize_ + (1 << bits) - 1) >> bits) * transform.ysize_;
+			const int unpacked = transform.xsize_ * transform.ysize_;
+			const bool inPlace = uniform(0, 1) != 0;
+			Expect(same([&](uint32_t* p, const LosslessKernels& kernels)
+				{
+					CpuInfoOverride cpu(&kernels == &reference ? nullptr : systemCpuInfo);
+					VP8LDspInit();
+					kernels.colorIndex(&transform, 0, transform.ysize_, inPlace ? p + unpacked - packed : p + 512, p);
+				}), "color indexing with %d bits per pixel differs on %dx%d pixels%s in trial %d", 8 >> bits,
+				transform.xsize_, transform.ysize_, inPlace ? " in place" : "", trial);
+
+			for (int k = 0; k < 5; ++k)
+			{
+				Expect(same([&](uint32_t* p, const LosslessKernels& kernels) { kernels.convert[k](p, count, reinterpret_cast<uint8_t*>(p + 320)); }),
+					"the conversion to %s differs on %d pixels in trial %d", convertNames[k], count, trial);
+			}
+		}
+	}
+}
+
+int main()
+{
+	std::vector<TestCase> tests;
+	tests.push_back(TestCase{ "kernels", TestKernels });
+	return RunTests(tests);
+}
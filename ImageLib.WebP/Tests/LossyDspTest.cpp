@@ -0,0 +1,144 @@
+// Checks libwebp's SIMD code for lossy frames, AVX2 included, against its
+// plain-C code, kernel by kernel and through whole decodes.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../../libwebp/dsp/dsp.h"
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "CpuInfoOverride.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// The VP8 reconstruction kernels that have SIMD versions, as set up by
+	// VP8DspInit() for one CPU.
+	struct DspKernels
+	{
+		VP8LumaFilterFunc luma[4];
+		VP8ChromaFilterFunc chroma[4];
+		VP8SimpleFilterFunc simple[4];
+		VP8DecIdct transformUV;
+		VP8PredFunc trueMotion16;
+		VP8PredFunc trueMotion8;
+	};
+
+	const char* const filterNames[4] = { "VFilter", "HFilter", "VFilter (inner)", "HFilter (inner)" };
+
+	DspKernels GetDspKernels(VP8CPUInfo cpuInfo)
+	{
+		CpuInfoOverride cpu(cpuInfo);
+		VP8DspInit();
+		return DspKernels{
+			{ VP8VFilter16, VP8HFilter16, VP8VFilter16i, VP8HFilter16i },
+			{ VP8VFilter8, VP8HFilter8, VP8VFilter8i, VP8HFilter8i },
+			{ VP8SimpleVFilter16, VP8SimpleHFilter16, VP8SimpleVFilter16i, VP8SimpleHFilter16i },
+			VP8TransformUV, VP8PredLuma16[1], VP8PredChroma8[1] };
+	}
+
+	// Runs the plain-C and the selected SIMD kernels on the same random edges
+	// and blocks. Noise of varying strength around a random level exercises
+	// both sides of every filter threshold as well as the clipping.
+	void TestKernels()
+	{
+		const DspKernels reference = GetDspKernels(nullptr);
+		const DspKernels simd = GetDspKernels(systemCpuInfo);
+		std::mt19937 random(12345);
+		auto uniform = [&random](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(random); };
+
+		const int stride = 32;
+		std::vector<uint8_t> input(stride * 40), expected, actual;
+		auto fill = [&]()
+		{
+			const int level = uniform(0, 255);
+			const int noise = uniform(0, 3) ? uniform(0, 12) : 255;
+			for (auto& pixel : input)
+			{
+				pixel = static_cast<uint8_t>(std::min(255, std::max(0, level + uniform(-noise, noise))));
+			}
+		};
+		// Calls 'run' on a copy of the input for each implementation, the
+		// reference one first, and compares the whole buffers.
+		auto same = [&](auto run)
+		{
+			expected = input;
+			actual = input;
+			run(expected.data(), reference);
+			run(actual.data(), simd);
+			return expected == actual;
+		};
+
+		const int edge = 8 * stride + 8;
+		for (int trial = 0; trial < 2000; ++trial)
+		{
+			fill();
+			const int thresh = uniform(0, 200), ithresh = uniform(0, 63), hevThresh = uniform(0, 3);
+			for (int k = 0; k < 4; ++k)
+			{
+				Expect(same([&](uint8_t* p, const DspKernels& kernels) { kernels.luma[k](p + edge, stride, thresh, ithresh, hevThresh); }),
+					"luma %s differs in trial %d", filterNames[k], trial);
+				Expect(same([&](uint8_t* p, const DspKernels& kernels)
+					{
+						kernels.chroma[k](p + edge, p + edge + 16 * stride, stride, thresh, ithresh, hevThresh);
+					}), "chroma %s differs in trial %d", filterNames[k], trial);
+				Expect(same([&](uint8_t* p, const DspKernels& kernels) { kernels.simple[k](p + edge, stride, thresh); }),
+					"simple %s differs in trial %d", filterNames[k], trial);
+			}
+
+			int16_t coeffs[4 * 16];
+			for (auto& coeff : coeffs)
+			{
+				coeff = static_cast<int16_t>(uniform(0, 1) ? uniform(-2048, 2047) : 0);
+			}
+			Expect(same([&](uint8_t* p, const DspKernels& kernels) { kernels.transformUV(coeffs, p + BPS); }),
+				"the chroma transform differs in trial %d", trial);
+			Expect(same([&](uint8_t* p, const DspKernels& kernels) { kernels.trueMotion16(p + BPS + 8); }),
+				"the 16x16 TrueMotion predictor differs in trial %d", trial);
+			Expect(same([&](uint8_t* p, const DspKernels& kernels) { kernels.trueMotion8(p + BPS + 8); }),
+				"the 8x8 TrueMotion predictor differs in trial %d", trial);
+		}
+	}
+
+	// Decodes every frame with the plain-C code, with SIMD up to SSE4.1 and
+	// with everything the CPU has, both with and without fancy upsampling.
+	void TestDecodes(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const auto& frames = container->Frames();
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			for (bool fancy : { false, true })
+			{
+				DecodeOptions options;
+				options.fancyUpsampling = fancy;
+				auto decode = [&](VP8CPUInfo cpuInfo)
+				{
+					CpuInfoOverride cpu(cpuInfo);
+					PixelBuffer pixels(frames[i].width, frames[i].height);
+					DecodeFrame(frames[i], pixels.Surface(), options);
+					return pixels;
+				};
+				PixelBuffer expected = decode(nullptr);
+				PixelBuffer withoutAVX2 = decode(CpuInfoWithoutAVX2);
+				PixelBuffer all = decode(systemCpuInfo);
+				const char* upsampling = fancy ? "fancy" : "simple";
+				ExpectSamePixels(withoutAVX2.Surface(), expected.Surface(), Format("frame %zu up to SSE4.1, %s upsampling", i, upsampling));
+				ExpectSamePixels(all.Surface(), expected.Surface(), Format("frame %zu with every SIMD extension, %s upsampling", i, upsampling));
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	tests.push_back(TestCase{ "kernels", TestKernels });
+	AddPerImage(&tests, "decodes", images, TestDecodes);
+	return RunTests(tests);
+}
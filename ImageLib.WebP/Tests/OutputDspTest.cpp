@@ -0,0 +1,199 @@
+// Checks libwebp's SIMD colour conversion, upsampling, premultiplication and
+// rescaling, AVX2 included, against its plain-C code.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../../libwebp/dsp/dsp.h"
+#include "../../libwebp/utils/rescaler_utils.h"
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "CpuInfoOverride.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// The 32-bit output modes the engine decodes to.
+	const WEBP_CSP_MODE outputModes[] = { MODE_RGBA, MODE_BGRA, MODE_ARGB, MODE_rgbA, MODE_bgrA, MODE_Argb };
+
+	const char* const modeNames[] = { "RGBA", "BGRA", "ARGB", "rgbA", "bgrA", "Argb" };
+
+	// The YUV conversion and alpha kernels that have SIMD versions, as set up
+	// for one CPU.
+	struct OutputKernels
+	{
+		WebPUpsampleLinePairFunc upsamplers[6];
+		WebPSamplerRowFunc samplers[6];
+		WebPYUV444Converter yuv444[6];
+		void (*applyAlphaMultiply)(uint8_t*, int, int, int, int);
+		int (*dispatchAlpha)(const uint8_t*, int, int, int, uint8_t*, int);
+		void (*multARGBRow)(uint32_t* const, int, int);
+		void (*multRow)(uint8_t* const, const uint8_t* const, int, int);
+	};
+
+	OutputKernels GetOutputKernels(VP8CPUInfo cpuInfo)
+	{
+		CpuInfoOverride cpu(cpuInfo);
+		WebPInitUpsamplers();
+		WebPInitSamplers();
+		WebPInitYUV444Converters();
+		WebPInitAlphaProcessing();
+		OutputKernels kernels = {};
+		for (int k = 0; k < 6; ++k)
+		{
+			kernels.upsamplers[k] = WebPUpsamplers[outputModes[k]];
+			kernels.samplers[k] = WebPSamplers[outputModes[k]];
+			kernels.yuv444[k] = WebPYUV444Converters[outputModes[k]];
+		}
+		kernels.applyAlphaMultiply = WebPApplyAlphaMultiply;
+		kernels.dispatchAlpha = WebPDispatchAlpha;
+		kernels.multARGBRow = WebPMultARGBRow;
+		kernels.multRow = WebPMultRow;
+		return kernels;
+	}
+
+	// Runs the plain-C and the selected SIMD YUV->RGB and premultiplication
+	// kernels on the same random rows. The alpha values are sometimes all
+	// opaque, as they are in most images.
+	void TestKernels()
+	{
+		const OutputKernels reference = GetOutputKernels(nullptr);
+		const OutputKernels simd = GetOutputKernels(systemCpuInfo);
+		std::mt19937 random(12345);
+		auto uniform = [&random](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(random); };
+
+		std::vector<uint8_t> input(8192), expected, actual;
+		auto same = [&](auto run)
+		{
+			expected = input;
+			actual = input;
+			run(expected.data(), reference);
+			run(actual.data(), simd);
+			return expected == actual;
+		};
+
+		for (int trial = 0; trial < 2000; ++trial)
+		{
+			const bool opaque = uniform(0, 3) == 0;
+			for (auto& value : input)
+			{
+				value = static_cast<uint8_t>(opaque ? 0xff : uniform(0, 255));
+			}
+			if (opaque)
+			{
+				// Only the alpha values need to be opaque.
+				std::generate(input.begin(), input.begin() + 1280, [&] { return static_cast<uint8_t>(uniform(0, 255)); });
+			}
+			const int len = uniform(0, 3) ? uniform(1, 40) : uniform(1, 300);
+			const bool bottom = uniform(0, 1) != 0;
+			// Y rows at 0 and 320, U/V rows at 640..1120, output from 1280.
+			for (int k = 0; k < 6; ++k)
+			{
+				Expect(same([&](uint8_t* p, const OutputKernels& kernels)
+					{
+						kernels.upsamplers[k](p, bottom ? p + 320 : nullptr, p + 640, p + 800, p + 960, p + 1120, p + 1280, p + 2560, len);
+					}), "the %s upsampler differs on %d pixels in trial %d", modeNames[k], len, trial);
+				Expect(same([&](uint8_t* p, const OutputKernels& kernels) { kernels.samplers[k](p, p + 640, p + 800, p + 1280, len); }),
+					"the %s sampler differs on %d pixels in trial %d", modeNames[k], len, trial);
+				Expect(same([&](uint8_t* p, const OutputKernels& kernels) { kernels.yuv444[k](p, p + 320, p + 640, p + 1280, len); }),
+					"the %s YUV444 converter differs on %d pixels in trial %d", modeNames[k], len, trial);
+			}
+
+			const int rows = uniform(1, 3);
+			const int stride = 4 * len + uniform(0, 8);
+			const int alphaFirst = uniform(0, 1);
+			Expect(same([&](uint8_t* p, const OutputKernels& kernels) { kernels.applyAlphaMultiply(p + 1280, alphaFirst, len, rows, stride); }),
+				"alpha premultiply differs on %dx%d pixels in trial %d", len, rows, trial);
+			const int offset = uniform(0, 3);
+			Expect(same([&](uint8_t* p, const OutputKernels& kernels)
+				{
+					p[0] = static_cast<uint8_t>(kernels.dispatchAlpha(p + 1280, len + 8, len, rows, p + 4096 + offset, stride));
+				}), "alpha dispatch differs on %dx%d pixels in trial %d", len, rows, trial);
+			const int inverse = uniform(0, 1);
+			Expect(same([&](uint8_t* p, const OutputKernels& kernels) { kernels.multARGBRow(reinterpret_cast<uint32_t*>(p + 4096), len, inverse); }),
+				"the ARGB row multiply differs on %d pixels in trial %d", len, trial);
+			Expect(same([&](uint8_t* p, const OutputKernels& kernels) { kernels.multRow(p + 4096, p + 1280, len, inverse); }),
+				"the row multiply differs on %d pixels in trial %d", len, trial);
+		}
+	}
+
+	// Rescales random planes with the plain-C and the selected SIMD code, both
+	// up and down in each direction, whole planes at a time so that the export
+	// rows see every accumulator state.
+	void TestRescaler()
+	{
+		std::mt19937 random(12345);
+		auto uniform = [&random](int lo, int hi) { return std::uniform_int_distribution<int>(lo, hi)(random); };
+		for (int trial = 0; trial < 200; ++trial)
+		{
+			const int channels = uniform(0, 1) ? 4 : 1;
+			const int srcWidth = uniform(1, 100), srcHeight = uniform(1, 40);
+			const int dstWidth = uniform(1, 100), dstHeight = uniform(1, 40);
+			std::vector<uint8_t> source(srcWidth * srcHeight * channels);
+			for (auto& value : source)
+			{
+				value = static_cast<uint8_t>(uniform(0, 255));
+			}
+			auto rescale = [&](VP8CPUInfo cpuInfo)
+			{
+				CpuInfoOverride cpu(cpuInfo);
+				std::vector<uint8_t> output(dstWidth * dstHeight * channels);
+				std::vector<rescaler_t> work(2 * dstWidth * channels);
+				WebPRescaler rescaler;
+				WebPRescalerInit(&rescaler, srcWidth, srcHeight, output.data(), dstWidth, dstHeight, dstWidth * channels, channels, work.data());
+				for (int y = 0; y < srcHeight; )
+				{
+					y += WebPRescalerImport(&rescaler, srcHeight - y, source.data() + y * srcWidth * channels, srcWidth * channels);
+					WebPRescalerExport(&rescaler);
+				}
+				return output;
+			};
+			Expect(rescale(nullptr) == rescale(systemCpuInfo), "rescaling %dx%d to %dx%d with %d channels differs",
+				srcWidth, srcHeight, dstWidth, dstHeight, channels);
+		}
+	}
+
+	// Decodes every frame rescaled, with fancy upsampling, to straight and to
+	// premultiplied samples, with the plain-C code and with everything the CPU
+	// has.
+	void TestDecodes(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const auto& frames = container->Frames();
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			for (WEBP_CSP_MODE mode : { MODE_BGRA, MODE_bgrA })
+			{
+				DecodeOptions options;
+				options.colorspace = mode;
+				options.fancyUpsampling = true;
+				options.scaledWidth = std::max(1, frames[i].width * 2 / 3);
+				options.scaledHeight = std::max(1, frames[i].height * 2 / 3);
+				auto decode = [&](VP8CPUInfo cpuInfo)
+				{
+					CpuInfoOverride cpu(cpuInfo);
+					PixelBuffer pixels(options.scaledWidth, options.scaledHeight);
+					DecodeFrame(frames[i], pixels.Surface(), options);
+					return pixels;
+				};
+				PixelBuffer expected = decode(nullptr);
+				PixelBuffer actual = decode(systemCpuInfo);
+				ExpectSamePixels(actual.Surface(), expected.Surface(), Format("frame %zu to %s", i, mode == MODE_bgrA ? "bgrA" : "BGRA"));
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	tests.push_back(TestCase{ "kernels", TestKernels });
+	tests.push_back(TestCase{ "rescaler", TestRescaler });
+	AddPerImage(&tests, "decodes", images, TestDecodes);
+	return RunTests(tests);
+}
@@ -0,0 +1,361 @@
+#include "TestSupport.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+
+#include "../../libwebp/webp/encode.h"
+#include "../../libwebp/webp/mux.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	std::string FormatV(const char* format, va_list args)
+	{
+		va_list copy;
+		va_copy(copy, args);
+		const int length = std::vsnprintf(nullptr, 0, format, copy);
+		va_end(copy);
+		std::string text(std::max(length, 0) + 1, '\0');
+		std::vsnprintf(&text[0], text.size(), format, args);
+		text.resize(std::max(length, 0));
+		return text;
+	}
+
+	// Paints frame 'index' of 'spec' into 'picture', which holds ARGB samples.
+	// The noise repeats from frame to frame, so only the disc moves.
+	void Paint(const ImageSpec& spec, int index, WebPPicture* picture)
+	{
+		const int width = spec.width, height = spec.height;
+		const int centerX = width * (index + 1) / (spec.frames + 2);
+		// Animations with alpha move an opaque disc along the edge of the
+		// transparent band, so that blending and disposing both show.
+		const bool overBand = spec.alpha && spec.frames > 1;
+		const int centerY = overBand ? height / 4 : height / 2;
+		const int radius = std::max(1, std::min(width, height) / 4);
+		const int band = std::max(1, height / 4);
+		uint32_t seed = 12345;
+		for (int y = 0; y < height; ++y)
+		{
+			uint32_t* row = picture->argb + static_cast<size_t>(picture->argb_stride) * y;
+			for (int x = 0; x < width; ++x)
+			{
+				seed = seed * 1103515245 + 12345;
+				const int noise = (seed >> 16) & 0x3f;
+				int r = 255 * x / std::max(1, width - 1);
+				int g = 255 * y / std::max(1, height - 1);
+				int b = ((x ^ y) & 16) ? 200 : 40;
+				if (x < width / 3)
+				{
+					r = std::min(255, r / 2 + noise * 2);
+					g = std::min(255, g / 2 + noise);
+				}
+				// Transparent at the top, fading in down to the middle.
+				int a = 255;
+				if (spec.alpha)
+				{
+					a = y < band ? 0 : std::min(255, (y - band) * 255 / band);
+					a = a * (320 - 128 * x / std::max(1, width)) / 320;
+				}
+				const int dx = x - centerX, dy = y - centerY;
+				if (dx * dx + dy * dy <= radius * radius)
+				{
+					r = 250;
+					g = (30 + 40 * index) & 0xff;
+					b = 60;
+					a = spec.alpha && !overBand ? 160 : 255;
+				}
+				row[x] = static_cast<uint32_t>(a) << 24 | r << 16 | g << 8 | b;
+			}
+		}
+	}
+
+	WebPConfig EncoderConfig(const ImageSpec& spec)
+	{
+		WebPConfig config;
+		if (!WebPConfigInit(&config))
+		{
+			throw std::runtime_error("WebPConfigInit failed");
+		}
+		config.method = 2;
+		config.lossless = spec.lossless;
+		config.exact = 1;
+		config.partitions = spec.partitions;
+		config.filter_type = spec.filterType;
+		config.filter_strength = 60;
+		config.alpha_quality = spec.alphaQuality;
+		return config;
+	}
+
+	// Owns a WebPPicture of ARGB samples.
+	class Picture
+	{
+	public:
+		Picture(int width, int height)
+		{
+			if (!WebPPictureInit(&picture))
+			{
+				throw std::runtime_error("WebPPictureInit failed");
+			}
+			picture.use_argb = 1;
+			picture.width = width;
+			picture.height = height;
+			if (!WebPPictureAlloc(&picture))
+			{
+				throw std::runtime_error("WebPPictureAlloc failed");
+			}
+		}
+
+		~Picture()
+		{
+			WebPPictureFree(&picture);
+		}
+
+		Picture(const Picture&) = delete;
+		Picture& operator=(const Picture&) = delete;
+
+		WebPPicture* Get() { return &picture; }
+
+	private:
+		WebPPicture picture;
+	};
+
+	std::vector<uint8_t> EncodePicture(const WebPConfig& config, WebPPicture* picture)
+	{
+		WebPMemoryWriter writer;
+		WebPMemoryWriterInit(&writer);
+		picture->writer = WebPMemoryWrite;
+		picture->custom_ptr = &writer;
+		const bool ok = WebPEncode(&config, picture) != 0;
+		std::vector<uint8_t> data(writer.mem, writer.mem + writer.size);
+		WebPMemoryWriterClear(&writer);
+		if (!ok)
+		{
+			throw std::runtime_error(Format("WebPEncode failed with error %d", picture->error_code));
+		}
+		return data;
+	}
+
+	std::vector<uint8_t> EncodeStill(const ImageSpec& spec)
+	{
+		Picture picture(spec.width, spec.height);
+		Paint(spec, 0, picture.Get());
+		return EncodePicture(EncoderConfig(spec), picture.Get());
+	}
+
+	// Assembles the frames by hand rather than through WebPAnimEncoder, which
+	// never disposes to the background while it inserts key frames. Frames
+	// other than the first and the middle one only cover the moving disc, and
+	// they take turns at blending, disposing and, if mixed, being lossless.
+	std::vector<uint8_t> EncodeAnimation(const ImageSpec& spec)
+	{
+		std::unique_ptr<WebPMux, decltype(&WebPMuxDelete)> mux(WebPMuxNew(), WebPMuxDelete);
+		if (!mux)
+		{
+			throw std::runtime_error("WebPMuxNew failed");
+		}
+		Picture canvas(spec.width, spec.height);
+		const int radius = std::max(1, std::min(spec.width, spec.height) / 4);
+		for (int i = 0; i < spec.frames; ++i)
+		{
+			Paint(spec, i, canvas.Get());
+			int x = 0, y = 0, width = spec.width, height = spec.height;
+			if (i != 0 && i != spec.frames / 2)
+			{
+				// Around the disc, which moves right; offsets must be even.
+				const int centerX = spec.width * (i + 1) / (spec.frames + 2);
+				const int centerY = spec.alpha ? spec.height / 4 : spec.height / 2;
+				x = std::max(0, centerX - 2 * radius) & ~1;
+				y = std::max(0, centerY - radius - 1) & ~1;
+				width = std::min(spec.width, centerX + radius + 1) - x;
+				height = std::min(spec.height, centerY + radius + 2) - y;
+			}
+			Picture frame(width, height);
+			for (int row = 0; row < height; ++row)
+			{
+				std::memcpy(frame.Get()->argb + static_cast<size_t>(frame.Get()->argb_stride) * row,
+					canvas.Get()->argb + static_cast<size_t>(canvas.Get()->argb_stride) * (y + row) + x, width * sizeof(uint32_t));
+			}
+			WebPConfig config = EncoderConfig(spec);
+			config.lossless = spec.lossless || (spec.mixed && i % 2 == 1);
+			const std::vector<uint8_t> bitstream = EncodePicture(config, frame.Get());
+
+			WebPMuxFrameInfo info = {};
+			info.bitstream.bytes = bitstream.data();
+			info.bitstream.size = bitstream.size();
+			info.x_offset = x;
+			info.y_offset = y;
+			info.duration = 40 + 40 * (i % 3);
+			info.id = WEBP_CHUNK_ANMF;
+			info.dispose_method = i % 3 == 1 ? WEBP_MUX_DISPOSE_BACKGROUND : WEBP_MUX_DISPOSE_NONE;
+			info.blend_method = i % 2 == 1 ? WEBP_MUX_BLEND : WEBP_MUX_NO_BLEND;
+			if (WebPMuxPushFrame(mux.get(), &info, 1) != WEBP_MUX_OK)
+			{
+				throw std::runtime_error("WebPMuxPushFrame failed");
+			}
+		}
+		WebPMuxAnimParams params = { 0xffffffff, 0 };
+		WebPData data;
+		WebPDataInit(&data);
+		if (WebPMuxSetAnimationParams(mux.get(), &params) != WEBP_MUX_OK || WebPMuxAssemble(mux.get(), &data) != WEBP_MUX_OK)
+		{
+			throw std::runtime_error("WebPMuxAssemble failed");
+		}
+		std::vector<uint8_t> bytes(data.bytes, data.bytes + data.size);
+		WebPDataClear(&data);
+		return bytes;
+	}
+
+	void CollectFiles(const std::string& path, std::vector<std::string>* files)
+	{
+		namespace fs = std::filesystem;
+		if (!fs::is_directory(path))
+		{
+			files->push_back(path);
+			return;
+		}
+		for (const auto& entry : fs::recursive_directory_iterator(path))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".webp")
+			{
+				files->push_back(entry.path().string());
+			}
+		}
+	}
+}
+
+std::vector<uint8_t> ImageLib::WebP::Tests::Encode(const ImageSpec& spec)
+{
+	return spec.frames > 1 ? EncodeAnimation(spec) : EncodeStill(spec);
+}
+
+TestImage ImageLib::WebP::Tests::MakeImage(const std::string& name, const ImageSpec& spec)
+{
+	return TestImage{ name, WebPSource::FromVector(Encode(spec)) };
+}
+
+std::vector<TestImage> ImageLib::WebP::Tests::Corpus(int argc, char** argv)
+{
+	std::vector<TestImage> images;
+	ImageSpec lossy(256, 192);
+	lossy.partitions = 3;
+	images.push_back(MakeImage("lossy", lossy));
+	ImageSpec lossyOdd(203, 147);
+	lossyOdd.filterType = 0;
+	images.push_back(MakeImage("lossy_odd", lossyOdd));
+	ImageSpec lossyAlpha(201, 153);
+	lossyAlpha.alpha = true;
+	lossyAlpha.alphaQuality = 60;
+	images.push_back(MakeImage("lossy_alpha", lossyAlpha));
+	ImageSpec lossless(190, 141);
+	lossless.lossless = true;
+	lossless.alpha = true;
+	images.push_back(MakeImage("lossless", lossless));
+	ImageSpec losslessOpaque(128, 96);
+	losslessOpaque.lossless = true;
+	images.push_back(MakeImage("lossless_opaque", losslessOpaque));
+	ImageSpec tiny(5, 3);
+	tiny.alpha = true;
+	images.push_back(MakeImage("tiny", tiny));
+	ImageSpec animLossy(160, 120);
+	animLossy.alpha = true;
+	animLossy.frames = 6;
+	images.push_back(MakeImage("anim_lossy", animLossy));
+	ImageSpec animLossless(97, 75);
+	animLossless.lossless = true;
+	animLossless.alpha = true;
+	animLossless.frames = 5;
+	images.push_back(MakeImage("anim_lossless", animLossless));
+	ImageSpec animMixed(120, 90);
+	animMixed.mixed = true;
+	animMixed.frames = 5;
+	images.push_back(MakeImage("anim_mixed", animMixed));
+
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; ++i)
+	{
+		CollectFiles(argv[i], &files);
+	}
+	std::sort(files.begin(), files.end());
+	for (const auto& path : files)
+	{
+		images.push_back(TestImage{ path, WebPSource::MapFile(path.c_str()) });
+	}
+	return images;
+}
+
+std::string ImageLib::WebP::Tests::Format(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	std::string text = FormatV(format, args);
+	va_end(args);
+	return text;
+}
+
+void ImageLib::WebP::Tests::Expect(bool condition, const char* format, ...)
+{
+	if (!condition)
+	{
+		va_list args;
+		va_start(args, format);
+		std::string message = FormatV(format, args);
+		va_end(args);
+		throw TestFailure(message);
+	}
+}
+
+void ImageLib::WebP::Tests::ExpectSamePixels(const PixelSurface& actual, const PixelSurface& expected, const std::string& what)
+{
+	Expect(actual.width == expected.width && actual.height == expected.height, "%s: %dx%d, expected %dx%d",
+		what.c_str(), actual.width, actual.height, expected.width, expected.height);
+	for (int y = 0; y < expected.height; ++y)
+	{
+		const uint8_t* a = actual.Row(y);
+		const uint8_t* e = expected.Row(y);
+		if (!std::memcmp(a, e, static_cast<size_t>(expected.width) * 4))
+		{
+			continue;
+		}
+		for (int x = 0; x < expected.width; ++x, a += 4, e += 4)
+		{
+			Expect(!std::memcmp(a, e, 4), "%s: pixel (%d, %d) is BGRA %d,%d,%d,%d, expected %d,%d,%d,%d",
+				what.c_str(), x, y, a[0], a[1], a[2], a[3], e[0], e[1], e[2], e[3]);
+		}
+	}
+}
+
+void ImageLib::WebP::Tests::AddPerImage(std::vector<TestCase>* tests, const std::string& name, const std::vector<TestImage>& images,
+	const std::function<void(const TestImage&)>& run)
+{
+	for (const auto& image : images)
+	{
+		tests->push_back(TestCase{ name + " " + image.name, [run, image] { run(image); } });
+	}
+}
+
+int ImageLib::WebP::Tests::RunTests(const std::vector<TestCase>& tests)
+{
+	int failures = 0;
+	for (const auto& test : tests)
+	{
+		try
+		{
+			test.run();
+			std::printf("%s: OK\n", test.name.c_str());
+		}
+		catch (const std::exception& e)
+		{
+			std::printf("%s: FAIL: %s\n", test.name.c_str(), e.what());
+			++failures;
+		}
+		std::fflush(stdout);
+	}
+	std::printf("%d of %zu failed\n", failures, tests.size());
+	return failures ? 1 : 0;
+}
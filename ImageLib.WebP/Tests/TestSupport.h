@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../Engine/PixelBuffer.h"
+#include "../Engine/WebPSource.h"
+
+namespace ImageLib
+{
+	namespace WebP
+	{
+		namespace Tests
+		{
+			// A picture to encode: gradients, noise and hard-edged shapes that move
+			// from frame to frame, so that every predictor and filter of the codecs
+			// gets used and animations change only part of the canvas.
+			struct ImageSpec
+			{
+				ImageSpec(int width, int height) : width(width), height(height) {}
+
+				int width;
+				int height;
+				bool lossless = false;
+				// Makes every other frame of a lossy animation lossless.
+				bool mixed = false;
+				bool alpha = false;
+				// More than one makes an animation.
+				int frames = 1;
+				// Lossy only: log2 of the number of token partitions, the loop
+				// filter (0 simple, 1 normal) and the alpha plane's quality, which
+				// quantizes its levels below 100.
+				int partitions = 0;
+				int filterType = 1;
+				int alphaQuality = 100;
+			};
+
+			// An encoded file the tests run on.
+			struct TestImage
+			{
+				std::string name;
+				std::shared_ptr<Engine::WebPSource> source;
+			};
+
+			// Encodes 'spec' with libwebp's encoder. Throws std::runtime_error if
+			// that fails.
+			std::vector<uint8_t> Encode(const ImageSpec& spec);
+
+			TestImage MakeImage(const std::string& name, const ImageSpec& spec);
+
+			// Lossy and lossless stills and animations, with and without alpha,
+			// some at sizes that are not multiples of a macroblock, followed by
+			// the .webp files found at the paths given on the command line.
+			std::vector<TestImage> Corpus(int argc, char** argv);
+
+			// Thrown by the checks below.
+			class TestFailure : public std::runtime_error
+			{
+			public:
+				explicit TestFailure(const std::string& message) : std::runtime_error(message) {}
+			};
+
+			std::string Format(const char* format, ...);
+
+			// Throws TestFailure with the printf-style message unless 'condition'.
+			void Expect(bool condition, const char* format, ...);
+
+			// Throws TestFailure naming 'what' and the first pixel that differs,
+			// unless both surfaces have the same size and pixels.
+			void ExpectSamePixels(const Engine::PixelSurface& actual, const Engine::PixelSurface& expected, const std::string& what);
+
+			struct TestCase
+			{
+				std::string name;
+				std::function<void()> run;
+			};
+
+			// Adds a case named "<name> <image>" running 'run' on each image.
+			void AddPerImage(std::vector<TestCase>* tests, const std::string& name, const std::vector<TestImage>& images,
+				const std::function<void(const TestImage&)>& run);
+
+			// Runs every case and prints its outcome; any exception fails it.
+			// Returns the exit status for main().
+			int RunTests(const std::vector<TestCase>& tests);
+		}
+	}
+}
@@ -0,0 +1,113 @@
+// Checks batch decoding of first frames against decoding each image on its
+// own.
+
+#include <mutex>
+#include <vector>
+
+#include "../Engine/WebPBatchDecoder.h"
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "../Engine/WebPThreadPool.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	std::vector<BatchItem> Items(const std::vector<TestImage>& images)
+	{
+		std::vector<BatchItem> items;
+		for (const auto& image : images)
+		{
+			items.push_back(BatchItem{ image.source->Data(), image.source->Size(), 160, 160 });
+		}
+		return items;
+	}
+
+	PixelBuffer DecodeAlone(const BatchItem& item, int* width, int* height)
+	{
+		WebPFrameInfo frame;
+		Expect(FindFirstFrame(item.data, item.size, &frame), "no first frame");
+		*width = frame.width;
+		*height = frame.height;
+		DecodeOptions options;
+		FitSize(frame.width, frame.height, item.maxWidth, item.maxHeight, &options.scaledWidth, &options.scaledHeight);
+		PixelBuffer pixels(options.scaledWidth, options.scaledHeight);
+		DecodeFrame(frame, pixels.Surface(), options);
+		return pixels;
+	}
+
+	// Decodes the images as one batch on 'pool', both keeping the results and
+	// through the callback, and compares every image with a decode on its own.
+	void TestBatch(const std::vector<TestImage>& images, WebPThreadPool* pool)
+	{
+		const std::vector<BatchItem> items = Items(images);
+		std::vector<BatchResult> results = DecodeBatch(items, DecodeOptions(), pool);
+		Expect(results.size() == items.size(), "%zu results for %zu items", results.size(), items.size());
+
+		std::vector<PixelBuffer> delivered(items.size());
+		std::vector<int> deliveries(items.size(), 0);
+		std::mutex mutex;
+		DecodeBatch(items, DecodeOptions(), [&](int index, const PixelSurface& pixels, std::exception_ptr error)
+		{
+			// The pixels are scratch memory, so they are copied during the call.
+			PixelBuffer copy = error ? PixelBuffer() : PixelBuffer::CopyOf(pixels);
+			std::lock_guard<std::mutex> lock(mutex);
+			deliveries[index] += error ? 100 : 1;
+			delivered[index] = std::move(copy);
+		}, pool);
+
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			int width, height;
+			PixelBuffer expected = DecodeAlone(items[i], &width, &height);
+			const std::string& name = images[i].name;
+			Expect(!results[i].error, "%s failed", name.c_str());
+			Expect(results[i].width == width && results[i].height == height, "%s is %dx%d, expected %dx%d",
+				name.c_str(), results[i].width, results[i].height, width, height);
+			ExpectSamePixels(results[i].pixels.Surface(), expected.Surface(), name);
+			Expect(deliveries[i] == 1, "%s was delivered %d times or failed", name.c_str(), deliveries[i]);
+			ExpectSamePixels(delivered[i].Surface(), expected.Surface(), name + " through the callback");
+		}
+	}
+
+	// A broken item fails on its own, through either entry point, without
+	// stopping the rest of the batch.
+	void TestErrors(const std::vector<TestImage>& images, WebPThreadPool* pool)
+	{
+		std::vector<BatchItem> items = Items(images);
+		std::vector<uint8_t> broken(images[0].source->Data(), images[0].source->Data() + images[0].source->Size());
+		broken[8] = 'X';
+		items.insert(items.begin() + 1, BatchItem{ broken.data(), broken.size(), 0, 0 });
+
+		std::vector<BatchResult> results = DecodeBatch(items, DecodeOptions(), pool);
+		Expect(results[1].error && results[1].pixels.Width() == 0, "a broken item decoded");
+		std::vector<int> errors(items.size(), 0);
+		std::mutex mutex;
+		DecodeBatch(items, DecodeOptions(), [&](int index, const PixelSurface&, std::exception_ptr error)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			errors[index] = error ? 1 : 0;
+		}, pool);
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			Expect((i == 1) == (results[i].error != nullptr), "item %zu: the batch result has the wrong outcome", i);
+			Expect((i == 1) == (errors[i] != 0), "item %zu: the callback had the wrong outcome", i);
+		}
+
+		Expect(DecodeBatch(std::vector<BatchItem>(), DecodeOptions(), pool).empty(), "an empty batch returned results");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	WebPThreadPool pool(3);
+	std::vector<TestCase> tests;
+	tests.push_back(TestCase{ "serial", [&images] { TestBatch(images, nullptr); } });
+	tests.push_back(TestCase{ "pool", [&] { TestBatch(images, &pool); } });
+	tests.push_back(TestCase{ "errors", [&images] { TestErrors(images, nullptr); } });
+	tests.push_back(TestCase{ "errors on the pool", [&] { TestErrors(images, &pool); } });
+	return RunTests(tests);
+}
@@ -0,0 +1,59 @@
+// Checks the compositor against libwebp's WebPAnimDecoder.
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "../../libwebp/webp/demux.h"
+#include "../Engine/WebPCompositor.h"
+#include "../Engine/WebPContainer.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// Compares every composited frame, then a rewind to the first frame, with
+	// WebPAnimDecoder.
+	void TestCompositor(const TestImage& image, WEBP_CSP_MODE mode)
+	{
+		WebPAnimDecoderOptions decoderOptions;
+		WebPAnimDecoderOptionsInit(&decoderOptions);
+		decoderOptions.color_mode = mode;
+		WebPData webPData = { image.source->Data(), image.source->Size() };
+		std::unique_ptr<WebPAnimDecoder, decltype(&WebPAnimDecoderDelete)> decoder(
+			WebPAnimDecoderNew(&webPData, &decoderOptions), WebPAnimDecoderDelete);
+		Expect(decoder != nullptr, "WebPAnimDecoderNew failed");
+
+		// WebPAnimDecoder always uses fancy upsampling.
+		DecodeOptions options;
+		options.colorspace = mode;
+		options.fancyUpsampling = true;
+		auto container = WebPContainer::Create(image.source);
+		WebPCompositor compositor(container, options);
+		const int width = container->CanvasWidth(), height = container->CanvasHeight();
+		std::vector<uint8_t> first;
+		for (int i = 0; WebPAnimDecoderHasMoreFrames(decoder.get()); ++i)
+		{
+			uint8_t* expected;
+			int timestamp;
+			Expect(WebPAnimDecoderGetNext(decoder.get(), &expected, &timestamp) != 0, "WebPAnimDecoderGetNext failed");
+			ExpectSamePixels(compositor.RenderFrame(i), PixelSurface{ expected, width, height, width * 4 }, Format("frame %d", i));
+			if (i == 0)
+			{
+				first.assign(expected, expected + static_cast<size_t>(width) * height * 4);
+			}
+		}
+		ExpectSamePixels(compositor.RenderFrame(0), PixelSurface{ first.data(), width, height, width * 4 }, "frame 0 after the last");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "premultiplied", images, [](const TestImage& image) { TestCompositor(image, MODE_bgrA); });
+	AddPerImage(&tests, "straight", images, [](const TestImage& image) { TestCompositor(image, MODE_BGRA); });
+	return RunTests(tests);
+}
@@ -0,0 +1,92 @@
+// Checks decodes through a reused DecoderContext against decodes on their
+// own.
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// Decodes the first half of 'frame' through 'options.context', which must
+	// fail and leave the context fit for the next decode.
+	void DecodeTruncated(const WebPFrameInfo& frame, const PixelSurface& target, const DecodeOptions& options)
+	{
+		bool threw = false;
+		try
+		{
+			DecodeFrame(frame.payload, frame.payloadSize / 2, target, options);
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+		Expect(threw, "half a frame decoded");
+	}
+
+	// Decodes every frame of every image through one context, at sizes and
+	// thread budgets that change from frame to frame and with a truncated
+	// payload in between, lossy and lossless frames taking turns.
+	void TestMixed(const std::vector<TestImage>& images)
+	{
+		DecoderContext context;
+		int index = 0;
+		for (const auto& image : images)
+		{
+			auto container = WebPContainer::Create(image.source);
+			for (const WebPFrameInfo& frame : container->Frames())
+			{
+				const int scale = 1 + index % 3;
+				DecodeOptions options;
+				options.scaledWidth = std::max(1, frame.width / scale);
+				options.scaledHeight = std::max(1, frame.height / scale);
+				options.useThreads = (index & 1) != 0;
+				PixelBuffer expected(options.scaledWidth, options.scaledHeight);
+				DecodeFrame(frame, expected.Surface(), options);
+
+				options.context = &context;
+				PixelBuffer actual(options.scaledWidth, options.scaledHeight);
+				DecodeTruncated(frame, actual.Surface(), options);
+				DecodeFrame(frame, actual.Surface(), options);
+				ExpectSamePixels(actual.Surface(), expected.Surface(), Format("%s frame %d", image.name.c_str(), frame.frameNum));
+				++index;
+			}
+		}
+	}
+
+	// Decodes every frame of one image several times through one context, as
+	// playback does, with and without threads.
+	void TestRepeat(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		DecoderContext context;
+		for (int pass = 0; pass < 3; ++pass)
+		{
+			for (const WebPFrameInfo& frame : container->Frames())
+			{
+				PixelBuffer expected = DecodeFrame(frame);
+				DecodeOptions options;
+				options.context = &context;
+				options.useThreads = pass == 1;
+				PixelBuffer actual(frame.width, frame.height);
+				DecodeFrame(frame, actual.Surface(), options);
+				ExpectSamePixels(actual.Surface(), expected.Surface(), Format("frame %d in pass %d", frame.frameNum, pass));
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	tests.push_back(TestCase{ "mixed", [&images] { TestMixed(images); } });
+	AddPerImage(&tests, "repeat", images, TestRepeat);
+	return RunTests(tests);
+}
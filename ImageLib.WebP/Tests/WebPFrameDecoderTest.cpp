@@ -0,0 +1,125 @@
+// Checks demuxing and frame decoding against libwebp's own simple API.
+
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "../../libwebp/webp/demux.h"
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// The canvas and frames must be what WebPDemux sees, and every frame must
+	// lie on the canvas.
+	void TestContainer(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		WebPData data = { image.source->Data(), image.source->Size() };
+		std::unique_ptr<WebPDemuxer, decltype(&WebPDemuxDelete)> demuxer(WebPDemux(&data), WebPDemuxDelete);
+		Expect(demuxer != nullptr, "WebPDemux failed");
+		Expect(container->CanvasWidth() == static_cast<int>(WebPDemuxGetI(demuxer.get(), WEBP_FF_CANVAS_WIDTH)) &&
+			container->CanvasHeight() == static_cast<int>(WebPDemuxGetI(demuxer.get(), WEBP_FF_CANVAS_HEIGHT)),
+			"canvas is %dx%d", container->CanvasWidth(), container->CanvasHeight());
+		const auto& frames = container->Frames();
+		Expect(frames.size() == WebPDemuxGetI(demuxer.get(), WEBP_FF_FRAME_COUNT), "%zu frames", frames.size());
+		Expect(container->IsComplete(), "container is partial");
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			const WebPFrameInfo& frame = frames[i];
+			Expect(frame.xOffset >= 0 && frame.yOffset >= 0 && frame.width > 0 && frame.height > 0 &&
+				frame.xOffset + frame.width <= container->CanvasWidth() && frame.yOffset + frame.height <= container->CanvasHeight(),
+				"frame %zu is %dx%d at (%d, %d)", i, frame.width, frame.height, frame.xOffset, frame.yOffset);
+		}
+	}
+
+	// Straight output with fancy upsampling must be WebPDecodeBGRA's, and the
+	// default premultiplied output must keep its alpha and stay within it.
+	void TestDecode(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const auto& frames = container->Frames();
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			const WebPFrameInfo& frame = frames[i];
+			int width, height;
+			std::unique_ptr<uint8_t, decltype(&WebPFree)> expected(
+				WebPDecodeBGRA(frame.payload, frame.payloadSize, &width, &height), WebPFree);
+			Expect(expected != nullptr && width == frame.width && height == frame.height, "WebPDecodeBGRA failed on frame %zu", i);
+			const PixelSurface expectedSurface = { expected.get(), width, height, width * 4 };
+
+			DecodeOptions options;
+			options.colorspace = MODE_BGRA;
+			options.fancyUpsampling = true;
+			PixelBuffer straight(frame.width, frame.height);
+			DecodeFrame(frame, straight.Surface(), options);
+			ExpectSamePixels(straight.Surface(), expectedSurface, Format("frame %zu", i));
+
+			const PixelBuffer premultiplied = DecodeFrame(frame);
+			for (size_t j = 0; j < premultiplied.Size(); j += 4)
+			{
+				const uint8_t* pixel = premultiplied.Data() + j;
+				const uint8_t alpha = straight.Data()[j + 3];
+				Expect(pixel[3] == alpha && pixel[0] <= alpha && pixel[1] <= alpha && pixel[2] <= alpha,
+					"frame %zu: premultiplied pixel %zu is BGRA %d,%d,%d,%d", i, j / 4, pixel[0], pixel[1], pixel[2], pixel[3]);
+			}
+		}
+	}
+
+	void TestErrors(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const WebPFrameInfo& frame = container->Frames()[0];
+		PixelBuffer small(frame.width - 1, frame.height);
+		bool threw = false;
+		try
+		{
+			DecodeFrame(frame, small.Surface());
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+		Expect(threw, "decoding into a smaller surface did not throw");
+
+		PixelBuffer pixels(frame.width, frame.height);
+		threw = false;
+		try
+		{
+			DecodeFrame(frame.payload, frame.payloadSize / 2, pixels.Surface());
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+		Expect(threw, "decoding half the payload did not throw");
+
+		threw = false;
+		try
+		{
+			std::vector<uint8_t> corrupt(image.source->Data(), image.source->Data() + image.source->Size());
+			corrupt[8] = 'X';
+			WebPContainer::Create(std::move(corrupt));
+		}
+		catch (const std::invalid_argument&)
+		{
+			threw = true;
+		}
+		Expect(threw, "demuxing a file without its WEBP tag did not throw");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "container", images, TestContainer);
+	AddPerImage(&tests, "decode", images, TestDecode);
+	AddPerImage(&tests, "errors", images, TestErrors);
+	return RunTests(tests);
+}
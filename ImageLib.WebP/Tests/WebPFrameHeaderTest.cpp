@@ -0,0 +1,111 @@
+// Checks the headers parsed while demuxing, and the probe, against libwebp.
+
+#include <stdexcept>
+#include <vector>
+
+#include "../../libwebp/webp/format_constants.h"
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameHeader.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// The header of every frame must agree with the demuxer and with
+	// WebPGetFeatures(), and locate chunks that lie inside the payload.
+	void TestFrames(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const auto& frames = container->Frames();
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			const WebPFrameInfo& frame = frames[i];
+			const WebPFrameHeader& header = frame.header;
+			Expect(header.valid, "frame %zu: no header", i);
+			WebPBitstreamFeatures features;
+			Expect(WebPGetFeatures(frame.payload, frame.payloadSize, &features) == VP8_STATUS_OK, "frame %zu: WebPGetFeatures failed", i);
+			Expect(header.features.width == frame.width && header.features.height == frame.height &&
+				header.features.width == features.width && header.features.height == features.height,
+				"frame %zu: %dx%d, expected %dx%d", i, header.features.width, header.features.height, frame.width, frame.height);
+			Expect(header.lossless == (features.format == 2) && header.features.has_alpha == features.has_alpha,
+				"frame %zu: the format or alpha differs from WebPGetFeatures", i);
+
+			Expect(header.bitstreamOffset + header.bitstreamSize <= frame.payloadSize, "frame %zu: the bitstream runs past the payload", i);
+			Expect(header.alphaOffset + header.alphaSize <= frame.payloadSize, "frame %zu: the alpha chunk runs past the payload", i);
+			if (header.lossless)
+			{
+				Expect(frame.payload[header.bitstreamOffset] == VP8L_MAGIC_BYTE, "frame %zu: the VP8L signature is not where expected", i);
+				Expect(header.alphaSize == 0, "frame %zu: a lossless frame has an alpha chunk", i);
+			}
+			else
+			{
+				Expect(!frame.hasAlpha || header.alphaSize > 0, "frame %zu: the alpha chunk of a lossy frame was not found", i);
+				Expect(header.firstPartitionSize > 0 && header.firstPartitionSize <= header.bitstreamSize,
+					"frame %zu: a first partition of %u bytes in %zu", i, header.firstPartitionSize, header.bitstreamSize);
+			}
+		}
+	}
+
+	// The probe must report the canvas and the animation flag, ask for more
+	// data while the first chunks are incomplete, and refuse data that is not
+	// WebP.
+	void TestProbe(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		WebPBitstreamFeatures features;
+		Expect(ProbeImage(image.source->Data(), image.source->Size(), &features), "the probe wanted more data");
+		Expect(features.width == container->CanvasWidth() && features.height == container->CanvasHeight(),
+			"probed %dx%d, the canvas is %dx%d", features.width, features.height, container->CanvasWidth(), container->CanvasHeight());
+		Expect((features.has_animation != 0) == (container->Frames().size() > 1), "the animation flag is wrong");
+		Expect(!ProbeImage(image.source->Data(), RIFF_HEADER_SIZE, &features), "the probe accepted only the RIFF header");
+
+		std::vector<uint8_t> garbled(image.source->Data(), image.source->Data() + image.source->Size());
+		garbled[8] = 'X';
+		bool threw = false;
+		try
+		{
+			ProbeImage(garbled.data(), garbled.size(), &features);
+		}
+		catch (const std::invalid_argument&)
+		{
+			threw = true;
+		}
+		Expect(threw, "probing a garbled file did not throw");
+	}
+
+	// A still file parses to the header of its only frame, relative to the
+	// file instead of the payload; cut short it parses to nothing.
+	void TestStillFile(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		if (container->Frames().size() > 1)
+		{
+			WebPFrameHeader header;
+			Expect(ParseFrameHeader(image.source->Data(), image.source->Size(), &header) && header.features.has_animation,
+				"an animation did not parse as one");
+			return;
+		}
+		const WebPFrameInfo& frame = container->Frames()[0];
+		const size_t payloadOffset = frame.payload - image.source->Data();
+		WebPFrameHeader header;
+		Expect(ParseFrameHeader(image.source->Data(), image.source->Size(), &header), "the file did not parse");
+		Expect(header.bitstreamOffset == payloadOffset + frame.header.bitstreamOffset && header.bitstreamSize == frame.header.bitstreamSize &&
+			header.alphaSize == frame.header.alphaSize && header.lossless == frame.header.lossless &&
+			header.firstPartitionSize == frame.header.firstPartitionSize && header.vp8Profile == frame.header.vp8Profile,
+			"the file parses differently from its frame");
+		Expect(!ParseFrameHeader(image.source->Data(), header.bitstreamOffset, &header) && !header.valid,
+			"a file cut before its bitstream parsed");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "frames", images, TestFrames);
+	AddPerImage(&tests, "probe", images, TestProbe);
+	AddPerImage(&tests, "still file", images, TestStillFile);
+	return RunTests(tests);
+}
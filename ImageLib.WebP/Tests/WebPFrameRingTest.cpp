@@ -0,0 +1,107 @@
+// Checks frames played out of a WebPFrameRing against the compositor.
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../Engine/WebPCompositor.h"
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameRing.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// Waits for the ring's next frame, failing if it takes far longer than a
+	// decode should.
+	WebPFrameRing::Frame Next(WebPFrameRing& ring)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+		WebPFrameRing::Frame frame;
+		while (!ring.Advance(&frame))
+		{
+			Expect(std::chrono::steady_clock::now() < deadline, "no frame ready after 30 s");
+			std::this_thread::yield();
+		}
+		return frame;
+	}
+
+	// Plays 'count' frames from 'first' on and compares each with the compositor.
+	void ExpectFrames(WebPFrameRing& ring, WebPCompositor& compositor, int first, int count)
+	{
+		const int frameCount = static_cast<int>(compositor.Container()->Frames().size());
+		for (int i = 0; i < count; ++i)
+		{
+			const int index = (first + i) % frameCount;
+			const WebPFrameRing::Frame frame = Next(ring);
+			Expect(frame.index == index, "frame %d played instead of %d", frame.index, index);
+			ExpectSamePixels(*frame.surface, compositor.RenderFrame(index), Format("frame %d", index));
+		}
+	}
+
+	// Plays two loops out of a minimal ring.
+	void TestMinimal(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const int frameCount = static_cast<int>(container->Frames().size());
+		WebPCompositor compositor(container);
+		WebPFrameRing ring(container, 0);
+		Expect(ring.Depth() == WebPFrameRing::MinDepth, "depth %d with no budget", ring.Depth());
+		ring.Start(0);
+		ExpectFrames(ring, compositor, 0, frameCount * 2);
+	}
+
+	// Restarts a ring with room for every frame in the middle of the animation,
+	// then plays on into the caller's slots, which are wider than the canvas.
+	void TestRestart(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const int frameCount = static_cast<int>(container->Frames().size());
+		const size_t canvasBytes = static_cast<size_t>(container->CanvasWidth()) * container->CanvasHeight() * 4;
+		WebPCompositor compositor(container);
+		Expect(WebPFrameRing::DepthForBudget(*container, canvasBytes * 100) == frameCount + 1,
+			"depth %d for a large budget", WebPFrameRing::DepthForBudget(*container, canvasBytes * 100));
+
+		WebPFrameRing ring(container, canvasBytes * 100);
+		ring.Start(0);
+		ExpectFrames(ring, compositor, 0, 1);
+		const int middle = frameCount / 2;
+		ring.Start(middle);
+		ExpectFrames(ring, compositor, middle, frameCount + 1);
+		ring.Stop();
+
+		std::vector<PixelBuffer> buffers;
+		std::vector<PixelSurface> slots;
+		for (int i = 0; i < 3; ++i)
+		{
+			buffers.emplace_back(container->CanvasWidth() + 3, container->CanvasHeight());
+		}
+		for (auto& buffer : buffers)
+		{
+			slots.push_back(buffer.Surface());
+		}
+		WebPFrameRing callerSlots(container, slots);
+		callerSlots.Start(frameCount - 1);
+		for (int i = 0; i < frameCount + 1; ++i)
+		{
+			const int index = (frameCount - 1 + i) % frameCount;
+			const WebPFrameRing::Frame frame = Next(callerSlots);
+			Expect(frame.index == index, "frame %d played instead of %d", frame.index, index);
+			PixelSurface canvas = *frame.surface;
+			canvas.width = container->CanvasWidth();
+			ExpectSamePixels(canvas, compositor.RenderFrame(index), Format("frame %d in a caller's slot", index));
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "minimal", images, TestMinimal);
+	AddPerImage(&tests, "restart", images, TestRestart);
+	return RunTests(tests);
+}
@@ -0,0 +1,165 @@
+// Checks the content hash and the decoded-image cache.
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "../Engine/WebPImageCache.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	WebPImageCache::Key KeyOf(uint64_t hash)
+	{
+		return WebPImageCache::Key{ hash, 10, 10, MODE_bgrA };
+	}
+
+	std::shared_ptr<PixelBuffer> Pixels(uint8_t value)
+	{
+		auto pixels = std::make_shared<PixelBuffer>(10, 10);
+		std::memset(pixels->Data(), value, pixels->Size());
+		return pixels;
+	}
+
+	// Hashing the file in uneven pieces must match hashing it at once, and
+	// any change to the bytes must change the hash.
+	void TestHash(const TestImage& image)
+	{
+		const uint8_t* data = image.source->Data();
+		const size_t size = image.source->Size();
+		ContentHasher hasher;
+		for (size_t offset = 0, piece = 1; offset < size; offset += piece, piece = piece * 2 + 1)
+		{
+			hasher.Update(data + offset, std::min(piece, size - offset));
+		}
+		const uint64_t hash = ContentHasher::Hash(data, size);
+		Expect(hasher.Finish() == hash, "hashing in pieces differs");
+
+		std::vector<uint8_t> changed(data, data + size);
+		changed[size / 2] ^= 1;
+		Expect(ContentHasher::Hash(changed.data(), size) != hash, "flipping a bit kept the hash");
+		Expect(ContentHasher::Hash(data, size - 1) != hash, "dropping the last byte kept the hash");
+	}
+
+	// Round-trips the first frame through a cache with room for two copies
+	// while two more are inserted.
+	void TestRoundTrip(const TestImage& image)
+	{
+		const uint64_t hash = ContentHasher::Hash(image.source->Data(), image.source->Size());
+		WebPFrameInfo frame;
+		Expect(FindFirstFrame(image.source->Data(), image.source->Size(), &frame), "no first frame");
+		auto pixels = std::make_shared<PixelBuffer>(DecodeFrame(frame));
+		WebPImageCache cache(pixels->Size() * 2, 4);
+		WebPImageCache::Key key = { hash, pixels->Width(), pixels->Height(), MODE_bgrA };
+		Expect(cache.Insert(key, pixels, 100), "insertion refused");
+		for (int i = 1; i <= 2; ++i)
+		{
+			WebPImageCache::Key other = key;
+			other.contentHash += i;
+			cache.Insert(other, std::make_shared<PixelBuffer>(pixels->Width(), pixels->Height()), 1);
+			// Keep the first entry the most recently used.
+			cache.Find(key);
+		}
+		const WebPImageCache::Stats stats = cache.GetStats();
+		Expect(stats.bytes <= stats.budgetBytes && stats.entries == 2 && stats.evictions == 1,
+			"%zu of %zu bytes in %zu entries after %llu evictions", stats.bytes, stats.budgetBytes, stats.entries,
+			static_cast<unsigned long long>(stats.evictions));
+		auto found = cache.Find(key);
+		Expect(found != nullptr, "the entry was evicted");
+		Expect(!std::memcmp(found->Data(), pixels->Data(), pixels->Size()), "the cached pixels changed");
+	}
+
+	// Equal-sized entries leave cheapest first, pixels evicted stay valid for
+	// their holders, and entries larger than the budget are refused.
+	void TestEviction()
+	{
+		const size_t entryBytes = Pixels(0)->Size();
+		WebPImageCache cache(entryBytes * 3, 1);
+		cache.Insert(KeyOf(1), Pixels(1), 50);
+		cache.Insert(KeyOf(2), Pixels(2), 10);
+		cache.Insert(KeyOf(3), Pixels(3), 30);
+		auto held = cache.Find(KeyOf(2));
+		cache.Insert(KeyOf(4), Pixels(4), 40);
+		Expect(cache.Find(KeyOf(2)) == nullptr, "the cheapest entry was kept");
+		Expect(held != nullptr && held->Data()[0] == 2, "evicted pixels changed under their holder");
+		cache.Insert(KeyOf(5), Pixels(5), 40);
+		Expect(cache.Find(KeyOf(3)) == nullptr && cache.Find(KeyOf(1)) != nullptr, "the next cheapest entry was kept");
+
+		Expect(!cache.Insert(KeyOf(6), std::make_shared<PixelBuffer>(20, 20), 1000), "an entry over the budget was stored");
+		cache.Erase(KeyOf(1));
+		Expect(cache.Find(KeyOf(1)) == nullptr, "an erased entry was found");
+		WebPImageCache::Stats stats = cache.GetStats();
+		Expect(stats.entries == 2 && stats.rejections == 1 && stats.evictions == 2 && stats.insertions == 5,
+			"%zu entries, %llu rejections, %llu evictions, %llu insertions", stats.entries,
+			static_cast<unsigned long long>(stats.rejections), static_cast<unsigned long long>(stats.evictions),
+			static_cast<unsigned long long>(stats.insertions));
+
+		cache.SetBudget(entryBytes);
+		stats = cache.GetStats();
+		Expect(stats.entries == 1 && stats.bytes == entryBytes, "%zu entries in %zu bytes after shrinking", stats.entries, stats.bytes);
+		cache.SetBudget(0);
+		Expect(cache.GetStats().entries == 0 && !cache.Insert(KeyOf(7), Pixels(7), 1), "a cache with no budget holds entries");
+		cache.SetBudget(entryBytes);
+		cache.Insert(KeyOf(8), Pixels(8), 1);
+		cache.Clear();
+		Expect(cache.GetStats().entries == 0 && cache.GetStats().bytes == 0, "entries left after Clear()");
+	}
+
+	// Threads inserting and finding their own keys must never see other
+	// pixels, nor push the cache over its budget.
+	void TestConcurrent()
+	{
+		const size_t entryBytes = Pixels(0)->Size();
+		WebPImageCache cache(entryBytes * 20, 4);
+		std::vector<int> wrong(4, 0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; ++t)
+		{
+			threads.emplace_back([&cache, &wrong, t]
+			{
+				for (int i = 0; i < 2000; ++i)
+				{
+					const uint64_t hash = static_cast<uint64_t>(t) << 32 | (i % 37);
+					if (auto found = cache.Find(KeyOf(hash)))
+					{
+						wrong[t] += found->Data()[0] != static_cast<uint8_t>(hash * 7 + t);
+					}
+					else
+					{
+						cache.Insert(KeyOf(hash), Pixels(static_cast<uint8_t>(hash * 7 + t)), i % 5 + 1);
+					}
+				}
+			});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		for (int t = 0; t < 4; ++t)
+		{
+			Expect(wrong[t] == 0, "thread %d found %d wrong entries", t, wrong[t]);
+		}
+		const WebPImageCache::Stats stats = cache.GetStats();
+		Expect(stats.bytes <= stats.budgetBytes && stats.bytes == stats.entries * entryBytes && stats.hits + stats.misses == 8000,
+			"%zu of %zu bytes in %zu entries after %llu finds", stats.bytes, stats.budgetBytes, stats.entries,
+			static_cast<unsigned long long>(stats.hits + stats.misses));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "hash", images, TestHash);
+	AddPerImage(&tests, "round trip", images, TestRoundTrip);
+	tests.push_back(TestCase{ "eviction", TestEviction });
+	tests.push_back(TestCase{ "concurrent", TestConcurrent });
+	return RunTests(tests);
+}
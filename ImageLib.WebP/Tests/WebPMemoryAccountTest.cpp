@@ -0,0 +1,200 @@
+// Checks that memory accounts see, limit and get back what libwebp allocates.
+
+#include <cstring>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// The account must see every decode's allocations, with and without
+	// threads, and get all of them back.
+	void TestAccount(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		for (const WebPFrameInfo& frame : container->Frames())
+		{
+			PixelBuffer expected = DecodeFrame(frame);
+			for (bool threads : { false, true })
+			{
+				DecodeOptions options;
+				options.useThreads = threads;
+				MemoryAccount account;
+				options.memory = &account;
+				PixelBuffer actual(frame.width, frame.height);
+				DecodeFrame(frame, actual.Surface(), options);
+				Expect(account.CurrentBytes() == 0 && account.PeakBytes() > 0 && account.Allocations() > 0,
+					"frame %d%s: %llu bytes kept of a peak of %llu in %llu allocations", frame.frameNum, threads ? " with threads" : "",
+					static_cast<unsigned long long>(account.CurrentBytes()), static_cast<unsigned long long>(account.PeakBytes()),
+					static_cast<unsigned long long>(account.Allocations()));
+				ExpectSamePixels(actual.Surface(), expected.Surface(), Format("frame %d", frame.frameNum));
+			}
+		}
+	}
+
+	// A limit one byte under the peak must fail the decode and give back what
+	// it had, without changing what a limit at the peak produces. Threads may
+	// allocate in a different order, so the limits are checked on serial
+	// decodes.
+	void TestLimit(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		for (const WebPFrameInfo& frame : container->Frames())
+		{
+			PixelBuffer expected = DecodeFrame(frame);
+			DecodeOptions options;
+			MemoryAccount serial;
+			options.memory = &serial;
+			PixelBuffer actual(frame.width, frame.height);
+			DecodeFrame(frame, actual.Surface(), options);
+
+			MemoryAccount tight(serial.PeakBytes() - 1);
+			options.memory = &tight;
+			bool failed = false;
+			try
+			{
+				DecodeFrame(frame, actual.Surface(), options);
+			}
+			catch (const std::bad_alloc&)
+			{
+				failed = true;
+			}
+			Expect(failed && tight.Failures() > 0 && tight.CurrentBytes() == 0, "frame %d: a limit under the peak let the decode through",
+				frame.frameNum);
+
+			MemoryAccount exact(serial.PeakBytes());
+			options.memory = &exact;
+			std::memset(actual.Data(), 0, actual.Size());
+			DecodeFrame(frame, actual.Surface(), options);
+			Expect(exact.Failures() == 0, "frame %d: a limit at the peak refused allocations", frame.frameNum);
+			ExpectSamePixels(actual.Surface(), expected.Surface(), Format("frame %d at the limit", frame.frameNum));
+		}
+	}
+
+	// Memory a context keeps stays counted until the context goes. Once its
+	// block has grown to fit a frame, decoding the frame again allocates less
+	// than a decode on its own, and nothing at all for lossy frames without
+	// alpha.
+	void TestContext(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		MemoryAccount account;
+		{
+			DecoderContext context;
+			DecodeOptions options;
+			options.context = &context;
+			options.memory = &account;
+			for (const WebPFrameInfo& frame : container->Frames())
+			{
+				MemoryAccount alone;
+				PixelBuffer pixels(frame.width, frame.height);
+				DecodeOptions aloneOptions;
+				aloneOptions.memory = &alone;
+				DecodeFrame(frame, pixels.Surface(), aloneOptions);
+
+				DecodeFrame(frame, pixels.Surface(), options);
+				DecodeFrame(frame, pixels.Surface(), options);
+				const uint64_t before = account.Allocations();
+				DecodeFrame(frame, pixels.Surface(), options);
+				const uint64_t allocations = account.Allocations() - before;
+				const bool plainLossy = !frame.header.lossless && frame.header.alphaSize == 0;
+				Expect(plainLossy ? allocations == 0 : allocations < alone.Allocations(),
+					"decoding frame %d again allocated %llu times, against %llu on its own", frame.frameNum,
+					static_cast<unsigned long long>(allocations), static_cast<unsigned long long>(alone.Allocations()));
+			}
+			Expect(account.CurrentBytes() > 0, "the context kept no memory");
+		}
+		Expect(account.CurrentBytes() == 0, "%llu bytes left after the context went", static_cast<unsigned long long>(account.CurrentBytes()));
+	}
+
+	// Threads decoding at once, some through accounts of their own and some
+	// on the built-in allocator, must each see what a decode alone allocates
+	// and get all of it back.
+	void TestConcurrent(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const WebPFrameInfo& frame = container->Frames()[0];
+		MemoryAccount serial;
+		DecodeOptions serialOptions;
+		serialOptions.memory = &serial;
+		PixelBuffer expected(frame.width, frame.height);
+		DecodeFrame(frame, expected.Surface(), serialOptions);
+
+		const int kThreads = 4;
+		std::vector<MemoryAccount> accounts(kThreads);
+		std::vector<PixelBuffer> results;
+		for (int i = 0; i < kThreads; ++i)
+		{
+			results.emplace_back(frame.width, frame.height);
+		}
+		std::vector<std::thread> threads;
+		for (int i = 0; i < kThreads; ++i)
+		{
+			threads.emplace_back([&, i]
+			{
+				DecodeOptions options;
+				options.memory = i % 2 == 0 ? &accounts[i] : nullptr;
+				for (int pass = 0; pass < 4; ++pass)
+				{
+					DecodeFrame(frame, results[i].Surface(), options);
+				}
+			});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		for (int i = 0; i < kThreads; i += 2)
+		{
+			Expect(accounts[i].CurrentBytes() == 0 && accounts[i].PeakBytes() == serial.PeakBytes() &&
+				accounts[i].Allocations() == 4 * serial.Allocations(), "thread %d: %llu bytes kept of a peak of %llu, against %llu alone", i,
+				static_cast<unsigned long long>(accounts[i].CurrentBytes()), static_cast<unsigned long long>(accounts[i].PeakBytes()),
+				static_cast<unsigned long long>(serial.PeakBytes()));
+		}
+		for (int i = 0; i < kThreads; ++i)
+		{
+			ExpectSamePixels(results[i].Surface(), expected.Surface(), Format("thread %d", i));
+		}
+	}
+
+	// Scopes serve the calling thread from their account and restore the one
+	// before them; a scope without an account changes nothing.
+	void TestScopes()
+	{
+		WebPAllocator* const initial = WebPGetThreadAllocator();
+		MemoryAccount outer, inner;
+		{
+			MemoryScope outerScope(&outer);
+			Expect(WebPGetThreadAllocator() == outer.Get(), "the outer scope is not in effect");
+			{
+				MemoryScope innerScope(&inner);
+				Expect(WebPGetThreadAllocator() == inner.Get(), "the inner scope is not in effect");
+				{
+					MemoryScope none(nullptr);
+					Expect(WebPGetThreadAllocator() == inner.Get(), "a scope without an account replaced the allocator");
+				}
+			}
+			Expect(WebPGetThreadAllocator() == outer.Get(), "the inner scope did not restore the outer one");
+		}
+		Expect(WebPGetThreadAllocator() == initial, "the outer scope did not restore the thread's allocator");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "account", images, TestAccount);
+	AddPerImage(&tests, "limit", images, TestLimit);
+	AddPerImage(&tests, "context", images, TestContext);
+	AddPerImage(&tests, "concurrent", images, TestConcurrent);
+	tests.push_back(TestCase{ "scopes", TestScopes });
+	return RunTests(tests);
+}
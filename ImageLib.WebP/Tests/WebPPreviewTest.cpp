@@ -0,0 +1,144 @@
+// Checks quarter-size previews against full decodes averaged down.
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// Mean absolute difference allowed in the luma of lossy previews, which
+	// skip the loop filter. Their chroma is upsampled from the averaged
+	// samples, so each of them spreads over 8x8 pixels of the picture, and
+	// sharp colour edges make any bound on the colour channels meaningless.
+	// They also clip the luma of previews smaller than kMinSize in either
+	// direction, whose luma goes unchecked.
+	const double kMaxLumaError = 2.0;
+	const int kMinSize = 16;
+
+	// 'full' averaged over 4x4 squares of straight BGRA samples, cut short at
+	// its edges.
+	PixelBuffer Average(const PixelSurface& full)
+	{
+		PixelBuffer averaged((full.width + 3) / 4, (full.height + 3) / 4);
+		const PixelSurface surface = averaged.Surface();
+		for (int y = 0; y < surface.height; ++y)
+		{
+			for (int x = 0; x < surface.width; ++x)
+			{
+				const int rows = std::min(4, full.height - 4 * y);
+				const int cols = std::min(4, full.width - 4 * x);
+				for (int c = 0; c < 4; ++c)
+				{
+					int sum = 0;
+					for (int j = 0; j < rows; ++j)
+					{
+						for (int k = 0; k < cols; ++k)
+						{
+							sum += full.Row(4 * y + j)[4 * (4 * x + k) + c];
+						}
+					}
+					surface.Row(y)[4 * x + c] = static_cast<uint8_t>((sum + rows * cols / 2) / (rows * cols));
+				}
+			}
+		}
+		return averaged;
+	}
+
+	// Mean absolute difference between the luma of 'actual' and 'expected',
+	// and whether their alpha channels are the same.
+	double LumaError(const PixelSurface& actual, const PixelSurface& expected, bool* sameAlpha)
+	{
+		int64_t error = 0;
+		*sameAlpha = true;
+		for (int y = 0; y < expected.height; ++y)
+		{
+			const uint8_t* a = actual.Row(y);
+			const uint8_t* e = expected.Row(y);
+			for (int x = 0; x < expected.width; ++x, a += 4, e += 4)
+			{
+				error += std::abs((29 * a[0] + 150 * a[1] + 77 * a[2]) - (29 * e[0] + 150 * e[1] + 77 * e[2]));
+				*sameAlpha = *sameAlpha && a[3] == e[3];
+			}
+		}
+		return static_cast<double>(error) / 256 / (static_cast<double>(expected.width) * expected.height);
+	}
+
+	// Every frame's preview must be a quarter of its size, rounded up, and the
+	// full decode averaged over 4x4 squares of straight samples: exactly for
+	// lossless frames, and in alpha and closely in luma for lossy ones.
+	void TestAverages(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		for (const WebPFrameInfo& frame : container->Frames())
+		{
+			DecodeOptions options;
+			options.colorspace = MODE_BGRA;
+			PixelBuffer full(frame.width, frame.height);
+			DecodeFrame(frame, full.Surface(), options);
+
+			options.preview = true;
+			int width, height;
+			OutputSize(frame.width, frame.height, options, &width, &height);
+			Expect(width == (frame.width + 3) / 4 && height == (frame.height + 3) / 4, "frame %d: a %dx%d preview of %dx%d",
+				frame.frameNum, width, height, frame.width, frame.height);
+			PixelBuffer preview(width, height);
+			DecodeFrame(frame, preview.Surface(), options);
+			PixelBuffer expected = Average(full.Surface());
+			if (frame.header.lossless)
+			{
+				ExpectSamePixels(preview.Surface(), expected.Surface(), Format("frame %d", frame.frameNum));
+				continue;
+			}
+			bool sameAlpha;
+			const double error = LumaError(preview.Surface(), expected.Surface(), &sameAlpha);
+			const bool measured = width >= kMinSize && height >= kMinSize;
+			Expect(sameAlpha && (!measured || error <= kMaxLumaError), "frame %d: the preview is off by %.2f in luma%s", frame.frameNum, error,
+				sameAlpha ? "" : " and in alpha");
+		}
+	}
+
+	// Previews through a DecoderContext that just decoded the frame in full,
+	// with threads, must match previews decoded on their own.
+	void TestContext(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		DecoderContext context;
+		for (const WebPFrameInfo& frame : container->Frames())
+		{
+			DecodeOptions options;
+			options.colorspace = MODE_BGRA;
+			options.useThreads = true;
+			options.context = &context;
+			PixelBuffer full(frame.width, frame.height);
+			DecodeFrame(frame, full.Surface(), options);
+
+			options.preview = true;
+			int width, height;
+			OutputSize(frame.width, frame.height, options, &width, &height);
+			PixelBuffer actual(width, height);
+			DecodeFrame(frame, actual.Surface(), options);
+			DecodeOptions plain;
+			plain.colorspace = MODE_BGRA;
+			plain.preview = true;
+			PixelBuffer expected(width, height);
+			DecodeFrame(frame, expected.Surface(), plain);
+			ExpectSamePixels(actual.Surface(), expected.Surface(), Format("frame %d", frame.frameNum));
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "averages", images, TestAverages);
+	AddPerImage(&tests, "context", images, TestContext);
+	return RunTests(tests);
+}
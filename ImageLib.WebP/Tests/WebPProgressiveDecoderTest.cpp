@@ -0,0 +1,169 @@
+// Checks still images decoded while their bytes arrive against one-shot
+// decodes.
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "../Engine/WebPProgressiveDecoder.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// Feeds 'image' in chunks of 'chunkSize' bytes. Rows must be published in
+	// order, at least 'options.minRows' at a time until the last, and the
+	// result must equal a one-shot decode under the same options. Animations
+	// only need to be recognised as such.
+	void Feed(const TestImage& image, size_t chunkSize, const ProgressiveOptions& options)
+	{
+		PixelBuffer progressive;
+		int targets = 0;
+		int lastRows = 0;
+		WebPProgressiveDecoder decoder(
+			[&](int width, int height)
+			{
+				++targets;
+				progressive = PixelBuffer(width, height);
+				return progressive.Surface();
+			},
+			[&](const PixelSurface&, int rows)
+			{
+				Expect(rows > lastRows, "%d rows published after %d", rows, lastRows);
+				Expect(rows - lastRows >= options.minRows || rows == progressive.Height(), "%d rows published after %d, fewer than %d",
+					rows, lastRows, options.minRows);
+				lastRows = rows;
+			},
+			options);
+		const size_t size = image.source->Size();
+		bool complete = false;
+		for (size_t offset = 0; offset < size && !decoder.IsAnimated(); offset += chunkSize)
+		{
+			complete = decoder.Append(image.source->Data() + offset, std::min(chunkSize, size - offset));
+		}
+		if (decoder.IsAnimated())
+		{
+			Expect(targets == 0, "an animation asked for a target");
+			return;
+		}
+		Expect(complete && decoder.IsComplete() && targets == 1, "incomplete after the whole file");
+		Expect(lastRows == progressive.Height() && decoder.DecodedRows() == lastRows, "%d of %d rows published", lastRows, progressive.Height());
+
+		DecodeOptions decode = options.decode;
+		FitSize(decoder.Width(), decoder.Height(), options.maxWidth, options.maxHeight, &decode.scaledWidth, &decode.scaledHeight);
+		int width, height;
+		OutputSize(decoder.Width(), decoder.Height(), decode, &width, &height);
+		PixelBuffer expected(width, height);
+		DecodeFrame(image.source->Data(), size, expected.Surface(), decode);
+		ExpectSamePixels(progressive.Surface(), expected.Surface(), Format("%zu-byte chunks", chunkSize));
+	}
+
+	void TestChunks(const TestImage& image)
+	{
+		ProgressiveOptions options;
+		options.minRows = 1;
+		options.minIntervalMs = 0;
+		for (size_t chunkSize : { static_cast<size_t>(1), static_cast<size_t>(256), image.source->Size() })
+		{
+			Feed(image, chunkSize, options);
+		}
+	}
+
+	void TestBounded(const TestImage& image)
+	{
+		ProgressiveOptions options;
+		options.minRows = 16;
+		options.minIntervalMs = 0;
+		options.maxWidth = 64;
+		options.maxHeight = 64;
+		options.decode.useThreads = true;
+		Feed(image, 100, options);
+	}
+
+	// Decodes 'frame' with libwebp's incremental decoder under the thread
+	// budget 'threads', appending it in separate buffers of irregular sizes,
+	// down to single bytes, that it reads in place. Each buffer is allocated
+	// on its own, so that reading past one is caught by the memory checkers.
+	PixelBuffer DecodeSegments(const WebPFrameInfo& frame, int threads)
+	{
+		static const size_t kSizes[] = { 1, 5, 64, 1021, 7, 4096 };
+		PixelBuffer pixels(frame.width, frame.height);
+		WebPDecoderConfig config;
+		Expect(WebPInitDecoderConfig(&config) && WebPGetFeatures(frame.payload, frame.payloadSize, &config.input) == VP8_STATUS_OK,
+			"WebPGetFeatures failed");
+		ConfigureOutput(pixels.Surface(), DecodeOptions(), &config);
+		config.options.use_threads = threads;
+		std::vector<std::unique_ptr<uint8_t[]>> segments;
+		std::unique_ptr<WebPIDecoder, decltype(&WebPIDelete)> idec(WebPIDecode(nullptr, 0, &config), WebPIDelete);
+		VP8StatusCode status = VP8_STATUS_SUSPENDED;
+		for (size_t offset = 0, k = 0; offset < frame.payloadSize && status == VP8_STATUS_SUSPENDED; ++k)
+		{
+			const size_t size = std::min(kSizes[k % (sizeof(kSizes) / sizeof(kSizes[0]))], frame.payloadSize - offset);
+			segments.emplace_back(new uint8_t[size]);
+			std::copy(frame.payload + offset, frame.payload + offset + size, segments.back().get());
+			status = WebPIAppendSegment(idec.get(), segments.back().get(), size);
+			offset += size;
+		}
+		Expect(status == VP8_STATUS_OK, "the segments decoded with status %d", status);
+		return pixels;
+	}
+
+	// Every frame appended in segments must decode as it does in one go, with
+	// and without a worker thread.
+	void TestSegments(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		for (const WebPFrameInfo& frame : container->Frames())
+		{
+			PixelBuffer expected = DecodeFrame(frame);
+			for (int threads : { 0, 1 })
+			{
+				PixelBuffer actual = DecodeSegments(frame, threads);
+				ExpectSamePixels(actual.Surface(), expected.Surface(), Format("frame %d with %d threads", frame.frameNum, threads));
+			}
+		}
+	}
+
+	void TestMalformed(const TestImage& image)
+	{
+		std::vector<uint8_t> bytes(image.source->Data(), image.source->Data() + image.source->Size());
+		// Garbles the first chunk tag.
+		std::fill(bytes.begin() + 12, bytes.begin() + 16, 'x');
+		ProgressiveOptions options;
+		WebPProgressiveDecoder decoder(
+			[](int width, int height) { return PixelSurface{ nullptr, width, height, 0 }; },
+			[](const PixelSurface&, int) {},
+			options);
+		bool threw = false;
+		try
+		{
+			decoder.Append(bytes.data(), bytes.size());
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+		Expect(threw, "a garbled file did not throw");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "chunks", images, TestChunks);
+	AddPerImage(&tests, "bounded", images, TestBounded);
+	AddPerImage(&tests, "malformed", images, TestMalformed);
+	// Token partitions before the last are gathered out of the segments.
+	ImageSpec partitions(256, 192);
+	partitions.partitions = 3;
+	partitions.alpha = true;
+	images.push_back(MakeImage("lossy_alpha_partitions", partitions));
+	AddPerImage(&tests, "segments", images, TestSegments);
+	return RunTests(tests);
+}
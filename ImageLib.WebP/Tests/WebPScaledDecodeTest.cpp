@@ -0,0 +1,235 @@
+// Checks decoding straight to a requested size, of frames and of whole
+// animations.
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "../Engine/WebPCompositor.h"
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// Mean absolute difference allowed per channel of premultiplied samples.
+	// libwebp averages straight samples before it premultiplies, and the
+	// compositor blends frames that are already scaled, with their edges
+	// rounded to whole pixels.
+	const double kMaxHalvingError = 4.0;
+
+	// Mean absolute difference allowed per channel of premultiplied samples
+	// between frames averaged down while decoding and rescaled in full. Sharp
+	// edges land a little differently in the two, which makes the most of the
+	// mean below kMinReducedSize.
+	const double kMaxReducingError = 3.0;
+	const int kMinReducedSize = 16;
+
+	// Mean absolute difference per channel between 'scaled' and 'full' averaged
+	// over the 2x2 squares it was halved from.
+	double HalvingError(const PixelSurface& scaled, const PixelSurface& full)
+	{
+		uint64_t error = 0;
+		for (int y = 0; y < scaled.height; ++y)
+		{
+			for (int x = 0; x < scaled.width * 4; ++x)
+			{
+				const int c = x % 4, sx = 2 * (x / 4);
+				const int sum = full.Row(2 * y)[4 * sx + c] + full.Row(2 * y)[4 * (sx + 1) + c] +
+					full.Row(2 * y + 1)[4 * sx + c] + full.Row(2 * y + 1)[4 * (sx + 1) + c];
+				error += std::abs((sum + 2) / 4 - scaled.Row(y)[x]);
+			}
+		}
+		return static_cast<double>(error) / (static_cast<double>(scaled.width) * scaled.height * 4);
+	}
+
+	// Mean absolute difference per channel between two surfaces of one size.
+	double MeanError(const PixelSurface& actual, const PixelSurface& expected)
+	{
+		uint64_t error = 0;
+		for (int y = 0; y < expected.height; ++y)
+		{
+			for (int x = 0; x < expected.width * 4; ++x)
+			{
+				error += std::abs(actual.Row(y)[x] - expected.Row(y)[x]);
+			}
+		}
+		return static_cast<double>(error) / (static_cast<double>(expected.width) * expected.height * 4);
+	}
+
+	// Decodes 'frame' with libwebp under 'options', cropped to the whole frame
+	// if 'whole', which keeps it from being averaged down while decoding.
+	PixelBuffer DecodeScaled(const WebPFrameInfo& frame, const DecodeOptions& options, bool whole)
+	{
+		PixelBuffer pixels(options.scaledWidth, options.scaledHeight);
+		WebPDecoderConfig config;
+		Expect(WebPInitDecoderConfig(&config) && WebPGetFeatures(frame.payload, frame.payloadSize, &config.input) == VP8_STATUS_OK,
+			"WebPGetFeatures failed");
+		ConfigureOutput(pixels.Surface(), options, &config);
+		if (whole)
+		{
+			config.options.use_cropping = 1;
+			config.options.crop_width = frame.width;
+			config.options.crop_height = frame.height;
+		}
+		Expect(WebPDecode(frame.payload, frame.payloadSize, &config) == VP8_STATUS_OK, "WebPDecode failed");
+		return pixels;
+	}
+
+	void TestFitSize()
+	{
+		struct Case
+		{
+			int width, height, maxWidth, maxHeight, expectedWidth, expectedHeight;
+		};
+		static const Case cases[] = {
+			{ 400, 300, 200, 200, 200, 150 },
+			{ 300, 400, 200, 200, 150, 200 },
+			{ 400, 300, 0, 100, 133, 100 },
+			{ 400, 300, 100, 0, 100, 75 },
+			{ 400, 300, 0, 0, 400, 300 },
+			// Never upscales, and keeps at least a pixel.
+			{ 40, 30, 200, 200, 40, 30 },
+			{ 1000, 1, 10, 10, 10, 1 },
+			{ 1, 1000, 10, 10, 1, 10 },
+		};
+		for (const Case& c : cases)
+		{
+			int width, height;
+			FitSize(c.width, c.height, c.maxWidth, c.maxHeight, &width, &height);
+			Expect(width == c.expectedWidth && height == c.expectedHeight, "%dx%d in %dx%d fits as %dx%d, expected %dx%d",
+				c.width, c.height, c.maxWidth, c.maxHeight, width, height, c.expectedWidth, c.expectedHeight);
+		}
+	}
+
+	// Every frame decoded at a size must be what libwebp's rescaler makes of it,
+	// and halving an even size must come close to averaging 2x2 squares.
+	void TestFrames(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const auto& frames = container->Frames();
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			const WebPFrameInfo& frame = frames[i];
+			PixelBuffer full = DecodeFrame(frame);
+			const int sizes[][2] = {
+				{ frame.width / 2, frame.height / 2 },
+				{ frame.width * 2 / 3, frame.height / 3 },
+				{ frame.width * 3 / 2, frame.height * 3 / 2 },
+			};
+			for (const auto& size : sizes)
+			{
+				DecodeOptions options;
+				options.scaledWidth = std::max(1, size[0]);
+				options.scaledHeight = std::max(1, size[1]);
+				int width, height;
+				OutputSize(frame.width, frame.height, options, &width, &height);
+				Expect(width == options.scaledWidth && height == options.scaledHeight, "frame %zu: output size %dx%d", i, width, height);
+				PixelBuffer actual(width, height);
+				DecodeFrame(frame, actual.Surface(), options);
+
+				WebPDecoderConfig config;
+				Expect(WebPInitDecoderConfig(&config) && WebPGetFeatures(frame.payload, frame.payloadSize, &config.input) == VP8_STATUS_OK,
+					"WebPGetFeatures failed on frame %zu", i);
+				PixelBuffer expected(width, height);
+				config.output.colorspace = MODE_bgrA;
+				config.output.is_external_memory = 1;
+				config.output.u.RGBA.rgba = expected.Data();
+				config.output.u.RGBA.stride = expected.Stride();
+				config.output.u.RGBA.size = expected.Size();
+				config.options.no_fancy_upsampling = 1;
+				config.options.use_scaling = 1;
+				config.options.scaled_width = width;
+				config.options.scaled_height = height;
+				Expect(WebPDecode(frame.payload, frame.payloadSize, &config) == VP8_STATUS_OK, "WebPDecode failed on frame %zu", i);
+				ExpectSamePixels(actual.Surface(), expected.Surface(), Format("frame %zu at %dx%d", i, width, height));
+
+				if (frame.width % 2 == 0 && frame.height % 2 == 0 && width == frame.width / 2 && height == frame.height / 2)
+				{
+					const double error = HalvingError(actual.Surface(), full.Surface());
+					Expect(error <= kMaxHalvingError, "frame %zu: halving is off by %.2f per channel", i, error);
+				}
+			}
+		}
+	}
+
+	// Every frame decoded to a fifth and a ninth of its size, letting lossy
+	// frames be averaged down to a half or a quarter while decoding, must come
+	// close to the same rescale of the full-size decode. Frames whose chroma
+	// does not divide by two are not averaged down and must match it.
+	void TestReduced(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		for (const WebPFrameInfo& frame : container->Frames())
+		{
+			for (int scale : { 5, 9 })
+			{
+				DecodeOptions options;
+				options.colorspace = MODE_bgrA;
+				options.scaledWidth = std::max(1, frame.width / scale);
+				options.scaledHeight = std::max(1, frame.height / scale);
+				options.reducedScaling = true;
+				PixelBuffer expected = DecodeScaled(frame, options, true);
+				PixelBuffer actual = DecodeScaled(frame, options, false);
+				const std::string what = Format("frame %d at %dx%d", frame.frameNum, options.scaledWidth, options.scaledHeight);
+				if (frame.header.lossless || frame.width % 4 != 0 || frame.height % 4 != 0)
+				{
+					ExpectSamePixels(actual.Surface(), expected.Surface(), what);
+					continue;
+				}
+				const double error = MeanError(actual.Surface(), expected.Surface());
+				const bool measured = options.scaledWidth >= kMinReducedSize && options.scaledHeight >= kMinReducedSize;
+				Expect(!measured || error <= kMaxReducingError, "%s: averaging down is off by %.2f per channel", what.c_str(), error);
+			}
+		}
+	}
+
+	// A compositor decoding to half the canvas size must come close to the
+	// full-size one averaged over 2x2 squares.
+	void TestCompositor(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		DecodeOptions options;
+		options.scaledWidth = std::max(1, container->CanvasWidth() / 2);
+		options.scaledHeight = std::max(1, container->CanvasHeight() / 2);
+		WebPCompositor full(container);
+		WebPCompositor scaled(container, options);
+		const bool even = container->CanvasWidth() % 2 == 0 && container->CanvasHeight() % 2 == 0;
+		for (int i = 0; i < static_cast<int>(container->Frames().size()); ++i)
+		{
+			const PixelSurface& canvas = scaled.RenderFrame(i);
+			Expect(canvas.width == options.scaledWidth && canvas.height == options.scaledHeight, "frame %d: canvas is %dx%d",
+				i, canvas.width, canvas.height);
+			if (even)
+			{
+				const double error = HalvingError(canvas, full.RenderFrame(i));
+				Expect(error <= kMaxHalvingError, "frame %d: halving is off by %.2f per channel", i, error);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	tests.push_back(TestCase{ "fit size", TestFitSize });
+	AddPerImage(&tests, "frames", images, TestFrames);
+	AddPerImage(&tests, "compositor", images, TestCompositor);
+	// Pictures large enough to be averaged down by four for a ninth, one
+	// whose size is not a multiple of the reduction, and two that are, one
+	// not a multiple of a macroblock.
+	ImageSpec odd(801, 603);
+	odd.alpha = true;
+	images.push_back(MakeImage("lossy_alpha_801x603", odd));
+	images.push_back(MakeImage("lossy_800x608", ImageSpec(800, 608)));
+	ImageSpec even(808, 600);
+	even.alpha = true;
+	images.push_back(MakeImage("lossy_alpha_808x600", even));
+	AddPerImage(&tests, "reduced", images, TestReduced);
+	return RunTests(tests);
+}
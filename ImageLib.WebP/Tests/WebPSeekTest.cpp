@@ -0,0 +1,103 @@
+// Checks seeking in animations through the key frame index and the frame
+// times of the container.
+
+#include <stdexcept>
+#include <vector>
+
+#include "../Engine/WebPCompositor.h"
+#include "../Engine/WebPContainer.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// Seeks a compositor to every frame from the opposite end of the animation
+	// and compares it with one that plays straight through.
+	void TestSeek(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const int frameCount = static_cast<int>(container->Frames().size());
+		WebPCompositor sequential(container);
+		WebPCompositor seeking(container);
+		for (int i = 0; i < frameCount; ++i)
+		{
+			seeking.RenderFrame(frameCount - 1 - i);
+			const PixelSurface& expected = sequential.RenderFrame(i);
+			ExpectSamePixels(seeking.RenderFrame(i), expected, Format("frame %d after frame %d", i, frameCount - 1 - i));
+		}
+	}
+
+	// The first frame is a key frame, as is any later one that covers the
+	// canvas without blending into it, and every frame maps to the last key
+	// frame at or before it.
+	void TestKeyFrames(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const auto& frames = container->Frames();
+		Expect(container->IsKeyFrame(0) && container->KeyFrameFor(0) == 0, "frame 0 is not a key frame");
+		int keyFrame = 0;
+		for (int i = 0; i < static_cast<int>(frames.size()); ++i)
+		{
+			const WebPFrameInfo& frame = frames[i];
+			const bool fullFrame = frame.xOffset == 0 && frame.yOffset == 0 &&
+				frame.width == container->CanvasWidth() && frame.height == container->CanvasHeight();
+			if (fullFrame && (!frame.hasAlpha || !frame.blendWithPreviousFrame))
+			{
+				Expect(container->IsKeyFrame(i), "frame %d covers the canvas but is not a key frame", i);
+			}
+			if (container->IsKeyFrame(i))
+			{
+				keyFrame = i;
+			}
+			Expect(container->KeyFrameFor(i) == keyFrame, "the key frame for frame %d is %d, expected %d", i, container->KeyFrameFor(i), keyFrame);
+		}
+	}
+
+	// Every time within a frame maps back to it, times outside the loop map to
+	// its ends, and start times add up to the total duration.
+	void TestTimes(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const auto& frames = container->Frames();
+		const int last = static_cast<int>(frames.size()) - 1;
+		int start = 0;
+		for (int i = 0; i <= last; ++i)
+		{
+			Expect(container->FrameStartTime(i) == start, "frame %d starts at %d ms, expected %d", i, container->FrameStartTime(i), start);
+			if (frames[i].duration > 0)
+			{
+				Expect(container->FrameAtTime(start) == i && container->FrameAtTime(start + frames[i].duration - 1) == i,
+					"the times of frame %d map to frames %d and %d", i, container->FrameAtTime(start),
+					container->FrameAtTime(start + frames[i].duration - 1));
+			}
+			start += frames[i].duration;
+		}
+		Expect(container->TotalDuration() == start, "the total duration is %d ms, expected %d", container->TotalDuration(), start);
+		Expect(container->FrameAtTime(-1) == 0, "a time before the start maps to frame %d", container->FrameAtTime(-1));
+		Expect(container->FrameAtTime(start) == last && container->FrameAtTime(start + 1000) == last,
+			"times past the end map to frame %d", container->FrameAtTime(start));
+
+		bool threw = false;
+		try
+		{
+			container->FrameStartTime(last + 1);
+		}
+		catch (const std::out_of_range&)
+		{
+			threw = true;
+		}
+		Expect(threw, "the start time of a frame past the end did not throw");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "seek", images, TestSeek);
+	AddPerImage(&tests, "key frames", images, TestKeyFrames);
+	AddPerImage(&tests, "times", images, TestTimes);
+	return RunTests(tests);
+}
@@ -0,0 +1,133 @@
+// Checks that sources hand their bytes to the demuxer in place and keep them
+// alive for as long as anything points into them.
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "../Engine/WebPSource.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// Every frame payload must point into the 'size' bytes at 'data', and
+	// decode as it does from the test image.
+	void ExpectFramesIn(const WebPContainer& container, const uint8_t* data, size_t size, const TestImage& image)
+	{
+		auto reference = WebPContainer::Create(image.source);
+		const auto& frames = container.Frames();
+		Expect(frames.size() == reference->Frames().size(), "%zu frames", frames.size());
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			const WebPFrameInfo& frame = frames[i];
+			Expect(frame.payload >= data && frame.payload + frame.payloadSize <= data + size,
+				"the payload of frame %zu is not in place", i);
+			PixelBuffer expected = DecodeFrame(reference->Frames()[i]);
+			PixelBuffer actual = DecodeFrame(frame);
+			ExpectSamePixels(actual.Surface(), expected.Surface(), Format("frame %zu", i));
+		}
+	}
+
+	void TestVector(const TestImage& image)
+	{
+		std::vector<uint8_t> bytes(image.source->Data(), image.source->Data() + image.source->Size());
+		const uint8_t* data = bytes.data();
+		auto source = WebPSource::FromVector(std::move(bytes));
+		Expect(source->Data() == data && source->Size() == image.source->Size(), "the vector was copied");
+
+		std::vector<uint8_t> more(image.source->Data(), image.source->Data() + image.source->Size());
+		data = more.data();
+		auto container = WebPContainer::Create(std::move(more));
+		ExpectFramesIn(*container, data, image.source->Size(), image);
+	}
+
+	// The owner of borrowed bytes must live exactly as long as the source and
+	// whatever holds on to it.
+	void TestBorrow(const TestImage& image)
+	{
+		auto bytes = std::make_shared<std::vector<uint8_t>>(image.source->Data(), image.source->Data() + image.source->Size());
+		std::weak_ptr<std::vector<uint8_t>> watch = bytes;
+		auto source = WebPSource::Borrow(bytes->data(), bytes->size(), bytes);
+		const uint8_t* data = bytes->data();
+		bytes.reset();
+		Expect(!watch.expired(), "the source released its owner");
+
+		auto container = WebPContainer::Create(source);
+		source.reset();
+		Expect(!watch.expired(), "the container released the source");
+		ExpectFramesIn(*container, data, image.source->Size(), image);
+		container.reset();
+		Expect(watch.expired(), "the owner outlived the container");
+	}
+
+	void TestMap(const TestImage& image)
+	{
+		namespace fs = std::filesystem;
+		const fs::path path = fs::temp_directory_path() / ("WebPSourceTest_" + std::to_string(::getpid()) + ".webp");
+		FILE* file = std::fopen(path.string().c_str(), "wb");
+		Expect(file != nullptr, "cannot create %s", path.string().c_str());
+		const bool written = std::fwrite(image.source->Data(), 1, image.source->Size(), file) == image.source->Size();
+		std::fclose(file);
+		Expect(written, "cannot write %s", path.string().c_str());
+
+		auto source = WebPSource::MapFile(path.string().c_str());
+		fs::remove(path);
+		Expect(source->Size() == image.source->Size() &&
+			std::equal(source->Data(), source->Data() + source->Size(), image.source->Data()), "the mapping differs from the file");
+		auto container = WebPContainer::Create(source);
+		ExpectFramesIn(*container, source->Data(), source->Size(), image);
+	}
+
+	void TestMapErrors()
+	{
+		namespace fs = std::filesystem;
+		bool threw = false;
+		try
+		{
+			WebPSource::MapFile((fs::temp_directory_path() / "WebPSourceTest_missing.webp").string().c_str());
+		}
+		catch (const std::runtime_error&)
+		{
+			threw = true;
+		}
+		Expect(threw, "mapping a missing file did not throw");
+
+		const fs::path path = fs::temp_directory_path() / ("WebPSourceTest_" + std::to_string(::getpid()) + ".empty");
+		std::fclose(std::fopen(path.string().c_str(), "wb"));
+		auto empty = WebPSource::MapFile(path.string().c_str());
+		fs::remove(path);
+		Expect(empty->Size() == 0, "an empty file maps to %zu bytes", empty->Size());
+		threw = false;
+		try
+		{
+			WebPContainer::Create(empty);
+		}
+		catch (const std::invalid_argument&)
+		{
+			threw = true;
+		}
+		Expect(threw, "demuxing an empty file did not throw");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "vector", images, TestVector);
+	AddPerImage(&tests, "borrow", images, TestBorrow);
+	AddPerImage(&tests, "map", images, TestMap);
+	tests.push_back(TestCase{ "map errors", TestMapErrors });
+	return RunTests(tests);
+}
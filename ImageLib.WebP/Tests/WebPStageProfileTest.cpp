@@ -0,0 +1,189 @@
+// Checks that stage profiles time the stages each decode and encode goes
+// through, on every thread, and record them for traces.
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	const WebPProfileStage kEncoderStages[] = {
+		WEBP_STAGE_ENC_CONVERT, WEBP_STAGE_ENC_ANALYZE, WEBP_STAGE_ENC_CODE,
+		WEBP_STAGE_ENC_ALPHA, WEBP_STAGE_ENC_WRITE, WEBP_STAGE_ENC_LOSSLESS,
+	};
+
+	uint64_t TotalCalls(const StageProfile& profile)
+	{
+		uint64_t calls = 0;
+		for (int stage = 0; stage < WEBP_STAGE_COUNT; ++stage)
+		{
+			calls += profile.Calls(static_cast<WebPProfileStage>(stage));
+		}
+		return calls;
+	}
+
+	// A serial decode of every frame, at its size and at half of it, must run
+	// the stages of its format and no others, and take no more time in them
+	// than the decode took.
+	void TestStages(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		for (const WebPFrameInfo& frame : container->Frames())
+		{
+			for (int scale : { 1, 2 })
+			{
+				StageProfile profile;
+				DecodeOptions options;
+				options.profile = &profile;
+				options.scaledWidth = std::max(1, frame.width / scale);
+				options.scaledHeight = std::max(1, frame.height / scale);
+				PixelBuffer pixels(options.scaledWidth, options.scaledHeight);
+				const uint64_t start = WebPProfileNow();
+				DecodeFrame(frame, pixels.Surface(), options);
+				const uint64_t elapsed = WebPProfileNow() - start;
+
+				const std::string what = Format("frame %d at %dx%d", frame.frameNum, options.scaledWidth, options.scaledHeight);
+				const bool lossless = frame.header.lossless;
+				Expect(profile.Calls(WEBP_STAGE_HEADERS) > 0, "%s: no headers", what.c_str());
+				Expect((profile.Calls(WEBP_STAGE_PARSE) > 0) == !lossless && (profile.Calls(WEBP_STAGE_RECONSTRUCT) > 0) == !lossless,
+					"%s: lossy stages ran %llu times", what.c_str(), static_cast<unsigned long long>(profile.Calls(WEBP_STAGE_PARSE)));
+				// Compressed alpha planes are lossless images of their own.
+				Expect(lossless ? profile.Calls(WEBP_STAGE_ENTROPY) > 0 : frame.header.alphaSize > 0 || profile.Calls(WEBP_STAGE_ENTROPY) == 0,
+					"%s: lossless stages ran %llu times", what.c_str(), static_cast<unsigned long long>(profile.Calls(WEBP_STAGE_ENTROPY)));
+				Expect((profile.Calls(WEBP_STAGE_ALPHA) > 0) == (frame.header.alphaSize > 0), "%s: the alpha stage ran %llu times",
+					what.c_str(), static_cast<unsigned long long>(profile.Calls(WEBP_STAGE_ALPHA)));
+				const bool rescaled = options.scaledWidth != frame.width || options.scaledHeight != frame.height;
+				Expect((profile.Calls(WEBP_STAGE_RESCALE) > 0) == rescaled, "%s: rescaling ran %llu times", what.c_str(),
+					static_cast<unsigned long long>(profile.Calls(WEBP_STAGE_RESCALE)));
+				for (WebPProfileStage stage : kEncoderStages)
+				{
+					Expect(profile.Calls(stage) == 0, "%s: the encoder stage %s ran", what.c_str(), WebPProfileStageName(stage));
+				}
+				Expect(profile.TotalNanoseconds() <= elapsed, "%s: %llu ns in stages of a %llu ns decode", what.c_str(),
+					static_cast<unsigned long long>(profile.TotalNanoseconds()), static_cast<unsigned long long>(elapsed));
+			}
+		}
+	}
+
+	// Runs past the event buffer are counted but dropped, and the trace holds
+	// one complete event per recorded run until the profile is reset.
+	void TestEvents(const TestImage& image)
+	{
+		WebPFrameInfo frame;
+		Expect(FindFirstFrame(image.source->Data(), image.source->Size(), &frame), "no first frame");
+		for (size_t maxEvents : { static_cast<size_t>(0), static_cast<size_t>(3), static_cast<size_t>(100000) })
+		{
+			StageProfile profile(maxEvents);
+			DecodeOptions options;
+			options.profile = &profile;
+			PixelBuffer pixels(frame.width, frame.height);
+			DecodeFrame(frame, pixels.Surface(), options);
+
+			const uint64_t runs = TotalCalls(profile);
+			const uint64_t recorded = std::min<uint64_t>(runs, maxEvents);
+			Expect(profile.Get()->num_events == runs && profile.DroppedEvents() == runs - recorded,
+				"%llu runs, %llu events and %llu dropped with room for %zu", static_cast<unsigned long long>(runs),
+				static_cast<unsigned long long>(profile.Get()->num_events), static_cast<unsigned long long>(profile.DroppedEvents()), maxEvents);
+			const std::string trace = profile.ChromeTrace();
+			size_t events = 0;
+			for (size_t at = trace.find("\"ph\":\"X\""); at != std::string::npos; at = trace.find("\"ph\":\"X\"", at + 1))
+			{
+				++events;
+			}
+			Expect(trace.find("{\"displayTimeUnit\"") == 0 && events == recorded, "the trace holds %zu events, expected %llu",
+				events, static_cast<unsigned long long>(recorded));
+
+			profile.Reset();
+			Expect(TotalCalls(profile) == 0 && profile.TotalNanoseconds() == 0 && profile.DroppedEvents() == 0 &&
+				profile.ChromeTrace().find("\"ph\"") == std::string::npos, "Reset() left runs behind");
+		}
+	}
+
+	// A lossy decode with threads must record the stages of the workers under
+	// thread numbers of their own.
+	void TestThreads(const TestImage& image)
+	{
+		WebPFrameInfo frame;
+		Expect(FindFirstFrame(image.source->Data(), image.source->Size(), &frame), "no first frame");
+		StageProfile profile(10000);
+		DecodeOptions options;
+		options.profile = &profile;
+		options.useThreads = true;
+		PixelBuffer pixels(frame.width, frame.height);
+		DecodeFrame(frame, pixels.Surface(), options);
+		Expect(profile.DroppedEvents() == 0, "events dropped");
+		std::set<uint32_t> threads;
+		const WebPProfile& events = *profile.Get();
+		for (uint64_t i = 0; i < events.num_events; ++i)
+		{
+			threads.insert(events.events[i].thread);
+		}
+		Expect(threads.size() >= 2, "runs on %zu threads", threads.size());
+		Expect(profile.Calls(WEBP_STAGE_FILTER) > 0, "no filtering");
+	}
+
+	// Encoding lossy and lossless pictures under a scope must run the stages
+	// of the encoder.
+	void TestEncoder()
+	{
+		StageProfile profile;
+		{
+			ProfileScope scope(&profile);
+			ImageSpec lossy(96, 64);
+			lossy.alpha = true;
+			Encode(lossy);
+			ImageSpec lossless(96, 64);
+			lossless.lossless = true;
+			Encode(lossless);
+		}
+		for (WebPProfileStage stage : kEncoderStages)
+		{
+			Expect(profile.Calls(stage) > 0, "the encoder stage %s did not run", WebPProfileStageName(stage));
+		}
+		Expect(profile.Calls(WEBP_STAGE_PARSE) == 0 && profile.Calls(WEBP_STAGE_ENTROPY) == 0, "decoder stages ran");
+	}
+
+	// Scopes profile the calling thread into their profile and restore the one
+	// before them; a scope without a profile changes nothing.
+	void TestScopes()
+	{
+		WebPProfile* const initial = WebPGetThreadProfile();
+		StageProfile outer, inner;
+		{
+			ProfileScope outerScope(&outer);
+			Expect(WebPGetThreadProfile() == outer.Get(), "the outer scope is not in effect");
+			{
+				ProfileScope innerScope(&inner);
+				Expect(WebPGetThreadProfile() == inner.Get(), "the inner scope is not in effect");
+				{
+					ProfileScope none(nullptr);
+					Expect(WebPGetThreadProfile() == inner.Get(), "a scope without a profile replaced the thread's");
+				}
+			}
+			Expect(WebPGetThreadProfile() == outer.Get(), "the inner scope did not restore the outer one");
+		}
+		Expect(WebPGetThreadProfile() == initial, "the outer scope did not restore the thread's profile");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	// Wide enough for libwebp to filter on a worker.
+	const TestImage wide = MakeImage("lossy_wide", ImageSpec(640, 256));
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "stages", images, TestStages);
+	AddPerImage(&tests, "events", images, TestEvents);
+	tests.push_back(TestCase{ "threads", [&wide] { TestThreads(wide); } });
+	tests.push_back(TestCase{ "encoder", TestEncoder });
+	tests.push_back(TestCase{ "scopes", TestScopes });
+	return RunTests(tests);
+}
@@ -0,0 +1,170 @@
+// Checks files demuxed and played while their bytes arrive against the whole
+// file.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../Engine/WebPCompositor.h"
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameRing.h"
+#include "../Engine/WebPStreamingDemuxer.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// Chunk sizes fed in turn, down to single bytes, as a download delivers.
+	const size_t kSizes[] = { 1, 5, 64, 1021, 7, 4096 };
+
+	// Size of the 'index'th chunk of a file with 'remaining' bytes left.
+	size_t ChunkSize(size_t index, size_t remaining)
+	{
+		return std::min(kSizes[index % (sizeof(kSizes) / sizeof(kSizes[0]))], remaining);
+	}
+
+	// Frame 'index' of 'actual' must be the one of 'expected', down to its bytes.
+	void ExpectSameFrame(const WebPContainer& actual, const WebPContainer& expected, int index)
+	{
+		const WebPFrameInfo& a = actual.Frames()[index];
+		const WebPFrameInfo& e = expected.Frames()[index];
+		Expect(a.xOffset == e.xOffset && a.yOffset == e.yOffset && a.width == e.width && a.height == e.height &&
+			a.duration == e.duration && a.hasAlpha == e.hasAlpha && a.disposeToBackgroundColor == e.disposeToBackgroundColor &&
+			a.blendWithPreviousFrame == e.blendWithPreviousFrame, "frame %d is placed differently", index);
+		Expect(a.payloadSize == e.payloadSize && !std::memcmp(a.payload, e.payload, e.payloadSize), "frame %d holds other bytes", index);
+		Expect(actual.IsKeyFrame(index) == expected.IsKeyFrame(index) && actual.FrameStartTime(index) == expected.FrameStartTime(index),
+			"frame %d is timed differently", index);
+	}
+
+	// Every snapshot, whether the file fits in the buffer from the start or
+	// makes it grow, must begin with the frames of the whole file, and still
+	// hold them after the rest of the file has arrived.
+	void TestSnapshots(const TestImage& image)
+	{
+		auto whole = WebPContainer::Create(image.source);
+		const size_t size = image.source->Size();
+		for (size_t expectedSize : { static_cast<size_t>(0), size })
+		{
+			WebPStreamingDemuxer demuxer(expectedSize);
+			std::vector<std::shared_ptr<WebPContainer>> snapshots;
+			for (size_t offset = 0, k = 0; offset < size; ++k)
+			{
+				const size_t chunk = ChunkSize(k, size - offset);
+				const bool changed = demuxer.Append(image.source->Data() + offset, chunk);
+				offset += chunk;
+				Expect(demuxer.Received() == offset, "%zu bytes received of %zu", demuxer.Received(), offset);
+				if (!changed)
+				{
+					continue;
+				}
+				const auto& container = demuxer.Container();
+				Expect(container->CanvasWidth() == whole->CanvasWidth() && container->CanvasHeight() == whole->CanvasHeight() &&
+					container->Frames().size() <= whole->Frames().size(), "a %dx%d snapshot of %zu frames", container->CanvasWidth(),
+					container->CanvasHeight(), container->Frames().size());
+				Expect(demuxer.IsComplete() == (offset == size), "complete after %zu of %zu bytes", offset, size);
+				snapshots.push_back(container);
+			}
+			Expect(demuxer.IsComplete() && demuxer.Container()->Frames().size() == whole->Frames().size(),
+				"%zu of %zu frames after the whole file", demuxer.Container()->Frames().size(), whole->Frames().size());
+			Expect(demuxer.Container()->LoopCount() == whole->LoopCount() && demuxer.Container()->TotalDuration() == whole->TotalDuration(),
+				"the complete file plays differently");
+			for (const auto& snapshot : snapshots)
+			{
+				for (int i = 0; i < static_cast<int>(snapshot->Frames().size()); ++i)
+				{
+					ExpectSameFrame(*snapshot, *whole, i);
+				}
+			}
+		}
+	}
+
+	// A ring that gets every new snapshot must play the frames in order,
+	// waiting at the end of a partial file rather than wrapping around, then
+	// carry on into the second loop, each frame equal to the compositor over
+	// the whole file.
+	void TestPlayback(const TestImage& image)
+	{
+		auto whole = WebPContainer::Create(image.source);
+		const int frameCount = static_cast<int>(whole->Frames().size());
+		WebPCompositor compositor(whole);
+		WebPStreamingDemuxer demuxer;
+		std::unique_ptr<WebPFrameRing> ring;
+		int played = 0;
+		auto play = [&](const WebPFrameRing::Frame& frame)
+		{
+			const int index = played++ % frameCount;
+			Expect(frame.index == index, "frame %d played instead of %d", frame.index, index);
+			ExpectSamePixels(*frame.surface, compositor.RenderFrame(index), Format("frame %d", index));
+		};
+
+		const size_t size = image.source->Size();
+		for (size_t offset = 0, k = 0; offset < size; ++k)
+		{
+			const size_t chunk = ChunkSize(k, size - offset);
+			if (demuxer.Append(image.source->Data() + offset, chunk) && !demuxer.Container()->Frames().empty())
+			{
+				if (ring != nullptr)
+				{
+					ring->Update(demuxer.Container());
+				}
+				else
+				{
+					ring = std::make_unique<WebPFrameRing>(demuxer.Container(), 0);
+					ring->Start(0);
+				}
+			}
+			offset += chunk;
+			WebPFrameRing::Frame frame;
+			while (ring != nullptr && ring->Advance(&frame))
+			{
+				play(frame);
+			}
+		}
+
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+		while (played < frameCount * 2)
+		{
+			WebPFrameRing::Frame frame;
+			while (!ring->Advance(&frame))
+			{
+				Expect(std::chrono::steady_clock::now() < deadline, "%d frames played after 30 s", played);
+				std::this_thread::yield();
+			}
+			play(frame);
+		}
+	}
+
+	// A bare bitstream has no RIFF header to tell when the file ends.
+	void TestBare(const TestImage& image)
+	{
+		auto whole = WebPContainer::Create(image.source);
+		const WebPFrameInfo& frame = whole->Frames()[0];
+		WebPStreamingDemuxer demuxer;
+		bool threw = false;
+		try
+		{
+			demuxer.Append(frame.payload, frame.payloadSize);
+		}
+		catch (const std::invalid_argument&)
+		{
+			threw = true;
+		}
+		Expect(threw && demuxer.Container() == nullptr, "a bare bitstream was demuxed");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const auto images = Corpus(argc, argv);
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "snapshots", images, TestSnapshots);
+	AddPerImage(&tests, "playback", images, TestPlayback);
+	AddPerImage(&tests, "bare", images, TestBare);
+	return RunTests(tests);
+}
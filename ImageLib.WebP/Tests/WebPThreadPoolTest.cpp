@@ -0,0 +1,149 @@
+// Checks the shared thread pool, on its own and behind libwebp's workers.
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../../libwebp/utils/thread_utils.h"
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "../Engine/WebPProgressiveDecoder.h"
+#include "../Engine/WebPThreadPool.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	void TestParallelFor()
+	{
+		WebPThreadPool pool(3);
+		std::vector<std::atomic<int>> runs(1000);
+		pool.ParallelFor(static_cast<int>(runs.size()), [&runs](int i) { runs[i].fetch_add(1); });
+		for (size_t i = 0; i < runs.size(); ++i)
+		{
+			Expect(runs[i].load() == 1, "task %zu ran %d times", i, runs[i].load());
+		}
+		const WebPThreadPool::Stats stats = pool.GetStats();
+		Expect(stats.workers == 3 && stats.tasksRun == runs.size() && stats.queueDepth == 0,
+			"%d workers ran %llu tasks, %d left queued", stats.workers, static_cast<unsigned long long>(stats.tasksRun), stats.queueDepth);
+
+		bool threw = false;
+		try
+		{
+			pool.ParallelFor(10, [](int i)
+			{
+				if (i == 7)
+				{
+					throw std::logic_error("task 7");
+				}
+			});
+		}
+		catch (const std::logic_error&)
+		{
+			threw = true;
+		}
+		Expect(threw, "an exception thrown by a task was not rethrown");
+	}
+
+	// Decodes every frame of every image with threads, on four threads at once
+	// through the installed pool, and compares with serial decodes.
+	void TestDecodes(const std::vector<TestImage>& images)
+	{
+		std::vector<WebPFrameInfo> frames;
+		std::vector<std::shared_ptr<WebPContainer>> containers;
+		std::vector<PixelBuffer> expected;
+		for (const auto& image : images)
+		{
+			containers.push_back(WebPContainer::Create(image.source));
+			for (const WebPFrameInfo& frame : containers.back()->Frames())
+			{
+				frames.push_back(frame);
+				expected.push_back(DecodeFrame(frame));
+			}
+		}
+
+		WebPThreadPool::Install(3);
+		Expect(WebPThreadPool::Installed() != nullptr, "no pool installed");
+		std::vector<int> mismatches(4, -1);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; ++t)
+		{
+			threads.emplace_back([&, t]
+			{
+				for (size_t i = t; i < frames.size(); i += 4)
+				{
+					DecodeOptions options;
+					options.useThreads = true;
+					PixelBuffer actual(frames[i].width, frames[i].height);
+					DecodeFrame(frames[i], actual.Surface(), options);
+					if (mismatches[t] < 0 && std::memcmp(actual.Data(), expected[i].Data(), expected[i].Size()))
+					{
+						mismatches[t] = static_cast<int>(i);
+					}
+				}
+			});
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		const uint64_t tasksRun = WebPThreadPool::Installed()->GetStats().tasksRun;
+		Expect(WebPThreadPool::Uninstall() && WebPThreadPool::Installed() == nullptr, "the pool stayed installed");
+		for (int mismatch : mismatches)
+		{
+			Expect(mismatch < 0, "frame %d differs from a serial decode", mismatch);
+		}
+		Expect(tasksRun > 0, "the pool ran no tasks");
+	}
+
+	// A worker between Reset() and End() holds a job of the pool, as do the
+	// workers of an incremental decode stopped halfway, so the pool must stay
+	// installed until they are done with it.
+	void TestUninstall(const TestImage& image)
+	{
+		WebPThreadPool::Install(2);
+		const WebPWorkerInterface* const workers = WebPGetWorkerInterface();
+		WebPWorker worker;
+		workers->Init(&worker);
+		Expect(workers->Reset(&worker) != 0, "Reset failed");
+		Expect(!WebPThreadPool::Uninstall(), "uninstalled while a worker holds a job");
+		workers->End(&worker);
+
+		{
+			ProgressiveOptions options;
+			options.decode.useThreads = true;
+			PixelBuffer pixels;
+			WebPProgressiveDecoder decoder(
+				[&pixels](int width, int height)
+				{
+					pixels = PixelBuffer(width, height);
+					return pixels.Surface();
+				},
+				[](const PixelSurface&, int) {},
+				options);
+			decoder.Append(image.source->Data(), image.source->Size() / 2);
+			Expect(decoder.DecodedRows() > 0, "no rows decoded from half the file");
+			Expect(!WebPThreadPool::Uninstall(), "uninstalled while an incremental decode holds a job");
+		}
+		Expect(WebPThreadPool::Uninstall() && WebPThreadPool::Installed() == nullptr, "the pool stayed installed once its jobs ended");
+		Expect(WebPThreadPool::Uninstall(), "uninstalling with no pool failed");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	auto images = Corpus(argc, argv);
+	// Wide enough for libwebp to filter on a worker, with a single token
+	// partition, so that half the file decodes half the rows.
+	const TestImage lossy = MakeImage("lossy_wide", ImageSpec(640, 256));
+	images.push_back(lossy);
+	std::vector<TestCase> tests;
+	tests.push_back(TestCase{ "parallel for", TestParallelFor });
+	tests.push_back(TestCase{ "decodes", [&images] { TestDecodes(images); } });
+	tests.push_back(TestCase{ "uninstall", [&lossy] { TestUninstall(lossy); } });
+	return RunTests(tests);
+}
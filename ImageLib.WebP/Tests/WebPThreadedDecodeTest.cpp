@@ -0,0 +1,130 @@
+// Checks frames decoded on several threads against single-threaded decodes.
+
+#include <algorithm>
+#include <vector>
+
+#include "../Engine/WebPContainer.h"
+#include "../Engine/WebPFrameDecoder.h"
+#include "TestSupport.h"
+
+using namespace ImageLib::WebP::Engine;
+using namespace ImageLib::WebP::Tests;
+
+namespace
+{
+	// Thread budgets that parse from two to all token partitions at once.
+	const int kThreadBudgets[] = { 1, 3, 5, 9 };
+
+	// Thread budgets that leave reconstruction and filtering one wave worker,
+	// a few, or more than there are spans in a row.
+	const int kWavefrontBudgets[] = { 2, 4, 12, 16 };
+
+	// Decodes 'frame' with libwebp under the thread budget 'threads', where 0
+	// decodes on the calling thread alone, with lossy dithering of strength
+	// 'dithering' and alpha dithering of strength 'alphaDithering'.
+	PixelBuffer Decode(const WebPFrameInfo& frame, const DecodeOptions& options, int threads, int dithering = 0, int alphaDithering = 0)
+	{
+		int width, height;
+		OutputSize(frame.width, frame.height, options, &width, &height);
+		PixelBuffer pixels(width, height);
+		WebPDecoderConfig config;
+		Expect(WebPInitDecoderConfig(&config) && WebPGetFeatures(frame.payload, frame.payloadSize, &config.input) == VP8_STATUS_OK,
+			"WebPGetFeatures failed");
+		ConfigureOutput(pixels.Surface(), options, &config);
+		config.options.use_threads = threads;
+		config.options.dithering_strength = dithering;
+		// Dequantizes alpha planes stored with reduced levels.
+		config.options.alpha_dithering_strength = alphaDithering;
+		Expect(WebPDecode(frame.payload, frame.payloadSize, &config) == VP8_STATUS_OK, "WebPDecode failed with %d threads", threads);
+		return pixels;
+	}
+
+	// Every frame must decode the same under every thread budget, at its
+	// natural size and rescaled to a half, which lossless frames do on the
+	// worker that emits their rows, and to a fifth and a ninth, letting lossy
+	// frames be averaged down while decoding, with and without alpha
+	// dithering, which smooths the alpha plane in strips on several threads.
+	void TestThreads(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const auto& frames = container->Frames();
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			for (int scale : { 1, 2, 5, 9 })
+			{
+				DecodeOptions options;
+				options.scaledWidth = std::max(1, frames[i].width / scale);
+				options.scaledHeight = std::max(1, frames[i].height / scale);
+				options.reducedScaling = scale > 2;
+				for (int alphaDithering : { 0, 100 })
+				{
+					PixelBuffer expected = Decode(frames[i], options, 0, 0, alphaDithering);
+					for (int threads : kThreadBudgets)
+					{
+						PixelBuffer actual = Decode(frames[i], options, threads, 0, alphaDithering);
+						ExpectSamePixels(actual.Surface(), expected.Surface(), Format("frame %zu at %dx%d with %d threads and alpha dithering %d",
+							i, options.scaledWidth, options.scaledHeight, threads, alphaDithering));
+					}
+				}
+			}
+		}
+	}
+
+	// Reconstruction and filtering split into spans of rows must decode as
+	// the rows one at a time do, as must dithering, which stays on a single
+	// worker since it draws its random numbers in raster order.
+	void TestWavefront(const TestImage& image)
+	{
+		auto container = WebPContainer::Create(image.source);
+		const auto& frames = container->Frames();
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			const DecodeOptions options;
+			for (int dithering : { 0, 100 })
+			{
+				PixelBuffer expected = Decode(frames[i], options, 0, dithering);
+				for (int threads : kWavefrontBudgets)
+				{
+					PixelBuffer actual = Decode(frames[i], options, threads, dithering);
+					ExpectSamePixels(actual.Surface(), expected.Surface(),
+						Format("frame %zu with %d threads and dithering %d", i, threads, dithering));
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	auto images = Corpus(argc, argv);
+	// libwebp only decodes lossy frames on several threads from 512 pixels
+	// wide, and only parses in parallel with more than one token partition.
+	ImageSpec partitions(1024, 384);
+	partitions.partitions = 3;
+	images.push_back(MakeImage("lossy_partitions", partitions));
+	ImageSpec twoPartitions(545, 300);
+	twoPartitions.partitions = 1;
+	twoPartitions.alpha = true;
+	images.push_back(MakeImage("lossy_alpha_partitions", twoPartitions));
+	// Rows of 63 macroblocks, which the wavefront does not split evenly, and
+	// the simple loop filter.
+	ImageSpec simpleFilter(1000, 700);
+	simpleFilter.partitions = 2;
+	simpleFilter.filterType = 0;
+	images.push_back(MakeImage("lossy_simple_filter", simpleFilter));
+	// An alpha plane with reduced levels, decoded in several chunks ahead of
+	// the rows, the last one partial.
+	ImageSpec alphaLevels(700, 230);
+	alphaLevels.alpha = true;
+	alphaLevels.alphaQuality = 40;
+	images.push_back(MakeImage("lossy_alpha_levels", alphaLevels));
+	// Many blocks of rows for the lossless pipeline, the last one partial.
+	ImageSpec lossless(600, 411);
+	lossless.lossless = true;
+	lossless.alpha = true;
+	images.push_back(MakeImage("lossless_tall", lossless));
+	std::vector<TestCase> tests;
+	AddPerImage(&tests, "threads", images, TestThreads);
+	AddPerImage(&tests, "wavefront", images, TestWavefront);
+	return RunTests(tests);
+}
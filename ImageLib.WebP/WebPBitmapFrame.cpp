@@ -15,39 +15,23 @@ WebPBitmapFrame::WebPBitmapFrame()
 
 WriteableBitmap^ WebPBitmapFrame::RenderFrame()
 {
-	WebPDecoderConfig config;
-	int ret = WebPInitDecoderConfig(&config);
-	if (!ret)
+	WriteableBitmap^ bitmap = ref new WriteableBitmap(info.width, info.height);
+	try
 	{
-		throw ref new FailureException(ref new String(L"WebPInitDecoderConfig failed"));
+		Engine::DecodeFrame(info, GetPixelSurface(bitmap));
 	}
-	const uint8_t* pPayload = this->pPayload;
-	size_t payloadSize = this->payloadSize;
-	ret = (WebPGetFeatures(pPayload, payloadSize, &config.input) == VP8_STATUS_OK);
-	if (!ret)
+	catch (const std::exception& e)
 	{
-		throw ref new FailureException(ref new String(L"WebPGetFeatures failed"));
+		throw ref new FailureException(ToPlatformString(e));
 	}
-	WriteableBitmap^ bitmap = ref new WriteableBitmap(this->width, this->height);
+	return bitmap;
+}
 
+Engine::PixelSurface WebPBitmapFrame::GetPixelSurface(WriteableBitmap^ bitmap)
+{
 	unsigned int length;
 	uint8_t* pixels = GetPointerToPixelData(bitmap->PixelBuffer, &length);
-
-	config.options.no_fancy_upsampling = 1;
-	config.output.colorspace = MODE_bgrA;
-	config.output.is_external_memory = 1;
-	config.output.u.RGBA.rgba = pixels;
-	config.output.u.RGBA.stride = this->width * 4;
-	config.output.u.RGBA.size = (this->width * 4) * this->height;
-
-	ret = WebPDecode(pPayload, payloadSize, &config);
-
-	if (ret != VP8_STATUS_OK)
-	{
-		throw ref new FailureException(ref new String(L"Failed to decode frame"));
-	}
-
-	return bitmap;
+	return Engine::PixelSurface{ pixels, bitmap->PixelWidth, bitmap->PixelHeight, bitmap->PixelWidth * 4 };
 }
 
 uint8_t* WebPBitmapFrame::GetPointerToPixelData(IBuffer^ pixelBuffer, unsigned int *length)
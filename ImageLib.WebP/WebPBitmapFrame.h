@@ -16,39 +16,32 @@ namespace ImageLib
 		{
 		internal:
 			WebPBitmapFrame();
-			std::shared_ptr<WebPDemuxerWrapper> spDemuxer;
-			int frameNum;
-			Point offset;
-			int duration;
-			int width;
-			int height;
-			bool disposeToBackgroundColor;
-			bool blendWithPreviousFrame;
-			const uint8_t* pPayload;
-			size_t payloadSize;
+			std::shared_ptr<Engine::WebPContainer> spContainer;
+			Engine::WebPFrameInfo info;
 			static uint8_t* GetPointerToPixelData(IBuffer^ pixelBuffer, unsigned int *length);
+			static Engine::PixelSurface GetPixelSurface(WriteableBitmap^ bitmap);
 
 		public:
 			WriteableBitmap^ RenderFrame();
 
 			property int PixelWidth
 			{
-				int get() { return width; }
+				int get() { return info.width; }
 			}
 
 			property int PixelHeight
 			{
-				int get() { return height; }
+				int get() { return info.height; }
 			}
 
 			property int Duration
 			{
-				int get() { return duration; }
+				int get() { return info.duration; }
 			}
 
 			property Point Offset
 			{
-				Point get() { return offset; }
+				Point get() { return Point(static_cast<float>(info.xOffset), static_cast<float>(info.yOffset)); }
 			}
 		};
 	}
@@ -14,8 +14,29 @@ using namespace Microsoft::WRL::Details;
 using namespace Windows::UI::Core;
 using namespace Platform::Collections;
 
+namespace
+{
+	// Reads 'stream' in chunks of up to 'chunkSize' bytes as they become
+	// available, until it ends or 'consume' returns false.
+	task<void> ReadChunksAsync(IInputStream^ stream, unsigned int chunkSize, std::function<bool(IBuffer^)> consume)
+	{
+		auto buffer = ref new Buffer(chunkSize);
+		return create_task(stream->ReadAsync(buffer, chunkSize, InputStreamOptions::Partial))
+			.then([stream, chunkSize, consume](IBuffer^ chunk)
+		{
+			if (chunk->Length == 0 || !consume(chunk))
+			{
+				return task_from_result();
+			}
+			return ReadChunksAsync(stream, chunkSize, consume);
+		});
+	}
+}
+
 WebPDecoder::WebPDecoder()
 {
+	// Decodes share a fixed set of worker threads instead of starting one each.
+	WebPImage::EnsureThreadPool();
 }
 
 int ImageLib::WebP::WebPDecoder::GetPriority(Windows::Storage::Streams::IBuffer ^headerBuffer)
@@ -32,6 +53,9 @@ void ImageLib::WebP::WebPDecoder::Start()
 		if (_animationTimer != nullptr) {
 			_animationTimer->Stop();
 		}
+		if (_webPImage != nullptr) {
+			_webPImage->StartPrefetch(_webPImage->NextFrame(0), _prefetchBudget);
+		}
 		_animationTimer = ref new DispatcherTimer();
 		_animationTimer->Tick += ref new Windows::Foundation::EventHandler<Platform::Object ^>(this, &ImageLib::WebP::WebPDecoder::OnTick);
 		_animationTimer->Interval = TimeSpan{ 0 };
@@ -50,6 +74,9 @@ void ImageLib::WebP::WebPDecoder::Stop()
 	if (_animationTimer != nullptr) {
 		_animationTimer->Stop();
 	}
+	if (_webPImage != nullptr) {
+		_webPImage->StopPrefetch();
+	}
 	_isAnimating = false;
 }
 
@@ -61,14 +88,22 @@ void ImageLib::WebP::WebPDecoder::OnTick(Platform::Object ^sender, Platform::Obj
 		return;
 	}
 
-	// Increment frame index and loop count
-	_currentFrameIndex++;
-	if (_currentFrameIndex >= webPImage->Frames->Length)
+	// Take the next frame composited by the background decoder. If it is still
+	// working, check again shortly rather than decoding on the UI thread.
+	int frameIndex;
+	auto canvas = webPImage->NextPrefetchedFrame(&frameIndex);
+	if (canvas == nullptr)
+	{
+		_animationTimer->Interval = TimeSpan{ _prefetchRetryMs * 10000 };
+		return;
+	}
+
+	// Update frame index and loop count
+	if (frameIndex == 0)
 	{
 		_completedLoops++;
-		_currentFrameIndex = 0;
 	}
-	auto frameIndex = _currentFrameIndex;
+	_currentFrameIndex = frameIndex;
 	auto frame = this->_webPImage->Frames->get(frameIndex);
 	// Set up the timer to display the next frame
 	if (this->_webPImage->LoopCount == 0 || _completedLoops < this->_webPImage->LoopCount)
@@ -80,10 +115,43 @@ void ImageLib::WebP::WebPDecoder::OnTick(Platform::Object ^sender, Platform::Obj
 	else
 	{
 		_animationTimer->Stop();
+		webPImage->StopPrefetch();
+	}
+
+	if (_image->Source != canvas)
+	{
+		_image->Source = canvas;
 	}
 
-	_image->Source = frame->RenderFrame();
+}
+
+void ImageLib::WebP::WebPDecoder::SeekToFrame(int index)
+{
+	auto webPImage = _webPImage;
+	if (!_isInitialized || webPImage == nullptr)
+	{
+		return;
+	}
+	auto canvas = webPImage->SeekToFrame(index);
+	_currentFrameIndex = index;
+	if (_isAnimating)
+	{
+		// Frames composited ahead belong to the old position.
+		webPImage->StopPrefetch();
+		webPImage->StartPrefetch(webPImage->NextFrame(index), _prefetchBudget);
+		_animationTimer->Interval = TimeSpan{ webPImage->Frames->get(index)->Duration * 10000 };
+	}
+	_image->Source = canvas;
+}
 
+void ImageLib::WebP::WebPDecoder::SeekToTime(int timeMs)
+{
+	auto webPImage = _webPImage;
+	if (!_isInitialized || webPImage == nullptr)
+	{
+		return;
+	}
+	SeekToFrame(webPImage->FrameAtTime(timeMs));
 }
 
 Windows::UI::Xaml::Media::ImageSource ^ ImageLib::WebP::WebPDecoder::RecreateSurfaces()
@@ -96,65 +164,28 @@ ImageLib::WebP::WebPDecoder::InitializeAsync(Windows::UI::Core::CoreDispatcher ^
 	Windows::UI::Xaml::Controls::Image ^image,
 	Windows::Foundation::Uri ^uriSource,
 	Windows::Storage::Streams::IRandomAccessStream ^streamSource)
+{
+	return InitializeAsync(dispatcher, image, uriSource, streamSource, 0, 0);
+}
+
+Windows::Foundation::IAsyncOperation<ImageLib::Support::ImagePackage ^> ^
+ImageLib::WebP::WebPDecoder::InitializeAsync(Windows::UI::Core::CoreDispatcher ^dispatcher,
+	Windows::UI::Xaml::Controls::Image ^image,
+	Windows::Foundation::Uri ^uriSource,
+	Windows::Storage::Streams::IRandomAccessStream ^streamSource,
+	int decodePixelWidth,
+	int decodePixelHeight)
 {
 	_image = image;
-	return create_async([this, dispatcher, image, uriSource, streamSource]()
+	return create_async([this, dispatcher, image, uriSource, streamSource, decodePixelWidth, decodePixelHeight]()
 	{
-		IAsyncOperation<ImageLib::Support::ImagePackage ^> ^  op;
-		auto buffer = ref new Buffer(streamSource->Size);
 		Uri^ uri = nullptr;
 		if (image->Tag != nullptr) {
 			uri = dynamic_cast<Uri^>(image->Tag);
 		}
-		ImagePackage^ result = nullptr;
-		auto imagePackage = create_task(streamSource->ReadAsync(buffer, streamSource->Size, InputStreamOptions::None))
-			.then([this, dispatcher, uri, uriSource, image](IBuffer^ buffer)
-		{
-			ImagePackage^ package = nullptr;
-			WebPBitstreamFeatures features = WebPBitstreamFeatures();
-			auto dataReader = DataReader::FromBuffer(buffer);
-			std::vector<uint8_t> vBuffer;
-			vBuffer.resize(buffer->Length);
-			dataReader->ReadBytes(ArrayReference<uint8_t>(vBuffer.data(), vBuffer.size()));
-			VP8StatusCode statusCode = WebPGetFeatures(vBuffer.data(), vBuffer.size(), &features);
-			if (statusCode == VP8_STATUS_OK) {
-				WriteableBitmap^ writeableBitmap = nullptr;
-				if (features.has_animation == 1) {
-					auto webPImage = WebPImage::CreateFromByteArray(vBuffer);
-					_webPImage = webPImage;
-					if (webPImage->Frames->Length > 0) {
-						auto first = webPImage->Frames->get(0);
-						writeableBitmap = first->RenderFrame();
-						package = ref new ImagePackage(this, writeableBitmap, writeableBitmap->PixelWidth, writeableBitmap->PixelHeight);
-					}
-				}
-				else
-				{
-					/*	writeableBitmap = ref new WriteableBitmap(features.width, features.height);
-						byte* pixels = WebPDecodeBGRA(vBuffer.data(), vBuffer.size(), &features.width, &features.height);
-						IBuffer^ buffer = writeableBitmap->PixelBuffer;
-						ComPtr<IBufferByteAccess> pBufferByteAccess;
-						ComPtr<IUnknown> pBuffer((IUnknown*)buffer);
-						pBuffer.As(&pBufferByteAccess);
-						byte *sourcePixels = nullptr;
-						pBufferByteAccess->Buffer(&sourcePixels);
-						memcpy(sourcePixels, (void *)pixels, features.width * features.height * 4);
-						writeableBitmap->Invalidate();
-						delete pixels;
-						pixels = nullptr;*/
-					writeableBitmap = WebPImage::DecodeFromByteArray(vBuffer);
-					package = ref new ImagePackage(this, writeableBitmap, writeableBitmap->PixelWidth, writeableBitmap->PixelHeight);
-				}
-				dispatcher->RunAsync(CoreDispatcherPriority::Normal, ref new DispatchedHandler([this, package, uri, uriSource, image, writeableBitmap]() {
-					if (uri->AbsoluteUri == uriSource->AbsoluteUri)
-					{
-						image->Source = writeableBitmap;
-					}
-				}));
-			}
-			return package;
-
-		});
+		auto imagePackage = _isProgressive
+			? DecodeProgressiveAsync(dispatcher, image, uri, uriSource, streamSource, decodePixelWidth, decodePixelHeight)
+			: DecodeWholeAsync(dispatcher, image, uri, uriSource, streamSource, decodePixelWidth, decodePixelHeight);
 		return concurrency::create_async([imagePackage, this]() -> concurrency::task<ImagePackage^>
 		{
 			_isInitialized = true;//ʼɹ
@@ -166,10 +197,265 @@ ImageLib::WebP::WebPDecoder::InitializeAsync(Windows::UI::Core::CoreDispatcher ^
 	});
 }
 
+concurrency::task<ImagePackage^> ImageLib::WebP::WebPDecoder::DecodeWholeAsync(CoreDispatcher ^dispatcher,
+	Windows::UI::Xaml::Controls::Image ^image,
+	Uri ^uri,
+	Uri ^uriSource,
+	IRandomAccessStream ^streamSource,
+	int decodePixelWidth,
+	int decodePixelHeight)
+{
+	auto buffer = ref new Buffer(static_cast<unsigned int>(streamSource->Size));
+	return create_task(streamSource->ReadAsync(buffer, buffer->Capacity, InputStreamOptions::None))
+		.then([this, dispatcher, uri, uriSource, image, decodePixelWidth, decodePixelHeight](IBuffer^ buffer)
+	{
+		return DecodeBuffer(dispatcher, image, uri, uriSource, buffer, decodePixelWidth, decodePixelHeight);
+	});
+}
+
+ImagePackage^ ImageLib::WebP::WebPDecoder::DecodeBuffer(CoreDispatcher ^dispatcher,
+	Windows::UI::Xaml::Controls::Image ^image,
+	Uri ^uri,
+	Uri ^uriSource,
+	IBuffer ^buffer,
+	int decodePixelWidth,
+	int decodePixelHeight)
+{
+	ImagePackage^ package = nullptr;
+	// Decode straight out of the buffer the stream was read into, parsing its
+	// headers only once.
+	unsigned int length;
+	const uint8_t* data = WebPBitmapFrame::GetPointerToPixelData(buffer, &length);
+	Engine::WebPFrameHeader header;
+	if (Engine::ParseFrameHeader(data, length, &header)) {
+		const WebPBitstreamFeatures& features = header.features;
+		WriteableBitmap^ writeableBitmap = nullptr;
+		if (features.has_animation == 1) {
+			auto webPImage = WebPImage::CreateFromBuffer(buffer, decodePixelWidth, decodePixelHeight);
+			_webPImage = webPImage;
+			if (webPImage->Frames->Length > 0) {
+				writeableBitmap = webPImage->RenderFrame(0);
+				package = ref new ImagePackage(this, writeableBitmap, webPImage->PixelWidth, webPImage->PixelHeight, writeableBitmap->PixelWidth, writeableBitmap->PixelHeight);
+			}
+		}
+		else
+		{
+			/*	writeableBitmap = ref new WriteableBitmap(features.width, features.height);
+				byte* pixels = WebPDecodeBGRA(vBuffer.data(), vBuffer.size(), &features.width, &features.height);
+				IBuffer^ buffer = writeableBitmap->PixelBuffer;
+				ComPtr<IBufferByteAccess> pBufferByteAccess;
+				ComPtr<IUnknown> pBuffer((IUnknown*)buffer);
+				pBuffer.As(&pBufferByteAccess);
+				byte *sourcePixels = nullptr;
+				pBufferByteAccess->Buffer(&sourcePixels);
+				memcpy(sourcePixels, (void *)pixels, features.width * features.height * 4);
+				writeableBitmap->Invalidate();
+				delete pixels;
+				pixels = nullptr;*/
+			Engine::WebPFrameInfo info;
+			Engine::StillFrameInfo(data, length, header, &info);
+			writeableBitmap = WebPImage::DecodeFirstFrame(info, data, length, decodePixelWidth, decodePixelHeight);
+			package = ref new ImagePackage(this, writeableBitmap, features.width, features.height, writeableBitmap->PixelWidth, writeableBitmap->PixelHeight);
+		}
+		dispatcher->RunAsync(CoreDispatcherPriority::Normal, ref new DispatchedHandler([this, package, uri, uriSource, image, writeableBitmap]() {
+			if (uri->AbsoluteUri == uriSource->AbsoluteUri)
+			{
+				image->Source = writeableBitmap;
+			}
+		}));
+	}
+	return package;
+}
 
+concurrency::task<ImagePackage^> ImageLib::WebP::WebPDecoder::DecodeStreamingAsync(CoreDispatcher ^dispatcher,
+	Windows::UI::Xaml::Controls::Image ^image,
+	Uri ^uri,
+	Uri ^uriSource,
+	IRandomAccessStream ^streamSource,
+	int decodePixelWidth,
+	int decodePixelHeight)
+{
+	struct Streaming
+	{
+		WebPImage^ image;
+		bool shown = false;
+		// Set on the dispatcher, read by the stream reader.
+		std::atomic<bool> failed{ false };
+	};
+	auto streaming = std::make_shared<Streaming>();
+	streaming->image = WebPImage::CreateStreaming(streamSource->Size, decodePixelWidth, decodePixelHeight);
+	task_completion_event<ImagePackage^> firstFrame;
 
+	// The image is played on the dispatcher, so chunks are appended there too;
+	// they run in the order they were read.
+	std::function<bool(IBuffer^)> consume = [this, streaming, firstFrame, dispatcher, uri, uriSource, image](IBuffer^ chunk)
+	{
+		dispatcher->RunAsync(CoreDispatcherPriority::Normal, ref new DispatchedHandler([this, streaming, firstFrame, chunk, uri, uriSource, image]() {
+			if (streaming->failed)
+			{
+				return;
+			}
+			WebPImage^ webPImage = streaming->image;
+			try
+			{
+				if (!webPImage->AppendData(chunk) || streaming->shown || webPImage->Frames->Length == 0)
+				{
+					return;
+				}
+				streaming->shown = true;
+				_webPImage = webPImage;
+				WriteableBitmap^ writeableBitmap = webPImage->RenderFrame(0);
+				if (uri->AbsoluteUri == uriSource->AbsoluteUri)
+				{
+					image->Source = writeableBitmap;
+				}
+				firstFrame.set(ref new ImagePackage(this, writeableBitmap, webPImage->PixelWidth, webPImage->PixelHeight, writeableBitmap->PixelWidth, writeableBitmap->PixelHeight));
+			}
+			catch (Exception^ e)
+			{
+				// A damaged tail leaves the frames before it playing.
+				streaming->failed = true;
+				firstFrame.set_exception(e);
+			}
+		}));
+		return !streaming->failed;
+	};
 
+	ReadChunksAsync(streamSource, _progressiveChunkSize, consume).then([streaming, firstFrame, dispatcher](task<void> read)
+	{
+		std::exception_ptr error;
+		try
+		{
+			read.get();
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+		// Queued behind the last chunk: if no frame has been shown by then there
+		// is nothing to show.
+		dispatcher->RunAsync(CoreDispatcherPriority::Normal, ref new DispatchedHandler([firstFrame, error]() {
+			if (error)
+			{
+				firstFrame.set_exception(error);
+			}
+			else
+			{
+				firstFrame.set(nullptr);
+			}
+		}));
+	});
+	return create_task(firstFrame);
+}
 
+concurrency::task<ImagePackage^> ImageLib::WebP::WebPDecoder::DecodeProgressiveAsync(CoreDispatcher ^dispatcher,
+	Windows::UI::Xaml::Controls::Image ^image,
+	Uri ^uri,
+	Uri ^uriSource,
+	IRandomAccessStream ^streamSource,
+	int decodePixelWidth,
+	int decodePixelHeight)
+{
+	struct Progress
+	{
+		WriteableBitmap^ bitmap;
+		std::unique_ptr<Engine::WebPProgressiveDecoder> decoder;
+		// What the decoded image is stored under once complete.
+		Engine::ContentHasher hasher;
+		size_t received = 0;
+		double decodeMicroseconds = 0;
+	};
+	auto progress = std::make_shared<Progress>();
+	Progress* state = progress.get();
 
+	Engine::ProgressiveOptions options;
+	options.maxWidth = decodePixelWidth;
+	options.maxHeight = decodePixelHeight;
+	options.minIntervalMs = _progressiveIntervalMs;
+	options.decode.useThreads = true;
+	options.decode.memory = WebPImage::DecodeMemory();
+	progress->decoder = std::make_unique<Engine::WebPProgressiveDecoder>(
+		[state](int width, int height)
+		{
+			state->bitmap = ref new WriteableBitmap(width, height);
+			return WebPBitmapFrame::GetPixelSurface(state->bitmap);
+		},
+		[state, dispatcher, uri, uriSource, image](const Engine::PixelSurface&, int)
+		{
+			// Show the bitmap as soon as its first rows are ready; later rows
+			// only need a redraw.
+			WriteableBitmap^ bitmap = state->bitmap;
+			dispatcher->RunAsync(CoreDispatcherPriority::Normal, ref new DispatchedHandler([bitmap, uri, uriSource, image]() {
+				bitmap->Invalidate();
+				if (uri->AbsoluteUri == uriSource->AbsoluteUri && image->Source != bitmap)
+				{
+					image->Source = bitmap;
+				}
+			}));
+		},
+		options);
 
+	std::function<bool(IBuffer^)> consume = [state](IBuffer^ chunk)
+	{
+		unsigned int length;
+		const uint8_t* data = WebPBitmapFrame::GetPointerToPixelData(chunk, &length);
+		state->hasher.Update(data, length);
+		state->received += length;
+		const auto start = std::chrono::steady_clock::now();
+		try
+		{
+			state->decoder->Append(data, length);
+		}
+		catch (const std::bad_alloc&)
+		{
+			throw ref new OutOfMemoryException();
+		}
+		catch (const std::exception& e)
+		{
+			throw ref new FailureException(ToPlatformString(e));
+		}
+		const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		state->decodeMicroseconds += elapsed.count();
+		return !state->decoder->IsComplete() && !state->decoder->IsAnimated();
+	};
 
+	// Start with whatever is available. When that is the whole file, as for
+	// anything from the storage cache, there is nothing to show progressively
+	// and the decoded-image cache can answer instead.
+	streamSource->Seek(0);
+	const unsigned int size = static_cast<unsigned int>(streamSource->Size);
+	const unsigned int chunkSize = _progressiveChunkSize;
+	auto first = ref new Buffer(size);
+	return create_task(streamSource->ReadAsync(first, size, InputStreamOptions::Partial))
+		.then([this, progress, consume, dispatcher, image, uri, uriSource, streamSource, size, chunkSize, decodePixelWidth, decodePixelHeight](IBuffer^ chunk)
+	{
+		if (chunk->Length == size)
+		{
+			return task_from_result(DecodeBuffer(dispatcher, image, uri, uriSource, chunk, decodePixelWidth, decodePixelHeight));
+		}
+		auto rest = chunk->Length > 0 && consume(chunk) ? ReadChunksAsync(streamSource, chunkSize, consume) : task_from_result();
+		return rest.then([this, progress, dispatcher, image, uri, uriSource, streamSource, size, decodePixelWidth, decodePixelHeight]()
+		{
+			const Engine::WebPProgressiveDecoder& decoder = *progress->decoder;
+			if (!decoder.HasHeader())
+			{
+				// Too short to tell; the demuxer reports what is wrong with it.
+				streamSource->Seek(0);
+				return DecodeWholeAsync(dispatcher, image, uri, uriSource, streamSource, decodePixelWidth, decodePixelHeight);
+			}
+			if (decoder.IsAnimated())
+			{
+				// Animations restart from the top, through the streaming demuxer.
+				streamSource->Seek(0);
+				return DecodeStreamingAsync(dispatcher, image, uri, uriSource, streamSource, decodePixelWidth, decodePixelHeight);
+			}
+			// A truncated file keeps the rows that did arrive.
+			WriteableBitmap^ bitmap = progress->bitmap;
+			if (decoder.IsComplete() && progress->received == size)
+			{
+				WebPImage::StoreDecoded(progress->hasher.Finish(), bitmap, progress->decodeMicroseconds);
+			}
+			return task_from_result(ref new ImagePackage(this, bitmap, decoder.Width(), decoder.Height(), bitmap->PixelWidth, bitmap->PixelHeight));
+		});
+	});
+}
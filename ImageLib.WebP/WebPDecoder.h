@@ -17,9 +17,31 @@ namespace ImageLib
 			int _currentFrameIndex = 0;
 			int _completedLoops = 0;
 			int _headerSize = 12;
+			// Memory for frames composited ahead of playback, and how soon to check
+			// again when the background decoder falls behind.
+			size_t _prefetchBudget = 16 * 1024 * 1024;
+			int _prefetchRetryMs = 5;
+			// Still images are decoded while they download and shown every
+			// _progressiveIntervalMs; animations start playing once their first
+			// frame has arrived.
+			bool _isProgressive = true;
+			int _progressiveIntervalMs = 100;
+			unsigned int _progressiveChunkSize = 16 * 1024;
 
 			//WriteableBitmap^ _writeableBitmap = nullptr;
 			Windows::UI::Xaml::DispatcherTimer^ _animationTimer = nullptr;
+
+			concurrency::task<ImageLib::Support::ImagePackage ^> DecodeWholeAsync(Windows::UI::Core::CoreDispatcher ^dispatcher, Windows::UI::Xaml::Controls::Image ^image, Windows::Foundation::Uri ^uri, Windows::Foundation::Uri ^uriSource, Windows::Storage::Streams::IRandomAccessStream ^streamSource, int decodePixelWidth, int decodePixelHeight);
+
+			// Decodes a whole file that is already in memory, through the
+			// decoded-image cache for still images.
+			ImageLib::Support::ImagePackage ^ DecodeBuffer(Windows::UI::Core::CoreDispatcher ^dispatcher, Windows::UI::Xaml::Controls::Image ^image, Windows::Foundation::Uri ^uri, Windows::Foundation::Uri ^uriSource, Windows::Storage::Streams::IBuffer ^buffer, int decodePixelWidth, int decodePixelHeight);
+
+			// Demuxes an animation while it downloads. The package is ready with the
+			// first frame; later frames join playback as they arrive.
+			concurrency::task<ImageLib::Support::ImagePackage ^> DecodeStreamingAsync(Windows::UI::Core::CoreDispatcher ^dispatcher, Windows::UI::Xaml::Controls::Image ^image, Windows::Foundation::Uri ^uri, Windows::Foundation::Uri ^uriSource, Windows::Storage::Streams::IRandomAccessStream ^streamSource, int decodePixelWidth, int decodePixelHeight);
+
+			concurrency::task<ImageLib::Support::ImagePackage ^> DecodeProgressiveAsync(Windows::UI::Core::CoreDispatcher ^dispatcher, Windows::UI::Xaml::Controls::Image ^image, Windows::Foundation::Uri ^uri, Windows::Foundation::Uri ^uriSource, Windows::Storage::Streams::IRandomAccessStream ^streamSource, int decodePixelWidth, int decodePixelHeight);
 		public:
 			WebPDecoder();
 			virtual	property int HeaderSize
@@ -27,6 +49,21 @@ namespace ImageLib
 				int get() { return _headerSize; }
 			}
 
+			// Decode still images while they download, publishing rows at most
+			// every ProgressiveIntervalMs, and start animations from their first
+			// frame. On by default.
+			property bool IsProgressive
+			{
+				bool get() { return _isProgressive; }
+				void set(bool value) { _isProgressive = value; }
+			}
+
+			property int ProgressiveIntervalMs
+			{
+				int get() { return _progressiveIntervalMs; }
+				void set(int value) { _progressiveIntervalMs = value; }
+			}
+
 			virtual int GetPriority(Windows::Storage::Streams::IBuffer ^headerBuffer);
 
 			virtual void Start();
@@ -37,7 +74,19 @@ namespace ImageLib
 
 			virtual Windows::Foundation::IAsyncOperation<ImageLib::Support::ImagePackage ^> ^ InitializeAsync(Windows::UI::Core::CoreDispatcher ^dispatcher, Windows::UI::Xaml::Controls::Image ^image, Windows::Foundation::Uri ^uriSource, Windows::Storage::Streams::IRandomAccessStream ^streamSource);
 
+			// Decodes straight to the largest size that fits in 'decodePixelWidth' x
+			// 'decodePixelHeight' (0 = unbounded), like BitmapImage.DecodePixelWidth/Height.
+			// The package reports the natural size and the decode size.
+			Windows::Foundation::IAsyncOperation<ImageLib::Support::ImagePackage ^> ^ InitializeAsync(Windows::UI::Core::CoreDispatcher ^dispatcher, Windows::UI::Xaml::Controls::Image ^image, Windows::Foundation::Uri ^uriSource, Windows::Storage::Streams::IRandomAccessStream ^streamSource, int decodePixelWidth, int decodePixelHeight);
+
+
+
+			// Shows frame 'index' of an animation straight away, decoding from the
+			// nearest key frame. Playback, if running, carries on from there.
+			void SeekToFrame(int index);
 
+			// Seeks to the frame on screen 'timeMs' into a loop.
+			void SeekToTime(int timeMs);
 
 			void OnTick(Platform::Object ^sender, Platform::Object ^args);
 		};
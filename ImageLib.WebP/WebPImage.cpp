@@ -7,144 +7,545 @@ using namespace Windows::Storage::Streams;
 using namespace ImageLib::WebP;
 using namespace Platform;
 
-WebPImage::WebPImage()
+namespace
 {
+	Engine::MemoryAccount decodeMemory;
 
+	std::shared_ptr<Engine::WebPSource> BorrowBuffer(IBuffer^ buffer)
+	{
+		unsigned int length;
+		uint8_t* data = WebPBitmapFrame::GetPointerToPixelData(buffer, &length);
+		// The deleter holds a reference to the buffer until the source is released.
+		std::shared_ptr<void> owner(nullptr, [buffer](void*) {});
+		return Engine::WebPSource::Borrow(data, length, owner);
+	}
 }
 
-WebPImage ^ ImageLib::WebP::WebPImage::CreateFromByteArray(std::vector<uint8> vBuffer)
+WebPImage::WebPImage() :
+	maxWidth(0),
+	maxHeight(0),
+	pixelWidth(0),
+	pixelHeight(0),
+	numFrames(0),
+	loopCount(0),
+	totalDuration(0),
+	decodePixelWidth(0),
+	decodePixelHeight(0),
+	frames(ref new Array<WebPBitmapFrame^>(0))
 {
+	decodeOptions.memory = DecodeMemory();
+}
+
+WebPImage ^ ImageLib::WebP::WebPImage::CreateFromSource(std::shared_ptr<Engine::WebPSource> source, int maxWidth, int maxHeight)
+{
+	std::shared_ptr<Engine::WebPContainer> spContainer;
+	try
+	{
+		spContainer = Engine::WebPContainer::Create(std::move(source));
+	}
+	catch (const std::exception& e)
+	{
+		throw ref new InvalidArgumentException(ToPlatformString(e));
+	}
 
 	WebPImage^ image = ref new WebPImage();
-	WebPData webPData;
-	webPData.bytes = vBuffer.data();
-	webPData.size = vBuffer.size();
+	image->maxWidth = maxWidth;
+	image->maxHeight = maxHeight;
+	image->Update(std::move(spContainer));
+	return image;
+}
 
-	auto spDemuxer = std::unique_ptr<WebPDemuxer, decltype(&WebPDemuxDelete)>
+void WebPImage::Update(std::shared_ptr<Engine::WebPContainer> container)
+{
+	if (spContainer == nullptr)
 	{
-		WebPDemux(&webPData),
-		WebPDemuxDelete
-	};
-	if (!spDemuxer)
+		pixelWidth = container->CanvasWidth();
+		pixelHeight = container->CanvasHeight();
+		int decodeWidth, decodeHeight;
+		Engine::FitSize(pixelWidth, pixelHeight, maxWidth, maxHeight, &decodeWidth, &decodeHeight);
+		decodePixelWidth = decodeWidth;
+		decodePixelHeight = decodeHeight;
+		if (decodeWidth != pixelWidth || decodeHeight != pixelHeight)
+		{
+			decodeOptions.scaledWidth = decodeWidth;
+			decodeOptions.scaledHeight = decodeHeight;
+		}
+	}
+	spContainer = container;
+	numFrames = static_cast<int>(container->Frames().size());
+	loopCount = container->LoopCount();
+	totalDuration = container->TotalDuration();
+
+	// Frames handed out before keep the snapshot they came from.
+	std::vector<WebPBitmapFrame^> bitmapFrames(begin(frames), end(frames));
+	for (size_t i = bitmapFrames.size(); i < container->Frames().size(); ++i)
 	{
-		throw ref new InvalidArgumentException(ref new String(L"Failed to create demuxer"));
-		return nullptr;
+		WebPBitmapFrame^ frame = ref new WebPBitmapFrame();
+		frame->spContainer = container;
+		frame->info = container->Frames()[i];
+		bitmapFrames.push_back(frame);
 	}
+	frames = ref new Array<WebPBitmapFrame^>(bitmapFrames.data(), static_cast<unsigned int>(bitmapFrames.size()));
 
-	image->pixelWidth = WebPDemuxGetI(spDemuxer.get(), WEBP_FF_CANVAS_WIDTH);
-	image->pixelHeight = WebPDemuxGetI(spDemuxer.get(), WEBP_FF_CANVAS_HEIGHT);
-	image->numFrames = WebPDemuxGetI(spDemuxer.get(), WEBP_FF_FRAME_COUNT);
-	image->loopCount = WebPDemuxGetI(spDemuxer.get(), WEBP_FF_LOOP_COUNT);
+	if (spCompositor != nullptr)
+	{
+		spCompositor->SetContainer(container);
+	}
+	if (spFrameRing != nullptr)
+	{
+		spFrameRing->Update(container);
+	}
+}
 
-	std::vector<WebPBitmapFrame^> frames;
-	int durationMs = 0;
-	//std::vector<int> frameDurationsMs;
-	WebPIterator iter;
-	if (WebPDemuxGetFrame(spDemuxer.get(), 1, &iter))
+bool WebPImage::AppendBytes(const uint8_t* data, size_t size)
+{
+	if (spStreamingDemuxer == nullptr)
+	{
+		throw ref new FailureException("The image was not created for streaming");
+	}
+	try
 	{
-		do
+		if (!spStreamingDemuxer->Append(data, size))
 		{
-			durationMs += iter.duration;
-			//frameDurationsMs.push_back(iter.duration);
-			WebPBitmapFrame^ frame = ref new WebPBitmapFrame();
-			frame->spDemuxer = image->spDemuxer;
-			frame->frameNum = iter.frame_num;
-			frame->offset = Point(static_cast<float>(iter.x_offset), static_cast<float>(iter.y_offset));
-			frame->duration = iter.duration;
-			frame->width = iter.width;
-			frame->height = iter.height;
-			frame->disposeToBackgroundColor = iter.dispose_method == WEBP_MUX_DISPOSE_BACKGROUND;
-			frame->blendWithPreviousFrame = iter.blend_method == WEBP_MUX_BLEND;
-			//frame->pPayload = std::make_unique<uint8_t[]>(iter.fragment.size);
-			frame->pPayload = iter.fragment.bytes;
-			frame->payloadSize = iter.fragment.size;
+			return false;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		throw ref new InvalidArgumentException(ToPlatformString(e));
+	}
+	try
+	{
+		Update(spStreamingDemuxer->Container());
+	}
+	catch (const std::exception& e)
+	{
+		throw ref new FailureException(ToPlatformString(e));
+	}
+	return true;
+}
+
+int WebPImage::NextFrame(int index)
+{
+	return index + 1 < numFrames || !IsComplete ? index + 1 : 0;
+}
 
-			//CopyMemory(frame->pPayload.get(), iter.fragment.bytes, iter.fragment.size);
+WebPImage ^ ImageLib::WebP::WebPImage::CreateFromByteArray(std::vector<uint8>&& vBuffer)
+{
+	return CreateFromSource(Engine::WebPSource::FromVector(std::move(vBuffer)));
+}
+
+WriteableBitmap ^ ImageLib::WebP::WebPImage::DecodeFromBytes(const uint8_t* data, size_t size, int maxWidth, int maxHeight)
+{
+	Engine::WebPFrameInfo info;
+	try
+	{
+		if (!Engine::FindFirstFrame(data, size, &info))
+		{
+			return nullptr;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		throw ref new InvalidArgumentException(ToPlatformString(e));
+	}
 
-			frames.push_back(frame);
+	return DecodeFirstFrame(info, data, size, maxWidth, maxHeight);
+}
 
-		} while (WebPDemuxNextFrame(&iter));
+WriteableBitmap ^ ImageLib::WebP::WebPImage::DecodeFirstFrame(const Engine::WebPFrameInfo& info, const uint8_t* data, size_t size, int maxWidth, int maxHeight)
+{
+	Engine::DecodeOptions options;
+	options.useThreads = true;
+	options.memory = DecodeMemory();
+	Engine::FitSize(info.width, info.height, maxWidth, maxHeight, &options.scaledWidth, &options.scaledHeight);
+	WriteableBitmap^ bitmap = ref new WriteableBitmap(options.scaledWidth, options.scaledHeight);
+	Engine::PixelSurface surface = WebPBitmapFrame::GetPixelSurface(bitmap);
 
-		WebPDemuxReleaseIterator(&iter);
+	Engine::WebPImageCache& cache = Engine::WebPImageCache::Shared();
+	const bool useCache = cache.Budget() > 0;
+	Engine::WebPImageCache::Key key = { 0, options.scaledWidth, options.scaledHeight, options.colorspace };
+	if (useCache)
+	{
+		key.contentHash = Engine::ContentHasher::Hash(data, size);
+		if (auto pixels = cache.Find(key))
+		{
+			pixels->CopyTo(surface);
+			return bitmap;
+		}
 	}
 
-	image->totalDuration = durationMs;
-	//spNativeContext->frameDurationsMs = ref new Array<int>(frameDurationsMs.data(), frameDurationsMs.size());
-	image->frames = ref new Array<WebPBitmapFrame^>(frames.data(), frames.size());
-	image->spDemuxer = std::shared_ptr<WebPDemuxerWrapper>(new WebPDemuxerWrapper(std::move(spDemuxer), std::move(vBuffer)));
+	const auto start = std::chrono::steady_clock::now();
+	try
+	{
+		Engine::DecodeFrame(info, surface, options);
+	}
+	catch (const std::bad_alloc&)
+	{
+		throw ref new OutOfMemoryException();
+	}
+	catch (const std::exception& e)
+	{
+		throw ref new FailureException(ToPlatformString(e));
+	}
+	if (useCache)
+	{
+		const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		cache.Insert(key, std::make_shared<Engine::PixelBuffer>(Engine::PixelBuffer::CopyOf(surface)), elapsed.count());
+	}
+	return bitmap;
+}
 
-	return image;
+WriteableBitmap ^ ImageLib::WebP::WebPImage::DecodeFromByteArray(const std::vector<uint8>& vBuffer)
+{
+	return DecodeFromBytes(vBuffer.data(), vBuffer.size());
 }
 
-WriteableBitmap ^ ImageLib::WebP::WebPImage::DecodeFromByteArray(std::vector<uint8> vBuffer)
+void ImageLib::WebP::WebPImage::EnsureThreadPool()
 {
+	static std::once_flag poolInstalled;
+	std::call_once(poolInstalled, [] { Engine::WebPThreadPool::Install(); });
+}
 
-	WebPData webPData;
-	webPData.bytes = vBuffer.data();
-	webPData.size = vBuffer.size();
+Engine::MemoryAccount* ImageLib::WebP::WebPImage::DecodeMemory()
+{
+	// Without a limit, decodes stay on libwebp's built-in allocator, which
+	// keeps no record of its blocks.
+	return decodeMemory.Limit() > 0 ? &decodeMemory : nullptr;
+}
 
-	auto spDemuxer = std::unique_ptr<WebPDemuxer, decltype(&WebPDemuxDelete)>
-	{
-		WebPDemux(&webPData),
-		WebPDemuxDelete
-	};
-	if (!spDemuxer)
+void ImageLib::WebP::WebPImage::StoreDecoded(uint64_t contentHash, WriteableBitmap^ bitmap, double decodeMicroseconds)
+{
+	Engine::WebPImageCache& cache = Engine::WebPImageCache::Shared();
+	if (cache.Budget() == 0)
 	{
-		throw ref new InvalidArgumentException(ref new String(L"Failed to create demuxer"));
-		return nullptr;
+		return;
 	}
+	const Engine::WebPImageCache::Key key = { contentHash, bitmap->PixelWidth, bitmap->PixelHeight, Engine::DecodeOptions().colorspace };
+	Engine::PixelSurface surface = WebPBitmapFrame::GetPixelSurface(bitmap);
+	cache.Insert(key, std::make_shared<Engine::PixelBuffer>(Engine::PixelBuffer::CopyOf(surface)), decodeMicroseconds);
+}
 
-	WebPIterator iter;
-	if (WebPDemuxGetFrame(spDemuxer.get(), 1, &iter))
+WebPImageInfo WebPImage::Probe(IBuffer^ buffer)
+{
+	unsigned int length;
+	const uint8_t* data = WebPBitmapFrame::GetPointerToPixelData(buffer, &length);
+	WebPBitstreamFeatures features;
+	try
 	{
-		WebPDecoderConfig config;
-		int ret = WebPInitDecoderConfig(&config);
-		if (!ret)
+		if (!Engine::ProbeImage(data, length, &features))
 		{
-			throw ref new FailureException(ref new String(L"WebPInitDecoderConfig failed"));
+			throw ref new InvalidArgumentException("Not enough data to read the WebP header");
 		}
+	}
+	catch (const std::exception& e)
+	{
+		throw ref new InvalidArgumentException(ToPlatformString(e));
+	}
+	WebPImageInfo info;
+	info.Width = features.width;
+	info.Height = features.height;
+	info.HasAlpha = features.has_alpha != 0;
+	info.HasAnimation = features.has_animation != 0;
+	info.IsLossless = features.format == 2;
+	return info;
+}
 
-		ret = (WebPGetFeatures(iter.fragment.bytes, iter.fragment.size, &config.input) == VP8_STATUS_OK);
-		if (!ret)
+WebPImage^ WebPImage::CreateFromByteArray(const Array<uint8> ^bytes)
+{
+	// An input array is only valid during the call, so the image needs its own copy.
+	return CreateFromByteArray(std::vector<uint8_t>(bytes->begin(), bytes->end()));
+}
+
+WriteableBitmap^ WebPImage::DecodeFromByteArray(const Array<uint8> ^bytes)
+{
+	return DecodeFromBytes(bytes->Data, bytes->Length);
+}
+
+WebPImage^ WebPImage::CreateFromBuffer(IBuffer^ buffer)
+{
+	return CreateFromBuffer(buffer, 0, 0);
+}
+
+WriteableBitmap^ WebPImage::DecodeFromBuffer(IBuffer^ buffer)
+{
+	return DecodeFromBuffer(buffer, 0, 0);
+}
+
+WebPImage^ WebPImage::CreateFromBuffer(IBuffer^ buffer, int maxWidth, int maxHeight)
+{
+	return CreateFromSource(BorrowBuffer(buffer), maxWidth, maxHeight);
+}
+
+WriteableBitmap^ WebPImage::DecodeFromBuffer(IBuffer^ buffer, int maxWidth, int maxHeight)
+{
+	unsigned int length;
+	uint8_t* data = WebPBitmapFrame::GetPointerToPixelData(buffer, &length);
+	return DecodeFromBytes(data, length, maxWidth, maxHeight);
+}
+
+WriteableBitmap^ WebPImage::DecodePreviewFromBuffer(IBuffer^ buffer)
+{
+	unsigned int length;
+	const uint8_t* data = WebPBitmapFrame::GetPointerToPixelData(buffer, &length);
+	Engine::WebPFrameInfo info;
+	try
+	{
+		if (!Engine::FindFirstFrame(data, length, &info))
 		{
-			throw ref new FailureException(ref new String(L"WebPGetFeatures failed"));
+			return nullptr;
 		}
+	}
+	catch (const std::exception& e)
+	{
+		throw ref new InvalidArgumentException(ToPlatformString(e));
+	}
 
-		WriteableBitmap^ bitmap = ref new WriteableBitmap(iter.width, iter.height);
+	Engine::DecodeOptions options;
+	options.preview = true;
+	options.memory = DecodeMemory();
+	int width, height;
+	Engine::OutputSize(info.width, info.height, options, &width, &height);
+	WriteableBitmap^ bitmap = ref new WriteableBitmap(width, height);
+	try
+	{
+		Engine::DecodeFrame(info, WebPBitmapFrame::GetPixelSurface(bitmap), options);
+	}
+	catch (const std::bad_alloc&)
+	{
+		throw ref new OutOfMemoryException();
+	}
+	catch (const std::exception& e)
+	{
+		throw ref new FailureException(ToPlatformString(e));
+	}
+	return bitmap;
+}
 
-		unsigned int length;
-		uint8_t* pixels = WebPBitmapFrame::GetPointerToPixelData(bitmap->PixelBuffer, &length);
+WebPImage^ WebPImage::CreateStreaming(uint64 expectedSize, int maxWidth, int maxHeight)
+{
+	WebPImage^ image = ref new WebPImage();
+	image->maxWidth = maxWidth;
+	image->maxHeight = maxHeight;
+	image->spStreamingDemuxer = std::make_unique<Engine::WebPStreamingDemuxer>(static_cast<size_t>(expectedSize));
+	return image;
+}
 
-		config.options.no_fancy_upsampling = 1;
-		config.output.colorspace = MODE_bgrA;
-		config.output.is_external_memory = 1;
-		config.output.u.RGBA.rgba = pixels;
-		config.output.u.RGBA.stride = iter.width * 4;
-		config.output.u.RGBA.size = (iter.width * 4) * iter.height;
+bool WebPImage::AppendData(IBuffer^ buffer)
+{
+	unsigned int length;
+	const uint8_t* data = WebPBitmapFrame::GetPointerToPixelData(buffer, &length);
+	return AppendBytes(data, length);
+}
+
+bool WebPImage::IsComplete::get()
+{
+	return spContainer != nullptr && spContainer->IsComplete();
+}
 
-		ret = WebPDecode(iter.fragment.bytes, iter.fragment.size, &config);
+WebPImage^ WebPImage::CreateFromFile(String^ path)
+{
+	std::shared_ptr<Engine::WebPSource> source;
+	try
+	{
+		source = Engine::WebPSource::MapFile(path->Data());
+	}
+	catch (const std::exception& e)
+	{
+		throw ref new FailureException(ToPlatformString(e));
+	}
+	return CreateFromSource(std::move(source));
+}
 
-		if (ret != VP8_STATUS_OK)
+Windows::Foundation::IAsyncOperation<Windows::Foundation::Collections::IVectorView<WriteableBitmap^>^>^ WebPImage::DecodeBatchAsync(Windows::Foundation::Collections::IVectorView<IBuffer^>^ buffers, int maxWidth, int maxHeight)
+{
+	EnsureThreadPool();
+	// Only the decoding leaves the calling thread; the bitmaps are created back
+	// in its context, as XAML objects have to be.
+	auto context = concurrency::task_continuation_context::use_current();
+	return concurrency::create_async([buffers, maxWidth, maxHeight, context]()
+	{
+		auto results = std::make_shared<std::vector<Engine::BatchResult>>();
+		return concurrency::create_task([buffers, maxWidth, maxHeight, results]()
 		{
-			throw ref new FailureException(ref new String(L"Failed to decode frame"));
-		}
+			std::vector<Engine::BatchItem> items;
+			items.reserve(buffers->Size);
+			for (IBuffer^ buffer : buffers)
+			{
+				unsigned int length;
+				const uint8_t* data = WebPBitmapFrame::GetPointerToPixelData(buffer, &length);
+				items.push_back(Engine::BatchItem{ data, length, maxWidth, maxHeight });
+			}
+			Engine::DecodeOptions options;
+			options.memory = DecodeMemory();
+			*results = Engine::DecodeBatch(items, options);
+		}).then([results]()
+		{
+			auto bitmaps = ref new Platform::Collections::Vector<WriteableBitmap^>();
+			for (const auto& result : *results)
+			{
+				WriteableBitmap^ bitmap = nullptr;
+				if (!result.error)
+				{
+					bitmap = ref new WriteableBitmap(result.pixels.Width(), result.pixels.Height());
+					result.pixels.CopyTo(WebPBitmapFrame::GetPixelSurface(bitmap));
+				}
+				bitmaps->Append(bitmap);
+			}
+			return bitmaps->GetView();
+		}, context);
+	});
+}
+
+uint64 WebPImage::DecodedCacheBudget::get()
+{
+	return Engine::WebPImageCache::Shared().Budget();
+}
+
+void WebPImage::DecodedCacheBudget::set(uint64 value)
+{
+	Engine::WebPImageCache::Shared().SetBudget(static_cast<size_t>(value));
+}
+
+void WebPImage::ClearDecodedCache()
+{
+	Engine::WebPImageCache::Shared().Clear();
+}
+
+uint64 WebPImage::DecodeMemoryLimit::get()
+{
+	return decodeMemory.Limit();
+}
+
+void WebPImage::DecodeMemoryLimit::set(uint64 value)
+{
+	decodeMemory.SetLimit(value);
+}
+
+uint64 WebPImage::DecodeMemoryPeak::get()
+{
+	return decodeMemory.PeakBytes();
+}
 
-		return bitmap;
+WriteableBitmap^ WebPImage::RenderFrame(int index)
+{
+	if (spContainer == nullptr)
+	{
+		throw ref new OutOfBoundsException("No frames have arrived yet");
 	}
+	if (canvasBitmap == nullptr)
+	{
+		canvasBitmap = ref new WriteableBitmap(decodePixelWidth, decodePixelHeight);
+		spCompositor = std::make_unique<Engine::WebPCompositor>(spContainer, WebPBitmapFrame::GetPixelSurface(canvasBitmap), decodeOptions);
+	}
+	try
+	{
+		spCompositor->RenderFrame(index);
+	}
+	catch (const std::out_of_range& e)
+	{
+		throw ref new OutOfBoundsException(ToPlatformString(e));
+	}
+	catch (const std::bad_alloc&)
+	{
+		throw ref new OutOfMemoryException();
+	}
+	catch (const std::exception& e)
+	{
+		throw ref new FailureException(ToPlatformString(e));
+	}
+	canvasBitmap->Invalidate();
+	return canvasBitmap;
+}
 
-	return nullptr;
+WriteableBitmap^ WebPImage::SeekToFrame(int index)
+{
+	// The compositor itself starts from the nearest key frame.
+	return RenderFrame(index);
 }
 
-WebPImage^ WebPImage::CreateFromByteArray(const Array<uint8> ^bytes)
+WriteableBitmap^ WebPImage::SeekToTime(int timeMs)
 {
-	auto vBuffer = std::vector<uint8_t>(bytes->Length);
-	std::copy(bytes->begin(), bytes->end(), vBuffer.begin());
-	return CreateFromByteArray(vBuffer);
+	return RenderFrame(FrameAtTime(timeMs));
 }
 
-WriteableBitmap^ WebPImage::DecodeFromByteArray(const Array<uint8> ^bytes)
+int WebPImage::FrameAtTime(int timeMs)
+{
+	return spContainer != nullptr ? spContainer->FrameAtTime(timeMs) : 0;
+}
+
+int WebPImage::FrameStartTime(int index)
 {
-	auto vBuffer = std::vector<uint8_t>(bytes->Length);
-	std::copy(bytes->begin(), bytes->end(), vBuffer.begin());
-	return DecodeFromByteArray(vBuffer);
+	if (spContainer == nullptr)
+	{
+		throw ref new OutOfBoundsException("Frame index out of range");
+	}
+	try
+	{
+		return spContainer->FrameStartTime(index);
+	}
+	catch (const std::out_of_range& e)
+	{
+		throw ref new OutOfBoundsException(ToPlatformString(e));
+	}
 }
+
+void WebPImage::StartPrefetch(int firstFrame, size_t budgetBytes)
+{
+	if (spContainer == nullptr)
+	{
+		throw ref new OutOfBoundsException("No frames have arrived yet");
+	}
+	try
+	{
+		if (spFrameRing == nullptr)
+		{
+			const int depth = Engine::WebPFrameRing::DepthForBudget(*spContainer, budgetBytes, decodeOptions);
+			slotBitmaps = ref new Array<WriteableBitmap^>(depth);
+			std::vector<Engine::PixelSurface> slots;
+			for (int i = 0; i < depth; ++i)
+			{
+				slotBitmaps[i] = ref new WriteableBitmap(decodePixelWidth, decodePixelHeight);
+				slots.push_back(WebPBitmapFrame::GetPixelSurface(slotBitmaps[i]));
+			}
+			spFrameRing = std::make_unique<Engine::WebPFrameRing>(spContainer, slots, decodeOptions);
+		}
+		spFrameRing->Start(firstFrame);
+	}
+	catch (const std::out_of_range& e)
+	{
+		throw ref new OutOfBoundsException(ToPlatformString(e));
+	}
+	catch (const std::exception& e)
+	{
+		throw ref new FailureException(ToPlatformString(e));
+	}
+}
+
+void WebPImage::StopPrefetch()
+{
+	if (spFrameRing != nullptr)
+	{
+		spFrameRing->Stop();
+	}
+}
+
+WriteableBitmap^ WebPImage::NextPrefetchedFrame(int* frameIndex)
+{
+	Engine::WebPFrameRing::Frame frame;
+	try
+	{
+		if (spFrameRing == nullptr || !spFrameRing->Advance(&frame))
+		{
+			return nullptr;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		throw ref new FailureException(ToPlatformString(e));
+	}
+	*frameIndex = frame.index;
+	WriteableBitmap^ bitmap = slotBitmaps[frame.slot];
+	bitmap->Invalidate();
+	return bitmap;
+}
\ No newline at end of file
@@ -12,31 +12,178 @@ namespace ImageLib
 {
 	namespace WebP
 	{
+		// What WebPImage::Probe reads from a file's headers.
+		public value struct WebPImageInfo
+		{
+			int Width;
+			int Height;
+			bool HasAlpha;
+			bool HasAnimation;
+			bool IsLossless;
+		};
+
 		[Windows::Foundation::Metadata::WebHostHidden]
 		public ref class WebPImage sealed
 		{
 		internal:
 			WebPImage();
-			std::shared_ptr<WebPDemuxerWrapper> spDemuxer;
+			std::shared_ptr<Engine::WebPContainer> spContainer;
+
+			// Demuxes 'source' in place; the image keeps it alive. Frames render at
+			// the largest size that fits in 'maxWidth' x 'maxHeight' (0 = unbounded).
+			static WebPImage^ CreateFromSource(std::shared_ptr<Engine::WebPSource> source, int maxWidth = 0, int maxHeight = 0);
+
+			static WebPImage^ CreateFromByteArray(std::vector<uint8>&& vBuffer);
+
+			// Copies the next 'size' bytes of a streaming image; see AppendData.
+			bool AppendBytes(const uint8_t* data, size_t size);
+
+			// Frame played after 'index': the next one, wrapping around to the first
+			// only once the whole file has arrived.
+			int NextFrame(int index);
+
+			// Decodes the first frame of the 'size' bytes at 'data', which are only
+			// read during the call, straight to the largest size that fits in
+			// 'maxWidth' x 'maxHeight' (0 = unbounded).
+			static WriteableBitmap^ DecodeFromBytes(const uint8_t* data, size_t size, int maxWidth = 0, int maxHeight = 0);
+
+			static WriteableBitmap^ DecodeFromByteArray(const std::vector<uint8>& vBuffer);
+
+			// Decodes 'info', the first frame of the 'size' bytes at 'data', whose
+			// headers are already parsed.
+			static WriteableBitmap^ DecodeFirstFrame(const Engine::WebPFrameInfo& info, const uint8_t* data, size_t size, int maxWidth, int maxHeight);
+
+			// Routes libwebp's worker threads, and batch decoding, through one
+			// process-wide WebPThreadPool. Safe to call more than once.
+			static void EnsureThreadPool();
+
+			// Account that every decode of the library allocates from while
+			// DecodeMemoryLimit is set, or nullptr.
+			static Engine::MemoryAccount* DecodeMemory();
+
+			// Stores a still image decoded elsewhere, at the bitmap's size and the
+			// default colorspace, in the decoded-image cache that DecodeFromBytes
+			// reads. 'contentHash' is Engine::ContentHasher over the whole file.
+			static void StoreDecoded(uint64_t contentHash, WriteableBitmap^ bitmap, double decodeMicroseconds);
 
-			static WebPImage^ CreateFromByteArray(std::vector<uint8> vBuffer);
+			// Starts compositing frames ahead of playback, beginning at 'firstFrame',
+			// into a ring of canvas-sized bitmaps bounded by 'budgetBytes'.
+			void StartPrefetch(int firstFrame, size_t budgetBytes);
 
-			static WriteableBitmap^ DecodeFromByteArray(std::vector<uint8> vBuffer);
+			void StopPrefetch();
+
+			// Swaps in the next pre-composited frame. Returns nullptr when the
+			// background decoder has not caught up yet.
+			WriteableBitmap^ NextPrefetchedFrame(int* frameIndex);
 		private:
+			// Takes 'container', or a later snapshot of the file being streamed,
+			// adding frames for whatever it has that the image does not.
+			void Update(std::shared_ptr<Engine::WebPContainer> container);
+
+			int maxWidth;
+			int maxHeight;
 			int pixelWidth;
 			int pixelHeight;
 			int numFrames;
 			int loopCount;
 			int totalDuration;
+			int decodePixelWidth;
+			int decodePixelHeight;
+			Engine::DecodeOptions decodeOptions;
+			// Only for images created by CreateStreaming.
+			std::unique_ptr<Engine::WebPStreamingDemuxer> spStreamingDemuxer;
 
 			//const Array<int>^ frameDurationsMs;
 			Array<WebPBitmapFrame^>^ frames;
 
+			WriteableBitmap^ canvasBitmap;
+			std::unique_ptr<Engine::WebPCompositor> spCompositor;
+
+			Array<WriteableBitmap^>^ slotBitmaps;
+			std::unique_ptr<Engine::WebPFrameRing> spFrameRing;
+
 		public:
 			static WebPImage^ CreateFromByteArray(const Array<uint8> ^bytes);
 
 			static WriteableBitmap^ DecodeFromByteArray(const Array<uint8> ^bytes);
 
+			// Borrows the buffer without copying it; the image holds a reference to it.
+			static WebPImage^ CreateFromBuffer(IBuffer^ buffer);
+
+			static WriteableBitmap^ DecodeFromBuffer(IBuffer^ buffer);
+
+			// As above, but decodes straight to the largest size that fits in
+			// 'maxWidth' x 'maxHeight', where 0 leaves a dimension unbounded.
+			static WebPImage^ CreateFromBuffer(IBuffer^ buffer, int maxWidth, int maxHeight);
+
+			static WriteableBitmap^ DecodeFromBuffer(IBuffer^ buffer, int maxWidth, int maxHeight);
+
+			// Decodes a placeholder of the first frame at a quarter of its width and
+			// height, rounded up, for showing while the full decode runs. Lossy
+			// images skip loop filtering and full-size colour conversion. Previews
+			// are not kept in the decoded-image cache.
+			static WriteableBitmap^ DecodePreviewFromBuffer(IBuffer^ buffer);
+
+			// Memory-maps a file the app can access, such as one in its cache folder.
+			static WebPImage^ CreateFromFile(String^ path);
+
+			// Creates an image for a file that is still downloading, to be fed with
+			// AppendData. 'expectedSize' is the length of the file if known, or 0.
+			// Frames render at the largest size that fits in 'maxWidth' x
+			// 'maxHeight' (0 = unbounded). The size, frames and loop count stay
+			// empty until their headers arrive.
+			static WebPImage^ CreateStreaming(uint64 expectedSize, int maxWidth, int maxHeight);
+
+			// Copies the next chunk of the file. Returns true when that completed
+			// the headers, more frames or the file, which then show in Frames and
+			// in playback. Throws InvalidArgumentException if the data is not a
+			// WebP file.
+			bool AppendData(IBuffer^ buffer);
+
+			// False while a streaming image still expects more of the file.
+			property bool IsComplete
+			{
+				bool get();
+			}
+
+			// Reads the size and kind of image from the first chunks of 'buffer'
+			// without touching pixel data, for layout before decoding. Throws
+			// InvalidArgumentException if the buffer does not start a WebP file.
+			static WebPImageInfo Probe(IBuffer^ buffer);
+
+			// Decodes the first frame of every buffer, each to the largest size that
+			// fits in 'maxWidth' x 'maxHeight' (0 = unbounded). The images are spread
+			// over the shared thread pool, largest first. Bitmaps come back in the
+			// order of 'buffers', with null for any that failed to decode.
+			static Windows::Foundation::IAsyncOperation<Windows::Foundation::Collections::IVectorView<WriteableBitmap^>^>^ DecodeBatchAsync(Windows::Foundation::Collections::IVectorView<IBuffer^>^ buffers, int maxWidth, int maxHeight);
+
+			// Bytes of decoded still images kept in memory so that decoding the same
+			// file at the same size again is a copy. 0 turns the cache off.
+			static property uint64 DecodedCacheBudget
+			{
+				uint64 get();
+				void set(uint64 value);
+			}
+
+			static void ClearDecodedCache();
+
+			// Bytes that libwebp may hold at once for all the decodes of the library
+			// together, not counting the bitmaps they decode into. A decode that
+			// would go over it fails with OutOfMemoryException. 0, the default,
+			// sets no limit. Set it before decoding starts.
+			static property uint64 DecodeMemoryLimit
+			{
+				uint64 get();
+				void set(uint64 value);
+			}
+
+			// Most memory libwebp has held at once for the decodes of the library
+			// that ran under DecodeMemoryLimit.
+			static property uint64 DecodeMemoryPeak
+			{
+				uint64 get();
+			}
+
 			property int PixelWidth
 			{
 				int get() { return pixelWidth; }
@@ -47,6 +194,18 @@ namespace ImageLib
 				int get() { return pixelHeight; }
 			}
 
+			// Size that frames are rendered at; smaller than PixelWidth/PixelHeight
+			// when the image was created with a maximum size.
+			property int DecodePixelWidth
+			{
+				int get() { return decodePixelWidth; }
+			}
+
+			property int DecodePixelHeight
+			{
+				int get() { return decodePixelHeight; }
+			}
+
 			property int LoopCount
 			{
 				int get() { return loopCount; }
@@ -68,6 +227,24 @@ namespace ImageLib
 			}
 
 			//WebPBitmapFrame^ GetFrame(int index);
+
+			// Composites frame 'index' onto one canvas-sized bitmap that is reused
+			// and returned by every call.
+			WriteableBitmap^ RenderFrame(int index);
+
+			// Like RenderFrame, for jumping around: decoding starts from the nearest
+			// key frame at or before 'index' rather than from the first frame.
+			WriteableBitmap^ SeekToFrame(int index);
+
+			// Seeks to the frame on screen 'timeMs' into a loop; times past the end
+			// show the last frame.
+			WriteableBitmap^ SeekToTime(int timeMs);
+
+			// Index of the frame on screen 'timeMs' into a loop.
+			int FrameAtTime(int timeMs);
+
+			// Time frame 'index' appears, in milliseconds from the start of a loop.
+			int FrameStartTime(int index);
 		};
 	}
 }
@@ -4,34 +4,24 @@
 #include <ppltasks.h>
 #include <wrl.h>
 #include <robuffer.h>
+#include <stdexcept>
+#include <string>
 #include <..\libwebp\webp\decode.h>
 #include <..\libwebp\webp\demux.h>
-
-
-class WebPDemuxerWrapper
+#include "Engine\WebPBatchDecoder.h"
+#include "Engine\WebPCompositor.h"
+#include "Engine\WebPContainer.h"
+#include "Engine\WebPFrameDecoder.h"
+#include "Engine\WebPFrameHeader.h"
+#include "Engine\WebPFrameRing.h"
+#include "Engine\WebPImageCache.h"
+#include "Engine\WebPProgressiveDecoder.h"
+#include "Engine\WebPSource.h"
+#include "Engine\WebPStreamingDemuxer.h"
+#include "Engine\WebPThreadPool.h"
+
+inline Platform::String^ ToPlatformString(const std::exception& e)
 {
-
-public:
-	WebPDemuxerWrapper(
-		std::unique_ptr<WebPDemuxer, decltype(&WebPDemuxDelete)>&& pDemuxer,
-		std::vector<uint8_t>&& pBuffer) :
-		m_pDemuxer(std::move(pDemuxer)),
-		m_pBuffer(std::move(pBuffer)) {
-	}
-
-	virtual ~WebPDemuxerWrapper() {
-		//FBLOGD("Deleting Demuxer");
-	}
-
-	WebPDemuxer* get() {
-		return m_pDemuxer.get();
-	}
-
-	size_t getBufferSize() {
-		return m_pBuffer.size();
-	}
-
-private:
-	std::unique_ptr<WebPDemuxer, decltype(&WebPDemuxDelete)> m_pDemuxer;
-	std::vector<uint8_t> m_pBuffer;
-};
\ No newline at end of file
+	std::string message(e.what());
+	return ref new Platform::String(std::wstring(message.begin(), message.end()).c_str());
+}
\ No newline at end of file
@@ -152,6 +152,10 @@ static int AllocateAlphaPlane(VP8Decoder* const dec, const VP8Io* const io) {
   const int height = io->crop_bottom;
   const uint64_t alpha_size = (uint64_t)stride * height;
   assert(dec->alpha_plane_mem_ == NULL);
+  if (dec->alpha_plane_ != NULL) {   // reserved in dec->mem_ already
+    dec->alpha_prev_line_ = NULL;
+    return 1;
+  }
   dec->alpha_plane_mem_ =
       (uint8_t*)WebPSafeMalloc(alpha_size, sizeof(*dec->alpha_plane_));
   if (dec->alpha_plane_mem_ == NULL) {
@@ -174,6 +178,115 @@ void WebPDeallocateAlphaMemory(VP8Decoder* const dec) {
 //------------------------------------------------------------------------------
 // Main entry point.
 
+#define ALPHA_AHEAD_ROWS 64   // rows decoded by each run of alpha_worker_
+
+// Reason for a failure of ALPHInit() or ALPHDecode().
+static VP8StatusCode ALPHStatus(const ALPHDecoder* const alph_dec) {
+  const VP8StatusCode status = (alph_dec->vp8l_dec_ != NULL) ?
+      alph_dec->vp8l_dec_->status_ : alph_dec->status_;
+  return (status == VP8_STATUS_OUT_OF_MEMORY) ? status
+                                              : VP8_STATUS_BITSTREAM_ERROR;
+}
+
+// Decodes the alpha rows from 'row' to 'row + num_rows', setting up the
+// decoder on the first call. In case of error, the cleanup is left to the
+// caller.
+static VP8StatusCode DecodeAlphaRows(VP8Decoder* const dec,
+                                     const VP8Io* const io,
+                                     int row, int num_rows) {
+  const int width = io->width;
+  const int height = io->crop_bottom;
+
+  if (dec->alph_dec_ == NULL) {    // Initialize decoder.
+    dec->alph_dec_ = ALPHNew();
+    if (dec->alph_dec_ == NULL) return VP8_STATUS_OUT_OF_MEMORY;
+    if (!AllocateAlphaPlane(dec, io)) return VP8_STATUS_OUT_OF_MEMORY;
+    if (!ALPHInit(dec->alph_dec_, dec->alpha_data_, dec->alpha_data_size_,
+                  io, dec->alpha_plane_)) {
+      return ALPHStatus(dec->alph_dec_);
+    }
+    // if we allowed use of alpha dithering, check whether it's needed at all
+    if (dec->alph_dec_->pre_processing_ != ALPHA_PREPROCESSED_LEVELS) {
+      dec->alpha_dithering_ = 0;   // disable dithering
+    } else {
+      num_rows = height - row;     // decode everything in one pass
+    }
+  }
+
+  assert(dec->alph_dec_ != NULL);
+  assert(row + num_rows <= height);
+  if (!ALPHDecode(dec, row, num_rows)) return ALPHStatus(dec->alph_dec_);
+
+  if (dec->is_alpha_decoded_) {   // finished?
+    ALPHDelete(dec->alph_dec_);
+    dec->alph_dec_ = NULL;
+    if (dec->alpha_dithering_ > 0) {
+      uint8_t* const alpha = dec->alpha_plane_ + io->crop_top * width
+                           + io->crop_left;
+      if (!WebPDequantizeLevelsMT(alpha,
+                                  io->crop_right - io->crop_left,
+                                  io->crop_bottom - io->crop_top,
+                                  width, dec->alpha_dithering_,
+                                  dec->max_threads_)) {
+        return VP8_STATUS_OUT_OF_MEMORY;
+      }
+    }
+  }
+  return VP8_STATUS_OK;
+}
+
+static int AlphaHook(void* arg1, void* arg2) {
+  VP8Decoder* const dec = (VP8Decoder*)arg1;
+  WebPStageMark mark;
+  (void)arg2;
+  WebPStageBegin(&mark, WEBP_STAGE_ALPHA);
+  dec->alpha_status_ =
+      DecodeAlphaRows(dec, &dec->alpha_io_, dec->alpha_ready_row_,
+                      dec->alpha_next_row_ - dec->alpha_ready_row_);
+  WebPStageEnd(&mark);
+  return (dec->alpha_status_ == VP8_STATUS_OK);
+}
+
+// Hands the rows following alpha_ready_row_ to the idle alpha_worker_.
+static void LaunchAlphaRows(VP8Decoder* const dec) {
+  const int height = dec->alpha_io_.crop_bottom;
+  if (dec->alpha_ready_row_ < height) {
+    dec->alpha_next_row_ = dec->alpha_ready_row_ + ALPHA_AHEAD_ROWS;
+    if (dec->alpha_next_row_ > height) dec->alpha_next_row_ = height;
+    WebPGetWorkerInterface()->Launch(&dec->alpha_worker_);
+  }
+}
+
+// Waits for alpha_worker_ until the rows above 'last_row' are decoded, and
+// sets it off on the next ones.
+static int WaitForAlphaRows(VP8Decoder* const dec, int last_row) {
+  const int height = dec->alpha_io_.crop_bottom;
+  while (dec->alpha_ready_row_ < last_row) {
+    if (!WebPGetWorkerInterface()->Sync(&dec->alpha_worker_)) return 0;
+    dec->alpha_ready_row_ =
+        dec->is_alpha_decoded_ ? height : dec->alpha_next_row_;
+    LaunchAlphaRows(dec);
+  }
+  return 1;
+}
+
+int VP8StartAlphaDecoding(VP8Decoder* const dec, const VP8Io* const io) {
+  WebPWorker* const worker = &dec->alpha_worker_;
+  assert(dec->alpha_data_ != NULL && !dec->is_alpha_decoded_);
+  if (!WebPGetWorkerInterface()->Reset(worker)) {
+    return VP8SetError(dec, VP8_STATUS_OUT_OF_MEMORY,
+                       "thread initialization failed.");
+  }
+  worker->hook = AlphaHook;
+  worker->data1 = dec;
+  worker->data2 = NULL;
+  dec->alpha_io_ = *io;
+  dec->alpha_ready_row_ = 0;
+  dec->alpha_ahead_ = 1;
+  LaunchAlphaRows(dec);
+  return 1;
+}
+
 const uint8_t* VP8DecompressAlphaRows(VP8Decoder* const dec,
                                       const VP8Io* const io,
                                       int row, int num_rows) {
@@ -186,41 +299,14 @@ const uint8_t* VP8DecompressAlphaRows(VP8Decoder* const dec,
     return NULL;    // sanity check.
   }
 
-  if (!dec->is_alpha_decoded_) {
-    if (dec->alph_dec_ == NULL) {    // Initialize decoder.
-      dec->alph_dec_ = ALPHNew();
-      if (dec->alph_dec_ == NULL) return NULL;
-      if (!AllocateAlphaPlane(dec, io)) goto Error;
-      if (!ALPHInit(dec->alph_dec_, dec->alpha_data_, dec->alpha_data_size_,
-                    io, dec->alpha_plane_)) {
-        goto Error;
-      }
-      // if we allowed use of alpha dithering, check whether it's needed at all
-      if (dec->alph_dec_->pre_processing_ != ALPHA_PREPROCESSED_LEVELS) {
-        dec->alpha_dithering_ = 0;   // disable dithering
-      } else {
-        num_rows = height - row;     // decode everything in one pass
-      }
-    }
-
-    assert(dec->alph_dec_ != NULL);
-    assert(row + num_rows <= height);
-    if (!ALPHDecode(dec, row, num_rows)) goto Error;
-
-    if (dec->is_alpha_decoded_) {   // finished?
-      ALPHDelete(dec->alph_dec_);
-      dec->alph_dec_ = NULL;
-      if (dec->alpha_dithering_ > 0) {
-        uint8_t* const alpha = dec->alpha_plane_ + io->crop_top * width
-                             + io->crop_left;
-        if (!WebPDequantizeLevels(alpha,
-                                  io->crop_right - io->crop_left,
-                                  io->crop_bottom - io->crop_top,
-                                  width, dec->alpha_dithering_)) {
-          goto Error;
-        }
-      }
-    }
+  if (dec->alpha_ahead_) {
+    if (!WaitForAlphaRows(dec, row + num_rows)) goto Error;
+  } else if (!dec->is_alpha_decoded_) {
+    WebPStageMark mark;
+    WebPStageBegin(&mark, WEBP_STAGE_ALPHA);
+    dec->alpha_status_ = DecodeAlphaRows(dec, io, row, num_rows);
+    WebPStageEnd(&mark);
+    if (dec->alpha_status_ != VP8_STATUS_OK) goto Error;
   }
 
   // Return a pointer to the current decoded row.
@@ -228,5 +314,8 @@ const uint8_t* VP8DecompressAlphaRows(VP8Decoder* const dec,
 
  Error:
   WebPDeallocateAlphaMemory(dec);
+  if (dec->alpha_status_ == VP8_STATUS_OUT_OF_MEMORY) {
+    VP8SetError(dec, VP8_STATUS_OUT_OF_MEMORY, "Alpha decoding out of memory.");
+  }
   return NULL;
 }
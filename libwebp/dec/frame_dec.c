@@ -68,38 +68,45 @@ static void DoUVTransform(uint32_t bits, const int16_t* const src,
   }
 }
 
+// Reconstructs the macroblocks [mb_x_start, mb_x_end) of a row. 'yuv_b' holds
+// the left samples from one span to the next.
 static void ReconstructRow(const VP8Decoder* const dec,
-                           const VP8ThreadContext* ctx) {
+                           const VP8ThreadContext* ctx, uint8_t* const yuv_b,
+                           int mb_x_start, int mb_x_end) {
   int j;
   int mb_x;
   const int mb_y = ctx->mb_y_;
   const int cache_id = ctx->id_;
-  uint8_t* const y_dst = dec->yuv_b_ + Y_OFF;
-  uint8_t* const u_dst = dec->yuv_b_ + U_OFF;
-  uint8_t* const v_dst = dec->yuv_b_ + V_OFF;
-
-  // Initialize left-most block.
-  for (j = 0; j < 16; ++j) {
-    y_dst[j * BPS - 1] = 129;
-  }
-  for (j = 0; j < 8; ++j) {
-    u_dst[j * BPS - 1] = 129;
-    v_dst[j * BPS - 1] = 129;
-  }
+  uint8_t* const y_dst = yuv_b + Y_OFF;
+  uint8_t* const u_dst = yuv_b + U_OFF;
+  uint8_t* const v_dst = yuv_b + V_OFF;
+  WebPStageMark mark;
+
+  WebPStageBegin(&mark, WEBP_STAGE_RECONSTRUCT);
+  if (mb_x_start == 0) {
+    // Initialize left-most block.
+    for (j = 0; j < 16; ++j) {
+      y_dst[j * BPS - 1] = 129;
+    }
+    for (j = 0; j < 8; ++j) {
+      u_dst[j * BPS - 1] = 129;
+      v_dst[j * BPS - 1] = 129;
+    }
 
-  // Init top-left sample on left column too.
-  if (mb_y > 0) {
-    y_dst[-1 - BPS] = u_dst[-1 - BPS] = v_dst[-1 - BPS] = 129;
-  } else {
-    // we only need to do this init once at block (0,0).
-    // Afterward, it remains valid for the whole topmost row.
-    memset(y_dst - BPS - 1, 127, 16 + 4 + 1);
-    memset(u_dst - BPS - 1, 127, 8 + 1);
-    memset(v_dst - BPS - 1, 127, 8 + 1);
+    // Init top-left sample on left column too.
+    if (mb_y > 0) {
+      y_dst[-1 - BPS] = u_dst[-1 - BPS] = v_dst[-1 - BPS] = 129;
+    } else {
+      // we only need to do this init once at block (0,0).
+      // Afterward, it remains valid for the whole topmost row.
+      memset(y_dst - BPS - 1, 127, 16 + 4 + 1);
+      memset(u_dst - BPS - 1, 127, 8 + 1);
+      memset(v_dst - BPS - 1, 127, 8 + 1);
+    }
   }
 
   // Reconstruct one row.
-  for (mb_x = 0; mb_x < dec->mb_w_; ++mb_x) {
+  for (mb_x = mb_x_start; mb_x < mb_x_end; ++mb_x) {
     const VP8MBData* const block = ctx->mb_data_ + mb_x;
 
     // Rotate in the left samples from previously decoded block. We move four
@@ -188,6 +195,7 @@ static void ReconstructRow(const VP8Decoder* const dec,
       }
     }
   }
+  WebPStageEnd(&mark);
 }
 
 //------------------------------------------------------------------------------
@@ -200,8 +208,17 @@ static void ReconstructRow(const VP8Decoder* const dec,
 //                 U/V, so it's 8 samples total (because of the 2x upsampling).
 static const uint8_t kFilterExtraRows[3] = { 0, 2, 8 };
 
-static void DoFilter(const VP8Decoder* const dec, int mb_x, int mb_y) {
-  const VP8ThreadContext* const ctx = &dec->thread_ctx_;
+// Number of bottom rows of a macroblock row that are emitted with the next
+// one. A reduced output holds back the whole row when filtering, so that its
+// batches start on a macroblock boundary.
+static int GetExtraRows(const VP8Decoder* const dec) {
+  return (dec->scale_shift_ > 0 && dec->filter_type_ > 0) ?
+         16 : kFilterExtraRows[dec->filter_type_];
+}
+
+static void DoFilter(const VP8Decoder* const dec,
+                     const VP8ThreadContext* const ctx, int mb_x) {
+  const int mb_y = ctx->mb_y_;
   const int cache_id = ctx->id_;
   const int y_bps = dec->cache_y_stride_;
   const VP8FInfo* const f_info = ctx->f_info_ + mb_x;
@@ -249,14 +266,21 @@ static void DoFilter(const VP8Decoder* const dec, int mb_x, int mb_y) {
   }
 }
 
-// Filter the decoded macroblock row (if needed)
-static void FilterRow(const VP8Decoder* const dec) {
+// Filter the macroblocks [mb_x_start, mb_x_end) of a decoded row, within the
+// cropping area.
+static void FilterRow(const VP8Decoder* const dec,
+                      const VP8ThreadContext* const ctx,
+                      int mb_x_start, int mb_x_end) {
   int mb_x;
-  const int mb_y = dec->thread_ctx_.mb_y_;
-  assert(dec->thread_ctx_.filter_row_);
-  for (mb_x = dec->tl_mb_x_; mb_x < dec->br_mb_x_; ++mb_x) {
-    DoFilter(dec, mb_x, mb_y);
+  WebPStageMark mark;
+  if (mb_x_start < dec->tl_mb_x_) mb_x_start = dec->tl_mb_x_;
+  if (mb_x_end > dec->br_mb_x_) mb_x_end = dec->br_mb_x_;
+  assert(ctx->filter_row_);
+  WebPStageBegin(&mark, WEBP_STAGE_FILTER);
+  for (mb_x = mb_x_start; mb_x < mb_x_end; ++mb_x) {
+    DoFilter(dec, ctx, mb_x);
   }
+  WebPStageEnd(&mark);
 }
 
 //------------------------------------------------------------------------------
@@ -398,14 +422,144 @@ static void DitherRow(VP8Decoder* const dec) {
 
 #define MACROBLOCK_VPOS(mb_y)  ((mb_y) * 16)    // vertical position of a MB
 
-// Finalize and transmit a complete row. Return false in case of user-abort.
-static int FinishRow(void* arg1, void* arg2) {
-  VP8Decoder* const dec = (VP8Decoder*)arg1;
-  VP8Io* const io = (VP8Io*)arg2;
+// Averages the 'width' x 'height' samples at 'src' over squares of
+// 1 << 'shift' samples on a side into 'dst'. Squares on the right and bottom
+// edges are only averaged over the samples they cover.
+static void AverageSquares(const uint8_t* src, int src_stride,
+                           int width, int height, int shift,
+                           uint8_t* dst, int dst_stride) {
+  const int size = 1 << shift;
+  int x, y, i, j;
+  for (y = 0; y < height; y += size) {
+    const int num_rows = (height - y < size) ? height - y : size;
+    x = 0;
+    if (num_rows == size && shift == 1) {
+      const uint8_t* const s = src + src_stride;
+      for (; x + 2 <= width; x += 2) {
+        dst[x >> 1] =
+            (uint8_t)((src[x] + src[x + 1] + s[x] + s[x + 1] + 2) >> 2);
+      }
+    } else if (num_rows == size) {
+      for (; x + 4 <= width; x += 4) {
+        int sum = 8;
+        for (j = 0; j < 4; ++j) {
+          const uint8_t* const s = src + j * src_stride + x;
+          sum += s[0] + s[1] + s[2] + s[3];
+        }
+        dst[x >> 2] = (uint8_t)(sum >> 4);
+      }
+    }
+    for (; x < width; x += size) {
+      const int num_cols = (width - x < size) ? width - x : size;
+      const int num = num_rows * num_cols;
+      int sum = 0;
+      for (j = 0; j < num_rows; ++j) {
+        for (i = 0; i < num_cols; ++i) sum += src[j * src_stride + x + i];
+      }
+      dst[x >> shift] = (uint8_t)((sum + num / 2) / num);
+    }
+    src += size * src_stride;
+    dst += dst_stride;
+  }
+}
+
+// Sets 'alpha_io' to decode the alpha plane of a reduced output at full size,
+// uncropped.
+static void GetReducedAlphaIo(const VP8Decoder* const dec,
+                              const VP8Io* const io, VP8Io* const alpha_io) {
+  const int width = dec->pic_hdr_.width_;
+  const int height = dec->pic_hdr_.height_;
+  *alpha_io = *io;
+  alpha_io->width = width;
+  alpha_io->height = height;
+  alpha_io->use_cropping = 0;
+  alpha_io->crop_left = 0;
+  alpha_io->crop_right = width;
+  alpha_io->crop_top = 0;
+  alpha_io->crop_bottom = height;
+}
+
+// Averages the alpha of rows 'y_start' to 'y_end' of the picture into
+// dec->reduced_a_, with a stride of 'io->width'. Returns false in case of
+// error.
+static int ReduceAlphaRows(VP8Decoder* const dec, const VP8Io* const io,
+                           int y_start, int y_end) {
+  const int width = dec->pic_hdr_.width_;
+  const int shift = dec->scale_shift_;
+  const uint8_t* alpha;
+  VP8Io alpha_io;
+  GetReducedAlphaIo(dec, io, &alpha_io);
+  alpha = VP8DecompressAlphaRows(dec, &alpha_io, y_start, y_end - y_start);
+  if (alpha == NULL) return 0;
+  AverageSquares(alpha, width, width, y_end - y_start, shift,
+                 dec->reduced_a_ + (y_start >> shift) * io->width, io->width);
+  return 1;
+}
+
+// Averages rows 'y_start' to 'y_end' of the picture, found at 'y', 'u' and
+// 'v', and transmits those of them that are in the cropping area of the
+// reduced output. Return false in case of error or user-abort.
+static int EmitReducedRows(VP8Decoder* const dec, VP8Io* const io,
+                           int y_start, int y_end, const uint8_t* const y,
+                           const uint8_t* const u, const uint8_t* const v) {
+  const int shift = dec->scale_shift_;
+  const int width = dec->pic_hdr_.width_;
+  const int uv_width = (width + 1) >> 1;
+  const int num_uv_rows = ((y_end + 1) >> 1) - (y_start >> 1);
+  const int first_row = y_start >> shift;
+  int out_start = first_row;
+  int out_end = (y_end + (1 << shift) - 1) >> shift;
+  int ok = 1;
+  WebPStageMark mark;
+
+  assert(!(y_start & 15));
+  WebPStageBegin(&mark, WEBP_STAGE_RESCALE);
+  AverageSquares(y, dec->cache_y_stride_, width, y_end - y_start, shift,
+                 dec->reduced_y_, io->y_stride);
+  AverageSquares(u, dec->cache_uv_stride_, uv_width, num_uv_rows, shift,
+                 dec->reduced_u_, io->uv_stride);
+  AverageSquares(v, dec->cache_uv_stride_, uv_width, num_uv_rows, shift,
+                 dec->reduced_v_, io->uv_stride);
+  WebPStageEnd(&mark);
+
+  if (out_end > io->crop_bottom) {
+    out_end = io->crop_bottom;
+  }
+  io->a = NULL;
+  if (dec->alpha_data_ != NULL && out_start < out_end) {
+    if (!ReduceAlphaRows(dec, io, y_start, y_end)) {
+      return VP8SetError(dec, VP8_STATUS_BITSTREAM_ERROR,
+                         "Could not decode alpha data.");
+    }
+    io->a = dec->reduced_a_ + first_row * io->width;
+  }
+  if (out_start < io->crop_top) out_start = io->crop_top;
+  if (out_start < out_end) {
+    const int delta_y = out_start - first_row;
+    const int uv_offset =
+        (delta_y >> 1) * io->uv_stride + (io->crop_left >> 1);
+    assert(!(delta_y & 1));
+    io->y = dec->reduced_y_ + delta_y * io->y_stride + io->crop_left;
+    io->u = dec->reduced_u_ + uv_offset;
+    io->v = dec->reduced_v_ + uv_offset;
+    if (io->a != NULL) {
+      io->a += delta_y * io->width + io->crop_left;
+    }
+    io->mb_y = out_start - io->crop_top;
+    io->mb_w = io->crop_right - io->crop_left;
+    io->mb_h = out_end - out_start;
+    ok = io->put(io);
+  }
+  return ok;
+}
+
+// Transmit a reconstructed and filtered row. Return false in case of
+// user-abort.
+static int EmitRow(VP8Decoder* const dec, const VP8ThreadContext* const ctx,
+                   VP8Io* const io) {
   int ok = 1;
-  const VP8ThreadContext* const ctx = &dec->thread_ctx_;
   const int cache_id = ctx->id_;
-  const int extra_y_rows = kFilterExtraRows[dec->filter_type_];
+  const int extra_y_rows = GetExtraRows(dec);
   const int ysize = extra_y_rows * dec->cache_y_stride_;
   const int uvsize = (extra_y_rows / 2) * dec->cache_uv_stride_;
   const int y_offset = cache_id * 16 * dec->cache_y_stride_;
@@ -417,18 +571,6 @@ static int FinishRow(void* arg1, void* arg2) {
   const int is_first_row = (mb_y == 0);
   const int is_last_row = (mb_y >= dec->br_mb_y_ - 1);
 
-  if (dec->mt_method_ == 2) {
-    ReconstructRow(dec, ctx);
-  }
-
-  if (ctx->filter_row_) {
-    FilterRow(dec);
-  }
-
-  if (dec->dither_) {
-    DitherRow(dec);
-  }
-
   if (io->put != NULL) {
     int y_start = MACROBLOCK_VPOS(mb_y);
     int y_end = MACROBLOCK_VPOS(mb_y + 1);
@@ -446,40 +588,48 @@ static int FinishRow(void* arg1, void* arg2) {
     if (!is_last_row) {
       y_end -= extra_y_rows;
     }
-    if (y_end > io->crop_bottom) {
-      y_end = io->crop_bottom;    // make sure we don't overflow on last row.
-    }
-    // If dec->alpha_data_ is not NULL, we have some alpha plane present.
-    io->a = NULL;
-    if (dec->alpha_data_ != NULL && y_start < y_end) {
-      io->a = VP8DecompressAlphaRows(dec, io, y_start, y_end - y_start);
-      if (io->a == NULL) {
-        return VP8SetError(dec, VP8_STATUS_BITSTREAM_ERROR,
-                           "Could not decode alpha data.");
+    if (dec->scale_shift_ > 0) {
+      const int height = dec->pic_hdr_.height_;
+      if (y_end > height) y_end = height;
+      if (y_start < y_end) {
+        ok = EmitReducedRows(dec, io, y_start, y_end, io->y, io->u, io->v);
       }
-    }
-    if (y_start < io->crop_top) {
-      const int delta_y = io->crop_top - y_start;
-      y_start = io->crop_top;
-      assert(!(delta_y & 1));
-      io->y += dec->cache_y_stride_ * delta_y;
-      io->u += dec->cache_uv_stride_ * (delta_y >> 1);
-      io->v += dec->cache_uv_stride_ * (delta_y >> 1);
-      if (io->a != NULL) {
-        io->a += io->width * delta_y;
+    } else {
+      if (y_end > io->crop_bottom) {
+        y_end = io->crop_bottom;    // make sure we don't overflow on last row.
       }
-    }
-    if (y_start < y_end) {
-      io->y += io->crop_left;
-      io->u += io->crop_left >> 1;
-      io->v += io->crop_left >> 1;
-      if (io->a != NULL) {
-        io->a += io->crop_left;
+      // If dec->alpha_data_ is not NULL, we have some alpha plane present.
+      io->a = NULL;
+      if (dec->alpha_data_ != NULL && y_start < y_end) {
+        io->a = VP8DecompressAlphaRows(dec, io, y_start, y_end - y_start);
+        if (io->a == NULL) {
+          return VP8SetError(dec, VP8_STATUS_BITSTREAM_ERROR,
+                             "Could not decode alpha data.");
+        }
+      }
+      if (y_start < io->crop_top) {
+        const int delta_y = io->crop_top - y_start;
+        y_start = io->crop_top;
+        assert(!(delta_y & 1));
+        io->y += dec->cache_y_stride_ * delta_y;
+        io->u += dec->cache_uv_stride_ * (delta_y >> 1);
+        io->v += dec->cache_uv_stride_ * (delta_y >> 1);
+        if (io->a != NULL) {
+          io->a += io->width * delta_y;
+        }
+      }
+      if (y_start < y_end) {
+        io->y += io->crop_left;
+        io->u += io->crop_left >> 1;
+        io->v += io->crop_left >> 1;
+        if (io->a != NULL) {
+          io->a += io->crop_left;
+        }
+        io->mb_y = y_start - io->crop_top;
+        io->mb_w = io->crop_right - io->crop_left;
+        io->mb_h = y_end - y_start;
+        ok = io->put(io);
       }
-      io->mb_y = y_start - io->crop_top;
-      io->mb_w = io->crop_right - io->crop_left;
-      io->mb_h = y_end - y_start;
-      ok = io->put(io);
     }
   }
   // rotate top samples if needed
@@ -496,6 +646,152 @@ static int FinishRow(void* arg1, void* arg2) {
 
 #undef MACROBLOCK_VPOS
 
+// Finalize and transmit a complete row. Return false in case of user-abort.
+static int FinishRow(void* arg1, void* arg2) {
+  VP8Decoder* const dec = (VP8Decoder*)arg1;
+  VP8Io* const io = (VP8Io*)arg2;
+  const VP8ThreadContext* const ctx = &dec->thread_ctx_;
+
+  if (dec->mt_method_ >= 2) {
+    ReconstructRow(dec, ctx, dec->yuv_b_, 0, dec->mb_w_);
+  }
+
+  if (ctx->filter_row_) {
+    FilterRow(dec, ctx, 0, dec->mb_w_);
+  }
+
+  if (dec->dither_) {
+    DitherRow(dec);
+  }
+
+  return EmitRow(dec, ctx, io);
+}
+
+//------------------------------------------------------------------------------
+// Wavefront reconstruction and filtering
+//
+// Reconstructing macroblock (x, y) needs the top samples of (x + 1, y - 1),
+// and filtering it modifies the right pixels of (x - 1, y) and the bottom
+// pixels of (x, y - 1), which must have been filtered by (x + 1, y - 1)
+// first. So row 'y' can follow row 'y - 1' two macroblocks behind. With
+// spans of columns, span 'c' of row 'r' runs at step '2 * r + c', once span
+// 'c + 1' of row 'r - 1' and span 'c - 1' of row 'r' are done, next to spans
+// that are at least one span apart. A band only starts when the previous one
+// is output, so its rows take the cache lines 0..num_wave_rows_ - 1.
+// The output itself stays serial, in row order.
+
+#define WAVE_SPAN_MBS 8   // macroblocks per span, to amortize the steps
+
+static int DoWaveJob(void* arg1, void* arg2) {
+  const VP8Decoder* const dec = (const VP8Decoder*)arg1;
+  const VP8WaveJob* const job = (const VP8WaveJob*)arg2;
+  ReconstructRow(dec, job->ctx_, job->yuv_b_,
+                 job->mb_x_start_, job->mb_x_end_);
+  if (job->ctx_->filter_row_) {
+    FilterRow(dec, job->ctx_, job->mb_x_start_, job->mb_x_end_);
+  }
+  return 1;
+}
+
+// Reconstruct, filter and transmit the band of rows handed over by
+// VP8ProcessRow(). Return false in case of user-abort.
+static int FinishBand(void* arg1, void* arg2) {
+  VP8Decoder* const dec = (VP8Decoder*)arg1;
+  VP8Io* const io = (VP8Io*)arg2;
+  const WebPWorkerInterface* const winterface = WebPGetWorkerInterface();
+  const int num_spans = dec->num_wave_spans_;
+  const int num_rows = dec->wave_band_rows_;
+  const int num_steps = 2 * (num_rows - 1) + num_spans;
+  int ok = 1;
+  int step, r;
+  for (r = 0; r < num_rows; ++r) {
+    const int y = dec->wave_band_y_ + r;
+    VP8WaveJob* const job = &dec->wave_jobs_[r];
+    job->ctx_ = &dec->wave_ctx_[y % (2 * dec->num_wave_rows_)];
+    job->yuv_b_ = dec->yuv_b_ + r * YUV_SIZE;
+  }
+  for (step = 0; step < num_steps; ++step) {
+    // rows with a span in this step
+    const int first_r = (step >= num_spans) ? (step - num_spans + 2) / 2 : 0;
+    const int last_r = (step / 2 < num_rows - 1) ? step / 2 : num_rows - 1;
+    for (r = first_r; r <= last_r; ++r) {
+      VP8WaveJob* const job = &dec->wave_jobs_[r];
+      const int c = step - 2 * r;
+      job->mb_x_start_ = c * dec->mb_w_ / num_spans;
+      job->mb_x_end_ = (c + 1) * dec->mb_w_ / num_spans;
+      if (r < last_r) {
+        winterface->Launch(&dec->wave_workers_[r]);
+      } else {
+        DoWaveJob(dec, job);
+      }
+    }
+    for (r = first_r; r < last_r; ++r) {
+      winterface->Sync(&dec->wave_workers_[r]);
+    }
+  }
+  for (r = 0; ok && r < num_rows; ++r) {
+    ok = EmitRow(dec, dec->wave_jobs_[r].ctx_, io);
+  }
+  return ok;
+}
+
+// Set up the spans and workers of the wavefront. Return false if a worker
+// can't be started.
+static int InitWave(VP8Decoder* const dec) {
+  const WebPWorkerInterface* const winterface = WebPGetWorkerInterface();
+  int r;
+  dec->num_wave_spans_ = dec->mb_w_ / WAVE_SPAN_MBS;
+  if (dec->num_wave_spans_ < 1) dec->num_wave_spans_ = 1;
+  for (r = 0; r < dec->num_wave_rows_ - 1; ++r) {
+    WebPWorker* const worker = &dec->wave_workers_[r];
+    if (!winterface->Reset(worker)) return 0;
+    worker->hook = DoWaveJob;
+    worker->data1 = dec;
+    worker->data2 = &dec->wave_jobs_[r];
+  }
+  dec->worker_.hook = FinishBand;
+  return 1;
+}
+
+#undef WAVE_SPAN_MBS
+
+void VP8UseRowSlot(VP8Decoder* const dec, int mb_y) {
+  const int slot = mb_y % dec->num_row_slots_;
+  dec->mb_data_ = dec->mb_data_slots_ + slot * dec->mb_w_;
+  dec->f_info_ = (dec->f_info_slots_ != NULL) ?
+      dec->f_info_slots_ + slot * dec->mb_w_ : NULL;
+}
+
+// Queue the row for FinishBand(), and hand the band over to worker_ when it's
+// complete.
+static int QueueWaveRow(VP8Decoder* const dec, VP8Io* const io,
+                        int filter_row) {
+  int ok = 1;
+  const int num_wave_rows = dec->num_wave_rows_;
+  const int r = dec->mb_y_ % num_wave_rows;
+  VP8ThreadContext* const ctx =
+      &dec->wave_ctx_[dec->mb_y_ % (2 * num_wave_rows)];
+  ctx->id_ = r;
+  ctx->mb_y_ = dec->mb_y_;
+  ctx->filter_row_ = filter_row;
+  ctx->mb_data_ = dec->mb_data_;
+  ctx->f_info_ = dec->f_info_;
+  if (r == num_wave_rows - 1 || dec->mb_y_ == dec->br_mb_y_ - 1) {
+    WebPWorker* const worker = &dec->worker_;
+    // Finish the previous band *before* updating the io
+    ok &= WebPGetWorkerInterface()->Sync(worker);
+    assert(worker->status_ == OK);
+    if (ok) {
+      dec->thread_ctx_.io_ = *io;
+      dec->wave_band_y_ = dec->mb_y_ - r;
+      dec->wave_band_rows_ = r + 1;
+      WebPGetWorkerInterface()->Launch(worker);
+    }
+  }
+  VP8UseRowSlot(dec, dec->mb_y_ + 1);
+  return ok;
+}
+
 //------------------------------------------------------------------------------
 
 int VP8ProcessRow(VP8Decoder* const dec, VP8Io* const io) {
@@ -508,8 +804,10 @@ int VP8ProcessRow(VP8Decoder* const dec, VP8Io* const io) {
     // ctx->id_ and ctx->f_info_ are already set
     ctx->mb_y_ = dec->mb_y_;
     ctx->filter_row_ = filter_row;
-    ReconstructRow(dec, ctx);
+    ReconstructRow(dec, ctx, dec->yuv_b_, 0, dec->mb_w_);
     ok = FinishRow(dec, io);
+  } else if (dec->num_wave_rows_ > 1) {
+    ok = QueueWaveRow(dec, io, filter_row);
   } else {
     WebPWorker* const worker = &dec->worker_;
     // Finish previous job *before* updating context
@@ -520,15 +818,19 @@ int VP8ProcessRow(VP8Decoder* const dec, VP8Io* const io) {
       ctx->id_ = dec->cache_id_;
       ctx->mb_y_ = dec->mb_y_;
       ctx->filter_row_ = filter_row;
-      if (dec->mt_method_ == 2) {  // swap macroblock data
+      if (dec->mt_method_ == 3) {
+        // the row stays in its VP8ParseRow slot until reconstructed
+        ctx->mb_data_ = dec->mb_data_;
+        ctx->f_info_ = dec->f_info_;
+      } else if (dec->mt_method_ == 2) {  // swap macroblock data
         VP8MBData* const tmp = ctx->mb_data_;
         ctx->mb_data_ = dec->mb_data_;
         dec->mb_data_ = tmp;
       } else {
         // perform reconstruction directly in main thread
-        ReconstructRow(dec, ctx);
+        ReconstructRow(dec, ctx, dec->yuv_b_, 0, dec->mb_w_);
       }
-      if (filter_row) {            // swap filter info
+      if (filter_row && dec->mt_method_ != 3) {   // swap filter info
         VP8FInfo* const tmp = ctx->f_info_;
         ctx->f_info_ = dec->f_info_;
         dec->f_info_ = tmp;
@@ -549,13 +851,18 @@ int VP8ProcessRow(VP8Decoder* const dec, VP8Io* const io) {
 VP8StatusCode VP8EnterCritical(VP8Decoder* const dec, VP8Io* const io) {
   // Call setup() first. This may trigger additional decoding features on 'io'.
   // Note: Afterward, we must call teardown() no matter what.
+  io->setup_out_of_memory = 0;
   if (io->setup != NULL && !io->setup(io)) {
+    if (io->setup_out_of_memory) {
+      VP8SetError(dec, VP8_STATUS_OUT_OF_MEMORY, "Frame setup out of memory");
+    }
     VP8SetError(dec, VP8_STATUS_USER_ABORT, "Frame setup failed");
     return dec->status_;
   }
 
-  // Disable filtering per user request
-  if (io->bypass_filtering) {
+  // Disable filtering per user request, or for a preview, where it would
+  // hardly show.
+  if (io->bypass_filtering || dec->preview_) {
     dec->filter_type_ = 0;
   }
 
@@ -570,6 +877,12 @@ VP8StatusCode VP8EnterCritical(VP8Decoder* const dec, VP8Io* const io) {
   // macroblocks.
   {
     const int extra_pixels = kFilterExtraRows[dec->filter_type_];
+    // A reduced output is cropped in reduced samples.
+    const int shift = dec->scale_shift_;
+    const int crop_left = io->crop_left << shift;
+    const int crop_top = io->crop_top << shift;
+    const int crop_right = io->crop_right << shift;
+    const int crop_bottom = io->crop_bottom << shift;
     if (dec->filter_type_ == 2) {
       // For complex filter, we need to preserve the dependency chain.
       dec->tl_mb_x_ = 0;
@@ -579,14 +892,14 @@ VP8StatusCode VP8EnterCritical(VP8Decoder* const dec, VP8Io* const io) {
       // We include 'extra_pixels' on the other side of the boundary, since
       // vertical or horizontal filtering of the previous macroblock can
       // modify some abutting pixels.
-      dec->tl_mb_x_ = (io->crop_left - extra_pixels) >> 4;
-      dec->tl_mb_y_ = (io->crop_top - extra_pixels) >> 4;
+      dec->tl_mb_x_ = (crop_left - extra_pixels) >> 4;
+      dec->tl_mb_y_ = (crop_top - extra_pixels) >> 4;
       if (dec->tl_mb_x_ < 0) dec->tl_mb_x_ = 0;
       if (dec->tl_mb_y_ < 0) dec->tl_mb_y_ = 0;
     }
     // We need some 'extra' pixels on the right/bottom.
-    dec->br_mb_y_ = (io->crop_bottom + 15 + extra_pixels) >> 4;
-    dec->br_mb_x_ = (io->crop_right + 15 + extra_pixels) >> 4;
+    dec->br_mb_y_ = (crop_bottom + 15 + extra_pixels) >> 4;
+    dec->br_mb_x_ = (crop_right + 15 + extra_pixels) >> 4;
     if (dec->br_mb_x_ > dec->mb_w_) {
       dec->br_mb_x_ = dec->mb_w_;
     }
@@ -603,6 +916,11 @@ int VP8ExitCritical(VP8Decoder* const dec, VP8Io* const io) {
   if (dec->mt_method_ > 0) {
     ok = WebPGetWorkerInterface()->Sync(&dec->worker_);
   }
+  if (dec->alpha_ahead_) {
+    // Only busy if decoding stopped early. Alpha errors are reported by
+    // VP8DecompressAlphaRows().
+    WebPGetWorkerInterface()->Sync(&dec->alpha_worker_);
+  }
 
   if (io->teardown != NULL) {
     io->teardown(io);
@@ -633,6 +951,10 @@ int VP8ExitCritical(VP8Decoder* const dec, VP8Io* const io) {
 // and output process have non-concurrent writing:
 // Decode:  [ 0..15][16..31][ 0..15][16..31][...
 // io->put:         [ 0..15][16..31][ 0..15][...
+// With parallel parsing (mt_method_ 3), several rows are parsed at once but
+// only the worker reconstructs into the cache, one row after the other, so
+// the same delay line applies. The parsed rows wait in a ring of
+// num_parse_jobs_ + 1 VP8ParseRow slots instead.
 
 #define MT_CACHE_LINES 3
 #define ST_CACHE_LINES 1   // 1 cache row only for single-threaded case
@@ -640,6 +962,7 @@ int VP8ExitCritical(VP8Decoder* const dec, VP8Io* const io) {
 // Initialize multi/single-thread worker
 static int InitThreadContext(VP8Decoder* const dec) {
   dec->cache_id_ = 0;
+  dec->num_wave_rows_ = 1;
   if (dec->mt_method_ > 0) {
     WebPWorker* const worker = &dec->worker_;
     if (!WebPGetWorkerInterface()->Reset(worker)) {
@@ -649,7 +972,38 @@ static int InitThreadContext(VP8Decoder* const dec) {
     worker->data1 = dec;
     worker->data2 = (void*)&dec->thread_ctx_.io_;
     worker->hook = FinishRow;
+    if (dec->mt_method_ == 3) {
+      // Reconstruction and filtering cost more than parsing: they get the
+      // larger half of the thread budget. Parsing takes one row per token
+      // partition at most.
+      const int num_parts = dec->num_parts_minus_one_ + 1;
+      int num_jobs = dec->max_threads_ / 2;
+      if (num_jobs > num_parts) num_jobs = num_parts;
+      if (num_jobs < 2) num_jobs = 1;
+      dec->num_wave_rows_ = dec->max_threads_ - num_jobs;
+      if (dec->num_wave_rows_ > MAX_WAVE_ROWS) {
+        dec->num_wave_rows_ = MAX_WAVE_ROWS;
+      }
+      // Dithering draws its random numbers in raster order.
+      if (dec->dither_) dec->num_wave_rows_ = 1;
+      if (dec->num_wave_rows_ > 1 && !InitWave(dec)) {
+        return VP8SetError(dec, VP8_STATUS_OUT_OF_MEMORY,
+                           "thread initialization failed.");
+      }
+      if (num_jobs == 1) {
+        dec->mt_method_ = 2;   // nothing to parse in parallel
+      } else {
+        dec->num_parse_jobs_ = num_jobs;
+        if (!VP8InitParseJobs(dec)) {
+          return VP8SetError(dec, VP8_STATUS_OUT_OF_MEMORY,
+                             "thread initialization failed.");
+        }
+      }
+    }
+    // The wavefront outputs a band before starting the next one, so each
+    // row of the band needs a cache line, and no more.
     dec->num_caches_ =
+      (dec->num_wave_rows_ > 1) ? dec->num_wave_rows_ :
       (dec->filter_type_ > 0) ? MT_CACHE_LINES : MT_CACHE_LINES - 1;
   } else {
     dec->num_caches_ = ST_CACHE_LINES;
@@ -668,7 +1022,11 @@ int VP8GetThreadMethod(const WebPDecoderOptions* const options,
   (void)height;
   assert(headers == NULL || !headers->is_lossless);
 #if defined(WEBP_USE_THREAD)
-  if (width >= MIN_WIDTH_FOR_THREADS) return 2;
+  if (width >= MIN_WIDTH_FOR_THREADS) {
+    // Parallel parsing needs all the token partitions up-front, which
+    // incremental decoding (headers == NULL) doesn't have.
+    return (headers != NULL && options->use_threads > 2) ? 3 : 2;
+  }
 #endif
   return 0;
 }
@@ -686,30 +1044,50 @@ static int AllocateMemory(VP8Decoder* const dec) {
   const size_t intra_pred_mode_size = 4 * mb_w * sizeof(uint8_t);
   const size_t top_size = sizeof(VP8TopSamples) * mb_w;
   const size_t mb_info_size = (mb_w + 1) * sizeof(VP8MB);
+  // Rows of parsed data: the one being parsed and the one being reconstructed.
+  // Otherwise, a slot per row being parsed, plus one for the row being
+  // reconstructed, or two bands for the wavefront: the one in flight and the
+  // one being parsed.
+  const int num_parse_jobs = (dec->mt_method_ == 3) ? dec->num_parse_jobs_ : 1;
+  const int use_slots = (dec->mt_method_ == 3) || (dec->num_wave_rows_ > 1);
+  const int num_parse_rows =
+      use_slots ? 2 * dec->num_wave_rows_ + num_parse_jobs - 1
+                : (dec->mt_method_ > 0) ? 2 : 1;
   const size_t f_info_size =
-      (dec->filter_type_ > 0) ?
-          mb_w * (dec->mt_method_ > 0 ? 2 : 1) * sizeof(VP8FInfo)
-        : 0;
-  const size_t yuv_size = YUV_SIZE * sizeof(*dec->yuv_b_);
+      (dec->filter_type_ > 0) ? mb_w * num_parse_rows * sizeof(VP8FInfo) : 0;
+  const size_t yuv_size =
+      dec->num_wave_rows_ * YUV_SIZE * sizeof(*dec->yuv_b_);
   const size_t mb_data_size =
-      (dec->mt_method_ == 2 ? 2 : 1) * mb_w * sizeof(*dec->mb_data_);
-  const size_t cache_height = (16 * num_caches
-                            + kFilterExtraRows[dec->filter_type_]) * 3 / 2;
+      (dec->mt_method_ == 1 ? 1 : num_parse_rows) * mb_w *
+      sizeof(*dec->mb_data_);
+  const size_t cache_height = (16 * num_caches + GetExtraRows(dec)) * 3 / 2;
   const size_t cache_size = top_size * cache_height;
   // alpha_size is the only one that scales as width x height.
   const uint64_t alpha_size = (dec->alpha_data_ != NULL) ?
       (uint64_t)dec->pic_hdr_.width_ * dec->pic_hdr_.height_ : 0ULL;
+  // A batch of reduced rows comes from up to 2 macroblock rows, the held
+  // back one and the last one.
+  const int shift = dec->scale_shift_;
+  const uint64_t reduced_y_size =
+      (uint64_t)(32 >> shift) * (16 >> shift) * mb_w;
+  const uint64_t reduced_uv_size =
+      (uint64_t)(16 >> shift) * (8 >> shift) * mb_w;
+  const uint64_t reduced_a_size = (dec->alpha_data_ != NULL) ?
+      (uint64_t)(16 >> shift) * mb_w * (16 >> shift) * dec->mb_h_ : 0ULL;
+  const uint64_t reduced_size = (shift == 0) ? 0ULL :
+      reduced_y_size + 2 * reduced_uv_size + reduced_a_size;
   const uint64_t needed = (uint64_t)intra_pred_mode_size
                         + top_size + mb_info_size + f_info_size
                         + yuv_size + mb_data_size
-                        + cache_size + alpha_size + WEBP_ALIGN_CST;
+                        + cache_size + alpha_size + reduced_size
+                        + WEBP_ALIGN_CST;
   uint8_t* mem;
 
   if (needed != (size_t)needed) return 0;  // check for overflow
   if (needed > dec->mem_size_) {
-    WebPSafeFree(dec->mem_);
+    WebPArenaFree(dec->arena_, dec->mem_);
     dec->mem_size_ = 0;
-    dec->mem_ = WebPSafeMalloc(needed, sizeof(uint8_t));
+    dec->mem_ = WebPArenaMalloc(dec->arena_, needed, sizeof(uint8_t));
     if (dec->mem_ == NULL) {
       return VP8SetError(dec, VP8_STATUS_OUT_OF_MEMORY,
                          "no memory during frame initialization.");
@@ -746,7 +1124,11 @@ static int AllocateMemory(VP8Decoder* const dec) {
 
   dec->mb_data_ = (VP8MBData*)mem;
   dec->thread_ctx_.mb_data_ = (VP8MBData*)mem;
-  if (dec->mt_method_ == 2) {
+  if (use_slots) {
+    dec->num_row_slots_ = num_parse_rows;
+    dec->mb_data_slots_ = dec->mb_data_;
+    dec->f_info_slots_ = dec->f_info_;
+  } else if (dec->mt_method_ == 2) {
     dec->thread_ctx_.mb_data_ += mb_w;
   }
   mem += mb_data_size;
@@ -754,7 +1136,7 @@ static int AllocateMemory(VP8Decoder* const dec) {
   dec->cache_y_stride_ = 16 * mb_w;
   dec->cache_uv_stride_ = 8 * mb_w;
   {
-    const int extra_rows = kFilterExtraRows[dec->filter_type_];
+    const int extra_rows = GetExtraRows(dec);
     const int extra_y = extra_rows * dec->cache_y_stride_;
     const int extra_uv = (extra_rows / 2) * dec->cache_uv_stride_;
     dec->cache_y_ = mem + extra_y;
@@ -769,6 +1151,15 @@ static int AllocateMemory(VP8Decoder* const dec) {
   // alpha plane
   dec->alpha_plane_ = alpha_size ? mem : NULL;
   mem += alpha_size;
+
+  if (reduced_size > 0) {
+    dec->reduced_y_ = mem;
+    dec->reduced_u_ = dec->reduced_y_ + reduced_y_size;
+    dec->reduced_v_ = dec->reduced_u_ + reduced_uv_size;
+    dec->reduced_a_ =
+        reduced_a_size ? dec->reduced_v_ + reduced_uv_size : NULL;
+    mem += reduced_size;
+  }
   assert(mem <= (uint8_t*)dec->mem_ + dec->mem_size_);
 
   // note: left/top-info is initialized once for all.
@@ -789,6 +1180,13 @@ static void InitIo(VP8Decoder* const dec, VP8Io* io) {
   io->v = dec->cache_v_;
   io->y_stride = dec->cache_y_stride_;
   io->uv_stride = dec->cache_uv_stride_;
+  if (dec->scale_shift_ > 0) {
+    io->y = dec->reduced_y_;
+    io->u = dec->reduced_u_;
+    io->v = dec->reduced_v_;
+    io->y_stride = (16 >> dec->scale_shift_) * dec->mb_w_;
+    io->uv_stride = (8 >> dec->scale_shift_) * dec->mb_w_;
+  }
   io->a = NULL;
 }
 
@@ -797,6 +1195,15 @@ int VP8InitFrame(VP8Decoder* const dec, VP8Io* const io) {
   if (!AllocateMemory(dec)) return 0;
   InitIo(dec, io);
   VP8DspInit();  // Init critical function pointers and look-up tables.
+  // The alpha plane is decoded on its own worker when threads are allowed.
+  // Incremental decoding doesn't set max_threads_, as its alpha data may
+  // move.
+  if (dec->alpha_data_ != NULL && dec->mt_method_ > 0 &&
+      dec->max_threads_ > 0) {
+    VP8Io alpha_io = *io;
+    if (dec->scale_shift_ > 0) GetReducedAlphaIo(dec, io, &alpha_io);
+    if (!VP8StartAlphaDecoding(dec, &alpha_io)) return 0;
+  }
   return 1;
 }
 
@@ -47,7 +47,8 @@ typedef enum {
 typedef enum {
   MEM_MODE_NONE = 0,
   MEM_MODE_APPEND,
-  MEM_MODE_MAP
+  MEM_MODE_MAP,
+  MEM_MODE_SEGMENTS
 } MemBufferMode;
 
 // storage for partition #0 and partial data (in a rolling fashion)
@@ -60,6 +61,14 @@ typedef struct {
 
   size_t part0_size_;         // size of partition #0
   const uint8_t* part0_buf_;  // buffer to store partition #0
+
+  // In MEM_MODE_SEGMENTS, the input stays in the caller's segments and
+  // 'start_' and 'end_' are positions in the whole input. Until the pixel
+  // data is reached, the headers that straddle segments are gathered in
+  // 'buf_', from input position 'buf_offset_' on.
+  VP8Segment* segments_;      // first segment
+  VP8Segment* last_segment_;
+  size_t buf_offset_;
 } MemBuffer;
 
 struct WebPIDecoder {
@@ -92,6 +101,21 @@ static WEBP_INLINE size_t MemDataSize(const MemBuffer* mem) {
   return (mem->end_ - mem->start_);
 }
 
+// Returns the data to be decoded, contiguous in memory.
+static const uint8_t* MemData(const MemBuffer* mem) {
+  if (mem->mode_ != MEM_MODE_SEGMENTS) {
+    return mem->buf_ + mem->start_;
+  } else if (mem->buf_ != NULL) {
+    return mem->buf_ + (mem->start_ - mem->buf_offset_);
+  } else {
+    // Not gathering: the data not decoded yet is all in the last segment.
+    const VP8Segment* const last = mem->last_segment_;
+    if (last == NULL) return NULL;
+    assert(mem->start_ >= last->offset_);
+    return last->data_ + (mem->start_ - last->offset_);
+  }
+}
+
 // Check if we need to preserve the compressed alpha data, as it may not have
 // been decoded yet.
 static int NeedCompressedAlpha(const WebPIDecoder* const idec) {
@@ -216,12 +240,96 @@ static int RemapMemBuffer(WebPIDecoder* const idec,
   return 1;
 }
 
+// Copies 'data' at the end of the headers gathered so far, in
+// MEM_MODE_SEGMENTS. The gathering starts with the data of the last segment
+// not decoded yet.
+static int GatherSegmentData(WebPIDecoder* const idec,
+                             const uint8_t* const data, size_t data_size) {
+  MemBuffer* const mem = &idec->mem_;
+  const int start = (mem->buf_ == NULL);
+  const uint8_t* const pending = start ? MemData(mem) : NULL;
+  const size_t pending_size = start ? MemDataSize(mem) : 0;
+  const size_t size = start ? 0 : mem->end_ - mem->buf_offset_;
+  const uint64_t new_size = (uint64_t)size + pending_size + data_size;
+  assert(mem->mode_ == MEM_MODE_SEGMENTS);
+
+  if (start) mem->buf_offset_ = mem->start_;
+  if (new_size > mem->buf_size_) {
+    // Grow geometrically, so that the gathering stays linear.
+    uint64_t extra_size = 2 * (uint64_t)mem->buf_size_;
+    uint8_t* new_buf;
+    if (extra_size < new_size) {
+      extra_size = (new_size + CHUNK_SIZE - 1) & ~(CHUNK_SIZE - 1);
+    }
+    new_buf = (uint8_t*)WebPSafeMalloc(extra_size, sizeof(*new_buf));
+    if (new_buf == NULL) return 0;
+    if (size > 0) {
+      memcpy(new_buf, mem->buf_, size);
+      if (NeedCompressedAlpha(idec)) {
+        // The alpha data may have been found in the gathered headers.
+        VP8Decoder* const dec = (VP8Decoder*)idec->dec_;
+        if (dec->alpha_data_ >= mem->buf_ &&
+            dec->alpha_data_ < mem->buf_ + size) {
+          dec->alpha_data_ = new_buf + (dec->alpha_data_ - mem->buf_);
+        }
+      }
+    }
+    WebPSafeFree(mem->buf_);
+    mem->buf_ = new_buf;
+    mem->buf_size_ = (size_t)extra_size;
+  }
+  if (pending_size > 0) memcpy(mem->buf_ + size, pending, pending_size);
+  memcpy(mem->buf_ + size + pending_size, data, data_size);
+  return 1;
+}
+
+// Links the caller's 'data' at the end of the input, in MEM_MODE_SEGMENTS.
+// Only the headers are copied, and only if they straddle segments: the bit
+// readers take the pixel data from the segments directly.
+static int AppendSegment(WebPIDecoder* const idec,
+                         const uint8_t* const data, size_t data_size) {
+  MemBuffer* const mem = &idec->mem_;
+  VP8Segment* seg;
+  assert(mem->mode_ == MEM_MODE_SEGMENTS);
+  if (data_size == 0) return 1;
+
+  seg = (VP8Segment*)WebPSafeMalloc(1ULL, sizeof(*seg));
+  if (seg == NULL) return 0;
+  seg->data_ = data;
+  seg->size_ = data_size;
+  seg->offset_ = mem->end_;
+  seg->next_ = NULL;
+  if (idec->state_ <= STATE_VP8_PARTS0 &&
+      (mem->buf_ != NULL || MemDataSize(mem) > 0)) {
+    if (!GatherSegmentData(idec, data, data_size)) {
+      WebPSafeFree(seg);
+      return 0;
+    }
+  }
+  if (mem->last_segment_ != NULL) {
+    mem->last_segment_->next_ = seg;
+  } else {
+    mem->segments_ = seg;
+  }
+  mem->last_segment_ = seg;
+  mem->end_ += data_size;
+
+  if (idec->state_ <= STATE_VP8_PARTS0) {
+    idec->io_.data = MemData(mem);
+    idec->io_.data_size = MemDataSize(mem);
+  }
+  return 1;
+}
+
 static void InitMemBuffer(MemBuffer* const mem) {
   mem->mode_       = MEM_MODE_NONE;
   mem->buf_        = NULL;
   mem->buf_size_   = 0;
   mem->part0_buf_  = NULL;
   mem->part0_size_ = 0;
+  mem->segments_   = NULL;
+  mem->last_segment_ = NULL;
+  mem->buf_offset_ = 0;
 }
 
 static void ClearMemBuffer(MemBuffer* const mem) {
@@ -229,6 +337,13 @@ static void ClearMemBuffer(MemBuffer* const mem) {
   if (mem->mode_ == MEM_MODE_APPEND) {
     WebPSafeFree(mem->buf_);
     WebPSafeFree((void*)mem->part0_buf_);
+  } else if (mem->mode_ == MEM_MODE_SEGMENTS) {
+    WebPSafeFree(mem->buf_);
+    while (mem->segments_ != NULL) {
+      VP8Segment* const next = mem->segments_->next_;
+      WebPSafeFree(mem->segments_);
+      mem->segments_ = next;
+    }
   }
 }
 
@@ -295,14 +410,14 @@ static void ChangeState(WebPIDecoder* const idec, DecState new_state,
   idec->state_ = new_state;
   mem->start_ += consumed_bytes;
   assert(mem->start_ <= mem->end_);
-  idec->io_.data = mem->buf_ + mem->start_;
+  idec->io_.data = MemData(mem);
   idec->io_.data_size = MemDataSize(mem);
 }
 
 // Headers
 static VP8StatusCode DecodeWebPHeaders(WebPIDecoder* const idec) {
   MemBuffer* const mem = &idec->mem_;
-  const uint8_t* data = mem->buf_ + mem->start_;
+  const uint8_t* data = MemData(mem);
   size_t curr_size = MemDataSize(mem);
   VP8StatusCode status;
   WebPHeaderStructure headers;
@@ -340,7 +455,7 @@ static VP8StatusCode DecodeWebPHeaders(WebPIDecoder* const idec) {
 }
 
 static VP8StatusCode DecodeVP8FrameHeader(WebPIDecoder* const idec) {
-  const uint8_t* data = idec->mem_.buf_ + idec->mem_.start_;
+  const uint8_t* data = MemData(&idec->mem_);
   const size_t curr_size = MemDataSize(&idec->mem_);
   int width, height;
   uint32_t bits;
@@ -391,18 +506,34 @@ static VP8StatusCode CopyParts0Data(WebPIDecoder* const idec) {
   return VP8_STATUS_OK;
 }
 
+// Makes the last partition, set up on the contiguous headers, read on from
+// the segments.
+static void SetLastPartitionSegments(WebPIDecoder* const idec) {
+  VP8Decoder* const dec = (VP8Decoder*)idec->dec_;
+  const MemBuffer* const mem = &idec->mem_;
+  VP8BitReader* const br = &dec->parts_[dec->num_parts_minus_one_];
+  const size_t pos = mem->start_ + (br->buf_ - idec->io_.data);
+  assert(mem->mode_ == MEM_MODE_SEGMENTS);
+  VP8BitReaderSetSegments(br, mem->segments_, pos, ~(size_t)0);
+}
+
 static VP8StatusCode DecodePartition0(WebPIDecoder* const idec) {
   VP8Decoder* const dec = (VP8Decoder*)idec->dec_;
   VP8Io* const io = &idec->io_;
   const WebPDecParams* const params = &idec->params_;
   WebPDecBuffer* const output = params->output;
+  int ok;
+  WebPStageMark mark;
 
   // Wait till we have enough data for the whole partition #0
   if (MemDataSize(&idec->mem_) < idec->mem_.part0_size_) {
     return VP8_STATUS_SUSPENDED;
   }
 
-  if (!VP8GetHeaders(dec, io)) {
+  WebPStageBegin(&mark, WEBP_STAGE_HEADERS);
+  ok = VP8GetHeaders(dec, io);
+  WebPStageEnd(&mark);
+  if (!ok) {
     const VP8StatusCode status = dec->status_;
     if (status == VP8_STATUS_SUSPENDED ||
         status == VP8_STATUS_NOT_ENOUGH_DATA) {
@@ -411,6 +542,9 @@ static VP8StatusCode DecodePartition0(WebPIDecoder* const idec) {
     }
     return IDecError(idec, status);
   }
+  if (idec->mem_.mode_ == MEM_MODE_SEGMENTS) {
+    SetLastPartitionSegments(idec);
+  }
 
   // Allocate/Verify output buffer now
   dec->status_ = WebPAllocateDecBuffer(io->width, io->height, params->options,
@@ -453,8 +587,11 @@ static VP8StatusCode DecodeRemaining(WebPIDecoder* const idec) {
     return IDecError(idec, VP8_STATUS_BITSTREAM_ERROR);
   }
   for (; dec->mb_y_ < dec->mb_h_; ++dec->mb_y_) {
+    WebPStageMark mark;
+    WebPStageBegin(&mark, WEBP_STAGE_PARSE);
     if (idec->last_mb_y_ != dec->mb_y_) {
       if (!VP8ParseIntraModeRow(&dec->br_, dec)) {
+        WebPStageEnd(&mark);
         // note: normally, error shouldn't occur since we already have the whole
         // partition0 available here in DecodeRemaining(). Reaching EOF while
         // reading intra modes really means a BITSTREAM_ERROR.
@@ -468,6 +605,7 @@ static VP8StatusCode DecodeRemaining(WebPIDecoder* const idec) {
       MBContext context;
       SaveContext(dec, token_br, &context);
       if (!VP8DecodeMB(dec, token_br)) {
+        WebPStageEnd(&mark);
         // We shouldn't fail when MAX_MB data was available
         if (dec->num_parts_minus_one_ == 0 &&
             MemDataSize(&idec->mem_) > MAX_MB_SIZE) {
@@ -484,15 +622,22 @@ static VP8StatusCode DecodeRemaining(WebPIDecoder* const idec) {
       }
       // Release buffer only if there is only one partition
       if (dec->num_parts_minus_one_ == 0) {
-        idec->mem_.start_ = token_br->buf_ - idec->mem_.buf_;
+        if (idec->mem_.mode_ == MEM_MODE_SEGMENTS) {
+          idec->mem_.start_ = token_br->seg_->offset_ +
+                              (token_br->buf_ - token_br->seg_->data_);
+        } else {
+          idec->mem_.start_ = token_br->buf_ - idec->mem_.buf_;
+        }
         assert(idec->mem_.start_ <= idec->mem_.end_);
       }
     }
+    WebPStageEnd(&mark);
     VP8InitScanline(dec);   // Prepare for next scanline
 
     // Reconstruct, filter and emit the row.
     if (!VP8ProcessRow(dec, io)) {
-      return IDecError(idec, VP8_STATUS_USER_ABORT);
+      return IDecError(idec, (dec->status_ == VP8_STATUS_OUT_OF_MEMORY) ?
+                                 dec->status_ : VP8_STATUS_USER_ABORT);
     }
   }
   // Synchronize the thread and check for errors.
@@ -518,6 +663,8 @@ static VP8StatusCode DecodeVP8LHeader(WebPIDecoder* const idec) {
   const WebPDecParams* const params = &idec->params_;
   WebPDecBuffer* const output = params->output;
   size_t curr_size = MemDataSize(&idec->mem_);
+  int ok;
+  WebPStageMark mark;
   assert(idec->is_lossless_);
 
   // Wait until there's enough data for decoding header.
@@ -526,7 +673,15 @@ static VP8StatusCode DecodeVP8LHeader(WebPIDecoder* const idec) {
     return ErrorStatusLossless(idec, dec->status_);
   }
 
-  if (!VP8LDecodeHeader(dec, io)) {
+  WebPStageBegin(&mark, WEBP_STAGE_HEADERS);
+  if (idec->mem_.mode_ == MEM_MODE_SEGMENTS) {
+    ok = VP8LDecodeHeaderSegments(dec, io, idec->mem_.segments_,
+                                  idec->mem_.start_);
+  } else {
+    ok = VP8LDecodeHeader(dec, io);
+  }
+  WebPStageEnd(&mark);
+  if (!ok) {
     if (dec->status_ == VP8_STATUS_BITSTREAM_ERROR &&
         curr_size < idec->chunk_size_) {
       dec->status_ = VP8_STATUS_SUSPENDED;
@@ -815,6 +970,27 @@ VP8StatusCode WebPIUpdate(WebPIDecoder* idec,
   return IDecode(idec);
 }
 
+VP8StatusCode WebPIAppendSegment(WebPIDecoder* idec,
+                                 const uint8_t* data, size_t data_size) {
+  VP8StatusCode status;
+  if (idec == NULL || data == NULL) {
+    return VP8_STATUS_INVALID_PARAM;
+  }
+  status = IDecCheckStatus(idec);
+  if (status != VP8_STATUS_SUSPENDED) {
+    return status;
+  }
+  // Check mixed calls with WebPIAppend() and WebPIUpdate().
+  if (!CheckMemBufferMode(&idec->mem_, MEM_MODE_SEGMENTS)) {
+    return VP8_STATUS_INVALID_PARAM;
+  }
+  // Link the data at the end of the input
+  if (!AppendSegment(idec, data, data_size)) {
+    return VP8_STATUS_OUT_OF_MEMORY;
+  }
+  return IDecode(idec);
+}
+
 //------------------------------------------------------------------------------
 
 static const WebPDecBuffer* GetOutputBuffer(const WebPIDecoder* const idec) {
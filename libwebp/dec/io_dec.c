@@ -316,7 +316,7 @@ static int InitYUVRescaler(const VP8Io* const io, WebPDecParams* const p) {
   }
   rescaler_size = num_rescalers * sizeof(*p->scaler_y) + WEBP_ALIGN_CST;
 
-  p->memory = WebPSafeMalloc(1ULL, tmp_size + rescaler_size);
+  p->memory = WebPArenaMalloc(p->arena, 1ULL, tmp_size + rescaler_size);
   if (p->memory == NULL) {
     return 0;   // memory error
   }
@@ -501,7 +501,7 @@ static int InitRGBRescaler(const VP8Io* const io, WebPDecParams* const p) {
   total_size = tmp_size1 * sizeof(*work) + tmp_size2 * sizeof(*tmp);
   rescaler_size = num_rescalers * sizeof(*p->scaler_y) + WEBP_ALIGN_CST;
 
-  p->memory = WebPSafeMalloc(1ULL, total_size + rescaler_size);
+  p->memory = WebPArenaMalloc(p->arena, 1ULL, total_size + rescaler_size);
   if (p->memory == NULL) {
     return 0;   // memory error
   }
@@ -567,6 +567,7 @@ static int CustomSetup(VP8Io* io) {
 #if !defined(WEBP_REDUCE_SIZE)
     const int ok = is_rgb ? InitRGBRescaler(io, p) : InitYUVRescaler(io, p);
     if (!ok) {
+      io->setup_out_of_memory = 1;
       return 0;    // memory error
     }
 #else
@@ -579,8 +580,10 @@ static int CustomSetup(VP8Io* io) {
       if (io->fancy_upsampling) {
 #ifdef FANCY_UPSAMPLING
         const int uv_width = (io->mb_w + 1) >> 1;
-        p->memory = WebPSafeMalloc(1ULL, (size_t)(io->mb_w + 2 * uv_width));
+        p->memory = WebPArenaMalloc(p->arena, 1ULL,
+                                    (size_t)(io->mb_w + 2 * uv_width));
         if (p->memory == NULL) {
+          io->setup_out_of_memory = 1;
           return 0;   // memory error.
         }
         p->tmp_y = (uint8_t*)p->memory;
@@ -615,15 +618,19 @@ static int CustomPut(const VP8Io* io) {
   const int mb_w = io->mb_w;
   const int mb_h = io->mb_h;
   int num_lines_out;
+  WebPStageMark mark;
   assert(!(io->mb_y & 1));
 
   if (mb_w <= 0 || mb_h <= 0) {
     return 0;
   }
+  WebPStageBegin(&mark, io->use_scaling ? WEBP_STAGE_RESCALE
+                                        : WEBP_STAGE_OUTPUT);
   num_lines_out = p->emit(io, p);
   if (p->emit_alpha != NULL) {
     p->emit_alpha(io, p, num_lines_out);
   }
+  WebPStageEnd(&mark);
   p->last_y += num_lines_out;
   return 1;
 }
@@ -632,7 +639,7 @@ static int CustomPut(const VP8Io* io) {
 
 static void CustomTeardown(const VP8Io* io) {
   WebPDecParams* const p = (WebPDecParams*)io->opaque;
-  WebPSafeFree(p->memory);
+  WebPArenaFree(p->arena, p->memory);
   p->memory = NULL;
 }
 
@@ -54,18 +54,38 @@ int VP8InitIoInternal(VP8Io* const io, int version) {
   return 1;
 }
 
+static void InitDecoder(VP8Decoder* const dec) {
+  int i;
+  SetOk(dec);
+  WebPGetWorkerInterface()->Init(&dec->worker_);
+  for (i = 0; i < MAX_NUM_PARTITIONS - 1; ++i) {
+    WebPGetWorkerInterface()->Init(&dec->parse_workers_[i]);
+  }
+  for (i = 0; i < MAX_WAVE_ROWS - 1; ++i) {
+    WebPGetWorkerInterface()->Init(&dec->wave_workers_[i]);
+  }
+  WebPGetWorkerInterface()->Init(&dec->alpha_worker_);
+  dec->ready_ = 0;
+  dec->num_parts_minus_one_ = 0;
+  InitGetCoeffs();
+}
+
 VP8Decoder* VP8New(void) {
   VP8Decoder* const dec = (VP8Decoder*)WebPSafeCalloc(1ULL, sizeof(*dec));
   if (dec != NULL) {
-    SetOk(dec);
-    WebPGetWorkerInterface()->Init(&dec->worker_);
-    dec->ready_ = 0;
-    dec->num_parts_minus_one_ = 0;
-    InitGetCoeffs();
+    InitDecoder(dec);
   }
   return dec;
 }
 
+void VP8Recycle(VP8Decoder* const dec) {
+  WebPArena* const arena = dec->arena_;
+  VP8Clear(dec);
+  memset(dec, 0, sizeof(*dec));
+  dec->arena_ = arena;
+  InitDecoder(dec);
+}
+
 VP8StatusCode VP8Status(VP8Decoder* const dec) {
   if (!dec) return VP8_STATUS_INVALID_PARAM;
   return dec->status_;
@@ -508,13 +528,13 @@ static WEBP_INLINE uint32_t NzCodeBits(uint32_t nz_coeffs, int nz, int dc_nz) {
 }
 
 static int ParseResiduals(VP8Decoder* const dec,
-                          VP8MB* const mb, VP8BitReader* const token_br) {
+                          VP8MB* const mb, VP8MB* const left_mb,
+                          VP8MBData* const block,
+                          VP8BitReader* const token_br) {
   const VP8BandProbas* (* const bands)[16 + 1] = dec->proba_.bands_ptr_;
   const VP8BandProbas* const * ac_proba;
-  VP8MBData* const block = dec->mb_data_ + dec->mb_x_;
   const VP8QuantMatrix* const q = &dec->dqm_[block->segment_];
   int16_t* dst = block->coeffs_;
-  VP8MB* const left_mb = dec->mb_info_ - 1;
   uint8_t tnz, lnz;
   uint32_t non_zero_y = 0;
   uint32_t non_zero_uv = 0;
@@ -601,14 +621,16 @@ static int ParseResiduals(VP8Decoder* const dec,
 //------------------------------------------------------------------------------
 // Main loop
 
-int VP8DecodeMB(VP8Decoder* const dec, VP8BitReader* const token_br) {
-  VP8MB* const left = dec->mb_info_ - 1;
-  VP8MB* const mb = dec->mb_info_ + dec->mb_x_;
-  VP8MBData* const block = dec->mb_data_ + dec->mb_x_;
+// Parses the residuals of one macroblock, given its top and left non-zero
+// contexts. Doesn't modify 'dec', so rows can be parsed concurrently.
+static int DecodeMB(VP8Decoder* const dec,
+                    VP8MB* const mb, VP8MB* const left,
+                    VP8MBData* const block, VP8FInfo* const finfo,
+                    VP8BitReader* const token_br) {
   int skip = dec->use_skip_proba_ ? block->skip_ : 0;
 
   if (!skip) {
-    skip = ParseResiduals(dec, mb, token_br);
+    skip = ParseResiduals(dec, mb, left, block, token_br);
   } else {
     left->nz_ = mb->nz_ = 0;
     if (!block->is_i4x4_) {
@@ -620,7 +642,6 @@ int VP8DecodeMB(VP8Decoder* const dec, VP8BitReader* const token_br) {
   }
 
   if (dec->filter_type_ > 0) {  // store filter info
-    VP8FInfo* const finfo = dec->f_info_ + dec->mb_x_;
     *finfo = dec->fstrengths_[block->segment_][block->is_i4x4_];
     finfo->f_inner_ |= !skip;
   }
@@ -628,6 +649,13 @@ int VP8DecodeMB(VP8Decoder* const dec, VP8BitReader* const token_br) {
   return !token_br->eof_;
 }
 
+int VP8DecodeMB(VP8Decoder* const dec, VP8BitReader* const token_br) {
+  VP8FInfo* const finfo =
+      (dec->filter_type_ > 0) ? dec->f_info_ + dec->mb_x_ : NULL;
+  return DecodeMB(dec, dec->mb_info_ + dec->mb_x_, dec->mb_info_ - 1,
+                  dec->mb_data_ + dec->mb_x_, finfo, token_br);
+}
+
 void VP8InitScanline(VP8Decoder* const dec) {
   VP8MB* const left = dec->mb_info_ - 1;
   left->nz_ = 0;
@@ -636,21 +664,140 @@ void VP8InitScanline(VP8Decoder* const dec) {
   dec->mb_x_ = 0;
 }
 
-static int ParseFrame(VP8Decoder* const dec, VP8Io* io) {
-  for (dec->mb_y_ = 0; dec->mb_y_ < dec->br_mb_y_; ++dec->mb_y_) {
-    // Parse bitstream for this row.
-    VP8BitReader* const token_br =
-        &dec->parts_[dec->mb_y_ & dec->num_parts_minus_one_];
-    if (!VP8ParseIntraModeRow(&dec->br_, dec)) {
-      return VP8SetError(dec, VP8_STATUS_NOT_ENOUGH_DATA,
-                         "Premature end-of-partition0 encountered.");
+// Parses one span of a row from its token partition (mt_method_ 3).
+static int ParseRowSpan(void* arg1, void* arg2) {
+  VP8Decoder* const dec = (VP8Decoder*)arg1;
+  const VP8ParseJob* const job = (const VP8ParseJob*)arg2;
+  VP8ParseRow* const row = job->row_;
+  VP8BitReader* const token_br =
+      &dec->parts_[row->mb_y_ & dec->num_parts_minus_one_];
+  int ok = 1;
+  int mb_x;
+  WebPStageMark mark;
+  WebPStageBegin(&mark, WEBP_STAGE_PARSE);
+  for (mb_x = job->mb_x_start_; ok && mb_x < job->mb_x_end_; ++mb_x) {
+    VP8FInfo* const finfo =
+        (dec->filter_type_ > 0) ? row->f_info_ + mb_x : NULL;
+    ok = DecodeMB(dec, dec->mb_info_ + mb_x, &row->left_,
+                  row->mb_data_ + mb_x, finfo, token_br);
+  }
+  WebPStageEnd(&mark);
+  return ok;
+}
+
+int VP8InitParseJobs(VP8Decoder* const dec) {
+  const WebPWorkerInterface* const winterface = WebPGetWorkerInterface();
+  const int num_jobs = dec->num_parse_jobs_;
+  int c;
+  for (c = 0; c < num_jobs; ++c) {
+    VP8ParseJob* const job = &dec->parse_jobs_[c];
+    job->mb_x_start_ = c * dec->mb_w_ / num_jobs;
+    job->mb_x_end_ = (c + 1) * dec->mb_w_ / num_jobs;
+    if (c < num_jobs - 1) {
+      WebPWorker* const worker = &dec->parse_workers_[c];
+      if (!winterface->Reset(worker)) return 0;
+      worker->hook = ParseRowSpan;
+      worker->data1 = dec;
+      worker->data2 = job;
     }
-    for (; dec->mb_x_ < dec->mb_w_; ++dec->mb_x_) {
-      if (!VP8DecodeMB(dec, token_br)) {
+  }
+  return 1;
+}
+
+// Parses the frame with num_parse_jobs_ rows in flight (mt_method_ 3).
+// Span 'c' of row 'y' needs span 'c' of row 'y - 1' (top non-zero contexts)
+// and span 'c - 1' of row 'y' (left context and partition position), so all
+// the spans with the same 'y + c' are parsed at once, one diagonal per step.
+// There are no more spans than token partitions, hence rows parsed at once
+// never share a partition. Every row is handed to VP8ProcessRow() as soon as
+// its last span is done, and reconstructed while the next diagonals parse.
+static int ParseFrameMT(VP8Decoder* const dec, VP8Io* io) {
+  const WebPWorkerInterface* const winterface = WebPGetWorkerInterface();
+  const int num_jobs = dec->num_parse_jobs_;
+  const int num_rows = num_jobs;   // rows in flight
+  const int num_steps = dec->br_mb_y_ + num_jobs - 1;
+  int step;
+  for (step = 0; step < num_steps; ++step) {
+    // rows with a span in this diagonal
+    const int first_y = (step >= num_jobs) ? step - num_jobs + 1 : 0;
+    const int last_y = (step < dec->br_mb_y_) ? step : dec->br_mb_y_ - 1;
+    int ok = 1;
+    int y;
+    if (step < dec->br_mb_y_) {   // start a new row from partition #0
+      VP8ParseRow* const row = &dec->parse_rows_[step % num_rows];
+      WebPStageMark mark;
+      row->mb_y_ = step;
+      row->left_.nz_ = row->left_.nz_dc_ = 0;
+      VP8UseRowSlot(dec, step);
+      row->mb_data_ = dec->mb_data_;
+      row->f_info_ = dec->f_info_;
+      VP8InitScanline(dec);
+      WebPStageBegin(&mark, WEBP_STAGE_PARSE);
+      ok = VP8ParseIntraModeRow(&dec->br_, dec);
+      WebPStageEnd(&mark);
+      if (!ok) {
         return VP8SetError(dec, VP8_STATUS_NOT_ENOUGH_DATA,
-                           "Premature end-of-file encountered.");
+                           "Premature end-of-partition0 encountered.");
       }
     }
+    // The span of the oldest row is the last one: parse it on this thread.
+    for (y = last_y; y >= first_y; --y) {
+      const int c = step - y;
+      dec->parse_jobs_[c].row_ = &dec->parse_rows_[y % num_rows];
+      if (y > first_y) {
+        winterface->Launch(&dec->parse_workers_[c]);
+      } else {
+        ok = ParseRowSpan(dec, &dec->parse_jobs_[c]);
+      }
+    }
+    for (y = last_y; y > first_y; --y) {
+      ok &= winterface->Sync(&dec->parse_workers_[step - y]);
+    }
+    if (!ok) {
+      return VP8SetError(dec, VP8_STATUS_NOT_ENOUGH_DATA,
+                         "Premature end-of-file encountered.");
+    }
+    if (step - first_y == num_jobs - 1) {   // row 'first_y' is complete
+      const VP8ParseRow* const row = &dec->parse_rows_[first_y % num_rows];
+      dec->mb_y_ = first_y;
+      dec->mb_data_ = row->mb_data_;
+      dec->f_info_ = row->f_info_;
+      if (!VP8ProcessRow(dec, io)) {
+        return VP8SetError(dec, VP8_STATUS_USER_ABORT, "Output aborted.");
+      }
+    }
+  }
+  return winterface->Sync(&dec->worker_);
+}
+
+// Parses the modes and tokens of row mb_y_. Returns false with the error set.
+static int ParseRow(VP8Decoder* const dec) {
+  VP8BitReader* const token_br =
+      &dec->parts_[dec->mb_y_ & dec->num_parts_minus_one_];
+  int ok;
+  WebPStageMark mark;
+  WebPStageBegin(&mark, WEBP_STAGE_PARSE);
+  ok = VP8ParseIntraModeRow(&dec->br_, dec);
+  if (!ok) {
+    VP8SetError(dec, VP8_STATUS_NOT_ENOUGH_DATA,
+                "Premature end-of-partition0 encountered.");
+  }
+  for (; ok && dec->mb_x_ < dec->mb_w_; ++dec->mb_x_) {
+    ok = VP8DecodeMB(dec, token_br);
+    if (!ok) {
+      VP8SetError(dec, VP8_STATUS_NOT_ENOUGH_DATA,
+                  "Premature end-of-file encountered.");
+    }
+  }
+  WebPStageEnd(&mark);
+  return ok;
+}
+
+static int ParseFrame(VP8Decoder* const dec, VP8Io* io) {
+  if (dec->mt_method_ == 3) return ParseFrameMT(dec, io);
+  for (dec->mb_y_ = 0; dec->mb_y_ < dec->br_mb_y_; ++dec->mb_y_) {
+    // Parse bitstream for this row.
+    if (!ParseRow(dec)) return 0;
     VP8InitScanline(dec);   // Prepare for next scanline
 
     // Reconstruct, filter and emit the row.
@@ -705,13 +852,48 @@ int VP8Decode(VP8Decoder* const dec, VP8Io* const io) {
   return ok;
 }
 
+static int DecodeReduced(VP8Decoder* const dec, VP8Io* const io,
+                         int shift, int preview) {
+  int ok;
+  if (dec == NULL) {
+    return 0;
+  }
+  assert(dec->ready_ && io != NULL);
+  assert(shift == 1 || shift == 2);
+  assert(io->width == (dec->pic_hdr_.width_ + (1 << shift) - 1) >> shift);
+  assert(io->height == (dec->pic_hdr_.height_ + (1 << shift) - 1) >> shift);
+  dec->scale_shift_ = shift;
+  dec->preview_ = preview;
+  ok = VP8Decode(dec, io);
+  dec->scale_shift_ = 0;
+  dec->preview_ = 0;
+  return ok;
+}
+
+int VP8DecodeScaled(VP8Decoder* const dec, VP8Io* const io, int shift) {
+  return DecodeReduced(dec, io, shift, 0);
+}
+
+int VP8DecodePreview(VP8Decoder* const dec, VP8Io* const io) {
+  return DecodeReduced(dec, io, 2, 1);
+}
+
 void VP8Clear(VP8Decoder* const dec) {
+  int i;
   if (dec == NULL) {
     return;
   }
   WebPGetWorkerInterface()->End(&dec->worker_);
+  for (i = 0; i < MAX_NUM_PARTITIONS - 1; ++i) {
+    WebPGetWorkerInterface()->End(&dec->parse_workers_[i]);
+  }
+  for (i = 0; i < MAX_WAVE_ROWS - 1; ++i) {
+    WebPGetWorkerInterface()->End(&dec->wave_workers_[i]);
+  }
+  WebPGetWorkerInterface()->End(&dec->alpha_worker_);
+  dec->alpha_ahead_ = 0;
   WebPDeallocateAlphaMemory(dec);
-  WebPSafeFree(dec->mem_);
+  WebPArenaFree(dec->arena_, dec->mem_);
   dec->mem_ = NULL;
   dec->mem_size_ = 0;
   memset(&dec->br_, 0, sizeof(dec->br_));
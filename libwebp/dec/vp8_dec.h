@@ -105,6 +105,10 @@ struct VP8Io {
   // start of the current row (That is: it is pre-offset by mb_y and takes
   // cropping into account).
   const uint8_t* a;
+
+  // Can be set by setup() when it fails for lack of memory, so that the
+  // decoder reports VP8_STATUS_OUT_OF_MEMORY rather than a user abort.
+  int setup_out_of_memory;
 };
 
 // Internal, version-checked, entry point
@@ -140,6 +144,20 @@ int VP8GetHeaders(VP8Decoder* const dec, VP8Io* const io);
 // Returns false in case of error.
 int VP8Decode(VP8Decoder* const dec, VP8Io* const io);
 
+// Decode the picture reduced by 1 << 'shift' in width and height, rounded up,
+// with 'shift' 1 or 2. Each square of 1 << 'shift' samples on a side is
+// averaged into one once filtered, before the output converts and rescales
+// it. 'io->width' and 'io->height' must be set to the reduced size after
+// VP8GetHeaders(), and the cropping set up by io->setup() applies to it.
+// Returns false in case of error.
+int VP8DecodeScaled(VP8Decoder* const dec, VP8Io* const io, int shift);
+
+// Decode a preview of the picture at a quarter of its width and height,
+// rounded up, without loop filtering. Each 4x4 square of samples is averaged
+// into one. 'io->width' and 'io->height' must be set to this size after
+// VP8GetHeaders(). Returns false in case of error.
+int VP8DecodePreview(VP8Decoder* const dec, VP8Io* const io);
+
 // Return current status of the decoder:
 VP8StatusCode VP8Status(VP8Decoder* const dec);
 
@@ -153,6 +171,10 @@ void VP8Clear(VP8Decoder* const dec);
 // Destroy the decoder object.
 void VP8Delete(VP8Decoder* const dec);
 
+// Clears 'dec' and returns it to the state of a new decoder object, for the
+// next picture.
+void VP8Recycle(VP8Decoder* const dec);
+
 //------------------------------------------------------------------------------
 // Miscellaneous VP8/VP8L bitstream probing functions.
 
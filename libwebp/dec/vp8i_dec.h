@@ -64,6 +64,9 @@ extern "C" {
 // minimal width under which lossy multi-threading is always disabled
 #define MIN_WIDTH_FOR_THREADS 512
 
+// maximal number of rows reconstructed and filtered at once in a wavefront
+#define MAX_WAVE_ROWS 16
+
 //------------------------------------------------------------------------------
 // Headers
 
@@ -171,6 +174,29 @@ typedef struct {
   VP8Io io_;            // copy of the VP8Io to pass to put()
 } VP8ThreadContext;
 
+// A macroblock row parsed from its token partition while other rows are
+// parsed from theirs (mt_method_ 3).
+typedef struct {
+  int mb_y_;            // macroblock position of the row
+  VP8MB left_;          // left non-zero context, carried from span to span
+  VP8MBData* mb_data_;  // parsed reconstruction data
+  VP8FInfo* f_info_;    // filter strengths (NULL if there is no filtering)
+} VP8ParseRow;
+
+// A span of macroblock columns of one row, parsed by one worker.
+typedef struct {
+  VP8ParseRow* row_;
+  int mb_x_start_, mb_x_end_;
+} VP8ParseJob;
+
+// A span of macroblock columns of one row, reconstructed and filtered by one
+// worker of the wavefront.
+typedef struct {
+  const VP8ThreadContext* ctx_;   // the row (mb_y_, id_, mb_data_, f_info_)
+  uint8_t* yuv_b_;                // the row's work block, carried along spans
+  int mb_x_start_, mb_x_end_;
+} VP8WaveJob;
+
 // Saved top samples, per macroblock. Fits into a cache-line.
 typedef struct {
   uint8_t y[16], u[8], v[8];
@@ -197,9 +223,39 @@ struct VP8Decoder {
   WebPWorker worker_;
   int mt_method_;      // multi-thread method: 0=off, 1=[parse+recon][filter]
                        // 2=[parse][recon+filter]
+                       // 3=[parse x num_parse_jobs_][recon+filter]
+                       // with 2 and 3, [recon+filter] runs as a wavefront
+                       // of num_wave_rows_ rows if that is above 1
   int cache_id_;       // current cache row
   int num_caches_;     // number of cached rows of 16 pixels (1, 2 or 3)
   VP8ThreadContext thread_ctx_;  // Thread context
+  int max_threads_;    // thread budget, from WebPDecoderOptions::use_threads
+
+  // Parallel token parsing (mt_method_ 3): rows in flight, at most one per
+  // token partition, each split into num_parse_jobs_ spans of columns.
+  int num_parse_jobs_;
+  VP8ParseRow parse_rows_[MAX_NUM_PARTITIONS];   // rows being parsed
+  VP8ParseJob parse_jobs_[MAX_NUM_PARTITIONS];
+  WebPWorker parse_workers_[MAX_NUM_PARTITIONS - 1];  // the last span runs
+                                                      // on the calling thread
+
+  // Parsed rows waiting for reconstruction, when more than two are in flight:
+  // row 'y' is parsed into slot 'y % num_row_slots_'.
+  int num_row_slots_;
+  VP8MBData* mb_data_slots_;
+  VP8FInfo* f_info_slots_;   // NULL if there is no filtering
+
+  // Wavefront reconstruction and filtering (num_wave_rows_ > 1): worker_
+  // takes bands of num_wave_rows_ rows, one per cache line, cut into
+  // num_wave_spans_ spans of columns, and runs span 'c' of row 'r' at step
+  // '2 * r + c' with the other spans of the step.
+  int num_wave_rows_;
+  int num_wave_spans_;
+  int wave_band_y_, wave_band_rows_;   // band handed to worker_
+  VP8ThreadContext wave_ctx_[2 * MAX_WAVE_ROWS];  // row 'y' in 'y % (2 * n)'
+  VP8WaveJob wave_jobs_[MAX_WAVE_ROWS];           // one per row of the band
+  WebPWorker wave_workers_[MAX_WAVE_ROWS - 1];    // the last row's span runs
+                                                  // on worker_ itself
 
   // dimension, in macroblock units.
   int mb_w_, mb_h_;
@@ -233,7 +289,8 @@ struct VP8Decoder {
 
   VP8MB* mb_info_;        // contextual macroblock info (mb_w_ + 1)
   VP8FInfo* f_info_;      // filter strength info
-  uint8_t* yuv_b_;        // main block for Y/U/V (size = YUV_SIZE)
+  uint8_t* yuv_b_;        // main block for Y/U/V (size = YUV_SIZE), one per
+                          // wavefront row if num_wave_rows_ > 1
 
   uint8_t* cache_y_;      // macroblock row for storing unfiltered samples
   uint8_t* cache_u_;
@@ -241,9 +298,23 @@ struct VP8Decoder {
   int cache_y_stride_;
   int cache_uv_stride_;
 
+  // Reduced output (VP8DecodeScaled(), VP8DecodePreview()): each batch of
+  // reconstructed and filtered rows is averaged over squares of
+  // 1 << scale_shift_ samples on a side before it is emitted. Filtered rows
+  // are then held back a whole macroblock row, so that batches start on a
+  // macroblock boundary. The reduced alpha is kept whole, as the output
+  // reads back the rows it has already been given.
+  int scale_shift_;       // 0 for full size, 1 or 2
+  int preview_;           // if true, loop filtering is skipped too
+  uint8_t* reduced_y_;
+  uint8_t* reduced_u_;
+  uint8_t* reduced_v_;
+  uint8_t* reduced_a_;    // NULL without alpha
+
   // main memory chunk for the above data. Persistent.
   void* mem_;
   size_t mem_size_;
+  WebPArena* arena_;      // if not NULL, mem_ comes from it
 
   // Per macroblock non-persistent infos.
   int mb_x_, mb_y_;       // current position, in macroblock units
@@ -262,6 +333,15 @@ struct VP8Decoder {
   uint8_t* alpha_plane_;      // output. Persistent, contains the whole data.
   const uint8_t* alpha_prev_line_;  // last decoded alpha row (or NULL)
   int alpha_dithering_;       // derived from decoding options (0=off, 100=full)
+
+  // Alpha decoded ahead of the rows being emitted, with threads: the rows
+  // below alpha_ready_row_ are done and alpha_worker_ may be decoding the
+  // ones up to alpha_next_row_.
+  WebPWorker alpha_worker_;
+  int alpha_ahead_;           // true if alpha_worker_ decodes the alpha plane
+  int alpha_ready_row_, alpha_next_row_;
+  VP8Io alpha_io_;            // the io of the frame, for alpha_worker_
+  VP8StatusCode alpha_status_;   // result of the last alpha decoding step
 };
 
 //------------------------------------------------------------------------------
@@ -300,15 +380,23 @@ void VP8InitDithering(const WebPDecoderOptions* const options,
                       VP8Decoder* const dec);
 // Process the last decoded row (filtering + output).
 int VP8ProcessRow(VP8Decoder* const dec, VP8Io* const io);
+// Point dec->mb_data_ and dec->f_info_ at the slot of row 'mb_y'.
+void VP8UseRowSlot(VP8Decoder* const dec, int mb_y);
 // To be called at the start of a new scanline, to initialize predictors.
 void VP8InitScanline(VP8Decoder* const dec);
 // Decode one macroblock. Returns false if there is not enough data.
 int VP8DecodeMB(VP8Decoder* const dec, VP8BitReader* const token_br);
+// Set up the column spans and workers of the parallel parse (mt_method_ 3).
+// Returns false if a worker can't be started.
+int VP8InitParseJobs(VP8Decoder* const dec);
 
 // in alpha.c
 const uint8_t* VP8DecompressAlphaRows(VP8Decoder* const dec,
                                       const VP8Io* const io,
                                       int row, int num_rows);
+// Start decoding the alpha plane on dec->alpha_worker_, ahead of the calls to
+// VP8DecompressAlphaRows(). Returns false if the worker can't be started.
+int VP8StartAlphaDecoding(VP8Decoder* const dec, const VP8Io* const io);
 
 //------------------------------------------------------------------------------
 
@@ -25,6 +25,7 @@
 #include "../utils/utils.h"
 
 #define NUM_ARGB_CACHE_ROWS          16
+#define PREVIEW_SIZE(n)              (((n) + 3) >> 2)
 
 static const int kCodeLengthLiterals = 16;
 static const int kCodeLengthRepeatCode = 16;
@@ -404,7 +405,8 @@ static int ReadHuffmanCodes(VP8LDecoder* const dec, int xsize, int ysize,
     if (num_htree_groups_max > 1000 || num_htree_groups_max > xsize * ysize) {
       // Create a mapping from the used indices to the minimal set of used
       // values [0, num_htree_groups)
-      mapping = (int*)WebPSafeMalloc(num_htree_groups_max, sizeof(*mapping));
+      mapping = (int*)WebPArenaMalloc(dec->arena_, num_htree_groups_max,
+                                      sizeof(*mapping));
       if (mapping == NULL) {
         dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
         goto Error;
@@ -418,8 +420,8 @@ static int ReadHuffmanCodes(VP8LDecoder* const dec, int xsize, int ysize,
         if (*mapped_group == -1) *mapped_group = num_htree_groups++;
         huffman_image[i] = *mapped_group;
       }
-      huffman_tables_bogus = (HuffmanCode*)WebPSafeMalloc(
-          table_size, sizeof(*huffman_tables_bogus));
+      huffman_tables_bogus = (HuffmanCode*)WebPArenaMalloc(
+          dec->arena_, table_size, sizeof(*huffman_tables_bogus));
       if (huffman_tables_bogus == NULL) {
         dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
         goto Error;
@@ -442,10 +444,12 @@ static int ReadHuffmanCodes(VP8LDecoder* const dec, int xsize, int ysize,
     }
   }
 
-  code_lengths = (int*)WebPSafeCalloc((uint64_t)max_alphabet_size,
-                                      sizeof(*code_lengths));
-  huffman_tables = (HuffmanCode*)WebPSafeMalloc(num_htree_groups * table_size,
-                                                sizeof(*huffman_tables));
+  // ReadHuffmanCode() clears the part of 'code_lengths' it uses.
+  code_lengths = (int*)WebPArenaMalloc(dec->arena_, max_alphabet_size,
+                                       sizeof(*code_lengths));
+  huffman_tables = (HuffmanCode*)WebPArenaMalloc(dec->arena_,
+                                                 num_htree_groups * table_size,
+                                                 sizeof(*huffman_tables));
   htree_groups = VP8LHtreeGroupsNew(num_htree_groups);
 
   if (htree_groups == NULL || code_lengths == NULL || huffman_tables == NULL) {
@@ -520,12 +524,12 @@ static int ReadHuffmanCodes(VP8LDecoder* const dec, int xsize, int ysize,
   hdr->huffman_tables_ = huffman_tables;
 
  Error:
-  WebPSafeFree(code_lengths);
-  WebPSafeFree(huffman_tables_bogus);
-  WebPSafeFree(mapping);
+  WebPArenaFree(dec->arena_, code_lengths);
+  WebPArenaFree(dec->arena_, huffman_tables_bogus);
+  WebPArenaFree(dec->arena_, mapping);
   if (!ok) {
-    WebPSafeFree(huffman_image);
-    WebPSafeFree(huffman_tables);
+    WebPArenaFree(dec->arena_, huffman_image);
+    WebPArenaFree(dec->arena_, huffman_tables);
     VP8LHtreeGroupsFree(htree_groups);
   }
   return ok;
@@ -537,9 +541,9 @@ static int ReadHuffmanCodes(VP8LDecoder* const dec, int xsize, int ysize,
 #if !defined(WEBP_REDUCE_SIZE)
 static int AllocateAndInitRescaler(VP8LDecoder* const dec, VP8Io* const io) {
   const int num_channels = 4;
-  const int in_width = io->mb_w;
+  const int in_width = dec->preview_ ? PREVIEW_SIZE(io->mb_w) : io->mb_w;
   const int out_width = io->scaled_width;
-  const int in_height = io->mb_h;
+  const int in_height = dec->preview_ ? PREVIEW_SIZE(io->mb_h) : io->mb_h;
   const int out_height = io->scaled_height;
   const uint64_t work_size = 2 * num_channels * (uint64_t)out_width;
   rescaler_t* work;        // Rescaler work area.
@@ -548,7 +552,8 @@ static int AllocateAndInitRescaler(VP8LDecoder* const dec, VP8Io* const io) {
   const uint64_t memory_size = sizeof(*dec->rescaler) +
                                work_size * sizeof(*work) +
                                scaled_data_size * sizeof(*scaled_data);
-  uint8_t* memory = (uint8_t*)WebPSafeMalloc(memory_size, sizeof(*memory));
+  uint8_t* memory =
+      (uint8_t*)WebPArenaMalloc(dec->arena_, memory_size, sizeof(*memory));
   if (memory == NULL) {
     dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
     return 0;
@@ -706,6 +711,39 @@ static int EmitRowsYUVA(const VP8LDecoder* const dec,
   return y_pos;
 }
 
+//------------------------------------------------------------------------------
+// Preview.
+
+// Averages the 'width' x 'height' BGRA samples at 'src' over 4x4 squares,
+// channel by channel, into dec->preview_argb_. Squares cut by the right and
+// bottom edges are only averaged over the samples they cover.
+static void AveragePreviewRows(const VP8LDecoder* const dec,
+                               const uint32_t* src, int src_stride,
+                               int width, int height) {
+  const int dst_width = PREVIEW_SIZE(width);
+  uint32_t* dst = dec->preview_argb_;
+  int x, y, i, j, c;
+  for (y = 0; y < height; y += 4) {
+    const int num_rows = (height - y < 4) ? height - y : 4;
+    for (x = 0; x < width; x += 4) {
+      const int num_cols = (width - x < 4) ? width - x : 4;
+      const uint32_t num = (uint32_t)(num_rows * num_cols);
+      uint32_t sum[4] = { 0, 0, 0, 0 };
+      uint32_t argb = 0;
+      for (j = 0; j < num_rows; ++j) {
+        const uint32_t* const s = src + j * src_stride + x;
+        for (i = 0; i < num_cols; ++i) {
+          for (c = 0; c < 4; ++c) sum[c] += (s[i] >> (8 * c)) & 0xff;
+        }
+      }
+      for (c = 0; c < 4; ++c) argb |= ((sum[c] + num / 2) / num) << (8 * c);
+      dst[x >> 2] = argb;
+    }
+    src += 4 * src_stride;
+    dst += dst_width;
+  }
+}
+
 //------------------------------------------------------------------------------
 // Cropping.
 
@@ -765,7 +803,9 @@ static void ApplyInverseTransforms(VP8LDecoder* const dec, int num_rows,
   const int end_row = start_row + num_rows;
   const uint32_t* rows_in = rows;
   uint32_t* const rows_out = dec->argb_cache_;
+  WebPStageMark mark;
 
+  WebPStageBegin(&mark, WEBP_STAGE_TRANSFORM);
   // Inverse transforms.
   while (n-- > 0) {
     VP8LTransform* const transform = &dec->transforms_[n];
@@ -776,6 +816,7 @@ static void ApplyInverseTransforms(VP8LDecoder* const dec, int num_rows,
     // No transform called, hence just copy.
     memcpy(rows_out, rows_in, cache_pixs * sizeof(*rows_out));
   }
+  WebPStageEnd(&mark);
 }
 
 // Processes (transforms, scales & color-converts) the rows decoded after the
@@ -791,31 +832,46 @@ static void ProcessRows(VP8LDecoder* const dec, int row) {
   if (num_rows > 0) {    // Emit output.
     VP8Io* const io = dec->io_;
     uint8_t* rows_data = (uint8_t*)dec->argb_cache_;
-    const int in_stride = io->width * sizeof(uint32_t);  // in unit of RGBA
+    int in_stride = io->width * sizeof(uint32_t);  // in unit of RGBA
 
     ApplyInverseTransforms(dec, num_rows, rows);
     if (!SetCropWindow(io, dec->last_row_, row, &rows_data, in_stride)) {
       // Nothing to output (this time).
     } else {
       const WebPDecBuffer* const output = dec->output_;
+      int width = io->mb_w;
+      int height = io->mb_h;
+      WebPStageMark mark;
+      WebPStageBegin(&mark, (io->use_scaling || dec->preview_) ?
+                                WEBP_STAGE_RESCALE : WEBP_STAGE_OUTPUT);
+      if (dec->preview_) {
+        assert(!(io->mb_y & 3));
+        AveragePreviewRows(dec, (const uint32_t*)rows_data, io->width,
+                           width, height);
+        width = PREVIEW_SIZE(width);
+        height = PREVIEW_SIZE(height);
+        rows_data = (uint8_t*)dec->preview_argb_;
+        in_stride = width * sizeof(uint32_t);
+      }
       if (WebPIsRGBMode(output->colorspace)) {  // convert to RGBA
         const WebPRGBABuffer* const buf = &output->u.RGBA;
         uint8_t* const rgba = buf->rgba + dec->last_out_row_ * buf->stride;
         const int num_rows_out =
 #if !defined(WEBP_REDUCE_SIZE)
          io->use_scaling ?
-            EmitRescaledRowsRGBA(dec, rows_data, in_stride, io->mb_h,
+            EmitRescaledRowsRGBA(dec, rows_data, in_stride, height,
                                  rgba, buf->stride) :
 #endif  // WEBP_REDUCE_SIZE
             EmitRows(output->colorspace, rows_data, in_stride,
-                     io->mb_w, io->mb_h, rgba, buf->stride);
+                     width, height, rgba, buf->stride);
         // Update 'last_out_row_'.
         dec->last_out_row_ += num_rows_out;
       } else {                              // convert to YUVA
         dec->last_out_row_ = io->use_scaling ?
-            EmitRescaledRowsYUVA(dec, rows_data, in_stride, io->mb_h) :
-            EmitRowsYUVA(dec, rows_data, in_stride, io->mb_w, io->mb_h);
+            EmitRescaledRowsYUVA(dec, rows_data, in_stride, height) :
+            EmitRowsYUVA(dec, rows_data, in_stride, width, height);
       }
+      WebPStageEnd(&mark);
       assert(dec->last_out_row_ <= output->height);
     }
   }
@@ -825,6 +881,22 @@ static void ProcessRows(VP8LDecoder* const dec, int row) {
   assert(dec->last_row_ <= dec->height_);
 }
 
+// Pipelined version of ProcessRows(): the previous row-block must be emitted
+// before handing this one over to the worker. 'pixels_' holds the whole
+// image, so the rows stay put while the next ones are decoded.
+static int ProcessRowsHook(void* arg1, void* arg2) {
+  VP8LDecoder* const dec = (VP8LDecoder*)arg1;
+  ProcessRows(dec, *(const int*)arg2);
+  return 1;
+}
+
+static void ProcessRowsMT(VP8LDecoder* const dec, int row) {
+  const WebPWorkerInterface* const winterface = WebPGetWorkerInterface();
+  winterface->Sync(&dec->worker_);
+  dec->worker_row_ = row;
+  winterface->Launch(&dec->worker_);
+}
+
 // Row-processing for the special case when alpha data contains only one
 // transform (color indexing), and trivial non-green literals.
 static int Is8bOptimizable(const VP8LMetadata* const hdr) {
@@ -847,12 +919,15 @@ static void AlphaApplyFilter(ALPHDecoder* const alph_dec,
   if (alph_dec->filter_ != WEBP_FILTER_NONE) {
     int y;
     const uint8_t* prev_line = alph_dec->prev_line_;
+    WebPStageMark mark;
     assert(WebPUnfilters[alph_dec->filter_] != NULL);
+    WebPStageBegin(&mark, WEBP_STAGE_ALPHA);
     for (y = first_row; y < last_row; ++y) {
       WebPUnfilters[alph_dec->filter_](prev_line, out, out, stride);
       prev_line = out;
       out += stride;
     }
+    WebPStageEnd(&mark);
     alph_dec->prev_line_ = prev_line;
   }
 }
@@ -874,10 +949,13 @@ static void ExtractPalettedAlphaRows(VP8LDecoder* const dec, int last_row) {
     const uint8_t* const in =
       (uint8_t*)dec->pixels_ + dec->width_ * first_row;
     VP8LTransform* const transform = &dec->transforms_[0];
+    WebPStageMark mark;
     assert(dec->next_transform_ == 1);
     assert(transform->type_ == COLOR_INDEXING_TRANSFORM);
+    WebPStageBegin(&mark, WEBP_STAGE_TRANSFORM);
     VP8LColorIndexInverseTransformAlpha(transform, first_row, last_row,
                                         in, out);
+    WebPStageEnd(&mark);
     AlphaApplyFilter(alph_dec, first_row, last_row, out, width);
   }
   dec->last_row_ = dec->last_out_row_ = last_row;
@@ -1260,19 +1338,21 @@ static int DecodeImageData(VP8LDecoder* const dec, uint32_t* const data,
 // -----------------------------------------------------------------------------
 // VP8LTransform
 
-static void ClearTransform(VP8LTransform* const transform) {
-  WebPSafeFree(transform->data_);
+static void ClearTransform(WebPArena* const arena,
+                           VP8LTransform* const transform) {
+  WebPArenaFree(arena, transform->data_);
   transform->data_ = NULL;
 }
 
 // For security reason, we need to remap the color map to span
 // the total possible bundled values, and not just the num_colors.
-static int ExpandColorMap(int num_colors, VP8LTransform* const transform) {
+static int ExpandColorMap(WebPArena* const arena, int num_colors,
+                          VP8LTransform* const transform) {
   int i;
   const int final_num_colors = 1 << (8 >> transform->bits_);
   uint32_t* const new_color_map =
-      (uint32_t*)WebPSafeMalloc((uint64_t)final_num_colors,
-                                sizeof(*new_color_map));
+      (uint32_t*)WebPArenaMalloc(arena, (uint64_t)final_num_colors,
+                                 sizeof(*new_color_map));
   if (new_color_map == NULL) {
     return 0;
   } else {
@@ -1286,7 +1366,7 @@ static int ExpandColorMap(int num_colors, VP8LTransform* const transform) {
     for (; i < 4 * final_num_colors; ++i) {
       new_data[i] = 0;  // black tail.
     }
-    WebPSafeFree(transform->data_);
+    WebPArenaFree(arena, transform->data_);
     transform->data_ = new_color_map;
   }
   return 1;
@@ -1332,7 +1412,7 @@ static int ReadTransform(int* const xsize, int const* ysize,
        *xsize = VP8LSubSampleSize(transform->xsize_, bits);
        transform->bits_ = bits;
        ok = DecodeImageStream(num_colors, 1, 0, dec, &transform->data_);
-       ok = ok && ExpandColorMap(num_colors, transform);
+       ok = ok && ExpandColorMap(dec->arena_, num_colors, transform);
       break;
     }
     case SUBTRACT_GREEN:
@@ -1353,11 +1433,11 @@ static void InitMetadata(VP8LMetadata* const hdr) {
   memset(hdr, 0, sizeof(*hdr));
 }
 
-static void ClearMetadata(VP8LMetadata* const hdr) {
+static void ClearMetadata(WebPArena* const arena, VP8LMetadata* const hdr) {
   assert(hdr != NULL);
 
-  WebPSafeFree(hdr->huffman_image_);
-  WebPSafeFree(hdr->huffman_tables_);
+  WebPArenaFree(arena, hdr->huffman_image_);
+  WebPArenaFree(arena, hdr->huffman_tables_);
   VP8LHtreeGroupsFree(hdr->htree_groups_);
   VP8LColorCacheClear(&hdr->color_cache_);
   VP8LColorCacheClear(&hdr->saved_color_cache_);
@@ -1367,31 +1447,38 @@ static void ClearMetadata(VP8LMetadata* const hdr) {
 // -----------------------------------------------------------------------------
 // VP8LDecoder
 
-VP8LDecoder* VP8LNew(void) {
-  VP8LDecoder* const dec = (VP8LDecoder*)WebPSafeCalloc(1ULL, sizeof(*dec));
-  if (dec == NULL) return NULL;
+static void InitDecoder(VP8LDecoder* const dec) {
   dec->status_ = VP8_STATUS_OK;
   dec->state_ = READ_DIM;
+  WebPGetWorkerInterface()->Init(&dec->worker_);
 
   VP8LDspInit();  // Init critical function pointers.
+}
 
+VP8LDecoder* VP8LNew(void) {
+  VP8LDecoder* const dec = (VP8LDecoder*)WebPSafeCalloc(1ULL, sizeof(*dec));
+  if (dec == NULL) return NULL;
+  InitDecoder(dec);
   return dec;
 }
 
 void VP8LClear(VP8LDecoder* const dec) {
   int i;
   if (dec == NULL) return;
-  ClearMetadata(&dec->hdr_);
+  WebPGetWorkerInterface()->End(&dec->worker_);   // before freeing its rows
+  dec->use_threads_ = 0;
+  ClearMetadata(dec->arena_, &dec->hdr_);
 
-  WebPSafeFree(dec->pixels_);
+  WebPArenaFree(dec->arena_, dec->pixels_);
   dec->pixels_ = NULL;
+  dec->preview_argb_ = NULL;
   for (i = 0; i < dec->next_transform_; ++i) {
-    ClearTransform(&dec->transforms_[i]);
+    ClearTransform(dec->arena_, &dec->transforms_[i]);
   }
   dec->next_transform_ = 0;
   dec->transforms_seen_ = 0;
 
-  WebPSafeFree(dec->rescaler_memory);
+  WebPArenaFree(dec->arena_, dec->rescaler_memory);
   dec->rescaler_memory = NULL;
 
   dec->output_ = NULL;   // leave no trace behind
@@ -1404,6 +1491,14 @@ void VP8LDelete(VP8LDecoder* const dec) {
   }
 }
 
+void VP8LRecycle(VP8LDecoder* const dec) {
+  WebPArena* const arena = dec->arena_;
+  VP8LClear(dec);
+  memset(dec, 0, sizeof(*dec));
+  dec->arena_ = arena;
+  InitDecoder(dec);
+}
+
 static void UpdateDecoder(VP8LDecoder* const dec, int width, int height) {
   VP8LMetadata* const hdr = &dec->hdr_;
   const int num_bits = hdr->huffman_subsample_bits_;
@@ -1425,6 +1520,7 @@ static int DecodeImageStream(int xsize, int ysize,
   VP8LMetadata* const hdr = &dec->hdr_;
   uint32_t* data = NULL;
   int color_cache_bits = 0;
+  WebPStageMark mark;
 
   // Read the transforms (may recurse).
   if (is_level0) {
@@ -1447,7 +1543,10 @@ static int DecodeImageStream(int xsize, int ysize,
   ok = ok && ReadHuffmanCodes(dec, transform_xsize, transform_ysize,
                               color_cache_bits, is_level0);
   if (!ok) {
-    dec->status_ = VP8_STATUS_BITSTREAM_ERROR;
+    // Keep an out-of-memory status set by ReadHuffmanCodes().
+    if (dec->status_ == VP8_STATUS_OK) {
+      dec->status_ = VP8_STATUS_BITSTREAM_ERROR;
+    }
     goto End;
   }
 
@@ -1471,7 +1570,7 @@ static int DecodeImageStream(int xsize, int ysize,
 
   {
     const uint64_t total_size = (uint64_t)transform_xsize * transform_ysize;
-    data = (uint32_t*)WebPSafeMalloc(total_size, sizeof(*data));
+    data = (uint32_t*)WebPArenaMalloc(dec->arena_, total_size, sizeof(*data));
     if (data == NULL) {
       dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
       ok = 0;
@@ -1480,14 +1579,16 @@ static int DecodeImageStream(int xsize, int ysize,
   }
 
   // Use the Huffman trees to decode the LZ77 encoded data.
+  WebPStageBegin(&mark, WEBP_STAGE_ENTROPY);
   ok = DecodeImageData(dec, data, transform_xsize, transform_ysize,
                        transform_ysize, NULL);
+  WebPStageEnd(&mark);
   ok = ok && !br->eos_;
 
  End:
   if (!ok) {
-    WebPSafeFree(data);
-    ClearMetadata(hdr);
+    WebPArenaFree(dec->arena_, data);
+    ClearMetadata(dec->arena_, hdr);
   } else {
     if (decoded_data != NULL) {
       *decoded_data = data;
@@ -1498,7 +1599,8 @@ static int DecodeImageStream(int xsize, int ysize,
       assert(is_level0);
     }
     dec->last_pixel_ = 0;  // Reset for future DECODE_DATA_FUNC() calls.
-    if (!is_level0) ClearMetadata(hdr);  // Clean up temporary data behind.
+    // Clean up temporary data behind.
+    if (!is_level0) ClearMetadata(dec->arena_, hdr);
   }
   return ok;
 }
@@ -1512,24 +1614,31 @@ static int AllocateInternalBuffers32b(VP8LDecoder* const dec, int final_width) {
   const uint64_t cache_top_pixels = (uint16_t)final_width;
   // Scratch buffer for temporary BGRA storage. Not needed for paletted alpha.
   const uint64_t cache_pixels = (uint64_t)final_width * NUM_ARGB_CACHE_ROWS;
+  // Averaged rows of a preview.
+  const uint64_t preview_pixels = dec->preview_ ?
+      (uint64_t)PREVIEW_SIZE(final_width) * (NUM_ARGB_CACHE_ROWS / 4) : 0ULL;
   const uint64_t total_num_pixels =
-      num_pixels + cache_top_pixels + cache_pixels;
+      num_pixels + cache_top_pixels + cache_pixels + preview_pixels;
 
   assert(dec->width_ <= final_width);
-  dec->pixels_ = (uint32_t*)WebPSafeMalloc(total_num_pixels, sizeof(uint32_t));
+  dec->pixels_ = (uint32_t*)WebPArenaMalloc(dec->arena_, total_num_pixels,
+                                            sizeof(uint32_t));
   if (dec->pixels_ == NULL) {
     dec->argb_cache_ = NULL;    // for sanity check
     dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
     return 0;
   }
   dec->argb_cache_ = dec->pixels_ + num_pixels + cache_top_pixels;
+  dec->preview_argb_ =
+      dec->preview_ ? dec->argb_cache_ + cache_pixels : NULL;
   return 1;
 }
 
 static int AllocateInternalBuffers8b(VP8LDecoder* const dec) {
   const uint64_t total_num_pixels = (uint64_t)dec->width_ * dec->height_;
   dec->argb_cache_ = NULL;    // for sanity check
-  dec->pixels_ = (uint32_t*)WebPSafeMalloc(total_num_pixels, sizeof(uint8_t));
+  dec->pixels_ = (uint32_t*)WebPArenaMalloc(dec->arena_, total_num_pixels,
+                                            sizeof(uint8_t));
   if (dec->pixels_ == NULL) {
     dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
     return 0;
@@ -1573,9 +1682,11 @@ int VP8LDecodeAlphaHeader(ALPHDecoder* const alph_dec,
   int ok = 0;
   VP8LDecoder* dec = VP8LNew();
 
-  if (dec == NULL) return 0;
-
   assert(alph_dec != NULL);
+  if (dec == NULL) {
+    alph_dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
+    return 0;
+  }
 
   dec->width_ = alph_dec->width_;
   dec->height_ = alph_dec->height_;
@@ -1612,12 +1723,15 @@ int VP8LDecodeAlphaHeader(ALPHDecoder* const alph_dec,
   return 1;
 
  Err:
+  alph_dec->status_ = dec->status_;
   VP8LDelete(dec);
   return 0;
 }
 
 int VP8LDecodeAlphaImageStream(ALPHDecoder* const alph_dec, int last_row) {
   VP8LDecoder* const dec = alph_dec->vp8l_dec_;
+  int ok;
+  WebPStageMark mark;
   assert(dec != NULL);
   assert(last_row <= dec->height_);
 
@@ -1628,27 +1742,22 @@ int VP8LDecodeAlphaImageStream(ALPHDecoder* const alph_dec, int last_row) {
   if (!alph_dec->use_8b_decode_) WebPInitAlphaProcessing();
 
   // Decode (with special row processing).
-  return alph_dec->use_8b_decode_ ?
+  WebPStageBegin(&mark, WEBP_STAGE_ENTROPY);
+  ok = alph_dec->use_8b_decode_ ?
       DecodeAlphaData(dec, (uint8_t*)dec->pixels_, dec->width_, dec->height_,
                       last_row) :
       DecodeImageData(dec, dec->pixels_, dec->width_, dec->height_,
                       last_row, ExtractAlphaRows);
+  WebPStageEnd(&mark);
+  return ok;
 }
 
 //------------------------------------------------------------------------------
 
-int VP8LDecodeHeader(VP8LDecoder* const dec, VP8Io* const io) {
+// Decodes the header from dec->br_, once initialized.
+static int DecodeHeader(VP8LDecoder* const dec, VP8Io* const io) {
   int width, height, has_alpha;
 
-  if (dec == NULL) return 0;
-  if (io == NULL) {
-    dec->status_ = VP8_STATUS_INVALID_PARAM;
-    return 0;
-  }
-
-  dec->io_ = io;
-  dec->status_ = VP8_STATUS_OK;
-  VP8LInitBitReader(&dec->br_, io->data, io->data_size);
   if (!ReadImageInfo(&dec->br_, &width, &height, &has_alpha)) {
     dec->status_ = VP8_STATUS_BITSTREAM_ERROR;
     goto Error;
@@ -1666,6 +1775,33 @@ int VP8LDecodeHeader(VP8LDecoder* const dec, VP8Io* const io) {
   return 0;
 }
 
+int VP8LDecodeHeader(VP8LDecoder* const dec, VP8Io* const io) {
+  if (dec == NULL) return 0;
+  if (io == NULL) {
+    dec->status_ = VP8_STATUS_INVALID_PARAM;
+    return 0;
+  }
+
+  dec->io_ = io;
+  dec->status_ = VP8_STATUS_OK;
+  VP8LInitBitReader(&dec->br_, io->data, io->data_size);
+  return DecodeHeader(dec, io);
+}
+
+int VP8LDecodeHeaderSegments(VP8LDecoder* const dec, VP8Io* const io,
+                             const VP8Segment* const seg, size_t pos) {
+  if (dec == NULL) return 0;
+  if (io == NULL || seg == NULL) {
+    dec->status_ = VP8_STATUS_INVALID_PARAM;
+    return 0;
+  }
+
+  dec->io_ = io;
+  dec->status_ = VP8_STATUS_OK;
+  VP8LInitBitReaderSegments(&dec->br_, seg, pos);
+  return DecodeHeader(dec, io);
+}
+
 int VP8LDecodeImage(VP8LDecoder* const dec) {
   VP8Io* io = NULL;
   WebPDecParams* params = NULL;
@@ -1691,6 +1827,7 @@ int VP8LDecodeImage(VP8LDecoder* const dec) {
       dec->status_ = VP8_STATUS_INVALID_PARAM;
       goto Err;
     }
+    assert(!dec->preview_ || (!(io->crop_left & 3) && !(io->crop_top & 3)));
 
     if (!AllocateInternalBuffers32b(dec, io->width)) goto Err;
 
@@ -1711,6 +1848,22 @@ int VP8LDecodeImage(VP8LDecoder* const dec) {
       WebPInitConvertARGBToYUV();
       if (dec->output_->u.YUVA.a != NULL) WebPInitAlphaProcessing();
     }
+#if defined(WEBP_USE_THREAD)
+    // Incremental decoding may stop anywhere, so it keeps rows in sync.
+    dec->use_threads_ = (params->options != NULL &&
+                         params->options->use_threads && !dec->incremental_ &&
+                         io->crop_bottom > NUM_ARGB_CACHE_ROWS);
+    if (dec->use_threads_) {
+      WebPWorker* const worker = &dec->worker_;
+      if (!WebPGetWorkerInterface()->Reset(worker)) {
+        dec->status_ = VP8_STATUS_OUT_OF_MEMORY;
+        goto Err;
+      }
+      worker->hook = ProcessRowsHook;
+      worker->data1 = dec;
+      worker->data2 = &dec->worker_row_;
+    }
+#endif
     if (dec->incremental_) {
       if (dec->hdr_.color_cache_size_ > 0 &&
           dec->hdr_.saved_color_cache_.colors_ == NULL) {
@@ -1725,10 +1878,17 @@ int VP8LDecodeImage(VP8LDecoder* const dec) {
   }
 
   // Decode.
-  if (!DecodeImageData(dec, dec->pixels_, dec->width_, dec->height_,
-                       io->crop_bottom, ProcessRows)) {
-    goto Err;
+  {
+    int ok;
+    WebPStageMark mark;
+    WebPStageBegin(&mark, WEBP_STAGE_ENTROPY);
+    ok = DecodeImageData(dec, dec->pixels_, dec->width_, dec->height_,
+                         io->crop_bottom,
+                         dec->use_threads_ ? ProcessRowsMT : ProcessRows);
+    WebPStageEnd(&mark);
+    if (!ok) goto Err;
   }
+  if (dec->use_threads_) WebPGetWorkerInterface()->Sync(&dec->worker_);
 
   params->last_y = dec->last_out_row_;
   return 1;
@@ -1739,4 +1899,13 @@ int VP8LDecodeImage(VP8LDecoder* const dec) {
   return 0;
 }
 
+int VP8LDecodePreview(VP8LDecoder* const dec) {
+  int ok;
+  if (dec == NULL) return 0;
+  dec->preview_ = 1;
+  ok = VP8LDecodeImage(dec);
+  dec->preview_ = 0;
+  return ok;
+}
+
 //------------------------------------------------------------------------------
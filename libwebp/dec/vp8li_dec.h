@@ -17,9 +17,11 @@
 
 #include <string.h>     // for memcpy()
 #include "../dec/webpi_dec.h"
+#include "../utils/arena_utils.h"
 #include "../utils/bit_reader_utils.h"
 #include "../utils/color_cache_utils.h"
 #include "../utils/huffman_utils.h"
+#include "../utils/thread_utils.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -88,6 +90,20 @@ struct VP8LDecoder {
 
   uint8_t         *rescaler_memory;  // Working memory for rescaling work.
   WebPRescaler    *rescaler;         // Common rescaler for all channels.
+
+  // Pipelined decoding: while rows are entropy-decoded into pixels_, worker_
+  // inverse-transforms and emits the previous row-block.
+  int              use_threads_;
+  WebPWorker       worker_;
+  int              worker_row_;      // row to process up to, for worker_
+
+  // Preview at a quarter of the size (VP8LDecodePreview()): each 4x4 square
+  // of the cropped rows is averaged into preview_argb_, which then goes
+  // through the rescaler and the output conversion in place of the rows.
+  int              preview_;
+  uint32_t        *preview_argb_;    // NUM_ARGB_CACHE_ROWS / 4 rows
+
+  WebPArena       *arena_;           // if not NULL, buffers come from it
 };
 
 //------------------------------------------------------------------------------
@@ -98,7 +114,7 @@ struct ALPHDecoder;  // Defined in dec/alphai.h.
 // in vp8l.c
 
 // Decodes image header for alpha data stored using lossless compression.
-// Returns false in case of error.
+// Returns false in case of error, leaving the reason in alph_dec->status_.
 int VP8LDecodeAlphaHeader(struct ALPHDecoder* const alph_dec,
                           const uint8_t* const data, size_t data_size);
 
@@ -115,10 +131,23 @@ VP8LDecoder* VP8LNew(void);
 // Decodes the image header. Returns false in case of error.
 int VP8LDecodeHeader(VP8LDecoder* const dec, VP8Io* const io);
 
+// Same as VP8LDecodeHeader(), for an image that starts at input position
+// 'pos' of the chain 'seg' is part of, instead of io->data. The image data is
+// then read from the chain as well.
+int VP8LDecodeHeaderSegments(VP8LDecoder* const dec, VP8Io* const io,
+                             const VP8Segment* const seg, size_t pos);
+
 // Decodes an image. It's required to decode the lossless header before calling
 // this function. Returns false in case of error, with updated dec->status_.
 int VP8LDecodeImage(VP8LDecoder* const dec);
 
+// Same as VP8LDecodeImage(), for a preview at a quarter of the width and
+// height of the crop area, rounded up. Each 4x4 square of straight BGRA
+// samples is averaged channel by channel, those cut by the right and bottom
+// edges over the samples they cover. The crop area must start on multiples
+// of 4, and the scaling applies to the preview.
+int VP8LDecodePreview(VP8LDecoder* const dec);
+
 // Resets the decoder in its initial state, reclaiming memory.
 // Preserves the dec->status_ value.
 void VP8LClear(VP8LDecoder* const dec);
@@ -126,6 +155,10 @@ void VP8LClear(VP8LDecoder* const dec);
 // Clears and deallocate a lossless decoder instance.
 void VP8LDelete(VP8LDecoder* const dec);
 
+// Clears 'dec' and returns it to the state of a new instance, for the next
+// image. Keeps dec->arena_.
+void VP8LRecycle(VP8LDecoder* const dec);
+
 //------------------------------------------------------------------------------
 
 #ifdef __cplusplus
@@ -415,11 +415,14 @@ VP8StatusCode WebPParseHeaders(WebPHeaderStructure* const headers) {
   // status is marked volatile as a workaround for a clang-3.8 (aarch64) bug
   volatile VP8StatusCode status;
   int has_animation = 0;
+  WebPStageMark mark;
   assert(headers != NULL);
   // fill out headers, ignore width/height/has_alpha.
+  WebPStageBegin(&mark, WEBP_STAGE_HEADERS);
   status = ParseHeadersInternal(headers->data, headers->data_size,
                                 NULL, NULL, NULL, &has_animation,
                                 NULL, headers);
+  WebPStageEnd(&mark);
   if (status == VP8_STATUS_OK || status == VP8_STATUS_NOT_ENOUGH_DATA) {
     // The WebPDemux API + libwebp can be used to decode individual
     // uncomposited frames or the WebPAnimDecoder can be used to fully
@@ -440,15 +443,125 @@ void WebPResetDecParams(WebPDecParams* const params) {
   }
 }
 
+//------------------------------------------------------------------------------
+// WebPDecoderContext
+
+struct WebPDecoderContext {
+  VP8Decoder* vp8_;     // lossy decoder, recycled after each use (or NULL)
+  VP8LDecoder* vp8l_;   // lossless decoder, same
+  WebPArena arena_;     // scratch buffers of the decoders and of the output
+  WebPAllocator* allocator_;   // serves the decodes, if not NULL
+};
+
+WebPDecoderContext* WebPNewDecoderContext(void) {
+  WebPDecoderContext* const context =
+      (WebPDecoderContext*)WebPSafeCalloc(1ULL, sizeof(*context));
+  if (context != NULL) {
+    WebPArenaInit(&context->arena_);
+  }
+  return context;
+}
+
+void WebPSetDecoderContextAllocator(WebPDecoderContext* context,
+                                    WebPAllocator* allocator) {
+  if (context != NULL) context->allocator_ = allocator;
+}
+
+void WebPDeleteDecoderContext(WebPDecoderContext* context) {
+  if (context != NULL) {
+    VP8Delete(context->vp8_);
+    VP8LDelete(context->vp8l_);
+    WebPArenaClear(&context->arena_);
+    WebPSafeFree(context);
+  }
+}
+
 //------------------------------------------------------------------------------
 // "Into" decoding variants
 
-// Main flow
-static VP8StatusCode DecodeInto(const uint8_t* const data, size_t data_size,
+// Sets 'full_options' for VP8LDecodePreview() to decode the preview 'options'
+// asks for from a lossless picture of 'width' x 'height': its crop area is
+// scaled up to the picture, and its scaling applies to the cropped preview.
+static VP8StatusCode GetLosslessPreviewOptions(
+    const WebPDecoderOptions* const options, int width, int height,
+    WebPDecoderOptions* const full_options) {
+  const int preview_width = (width + 3) >> 2;
+  const int preview_height = (height + 3) >> 2;
+  int x = 0, y = 0, w = preview_width, h = preview_height;
+  *full_options = *options;
+  full_options->use_preview = 0;
+  if (options->use_cropping) {
+    x = options->crop_left;
+    y = options->crop_top;
+    w = options->crop_width;
+    h = options->crop_height;
+    if (x < 0 || y < 0 || w <= 0 || h <= 0 ||
+        x + w > preview_width || y + h > preview_height) {
+      return VP8_STATUS_INVALID_PARAM;
+    }
+    full_options->crop_left = 4 * x;
+    full_options->crop_top = 4 * y;
+    full_options->crop_width =
+        (4 * w < width - 4 * x) ? 4 * w : width - 4 * x;
+    full_options->crop_height =
+        (4 * h < height - 4 * y) ? 4 * h : height - 4 * y;
+  }
+  if (options->use_scaling) {
+    if (!WebPRescalerGetScaledDimensions(w, h, &full_options->scaled_width,
+                                         &full_options->scaled_height)) {
+      return VP8_STATUS_INVALID_PARAM;
+    }
+    // The rescaler premultiplies its input, which would round off the
+    // colour of translucent samples for nothing.
+    full_options->use_scaling = (full_options->scaled_width != w ||
+                                 full_options->scaled_height != h);
+  }
+  return VP8_STATUS_OK;
+}
+
+// Returns the log2 of the factor, 0 to 2, that a lossy picture of 'width' x
+// 'height' can be reduced by before it is rescaled to the size 'options'
+// asks for. The chroma of the reduced picture, at half its size, must stay
+// at least as large as the output. The factor must divide both dimensions of
+// the chroma: the rescaler spreads its input evenly over the output, so a
+// square cut by the edge would be stretched to a whole one and shift
+// everything before it.
+// The crop area is given in samples of the picture, so a cropped decode is
+// not reduced.
+static int GetScaleShift(const WebPDecoderOptions* const options,
+                         int width, int height) {
+  int scaled_width, scaled_height, shift;
+  if (options == NULL || !options->use_scaling ||
+      !options->use_reduced_scaling || options->use_cropping) {
+    return 0;
+  }
+  scaled_width = options->scaled_width;
+  scaled_height = options->scaled_height;
+  if (!WebPRescalerGetScaledDimensions(width, height,
+                                       &scaled_width, &scaled_height)) {
+    return 0;
+  }
+  for (shift = 2; shift > 0; --shift) {
+    const int mask = (2 << shift) - 1;
+    if ((scaled_width << (shift + 1)) <= width &&
+        (scaled_height << (shift + 1)) <= height &&
+        !(width & mask) && !(height & mask)) {
+      break;
+    }
+  }
+  return shift;
+}
+
+// Main flow. 'context' can be NULL.
+static VP8StatusCode DecodeInto(WebPDecoderContext* const context,
+                                const uint8_t* const data, size_t data_size,
                                 WebPDecParams* const params) {
   VP8StatusCode status;
   VP8Io io;
   WebPHeaderStructure headers;
+  const WebPDecoderOptions* const options = params->options;
+  const int use_preview = (options != NULL) && options->use_preview;
+  WebPDecoderOptions local_options;
 
   headers.data = data;
   headers.data_size = data_size;
@@ -463,52 +576,128 @@ static VP8StatusCode DecodeInto(const uint8_t* const data, size_t data_size,
   io.data = headers.data + headers.offset;
   io.data_size = headers.data_size - headers.offset;
   WebPInitCustomIo(params, &io);  // Plug the I/O functions.
+  if (context != NULL) {
+    // Nothing from the previous decode is in use anymore.
+    WebPArenaReset(&context->arena_);
+    params->arena = &context->arena_;
+  }
 
   if (!headers.is_lossless) {
-    VP8Decoder* const dec = VP8New();
+    VP8Decoder* const dec =
+        (context != NULL && context->vp8_ != NULL) ? context->vp8_ : VP8New();
+    int ok;
+    WebPStageMark mark;
     if (dec == NULL) {
       return VP8_STATUS_OUT_OF_MEMORY;
     }
+    if (context != NULL) {
+      context->vp8_ = dec;
+      dec->arena_ = &context->arena_;
+    }
     dec->alpha_data_ = headers.alpha_data;
     dec->alpha_data_size_ = headers.alpha_data_size;
 
     // Decode bitstream header, update io->width/io->height.
-    if (!VP8GetHeaders(dec, &io)) {
+    WebPStageBegin(&mark, WEBP_STAGE_HEADERS);
+    ok = VP8GetHeaders(dec, &io);
+    WebPStageEnd(&mark);
+    if (!ok) {
       status = dec->status_;   // An error occurred. Grab error status.
     } else {
+      const int width = io.width;
+      const int height = io.height;
+      // Thumbnails may be averaged down while decoding, rather than being
+      // output at full size first.
+      const int shift =
+          use_preview ? 2 : GetScaleShift(options, width, height);
+      io.width = (width + (1 << shift) - 1) >> shift;
+      io.height = (height + (1 << shift) - 1) >> shift;
+      if (shift > 0 && !use_preview) {
+        // Keep the aspect ratio of the picture for a missing dimension.
+        local_options = *options;
+        WebPRescalerGetScaledDimensions(width, height,
+                                        &local_options.scaled_width,
+                                        &local_options.scaled_height);
+        params->options = &local_options;
+      }
       // Allocate/check output buffers.
       status = WebPAllocateDecBuffer(io.width, io.height, params->options,
                                      params->output);
       if (status == VP8_STATUS_OK) {  // Decode
         // This change must be done before calling VP8Decode()
         dec->mt_method_ = VP8GetThreadMethod(params->options, &headers,
-                                             io.width, io.height);
+                                             width, height);
+        dec->max_threads_ =
+            (params->options != NULL) ? params->options->use_threads : 0;
         VP8InitDithering(params->options, dec);
-        if (!VP8Decode(dec, &io)) {
+        if (use_preview) {
+          ok = VP8DecodePreview(dec, &io);
+        } else if (shift > 0) {
+          ok = VP8DecodeScaled(dec, &io, shift);
+        } else {
+          ok = VP8Decode(dec, &io);
+        }
+        if (!ok) {
           status = dec->status_;
         }
       }
     }
-    VP8Delete(dec);
+    if (context != NULL) {
+      VP8Recycle(dec);
+    } else {
+      VP8Delete(dec);
+    }
   } else {
-    VP8LDecoder* const dec = VP8LNew();
+    VP8LDecoder* const dec =
+        (context != NULL && context->vp8l_ != NULL) ? context->vp8l_
+                                                    : VP8LNew();
+    int ok;
+    WebPStageMark mark;
     if (dec == NULL) {
       return VP8_STATUS_OUT_OF_MEMORY;
     }
-    if (!VP8LDecodeHeader(dec, &io)) {
+    if (context != NULL) {
+      context->vp8l_ = dec;
+      dec->arena_ = &context->arena_;
+    }
+    WebPStageBegin(&mark, WEBP_STAGE_HEADERS);
+    ok = VP8LDecodeHeader(dec, &io);
+    WebPStageEnd(&mark);
+    if (!ok) {
       status = dec->status_;   // An error occurred. Grab error status.
     } else {
+      status = VP8_STATUS_OK;
+      if (use_preview) {
+        // Decode in full, averaging the squares before the output.
+        status = GetLosslessPreviewOptions(options, io.width, io.height,
+                                           &local_options);
+      }
       // Allocate/check output buffers.
-      status = WebPAllocateDecBuffer(io.width, io.height, params->options,
-                                     params->output);
+      if (status == VP8_STATUS_OK) {
+        status = WebPAllocateDecBuffer(
+            use_preview ? (io.width + 3) >> 2 : io.width,
+            use_preview ? (io.height + 3) >> 2 : io.height,
+            params->options, params->output);
+      }
       if (status == VP8_STATUS_OK) {  // Decode
-        if (!VP8LDecodeImage(dec)) {
+        if (use_preview) {
+          params->options = &local_options;
+          ok = VP8LDecodePreview(dec);
+        } else {
+          ok = VP8LDecodeImage(dec);
+        }
+        if (!ok) {
           status = dec->status_;
         }
       }
     }
-    VP8LDelete(dec);
+    if (context != NULL) {
+      VP8LRecycle(dec);
+    } else {
+      VP8LDelete(dec);
+    }
   }
+  params->options = options;
 
   if (status != VP8_STATUS_OK) {
     WebPFreeDecBuffer(params->output);
@@ -541,7 +730,7 @@ static uint8_t* DecodeIntoRGBABuffer(WEBP_CSP_MODE colorspace,
   buf.u.RGBA.stride = stride;
   buf.u.RGBA.size   = size;
   buf.is_external_memory = 1;
-  if (DecodeInto(data, data_size, &params) != VP8_STATUS_OK) {
+  if (DecodeInto(NULL, data, data_size, &params) != VP8_STATUS_OK) {
     return NULL;
   }
   return rgba;
@@ -593,7 +782,7 @@ uint8_t* WebPDecodeYUVInto(const uint8_t* data, size_t data_size,
   output.u.YUVA.v_stride = v_stride;
   output.u.YUVA.v_size   = v_size;
   output.is_external_memory = 1;
-  if (DecodeInto(data, data_size, &params) != VP8_STATUS_OK) {
+  if (DecodeInto(NULL, data, data_size, &params) != VP8_STATUS_OK) {
     return NULL;
   }
   return luma;
@@ -620,7 +809,7 @@ static uint8_t* Decode(WEBP_CSP_MODE mode, const uint8_t* const data,
   if (height != NULL) *height = output.height;
 
   // Decode
-  if (DecodeInto(data, data_size, &params) != VP8_STATUS_OK) {
+  if (DecodeInto(NULL, data, data_size, &params) != VP8_STATUS_OK) {
     return NULL;
   }
   if (keep_info != NULL) {    // keep track of the side-info
@@ -680,16 +869,21 @@ static void DefaultFeatures(WebPBitstreamFeatures* const features) {
 
 static VP8StatusCode GetFeatures(const uint8_t* const data, size_t data_size,
                                  WebPBitstreamFeatures* const features) {
+  VP8StatusCode status;
+  WebPStageMark mark;
   if (features == NULL || data == NULL) {
     return VP8_STATUS_INVALID_PARAM;
   }
   DefaultFeatures(features);
 
   // Only parse enough of the data to retrieve the features.
-  return ParseHeadersInternal(data, data_size,
-                              &features->width, &features->height,
-                              &features->has_alpha, &features->has_animation,
-                              &features->format, NULL);
+  WebPStageBegin(&mark, WEBP_STAGE_HEADERS);
+  status = ParseHeadersInternal(data, data_size,
+                                &features->width, &features->height,
+                                &features->has_alpha, &features->has_animation,
+                                &features->format, NULL);
+  WebPStageEnd(&mark);
+  return status;
 }
 
 //------------------------------------------------------------------------------
@@ -744,6 +938,12 @@ VP8StatusCode WebPGetFeaturesInternal(const uint8_t* data, size_t data_size,
 
 VP8StatusCode WebPDecode(const uint8_t* data, size_t data_size,
                          WebPDecoderConfig* config) {
+  return WebPDecodeWithContext(NULL, data, data_size, config);
+}
+
+static VP8StatusCode DecodeConfig(WebPDecoderContext* const context,
+                                  const uint8_t* const data, size_t data_size,
+                                  WebPDecoderConfig* const config) {
   WebPDecParams params;
   VP8StatusCode status;
 
@@ -770,18 +970,31 @@ VP8StatusCode WebPDecode(const uint8_t* data, size_t data_size,
     in_mem_buffer.width = config->input.width;
     in_mem_buffer.height = config->input.height;
     params.output = &in_mem_buffer;
-    status = DecodeInto(data, data_size, &params);
+    status = DecodeInto(context, data, data_size, &params);
     if (status == VP8_STATUS_OK) {  // do the slow-copy
       status = WebPCopyDecBufferPixels(&in_mem_buffer, &config->output);
     }
     WebPFreeDecBuffer(&in_mem_buffer);
   } else {
-    status = DecodeInto(data, data_size, &params);
+    status = DecodeInto(context, data, data_size, &params);
   }
 
   return status;
 }
 
+VP8StatusCode WebPDecodeWithContext(WebPDecoderContext* context,
+                                    const uint8_t* data, size_t data_size,
+                                    WebPDecoderConfig* config) {
+  WebPAllocator* const allocator =
+      (context != NULL) ? context->allocator_ : NULL;
+  WebPAllocator* previous = NULL;
+  VP8StatusCode status;
+  if (allocator != NULL) previous = WebPSetThreadAllocator(allocator);
+  status = DecodeConfig(context, data, data_size, config);
+  if (allocator != NULL) WebPSetThreadAllocator(previous);
+  return status;
+}
+
 //------------------------------------------------------------------------------
 // Cropping and rescaling.
 
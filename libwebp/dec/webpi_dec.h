@@ -18,6 +18,7 @@
 extern "C" {
 #endif
 
+#include "../utils/arena_utils.h"
 #include "../utils/rescaler_utils.h"
 #include "../dec/vp8_dec.h"
 
@@ -41,6 +42,7 @@ struct WebPDecParams {
 
   WebPRescaler* scaler_y, *scaler_u, *scaler_v, *scaler_a;  // rescalers
   void* memory;                  // overall scratch memory for the output work.
+  WebPArena* arena;              // if not NULL, 'memory' comes from it.
 
   OutputFunc emit;               // output RGB or YUV samples
   OutputAlphaFunc emit_alpha;    // output alpha channel
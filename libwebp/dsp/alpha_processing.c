@@ -407,6 +407,7 @@ int (*WebPHasAlpha32b)(const uint8_t* src, int length);
 extern void WebPInitAlphaProcessingMIPSdspR2(void);
 extern void WebPInitAlphaProcessingSSE2(void);
 extern void WebPInitAlphaProcessingSSE41(void);
+extern void WebPInitAlphaProcessingAVX2(void);
 extern void WebPInitAlphaProcessingNEON(void);
 
 WEBP_DSP_INIT_FUNC(WebPInitAlphaProcessing) {
@@ -438,6 +439,11 @@ WEBP_DSP_INIT_FUNC(WebPInitAlphaProcessing) {
       if (VP8GetCPUInfo(kSSE4_1)) {
         WebPInitAlphaProcessingSSE41();
       }
+#endif
+#if defined(WEBP_USE_AVX2)
+      if (VP8GetCPUInfo(kAVX2)) {
+        WebPInitAlphaProcessingAVX2();
+      }
 #endif
     }
 #endif
@@ -0,0 +1,218 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Utilities for processing transparent channel, AVX2 version.
+//
+// Same arithmetic as alpha_processing_sse2.c, twice as wide. The per-lane
+// unpack/pack pairs below restore the pixel order by themselves.
+
+#include "./dsp.h"
+
+#if defined(WEBP_USE_AVX2)
+#include <immintrin.h>
+
+//------------------------------------------------------------------------------
+
+static int DispatchAlpha_AVX2(const uint8_t* alpha, int alpha_stride,
+                              int width, int height,
+                              uint8_t* dst, int dst_stride) {
+  // alpha_and stores an 'and' operation of all the alpha[] values. The final
+  // value is not 0xff if any of the alpha[] is not equal to 0xff.
+  uint32_t alpha_and = 0xff;
+  int i, j;
+  const __m256i rgb_mask = _mm256_set1_epi32(0xffffff00u);  // to preserve RGB
+  const __m128i all_0xff = _mm_set_epi32(0, 0, ~0u, ~0u);
+  __m128i all_alphas = all_0xff;
+
+  // We must be able to access 3 extra bytes after the last written byte
+  // 'dst[4 * width - 4]', because we don't know if alpha is the first or the
+  // last byte of the quadruplet.
+  const int limit = (width - 1) & ~7;
+
+  for (j = 0; j < height; ++j) {
+    __m256i* out = (__m256i*)dst;
+    for (i = 0; i < limit; i += 8) {
+      // load 8 alpha bytes and spread them to the low byte of 32b words
+      const __m128i a0 = _mm_loadl_epi64((const __m128i*)&alpha[i]);
+      const __m256i a1 = _mm256_cvtepu8_epi32(a0);
+      // load 8 dst pixels (32 bytes), mask dst alpha values and combine
+      const __m256i b0 = _mm256_loadu_si256(out);
+      const __m256i b1 = _mm256_and_si256(b0, rgb_mask);
+      _mm256_storeu_si256(out, _mm256_or_si256(b1, a1));
+      // accumulate eight alpha 'and' in parallel
+      all_alphas = _mm_and_si128(all_alphas, a0);
+      ++out;
+    }
+    for (; i < width; ++i) {
+      const uint32_t alpha_value = alpha[i];
+      dst[4 * i] = alpha_value;
+      alpha_and &= alpha_value;
+    }
+    alpha += alpha_stride;
+    dst += dst_stride;
+  }
+  // Combine the eight alpha 'and' into a 8-bit mask.
+  alpha_and &= _mm_movemask_epi8(_mm_cmpeq_epi8(all_alphas, all_0xff));
+  return (alpha_and != 0xff);
+}
+
+//------------------------------------------------------------------------------
+// Non-dither premultiplied modes
+
+#define MULTIPLIER(a)   ((a) * 0x8081)
+#define PREMULTIPLY(x, m) (((x) * (m)) >> 23)
+
+// See APPLY_ALPHA in alpha_processing_sse2.c: v / 255 = (v * 0x8081) >> 23.
+#define APPLY_ALPHA(RGBX, SHUFFLE) do {                                    \
+  const __m256i argb0 = _mm256_loadu_si256((const __m256i*)&(RGBX));      \
+  const __m256i argb1_lo = _mm256_unpacklo_epi8(argb0, zero);              \
+  const __m256i argb1_hi = _mm256_unpackhi_epi8(argb0, zero);              \
+  const __m256i alpha0_lo = _mm256_or_si256(argb1_lo, kMask);              \
+  const __m256i alpha0_hi = _mm256_or_si256(argb1_hi, kMask);              \
+  const __m256i alpha1_lo = _mm256_shufflelo_epi16(alpha0_lo, SHUFFLE);    \
+  const __m256i alpha1_hi = _mm256_shufflelo_epi16(alpha0_hi, SHUFFLE);    \
+  const __m256i alpha2_lo = _mm256_shufflehi_epi16(alpha1_lo, SHUFFLE);    \
+  const __m256i alpha2_hi = _mm256_shufflehi_epi16(alpha1_hi, SHUFFLE);    \
+  /* alpha2 = [ff a0 a0 a0][ff a1 a1 a1] */                                \
+  const __m256i A0_lo = _mm256_mullo_epi16(alpha2_lo, argb1_lo);           \
+  const __m256i A0_hi = _mm256_mullo_epi16(alpha2_hi, argb1_hi);           \
+  const __m256i A1_lo = _mm256_mulhi_epu16(A0_lo, kMult);                  \
+  const __m256i A1_hi = _mm256_mulhi_epu16(A0_hi, kMult);                  \
+  const __m256i A2_lo = _mm256_srli_epi16(A1_lo, 7);                       \
+  const __m256i A2_hi = _mm256_srli_epi16(A1_hi, 7);                       \
+  const __m256i A3 = _mm256_packus_epi16(A2_lo, A2_hi);                    \
+  _mm256_storeu_si256((__m256i*)&(RGBX), A3);                              \
+} while (0)
+
+static void ApplyAlphaMultiply_AVX2(uint8_t* rgba, int alpha_first,
+                                    int w, int h, int stride) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i kMult = _mm256_set1_epi16(0x8081u);
+  const __m256i kMask = _mm256_set_epi16(0, 0xff, 0xff, 0, 0, 0xff, 0xff, 0,
+                                         0, 0xff, 0xff, 0, 0, 0xff, 0xff, 0);
+  const int kSpan = 8;
+  while (h-- > 0) {
+    uint32_t* const rgbx = (uint32_t*)rgba;
+    int i;
+    if (!alpha_first) {
+      for (i = 0; i + kSpan <= w; i += kSpan) {
+        APPLY_ALPHA(rgbx[i], _MM_SHUFFLE(2, 3, 3, 3));
+      }
+    } else {
+      for (i = 0; i + kSpan <= w; i += kSpan) {
+        APPLY_ALPHA(rgbx[i], _MM_SHUFFLE(0, 0, 0, 1));
+      }
+    }
+    // Finish with left-overs.
+    for (; i < w; ++i) {
+      uint8_t* const rgb = rgba + (alpha_first ? 1 : 0);
+      const uint8_t* const alpha = rgba + (alpha_first ? 0 : 3);
+      const uint32_t a = alpha[4 * i];
+      if (a != 0xff) {
+        const uint32_t mult = MULTIPLIER(a);
+        rgb[4 * i + 0] = PREMULTIPLY(rgb[4 * i + 0], mult);
+        rgb[4 * i + 1] = PREMULTIPLY(rgb[4 * i + 1], mult);
+        rgb[4 * i + 2] = PREMULTIPLY(rgb[4 * i + 2], mult);
+      }
+    }
+    rgba += stride;
+  }
+}
+#undef APPLY_ALPHA
+#undef MULTIPLIER
+#undef PREMULTIPLY
+
+// -----------------------------------------------------------------------------
+// Apply alpha value to rows
+
+static void MultARGBRow_AVX2(uint32_t* const ptr, int width, int inverse) {
+  int x = 0;
+  if (!inverse) {
+    const int kSpan = 8;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i k128 = _mm256_set1_epi16(128);
+    const __m256i kMult = _mm256_set1_epi16(0x0101);
+    const __m256i kMask = _mm256_set_epi16(0, 0xff, 0, 0, 0, 0xff, 0, 0,
+                                           0, 0xff, 0, 0, 0, 0xff, 0, 0);
+    for (x = 0; x + kSpan <= width; x += kSpan) {
+      // To compute 'result = (int)(a * x / 255. + .5)', we use:
+      //   tmp = a * v + 128, result = (tmp * 0x0101u) >> 16
+      const __m256i A0 = _mm256_loadu_si256((const __m256i*)&ptr[x]);
+      const __m256i A1_lo = _mm256_unpacklo_epi8(A0, zero);
+      const __m256i A1_hi = _mm256_unpackhi_epi8(A0, zero);
+      const __m256i A2_lo = _mm256_or_si256(A1_lo, kMask);
+      const __m256i A2_hi = _mm256_or_si256(A1_hi, kMask);
+      const __m256i A3_lo =
+          _mm256_shufflelo_epi16(A2_lo, _MM_SHUFFLE(2, 3, 3, 3));
+      const __m256i A3_hi =
+          _mm256_shufflelo_epi16(A2_hi, _MM_SHUFFLE(2, 3, 3, 3));
+      const __m256i A4_lo =
+          _mm256_shufflehi_epi16(A3_lo, _MM_SHUFFLE(2, 3, 3, 3));
+      const __m256i A4_hi =
+          _mm256_shufflehi_epi16(A3_hi, _MM_SHUFFLE(2, 3, 3, 3));
+      // here, A4 = [ff a0 a0 a0][ff a1 a1 a1]
+      const __m256i A5_lo = _mm256_mullo_epi16(A4_lo, A1_lo);
+      const __m256i A5_hi = _mm256_mullo_epi16(A4_hi, A1_hi);
+      const __m256i A6_lo = _mm256_add_epi16(A5_lo, k128);
+      const __m256i A6_hi = _mm256_add_epi16(A5_hi, k128);
+      const __m256i A7_lo = _mm256_mulhi_epu16(A6_lo, kMult);
+      const __m256i A7_hi = _mm256_mulhi_epu16(A6_hi, kMult);
+      const __m256i A8 = _mm256_packus_epi16(A7_lo, A7_hi);
+      _mm256_storeu_si256((__m256i*)&ptr[x], A8);
+    }
+  }
+  width -= x;
+  if (width > 0) WebPMultARGBRow_C(ptr + x, width, inverse);
+}
+
+static void MultRow_AVX2(uint8_t* const ptr, const uint8_t* const alpha,
+                         int width, int inverse) {
+  int x = 0;
+  if (!inverse) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i k128 = _mm256_set1_epi16(128);
+    const __m256i kMult = _mm256_set1_epi16(0x0101);
+    for (x = 0; x + 32 <= width; x += 32) {
+      const __m256i v0 = _mm256_loadu_si256((__m256i*)&ptr[x]);
+      const __m256i a0 = _mm256_loadu_si256((const __m256i*)&alpha[x]);
+      const __m256i v1_lo = _mm256_unpacklo_epi8(v0, zero);
+      const __m256i v1_hi = _mm256_unpackhi_epi8(v0, zero);
+      const __m256i a1_lo = _mm256_unpacklo_epi8(a0, zero);
+      const __m256i a1_hi = _mm256_unpackhi_epi8(a0, zero);
+      const __m256i v2_lo = _mm256_mullo_epi16(v1_lo, a1_lo);
+      const __m256i v2_hi = _mm256_mullo_epi16(v1_hi, a1_hi);
+      const __m256i v3_lo = _mm256_add_epi16(v2_lo, k128);
+      const __m256i v3_hi = _mm256_add_epi16(v2_hi, k128);
+      const __m256i v4_lo = _mm256_mulhi_epu16(v3_lo, kMult);
+      const __m256i v4_hi = _mm256_mulhi_epu16(v3_hi, kMult);
+      const __m256i v5 = _mm256_packus_epi16(v4_lo, v4_hi);
+      _mm256_storeu_si256((__m256i*)&ptr[x], v5);
+    }
+  }
+  width -= x;
+  if (width > 0) WebPMultRow_C(ptr + x, alpha + x, width, inverse);
+}
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern void WebPInitAlphaProcessingAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void WebPInitAlphaProcessingAVX2(void) {
+  WebPMultARGBRow = MultARGBRow_AVX2;
+  WebPMultRow = MultRow_AVX2;
+  WebPApplyAlphaMultiply = ApplyAlphaMultiply_AVX2;
+  WebPDispatchAlpha = DispatchAlpha_AVX2;
+}
+
+#else  // !WEBP_USE_AVX2
+
+WEBP_DSP_INIT_STUB(WebPInitAlphaProcessingAVX2)
+
+#endif  // WEBP_USE_AVX2
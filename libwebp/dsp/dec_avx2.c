@@ -0,0 +1,446 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// AVX2 version of some decoding functions (idct, loop filtering).
+//
+// The loop filters widen pixels to 16 bits, one per lane, so that a whole
+// 16-pixel macroblock edge (or the u and v edges side by side) goes through
+// each instruction and the arithmetic follows the plain-C code directly. This
+// pays off on vertical edges, whose 16 rows are transposed as two 8x8 halves
+// in the two 128-bit lanes at once, and on the chroma edges; the 8-bit SSE2
+// code stays faster on the horizontal luma edges.
+
+#include "./dsp.h"
+
+#if defined(WEBP_USE_AVX2)
+
+#include <immintrin.h>
+#include "../dec/vp8i_dec.h"
+#include "../utils/utils.h"
+
+//------------------------------------------------------------------------------
+// Transforms (Paragraph 14.4)
+
+// Same as VP8Transpose_2_4x4_16b(), for the two pairs of blocks at once.
+static WEBP_INLINE void Transpose_4_4x4_16b_AVX2(__m256i* const x) {
+  const __m256i transpose0_0 = _mm256_unpacklo_epi16(x[0], x[1]);
+  const __m256i transpose0_1 = _mm256_unpacklo_epi16(x[2], x[3]);
+  const __m256i transpose0_2 = _mm256_unpackhi_epi16(x[0], x[1]);
+  const __m256i transpose0_3 = _mm256_unpackhi_epi16(x[2], x[3]);
+  const __m256i transpose1_0 = _mm256_unpacklo_epi32(transpose0_0,
+                                                     transpose0_1);
+  const __m256i transpose1_1 = _mm256_unpacklo_epi32(transpose0_2,
+                                                     transpose0_3);
+  const __m256i transpose1_2 = _mm256_unpackhi_epi32(transpose0_0,
+                                                     transpose0_1);
+  const __m256i transpose1_3 = _mm256_unpackhi_epi32(transpose0_2,
+                                                     transpose0_3);
+  x[0] = _mm256_unpacklo_epi64(transpose1_0, transpose1_1);
+  x[1] = _mm256_unpackhi_epi64(transpose1_0, transpose1_1);
+  x[2] = _mm256_unpacklo_epi64(transpose1_2, transpose1_3);
+  x[3] = _mm256_unpackhi_epi64(transpose1_2, transpose1_3);
+}
+
+// One pass of the transform on the four rows (or columns) in 'x'. See
+// Transform_SSE2() for the 16-bit fixed point multiplication trick.
+static WEBP_INLINE void TransformPass_AVX2(__m256i* const x,
+                                          const __m256i* const dc_bias) {
+  const __m256i k1 = _mm256_set1_epi16(20091);
+  const __m256i k2 = _mm256_set1_epi16(-30068);
+  const __m256i dc = _mm256_add_epi16(x[0], *dc_bias);
+  const __m256i a = _mm256_add_epi16(dc, x[2]);
+  const __m256i b = _mm256_sub_epi16(dc, x[2]);
+  // c = MUL(x1, K2) - MUL(x3, K1) = MUL(x1, k2) - MUL(x3, k1) + x1 - x3
+  const __m256i c1 = _mm256_mulhi_epi16(x[1], k2);
+  const __m256i c2 = _mm256_mulhi_epi16(x[3], k1);
+  const __m256i c3 = _mm256_sub_epi16(x[1], x[3]);
+  const __m256i c4 = _mm256_sub_epi16(c1, c2);
+  const __m256i c = _mm256_add_epi16(c3, c4);
+  // d = MUL(x1, K1) + MUL(x3, K2) = MUL(x1, k1) + MUL(x3, k2) + x1 + x3
+  const __m256i d1 = _mm256_mulhi_epi16(x[1], k1);
+  const __m256i d2 = _mm256_mulhi_epi16(x[3], k2);
+  const __m256i d3 = _mm256_add_epi16(x[1], x[3]);
+  const __m256i d4 = _mm256_add_epi16(d1, d2);
+  const __m256i d = _mm256_add_epi16(d3, d4);
+  x[0] = _mm256_add_epi16(a, d);
+  x[1] = _mm256_add_epi16(b, c);
+  x[2] = _mm256_sub_epi16(b, c);
+  x[3] = _mm256_sub_epi16(a, d);
+}
+
+// Row 'i' of blocks 0 and 1 in the low lane, of blocks 2 and 3 in the high one.
+static WEBP_INLINE __m256i LoadCoeffs_AVX2(const int16_t* const in) {
+  const __m128i top =
+      _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)&in[0 * 16]),
+                         _mm_loadl_epi64((const __m128i*)&in[1 * 16]));
+  const __m128i bottom =
+      _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)&in[2 * 16]),
+                         _mm_loadl_epi64((const __m128i*)&in[3 * 16]));
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(top), bottom, 1);
+}
+
+// The four 4x4 blocks of an 8x8 chroma plane in one go, where the SSE2
+// version handles two blocks per call.
+static void TransformUV_AVX2(const int16_t* in, uint8_t* dst) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i four = _mm256_set1_epi16(4);
+  __m256i x[4];
+  int i;
+  for (i = 0; i < 4; ++i) {
+    x[i] = LoadCoeffs_AVX2(in + 4 * i);
+  }
+
+  // Vertical pass and subsequent transpose.
+  TransformPass_AVX2(x, &zero);
+  Transpose_4_4x4_16b_AVX2(x);
+
+  // Horizontal pass and subsequent transpose.
+  TransformPass_AVX2(x, &four);
+  for (i = 0; i < 4; ++i) {
+    x[i] = _mm256_srai_epi16(x[i], 3);
+  }
+  Transpose_4_4x4_16b_AVX2(x);
+
+  // Add inverse transform to 'dst' and store, rows 'i' and 'i + 4' together.
+  for (i = 0; i < 4; ++i) {
+    uint8_t* const top = dst + i * BPS;
+    uint8_t* const bottom = top + 4 * BPS;
+    const __m256i ref = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadl_epi64((const __m128i*)top)),
+        _mm_loadl_epi64((const __m128i*)bottom), 1);
+    const __m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi8(ref, zero), x[i]);
+    const __m256i out = _mm256_packus_epi16(sum, sum);
+    _mm_storel_epi64((__m128i*)top, _mm256_castsi256_si128(out));
+    _mm_storel_epi64((__m128i*)bottom, _mm256_extracti128_si256(out, 1));
+  }
+}
+
+//------------------------------------------------------------------------------
+// Loop Filter (Paragraph 15)
+
+static WEBP_INLINE __m256i Abs_AVX2(const __m256i a, const __m256i b) {
+  return _mm256_abs_epi16(_mm256_sub_epi16(a, b));
+}
+
+static WEBP_INLINE __m256i Clamp_AVX2(const __m256i x, int lo, int hi) {
+  return _mm256_min_epi16(_mm256_max_epi16(x, _mm256_set1_epi16(lo)),
+                          _mm256_set1_epi16(hi));
+}
+
+// VP8kclip1. Filter outputs are left unclipped when they go straight to
+// memory, since storing packs them with unsigned saturation anyway.
+static WEBP_INLINE __m256i Clip8b_AVX2(const __m256i x) {
+  return Clamp_AVX2(x, 0, 255);
+}
+
+static WEBP_INLINE __m256i Mul3_AVX2(const __m256i x) {
+  return _mm256_add_epi16(x, _mm256_add_epi16(x, x));
+}
+
+// (a + bias) >> 3 clipped to [-16, 15], as VP8ksclip2 does.
+static WEBP_INLINE __m256i FilterStep_AVX2(const __m256i a, int bias) {
+  const __m256i biased = _mm256_add_epi16(a, _mm256_set1_epi16(bias));
+  return Clamp_AVX2(_mm256_srai_epi16(biased, 3), -16, 15);
+}
+
+// Lanes where 4 * |p0 - q0| + |p1 - q1| <= thresh2 (NeedsFilter_C).
+static WEBP_INLINE __m256i NeedsFilter_AVX2(const __m256i* const x,
+                                            int thresh2) {
+  const __m256i p1 = x[0], p0 = x[1], q0 = x[2], q1 = x[3];
+  const __m256i sum = _mm256_add_epi16(_mm256_slli_epi16(Abs_AVX2(p0, q0), 2),
+                                       Abs_AVX2(p1, q1));
+  return _mm256_cmpgt_epi16(_mm256_set1_epi16(thresh2 + 1), sum);
+}
+
+// Simple filter on one edge: x[0..3] hold p1, p0, q0 and q1.
+static WEBP_INLINE void SimpleFilter_AVX2(__m256i* const x, int thresh) {
+  const __m256i mask = NeedsFilter_AVX2(x, 2 * thresh + 1);
+  const __m256i p1 = x[0], p0 = x[1], q0 = x[2], q1 = x[3];
+  const __m256i a =
+      _mm256_add_epi16(Mul3_AVX2(_mm256_sub_epi16(q0, p0)),
+                       Clamp_AVX2(_mm256_sub_epi16(p1, q1), -128, 127));
+  const __m256i a1 = _mm256_and_si256(FilterStep_AVX2(a, 4), mask);
+  const __m256i a2 = _mm256_and_si256(FilterStep_AVX2(a, 3), mask);
+  x[1] = _mm256_add_epi16(p0, a2);
+  x[2] = _mm256_sub_epi16(q0, a1);
+}
+
+// Lanes that pass NeedsFilter2_C and, among all lanes, those where Hev() holds.
+// x[0..7] hold p3 to q3.
+static WEBP_INLINE void ComplexMask_AVX2(const __m256i* const x,
+                                         int thresh, int ithresh,
+                                         int hev_thresh, __m256i* const mask,
+                                         __m256i* const hev) {
+  const __m256i p1p0 = Abs_AVX2(x[2], x[3]);
+  const __m256i q1q0 = Abs_AVX2(x[5], x[4]);
+  __m256i max_diff = _mm256_max_epi16(Abs_AVX2(x[0], x[1]),
+                                      Abs_AVX2(x[1], x[2]));
+  max_diff = _mm256_max_epi16(max_diff, Abs_AVX2(x[7], x[6]));
+  max_diff = _mm256_max_epi16(max_diff, Abs_AVX2(x[6], x[5]));
+  max_diff = _mm256_max_epi16(max_diff, _mm256_max_epi16(p1p0, q1q0));
+  *mask = _mm256_and_si256(
+      _mm256_cmpgt_epi16(_mm256_set1_epi16(ithresh + 1), max_diff),
+      NeedsFilter_AVX2(x + 2, 2 * thresh + 1));
+  *hev = _mm256_cmpgt_epi16(_mm256_max_epi16(p1p0, q1q0),
+                            _mm256_set1_epi16(hev_thresh));
+}
+
+// FilterLoop26_C on one edge: DoFilter2_C where Hev(), DoFilter6_C elsewhere.
+static WEBP_INLINE void FilterLoop26_AVX2(__m256i* const x, int thresh,
+                                          int ithresh, int hev_thresh) {
+  const __m256i p2 = x[1], p1 = x[2], p0 = x[3];
+  const __m256i q0 = x[4], q1 = x[5], q2 = x[6];
+  const __m256i k63 = _mm256_set1_epi16(63);
+  __m256i mask, hev;
+  ComplexMask_AVX2(x, thresh, ithresh, hev_thresh, &mask, &hev);
+  {
+    const __m256i a0 =
+        _mm256_add_epi16(Mul3_AVX2(_mm256_sub_epi16(q0, p0)),
+                         Clamp_AVX2(_mm256_sub_epi16(p1, q1), -128, 127));
+    // DoFilter2_C
+    const __m256i f1 = FilterStep_AVX2(a0, 4);
+    const __m256i f2 = FilterStep_AVX2(a0, 3);
+    // DoFilter6_C
+    const __m256i a = Clamp_AVX2(a0, -128, 127);
+    const __m256i a1 = _mm256_srai_epi16(
+        _mm256_add_epi16(_mm256_mullo_epi16(a, _mm256_set1_epi16(27)), k63), 7);
+    const __m256i a2 = _mm256_srai_epi16(
+        _mm256_add_epi16(_mm256_mullo_epi16(a, _mm256_set1_epi16(18)), k63), 7);
+    const __m256i a3 = _mm256_srai_epi16(
+        _mm256_add_epi16(_mm256_mullo_epi16(a, _mm256_set1_epi16(9)), k63), 7);
+    const __m256i strong = _mm256_andnot_si256(hev, mask);
+    const __m256i dp0 = _mm256_and_si256(_mm256_blendv_epi8(a1, f2, hev), mask);
+    const __m256i dq0 = _mm256_and_si256(_mm256_blendv_epi8(a1, f1, hev), mask);
+    const __m256i d1 = _mm256_and_si256(a2, strong);
+    const __m256i d2 = _mm256_and_si256(a3, strong);
+    x[1] = _mm256_add_epi16(p2, d2);
+    x[2] = _mm256_add_epi16(p1, d1);
+    x[3] = _mm256_add_epi16(p0, dp0);
+    x[4] = _mm256_sub_epi16(q0, dq0);
+    x[5] = _mm256_sub_epi16(q1, d1);
+    x[6] = _mm256_sub_epi16(q2, d2);
+  }
+}
+
+// FilterLoop24_C on one edge: DoFilter2_C where Hev(), DoFilter4_C elsewhere.
+static WEBP_INLINE void FilterLoop24_AVX2(__m256i* const x, int thresh,
+                                          int ithresh, int hev_thresh) {
+  const __m256i p1 = x[2], p0 = x[3], q0 = x[4], q1 = x[5];
+  __m256i mask, hev;
+  ComplexMask_AVX2(x, thresh, ithresh, hev_thresh, &mask, &hev);
+  {
+    const __m256i a = Mul3_AVX2(_mm256_sub_epi16(q0, p0));
+    const __m256i a0 = _mm256_add_epi16(
+        a, Clamp_AVX2(_mm256_sub_epi16(p1, q1), -128, 127));
+    // DoFilter2_C
+    const __m256i f1 = FilterStep_AVX2(a0, 4);
+    const __m256i f2 = FilterStep_AVX2(a0, 3);
+    // DoFilter4_C
+    const __m256i a1 = FilterStep_AVX2(a, 4);
+    const __m256i a2 = FilterStep_AVX2(a, 3);
+    const __m256i a3 =
+        _mm256_srai_epi16(_mm256_add_epi16(a1, _mm256_set1_epi16(1)), 1);
+    const __m256i strong = _mm256_andnot_si256(hev, mask);
+    const __m256i dp0 = _mm256_and_si256(_mm256_blendv_epi8(a2, f2, hev), mask);
+    const __m256i dq0 = _mm256_and_si256(_mm256_blendv_epi8(a1, f1, hev), mask);
+    const __m256i d1 = _mm256_and_si256(a3, strong);
+    x[2] = _mm256_add_epi16(p1, d1);
+    x[3] = _mm256_add_epi16(p0, dp0);
+    x[4] = _mm256_sub_epi16(q0, dq0);
+    x[5] = _mm256_sub_epi16(q1, d1);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Loading and storing edges
+
+// 'count' rows of 8 u pixels followed by 8 v pixels.
+static WEBP_INLINE void LoadRowsUV_AVX2(const uint8_t* u, const uint8_t* v,
+                                        int stride, __m256i* const x,
+                                        int count) {
+  int i;
+  for (i = 0; i < count; ++i, u += stride, v += stride) {
+    const __m128i uv = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)u),
+                                          _mm_loadl_epi64((const __m128i*)v));
+    x[i] = _mm256_cvtepu8_epi16(uv);
+  }
+}
+
+static WEBP_INLINE void StoreRowsUV_AVX2(const __m256i* const x, int count,
+                                         uint8_t* u, uint8_t* v, int stride) {
+  int i;
+  for (i = 0; i < count; i += 2, u += 2 * stride, v += 2 * stride) {
+    const __m256i out = _mm256_packus_epi16(x[i], x[i + 1]);
+    const __m128i u_rows = _mm256_castsi256_si128(out);
+    const __m128i v_rows = _mm256_extracti128_si256(out, 1);
+    _mm_storel_epi64((__m128i*)u, u_rows);
+    _mm_storel_epi64((__m128i*)(u + stride), _mm_srli_si128(u_rows, 8));
+    _mm_storel_epi64((__m128i*)v, v_rows);
+    _mm_storel_epi64((__m128i*)(v + stride), _mm_srli_si128(v_rows, 8));
+  }
+}
+
+// Transposes the 8x8 bytes held in each lane of x[0..3], where x[i] holds
+// lines 2i and 2i + 1 in its low and high 8 bytes.
+static WEBP_INLINE void Transpose8x8_AVX2(__m256i* const x) {
+  const __m256i interleave = _mm256_setr_epi8(
+      0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15,
+      0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15);
+  // 00 10 01 11 02 12 03 13 04 14 05 15 06 16 07 17 (and likewise for 2-7)
+  const __m256i a0 = _mm256_shuffle_epi8(x[0], interleave);
+  const __m256i a1 = _mm256_shuffle_epi8(x[1], interleave);
+  const __m256i a2 = _mm256_shuffle_epi8(x[2], interleave);
+  const __m256i a3 = _mm256_shuffle_epi8(x[3], interleave);
+  // 00 10 20 30 01 11 21 31 02 12 22 32 03 13 23 33 (and columns 4-7)
+  const __m256i b0 = _mm256_unpacklo_epi16(a0, a1);
+  const __m256i b1 = _mm256_unpackhi_epi16(a0, a1);
+  const __m256i b2 = _mm256_unpacklo_epi16(a2, a3);
+  const __m256i b3 = _mm256_unpackhi_epi16(a2, a3);
+  // 00 10 20 30 40 50 60 70 01 11 21 31 41 51 61 71
+  x[0] = _mm256_unpacklo_epi32(b0, b2);
+  x[1] = _mm256_unpackhi_epi32(b0, b2);
+  x[2] = _mm256_unpacklo_epi32(b1, b3);
+  x[3] = _mm256_unpackhi_epi32(b1, b3);
+}
+
+// Eight columns of 16 pixels: the 8 bytes at 'r0' and the 7 rows below it
+// make up the first 8 pixels of each column, those at 'r8' the last 8.
+static WEBP_INLINE void LoadColumns_AVX2(const uint8_t* r0, const uint8_t* r8,
+                                         int stride, __m256i* const x) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i lines[4];
+  int i;
+  for (i = 0; i < 4; ++i, r0 += 2 * stride, r8 += 2 * stride) {
+    const __m128i lo =
+        _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)r0),
+                           _mm_loadl_epi64((const __m128i*)(r0 + stride)));
+    const __m128i hi =
+        _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)r8),
+                           _mm_loadl_epi64((const __m128i*)(r8 + stride)));
+    lines[i] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+  }
+  Transpose8x8_AVX2(lines);
+  for (i = 0; i < 4; ++i) {
+    x[2 * i + 0] = _mm256_unpacklo_epi8(lines[i], zero);
+    x[2 * i + 1] = _mm256_unpackhi_epi8(lines[i], zero);
+  }
+}
+
+static WEBP_INLINE void StoreColumns_AVX2(const __m256i* const x,
+                                          uint8_t* r0, uint8_t* r8,
+                                          int stride) {
+  __m256i lines[4];
+  int i;
+  for (i = 0; i < 4; ++i) {
+    lines[i] = _mm256_packus_epi16(x[2 * i + 0], x[2 * i + 1]);
+  }
+  Transpose8x8_AVX2(lines);
+  for (i = 0; i < 4; ++i, r0 += 2 * stride, r8 += 2 * stride) {
+    const __m128i lo = _mm256_castsi256_si128(lines[i]);
+    const __m128i hi = _mm256_extracti128_si256(lines[i], 1);
+    _mm_storel_epi64((__m128i*)r0, lo);
+    _mm_storel_epi64((__m128i*)(r0 + stride), _mm_srli_si128(lo, 8));
+    _mm_storel_epi64((__m128i*)r8, hi);
+    _mm_storel_epi64((__m128i*)(r8 + stride), _mm_srli_si128(hi, 8));
+  }
+}
+
+//------------------------------------------------------------------------------
+// Simple In-loop filtering (Paragraph 15.2)
+
+// The simple filter only moves p0 and q0, so the three inner edges do not
+// overlap and are all filtered from one transpose.
+static void SimpleHFilter16i_AVX2(uint8_t* p, int stride, int thresh) {
+  __m256i x[16];
+  int k;
+  LoadColumns_AVX2(p, p + 8 * stride, stride, x);
+  LoadColumns_AVX2(p + 8, p + 8 + 8 * stride, stride, x + 8);
+  for (k = 1; k <= 3; ++k) {
+    SimpleFilter_AVX2(x + 4 * k - 2, thresh);
+  }
+  StoreColumns_AVX2(x, p, p + 8 * stride, stride);
+  StoreColumns_AVX2(x + 8, p + 8, p + 8 + 8 * stride, stride);
+}
+
+//------------------------------------------------------------------------------
+// Complex In-loop filtering (Paragraph 15.3)
+
+static void HFilter16_AVX2(uint8_t* p, int stride,
+                           int thresh, int ithresh, int hev_thresh) {
+  __m256i x[8];
+  LoadColumns_AVX2(p - 4, p - 4 + 8 * stride, stride, x);
+  FilterLoop26_AVX2(x, thresh, ithresh, hev_thresh);
+  StoreColumns_AVX2(x, p - 4, p - 4 + 8 * stride, stride);
+}
+
+// Transposes the macroblock once rather than 8 columns per edge, so each edge
+// reads what the previous one wrote from registers.
+static void HFilter16i_AVX2(uint8_t* p, int stride,
+                            int thresh, int ithresh, int hev_thresh) {
+  __m256i x[16];
+  int k;
+  LoadColumns_AVX2(p, p + 8 * stride, stride, x);
+  LoadColumns_AVX2(p + 8, p + 8 + 8 * stride, stride, x + 8);
+  for (k = 0; k < 3; ++k) {
+    FilterLoop24_AVX2(x + 4 * k, thresh, ithresh, hev_thresh);
+    // q0 and q1 are p3 and p2 of the next edge.
+    x[4 * k + 4] = Clip8b_AVX2(x[4 * k + 4]);
+    x[4 * k + 5] = Clip8b_AVX2(x[4 * k + 5]);
+  }
+  StoreColumns_AVX2(x, p, p + 8 * stride, stride);
+  StoreColumns_AVX2(x + 8, p + 8, p + 8 + 8 * stride, stride);
+}
+
+// 8-pixels wide variant, for chroma filtering: u and v share each register.
+static void VFilter8_AVX2(uint8_t* u, uint8_t* v, int stride,
+                          int thresh, int ithresh, int hev_thresh) {
+  __m256i x[8];
+  LoadRowsUV_AVX2(u - 4 * stride, v - 4 * stride, stride, x, 8);
+  FilterLoop26_AVX2(x, thresh, ithresh, hev_thresh);
+  StoreRowsUV_AVX2(x + 1, 6, u - 3 * stride, v - 3 * stride, stride);
+}
+
+static void HFilter8_AVX2(uint8_t* u, uint8_t* v, int stride,
+                          int thresh, int ithresh, int hev_thresh) {
+  __m256i x[8];
+  LoadColumns_AVX2(u - 4, v - 4, stride, x);
+  FilterLoop26_AVX2(x, thresh, ithresh, hev_thresh);
+  StoreColumns_AVX2(x, u - 4, v - 4, stride);
+}
+
+static void HFilter8i_AVX2(uint8_t* u, uint8_t* v, int stride,
+                           int thresh, int ithresh, int hev_thresh) {
+  __m256i x[8];
+  LoadColumns_AVX2(u, v, stride, x);
+  FilterLoop24_AVX2(x, thresh, ithresh, hev_thresh);
+  StoreColumns_AVX2(x, u, v, stride);
+}
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern void VP8DspInitAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void VP8DspInitAVX2(void) {
+  VP8TransformUV = TransformUV_AVX2;
+
+  VP8HFilter16 = HFilter16_AVX2;
+  VP8VFilter8 = VFilter8_AVX2;
+  VP8HFilter8 = HFilter8_AVX2;
+  VP8HFilter16i = HFilter16i_AVX2;
+  VP8HFilter8i = HFilter8i_AVX2;
+
+  VP8SimpleHFilter16i = SimpleHFilter16i_AVX2;
+}
+
+#else  // !WEBP_USE_AVX2
+
+WEBP_DSP_INIT_STUB(VP8DspInitAVX2)
+
+#endif  // WEBP_USE_AVX2
@@ -64,6 +64,11 @@ extern "C" {
 #define WEBP_MSC_SSE41  // Visual C++ SSE4.1 targets
 #endif
 
+#if defined(_MSC_VER) && _MSC_VER >= 1700 && \
+    (defined(_M_X64) || defined(_M_IX86))
+#define WEBP_MSC_AVX2  // Visual C++ AVX2 targets
+#endif
+
 // WEBP_HAVE_* are used to indicate the presence of the instruction set in dsp
 // files without intrinsics, allowing the corresponding Init() to be called.
 // Files containing intrinsics will need to be built targeting the instruction
@@ -76,6 +81,10 @@ extern "C" {
 #define WEBP_USE_SSE41
 #endif
 
+#if defined(__AVX2__) || defined(WEBP_MSC_AVX2) || defined(WEBP_HAVE_AVX2)
+#define WEBP_USE_AVX2
+#endif
+
 // The intrinsics currently cause compiler errors with arm-nacl-gcc and the
 // inline assembly would need to be modified for use with Native Client.
 #if (defined(__ARM_NEON__) || \
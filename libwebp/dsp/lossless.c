@@ -403,9 +403,9 @@ void VP8LInverseTransform(const VP8LTransform* const transform,
             VP8LSubSampleSize(transform->xsize_, transform->bits_);
         uint32_t* const src = out + out_stride - in_stride;
         memmove(src, out, in_stride * sizeof(*src));
-        ColorIndexInverseTransform_C(transform, row_start, row_end, src, out);
+        VP8LColorIndexInverseTransform(transform, row_start, row_end, src, out);
       } else {
-        ColorIndexInverseTransform_C(transform, row_start, row_end, in, out);
+        VP8LColorIndexInverseTransform(transform, row_start, row_end, in, out);
       }
       break;
   }
@@ -561,6 +561,8 @@ VP8LPredictorFunc VP8LPredictors_C[16];
 
 VP8LTransformColorInverseFunc VP8LTransformColorInverse;
 
+VP8LColorIndexInverseTransformFunc VP8LColorIndexInverseTransform;
+
 VP8LConvertFunc VP8LConvertBGRAToRGB;
 VP8LConvertFunc VP8LConvertBGRAToRGBA;
 VP8LConvertFunc VP8LConvertBGRAToRGBA4444;
@@ -571,6 +573,7 @@ VP8LMapARGBFunc VP8LMapColor32b;
 VP8LMapAlphaFunc VP8LMapColor8b;
 
 extern void VP8LDspInitSSE2(void);
+extern void VP8LDspInitAVX2(void);
 extern void VP8LDspInitNEON(void);
 extern void VP8LDspInitMIPSdspR2(void);
 extern void VP8LDspInitMSA(void);
@@ -613,6 +616,7 @@ WEBP_DSP_INIT_FUNC(VP8LDspInit) {
   VP8LConvertBGRAToRGBA4444 = VP8LConvertBGRAToRGBA4444_C;
   VP8LConvertBGRAToRGB565 = VP8LConvertBGRAToRGB565_C;
 
+  VP8LColorIndexInverseTransform = ColorIndexInverseTransform_C;
   VP8LMapColor32b = MapARGB_C;
   VP8LMapColor8b = MapAlpha_C;
 
@@ -621,6 +625,11 @@ WEBP_DSP_INIT_FUNC(VP8LDspInit) {
 #if defined(WEBP_USE_SSE2)
     if (VP8GetCPUInfo(kSSE2)) {
       VP8LDspInitSSE2();
+#if defined(WEBP_USE_AVX2)
+      if (VP8GetCPUInfo(kAVX2)) {
+        VP8LDspInitAVX2();
+      }
+#endif
     }
 #endif
 #if defined(WEBP_USE_MIPS_DSP_R2)
@@ -649,6 +658,7 @@ WEBP_DSP_INIT_FUNC(VP8LDspInit) {
   assert(VP8LConvertBGRAToBGR != NULL);
   assert(VP8LConvertBGRAToRGBA4444 != NULL);
   assert(VP8LConvertBGRAToRGB565 != NULL);
+  assert(VP8LColorIndexInverseTransform != NULL);
   assert(VP8LMapColor32b != NULL);
   assert(VP8LMapColor8b != NULL);
 }
@@ -64,6 +64,14 @@ void VP8LInverseTransform(const struct VP8LTransform* const transform,
                           int row_start, int row_end,
                           const uint32_t* const in, uint32_t* const out);
 
+// Expands the color indices of rows [y_start, y_end[ through the color map of
+// a color-indexing 'transform'. 'src' may lie at the end of the 'dst' rows, as
+// it does when VP8LInverseTransform() unpacks in place.
+typedef void (*VP8LColorIndexInverseTransformFunc)(
+    const struct VP8LTransform* const transform, int y_start, int y_end,
+    const uint32_t* src, uint32_t* dst);
+extern VP8LColorIndexInverseTransformFunc VP8LColorIndexInverseTransform;
+
 // Color space conversion.
 typedef void (*VP8LConvertFunc)(const uint32_t* src, int num_pixels,
                                 uint8_t* dst);
@@ -0,0 +1,442 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// AVX2 variant of methods for lossless decoder.
+//
+// The predictors and transforms are called on a tile row at a time, often
+// only 8 or 16 pixels, so every loop does 8 pixels at a time, then 4 with
+// SSE, and leaves at most 3 to plain-C. The predictors that depend on the
+// pixel to their left (5, 6, 7 and 10 to 13) stay with their SSE2 versions.
+
+#include "./dsp.h"
+
+#if defined(WEBP_USE_AVX2)
+
+#include <immintrin.h>
+#include <string.h>
+#include "../dec/vp8li_dec.h"
+#include "./lossless.h"
+#include "./lossless_common.h"
+
+//------------------------------------------------------------------------------
+// Predictor Transform
+
+// (a + b) >> 1 = ((a + b + 1) >> 1) - ((a ^ b) & 1)
+static WEBP_INLINE __m256i Average2_AVX2(const __m256i a0, const __m256i a1) {
+  const __m256i ones = _mm256_set1_epi8(1);
+  const __m256i avg1 = _mm256_avg_epu8(a0, a1);
+  const __m256i one = _mm256_and_si256(_mm256_xor_si256(a0, a1), ones);
+  return _mm256_sub_epi8(avg1, one);
+}
+
+static WEBP_INLINE __m128i Average2_SSE(const __m128i a0, const __m128i a1) {
+  const __m128i ones = _mm_set1_epi8(1);
+  const __m128i avg1 = _mm_avg_epu8(a0, a1);
+  const __m128i one = _mm_and_si128(_mm_xor_si128(a0, a1), ones);
+  return _mm_sub_epi8(avg1, one);
+}
+
+// Predictor0: ARGB_BLACK.
+static void PredictorAdd0_AVX2(const uint32_t* in, const uint32_t* upper,
+                               int num_pixels, uint32_t* out) {
+  int i;
+  const __m256i black = _mm256_set1_epi32(ARGB_BLACK);
+  for (i = 0; i + 8 <= num_pixels; i += 8) {
+    const __m256i src = _mm256_loadu_si256((const __m256i*)&in[i]);
+    _mm256_storeu_si256((__m256i*)&out[i], _mm256_add_epi8(src, black));
+  }
+  if (i + 4 <= num_pixels) {
+    const __m128i src = _mm_loadu_si128((const __m128i*)&in[i]);
+    _mm_storeu_si128((__m128i*)&out[i],
+                     _mm_add_epi8(src, _mm256_castsi256_si128(black)));
+    i += 4;
+  }
+  if (i != num_pixels) {
+    VP8LPredictorsAdd_C[0](in + i, upper + i, num_pixels - i, out + i);
+  }
+}
+
+// Predictor1: left. Each lane of 4 pixels gets its prefix sum as in SSE2, then
+// the second lane adds the last sum of the first one.
+static void PredictorAdd1_AVX2(const uint32_t* in, const uint32_t* upper,
+                               int num_pixels, uint32_t* out) {
+  int i;
+  const __m256i last = _mm256_set1_epi32(7);
+  const __m256i lane0_last = _mm256_set_epi32(3, 3, 3, 3, 0, 0, 0, 0);
+  __m256i prev = _mm256_set1_epi32((int)out[-1]);
+  for (i = 0; i + 8 <= num_pixels; i += 8) {
+    const __m256i src = _mm256_loadu_si256((const __m256i*)&in[i]);
+    const __m256i sum0 = _mm256_add_epi8(src, _mm256_slli_si256(src, 4));
+    const __m256i sum1 = _mm256_add_epi8(sum0, _mm256_slli_si256(sum0, 8));
+    const __m256i carry = _mm256_blend_epi32(
+        _mm256_setzero_si256(),
+        _mm256_permutevar8x32_epi32(sum1, lane0_last), 0xf0);
+    const __m256i res =
+        _mm256_add_epi8(_mm256_add_epi8(sum1, carry), prev);
+    _mm256_storeu_si256((__m256i*)&out[i], res);
+    prev = _mm256_permutevar8x32_epi32(res, last);
+  }
+  if (i + 4 <= num_pixels) {
+    const __m128i src = _mm_loadu_si128((const __m128i*)&in[i]);
+    const __m128i sum0 = _mm_add_epi8(src, _mm_slli_si128(src, 4));
+    const __m128i sum1 = _mm_add_epi8(sum0, _mm_slli_si128(sum0, 8));
+    const __m128i res = _mm_add_epi8(sum1, _mm256_castsi256_si128(prev));
+    _mm_storeu_si128((__m128i*)&out[i], res);
+    i += 4;
+  }
+  if (i != num_pixels) {
+    VP8LPredictorsAdd_C[1](in + i, upper + i, num_pixels - i, out + i);
+  }
+}
+
+// Adds the pixels of IN, relative to 'upper[i]', to the residuals.
+#define GENERATE_PREDICTOR_1(X, IN)                                           \
+static void PredictorAdd##X##_AVX2(const uint32_t* in, const uint32_t* upper, \
+                                   int num_pixels, uint32_t* out) {           \
+  int i;                                                                      \
+  for (i = 0; i + 8 <= num_pixels; i += 8) {                                  \
+    const __m256i src = _mm256_loadu_si256((const __m256i*)&in[i]);           \
+    const __m256i other = _mm256_loadu_si256((const __m256i*)&upper[i + IN]); \
+    _mm256_storeu_si256((__m256i*)&out[i], _mm256_add_epi8(src, other));      \
+  }                                                                           \
+  if (i + 4 <= num_pixels) {                                                  \
+    const __m128i src = _mm_loadu_si128((const __m128i*)&in[i]);              \
+    const __m128i other = _mm_loadu_si128((const __m128i*)&upper[i + IN]);    \
+    _mm_storeu_si128((__m128i*)&out[i], _mm_add_epi8(src, other));            \
+    i += 4;                                                                   \
+  }                                                                           \
+  if (i != num_pixels) {                                                      \
+    VP8LPredictorsAdd_C[(X)](in + i, upper + i, num_pixels - i, out + i);     \
+  }                                                                           \
+}
+
+// Predictor2: Top.
+GENERATE_PREDICTOR_1(2, 0)
+// Predictor3: Top-right.
+GENERATE_PREDICTOR_1(3, 1)
+// Predictor4: Top-left.
+GENERATE_PREDICTOR_1(4, -1)
+#undef GENERATE_PREDICTOR_1
+
+// Adds the average of 'upper[i]' and 'upper[i + IN]' to the residuals.
+#define GENERATE_PREDICTOR_2(X, IN)                                           \
+static void PredictorAdd##X##_AVX2(const uint32_t* in, const uint32_t* upper, \
+                                   int num_pixels, uint32_t* out) {           \
+  int i;                                                                      \
+  for (i = 0; i + 8 <= num_pixels; i += 8) {                                  \
+    const __m256i T = _mm256_loadu_si256((const __m256i*)&upper[i]);          \
+    const __m256i other = _mm256_loadu_si256((const __m256i*)&upper[i + IN]); \
+    const __m256i src = _mm256_loadu_si256((const __m256i*)&in[i]);           \
+    const __m256i res = _mm256_add_epi8(Average2_AVX2(T, other), src);        \
+    _mm256_storeu_si256((__m256i*)&out[i], res);                              \
+  }                                                                           \
+  if (i + 4 <= num_pixels) {                                                  \
+    const __m128i T = _mm_loadu_si128((const __m128i*)&upper[i]);             \
+    const __m128i other = _mm_loadu_si128((const __m128i*)&upper[i + IN]);    \
+    const __m128i src = _mm_loadu_si128((const __m128i*)&in[i]);              \
+    const __m128i res = _mm_add_epi8(Average2_SSE(T, other), src);            \
+    _mm_storeu_si128((__m128i*)&out[i], res);                                 \
+    i += 4;                                                                   \
+  }                                                                           \
+  if (i != num_pixels) {                                                      \
+    VP8LPredictorsAdd_C[(X)](in + i, upper + i, num_pixels - i, out + i);     \
+  }                                                                           \
+}
+// Predictor8: average TL T.
+GENERATE_PREDICTOR_2(8, -1)
+// Predictor9: average T TR.
+GENERATE_PREDICTOR_2(9, 1)
+#undef GENERATE_PREDICTOR_2
+
+//------------------------------------------------------------------------------
+// Subtract-Green Transform
+
+static void AddGreenToBlueAndRed_AVX2(const uint32_t* const src, int num_pixels,
+                                      uint32_t* dst) {
+  // Copies green into the blue and red bytes of each pixel, zero elsewhere.
+  const __m256i kGreen = _mm256_setr_epi8(
+      1, -1, 1, -1, 5, -1, 5, -1, 9, -1, 9, -1, 13, -1, 13, -1,
+      1, -1, 1, -1, 5, -1, 5, -1, 9, -1, 9, -1, 13, -1, 13, -1);
+  int i;
+  for (i = 0; i + 8 <= num_pixels; i += 8) {
+    const __m256i in = _mm256_loadu_si256((const __m256i*)&src[i]);  // argb
+    const __m256i green = _mm256_shuffle_epi8(in, kGreen);           // 0g0g
+    _mm256_storeu_si256((__m256i*)&dst[i], _mm256_add_epi8(in, green));
+  }
+  if (i + 4 <= num_pixels) {
+    const __m128i in = _mm_loadu_si128((const __m128i*)&src[i]);
+    const __m128i green =
+        _mm_shuffle_epi8(in, _mm256_castsi256_si128(kGreen));
+    _mm_storeu_si128((__m128i*)&dst[i], _mm_add_epi8(in, green));
+    i += 4;
+  }
+  if (i != num_pixels) {
+    VP8LAddGreenToBlueAndRed_C(src + i, num_pixels - i, dst + i);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Color Transform
+
+// Same steps as TransformColorInverse_SSE2(), with one shuffle to spread green.
+// TYPE and SI are the vector type and suffix, PREFIX the intrinsics prefix.
+#define TRANSFORM_COLOR_INVERSE(IN, OUT, MULTS_RB, MULTS_B2, MASK_AG, KGREEN,  \
+                                TYPE, PREFIX, SI) do {                         \
+  const TYPE A = PREFIX##_and_##SI((IN), (MASK_AG));    /* a   0   g   0 */   \
+  const TYPE C = PREFIX##_shuffle_epi8((IN), (KGREEN)); /* g   0   g   0 */   \
+  const TYPE D = PREFIX##_mulhi_epi16(C, (MULTS_RB));   /* x  dr   x db1 */   \
+  const TYPE E = PREFIX##_add_epi8((IN), D);            /* x  r'   x  b' */   \
+  const TYPE F = PREFIX##_slli_epi16(E, 8);             /* r'  0  b'   0 */   \
+  const TYPE G = PREFIX##_mulhi_epi16(F, (MULTS_B2));   /* x db2   0   0 */   \
+  const TYPE H = PREFIX##_srli_epi32(G, 8);             /* 0   x db2   0 */   \
+  const TYPE I = PREFIX##_add_epi8(H, F);               /* r'  x b''   0 */   \
+  const TYPE J = PREFIX##_srli_epi16(I, 8);             /* 0  r'   0 b'' */   \
+  (OUT) = PREFIX##_or_##SI(J, A);                                             \
+} while (0)
+
+static void TransformColorInverse_AVX2(const VP8LMultipliers* const m,
+                                       const uint32_t* const src,
+                                       int num_pixels, uint32_t* dst) {
+// sign-extended multiplying constants, pre-shifted by 5.
+#define CST(X)  (((int16_t)(m->X << 8)) >> 5)   // sign-extend
+#define MK_CST_16(HI, LO) \
+  _mm256_set1_epi32((int)(((uint32_t)(HI) << 16) | ((LO) & 0xffff)))
+  const __m256i mults_rb = MK_CST_16(CST(green_to_red_), CST(green_to_blue_));
+  const __m256i mults_b2 = MK_CST_16(CST(red_to_blue_), 0);
+#undef MK_CST_16
+#undef CST
+  const __m256i mask_ag = _mm256_set1_epi32(0xff00ff00);  // alpha-green masks
+  // Moves green to the high byte of both 16-bit halves: g 0 g 0.
+  const __m256i kGreen = _mm256_setr_epi8(
+      -1, 1, -1, 1, -1, 5, -1, 5, -1, 9, -1, 9, -1, 13, -1, 13,
+      -1, 1, -1, 1, -1, 5, -1, 5, -1, 9, -1, 9, -1, 13, -1, 13);
+  int i;
+  for (i = 0; i + 8 <= num_pixels; i += 8) {
+    const __m256i in = _mm256_loadu_si256((const __m256i*)&src[i]);
+    __m256i out;
+    TRANSFORM_COLOR_INVERSE(in, out, mults_rb, mults_b2, mask_ag, kGreen,
+                            __m256i, _mm256, si256);
+    _mm256_storeu_si256((__m256i*)&dst[i], out);
+  }
+  if (i + 4 <= num_pixels) {
+    const __m128i in = _mm_loadu_si128((const __m128i*)&src[i]);
+    __m128i out;
+    TRANSFORM_COLOR_INVERSE(in, out, _mm256_castsi256_si128(mults_rb),
+                            _mm256_castsi256_si128(mults_b2),
+                            _mm256_castsi256_si128(mask_ag),
+                            _mm256_castsi256_si128(kGreen), __m128i, _mm,
+                            si128);
+    _mm_storeu_si128((__m128i*)&dst[i], out);
+    i += 4;
+  }
+  if (i != num_pixels) {
+    VP8LTransformColorInverse_C(m, src + i, num_pixels - i, dst + i);
+  }
+}
+#undef TRANSFORM_COLOR_INVERSE
+
+//------------------------------------------------------------------------------
+// Color-Indexing Transform
+
+// Looks up 8 indices at a time with a gather from the 256-entry color map.
+static void MapARGB_AVX2(const uint32_t* src, const uint32_t* const color_map,
+                         uint32_t* dst, int y_start, int y_end, int width) {
+  const __m256i mask_ff = _mm256_set1_epi32(0xff);
+  int y;
+  for (y = y_start; y < y_end; ++y) {
+    int x;
+    for (x = 0; x + 8 <= width; x += 8) {
+      const __m256i in = _mm256_loadu_si256((const __m256i*)&src[x]);
+      const __m256i index = _mm256_and_si256(_mm256_srli_epi32(in, 8), mask_ff);
+      const __m256i argb =
+          _mm256_i32gather_epi32((const int*)color_map, index, 4);
+      _mm256_storeu_si256((__m256i*)&dst[x], argb);
+    }
+    for (; x < width; ++x) {
+      dst[x] = VP8GetARGBValue(color_map[VP8GetARGBIndex(src[x])]);
+    }
+    src += width;
+    dst += width;
+  }
+}
+
+// With bundled pixels the color map has at most 16 entries, so both halves of
+// it fit in a register each and 8 pixels are looked up with one or two
+// permutes. Unpacking in place writes each run of 8 pixels after reading the
+// source words they come from; those never lie after the ones still to read.
+static void ColorIndexInverseTransform_AVX2(
+    const VP8LTransform* const transform, int y_start, int y_end,
+    const uint32_t* src, uint32_t* dst) {
+  const int bits = transform->bits_;
+  const int bits_per_pixel = 8 >> bits;
+  const int width = transform->xsize_;
+  const uint32_t* const color_map = transform->data_;
+  int y;
+  if (bits_per_pixel == 8) {
+    VP8LMapColor32b(src, color_map, dst, y_start, y_end, width);
+    return;
+  }
+  {
+    const int pixels_per_byte = 1 << bits;
+    const int count_mask = pixels_per_byte - 1;
+    const uint32_t bit_mask = (1 << bits_per_pixel) - 1;
+    const int num_colors = 1 << bits_per_pixel;
+    // Source word and shift of the index of each of 8 pixels, per 'bits'.
+    static const int kWord[3][8] = {
+      { 0, 0, 1, 1, 2, 2, 3, 3 }, { 0, 0, 0, 0, 1, 1, 1, 1 },
+      { 0, 0, 0, 0, 0, 0, 0, 0 }
+    };
+    static const int kShift[3][8] = {
+      { 8, 12, 8, 12, 8, 12, 8, 12 }, { 8, 10, 12, 14, 8, 10, 12, 14 },
+      { 8, 9, 10, 11, 12, 13, 14, 15 }
+    };
+    const __m256i word = _mm256_loadu_si256((const __m256i*)kWord[bits - 1]);
+    const __m256i shift = _mm256_loadu_si256((const __m256i*)kShift[bits - 1]);
+    const __m256i index_mask = _mm256_set1_epi32((int)bit_mask);
+    const __m256i seven = _mm256_set1_epi32(7);
+    __m256i colors_lo, colors_hi;
+    {
+      uint32_t colors[16] = { 0 };
+      memcpy(colors, color_map, num_colors * sizeof(*colors));
+      colors_lo = _mm256_loadu_si256((const __m256i*)&colors[0]);
+      colors_hi = _mm256_loadu_si256((const __m256i*)&colors[8]);
+    }
+    for (y = y_start; y < y_end; ++y) {
+      uint32_t packed_pixels = 0;
+      int x;
+      for (x = 0; x + 8 <= width; x += 8) {
+        __m128i packed;
+        __m256i index, argb;
+        if (bits == 1) {
+          packed = _mm_loadu_si128((const __m128i*)src);
+          src += 4;
+        } else if (bits == 2) {
+          packed = _mm_loadl_epi64((const __m128i*)src);
+          src += 2;
+        } else {
+          packed = _mm_cvtsi32_si128((int)*src++);
+        }
+        index = _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(packed),
+                                            word);
+        index = _mm256_and_si256(_mm256_srlv_epi32(index, shift), index_mask);
+        argb = _mm256_permutevar8x32_epi32(colors_lo, index);
+        if (num_colors > 8) {
+          const __m256i argb_hi = _mm256_permutevar8x32_epi32(colors_hi, index);
+          argb = _mm256_blendv_epi8(argb, argb_hi,
+                                    _mm256_cmpgt_epi32(index, seven));
+        }
+        _mm256_storeu_si256((__m256i*)dst, argb);
+        dst += 8;
+      }
+      for (; x < width; ++x) {
+        if ((x & count_mask) == 0) packed_pixels = VP8GetARGBIndex(*src++);
+        *dst++ = VP8GetARGBValue(color_map[packed_pixels & bit_mask]);
+        packed_pixels >>= bits_per_pixel;
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Color-space conversion functions
+
+static void ConvertBGRAToRGBA_AVX2(const uint32_t* src,
+                                   int num_pixels, uint8_t* dst) {
+  const __m256i kSwapRB = _mm256_setr_epi8(
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  while (num_pixels >= 8) {
+    const __m256i bgra = _mm256_loadu_si256((const __m256i*)src);
+    _mm256_storeu_si256((__m256i*)dst, _mm256_shuffle_epi8(bgra, kSwapRB));
+    src += 8;
+    dst += 32;
+    num_pixels -= 8;
+  }
+  // left-overs
+  if (num_pixels > 0) {
+    VP8LConvertBGRAToRGBA_C(src, num_pixels, dst);
+  }
+}
+
+// Drops alpha with 'shuffle', which packs 12 bytes at the start of each lane,
+// then moves the second lane next to the first one and stores 24 bytes.
+static WEBP_INLINE void ConvertBGRATo24b_AVX2(const uint32_t* src,
+                                              int num_pixels, uint8_t* dst,
+                                              const __m256i shuffle) {
+  const __m256i kPack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+  while (num_pixels >= 8) {
+    const __m256i bgra = _mm256_loadu_si256((const __m256i*)src);
+    const __m256i packed =
+        _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(bgra, shuffle), kPack);
+    _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(packed));
+    _mm_storel_epi64((__m128i*)(dst + 16), _mm256_extracti128_si256(packed, 1));
+    src += 8;
+    dst += 24;
+    num_pixels -= 8;
+  }
+}
+
+static void ConvertBGRAToRGB_AVX2(const uint32_t* src,
+                                  int num_pixels, uint8_t* dst) {
+  const __m256i kRGB = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const int num_simd = num_pixels & ~7;
+  ConvertBGRATo24b_AVX2(src, num_simd, dst, kRGB);
+  // left-overs
+  if (num_simd != num_pixels) {
+    VP8LConvertBGRAToRGB_C(src + num_simd, num_pixels - num_simd,
+                           dst + 3 * num_simd);
+  }
+}
+
+static void ConvertBGRAToBGR_AVX2(const uint32_t* src,
+                                  int num_pixels, uint8_t* dst) {
+  const __m256i kBGR = _mm256_setr_epi8(
+      0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+      0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  const int num_simd = num_pixels & ~7;
+  ConvertBGRATo24b_AVX2(src, num_simd, dst, kBGR);
+  // left-overs
+  if (num_simd != num_pixels) {
+    VP8LConvertBGRAToBGR_C(src + num_simd, num_pixels - num_simd,
+                           dst + 3 * num_simd);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern void VP8LDspInitAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void VP8LDspInitAVX2(void) {
+  VP8LPredictorsAdd[0] = PredictorAdd0_AVX2;
+  VP8LPredictorsAdd[1] = PredictorAdd1_AVX2;
+  VP8LPredictorsAdd[2] = PredictorAdd2_AVX2;
+  VP8LPredictorsAdd[3] = PredictorAdd3_AVX2;
+  VP8LPredictorsAdd[4] = PredictorAdd4_AVX2;
+  VP8LPredictorsAdd[8] = PredictorAdd8_AVX2;
+  VP8LPredictorsAdd[9] = PredictorAdd9_AVX2;
+
+  VP8LAddGreenToBlueAndRed = AddGreenToBlueAndRed_AVX2;
+  VP8LTransformColorInverse = TransformColorInverse_AVX2;
+
+  VP8LColorIndexInverseTransform = ColorIndexInverseTransform_AVX2;
+  VP8LMapColor32b = MapARGB_AVX2;
+
+  VP8LConvertBGRAToRGB = ConvertBGRAToRGB_AVX2;
+  VP8LConvertBGRAToRGBA = ConvertBGRAToRGBA_AVX2;
+  VP8LConvertBGRAToBGR = ConvertBGRAToBGR_AVX2;
+}
+
+#else  // !WEBP_USE_AVX2
+
+WEBP_DSP_INIT_STUB(VP8LDspInitAVX2)
+
+#endif  // WEBP_USE_AVX2
@@ -0,0 +1,262 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// AVX2 Rescaling functions
+//
+// Only the row exports are vectorized here, 16 values per iteration. The
+// imports carry a running accumulator from one output sample to the next
+// and keep their SSE2 versions.
+
+#include "./dsp.h"
+
+#if defined(WEBP_USE_AVX2) && !defined(WEBP_REDUCE_SIZE)
+#include <immintrin.h>
+
+#include <assert.h>
+#include "../utils/rescaler_utils.h"
+#include "../utils/utils.h"
+
+#define ROUNDER (WEBP_RESCALER_ONE >> 1)
+#define MULT_FIX(x, y) (((uint64_t)(x) * (y) + ROUNDER) >> WEBP_RESCALER_RFIX)
+#define MULT_FIX_FLOOR(x, y) (((uint64_t)(x) * (y)) >> WEBP_RESCALER_RFIX)
+
+//------------------------------------------------------------------------------
+// Row export
+
+// load *src as epi64, multiply by mult and store result in [out0 ... out3]:
+// out0/out1 hold the even values of src[0..7]/src[8..15], out2/out3 the odd.
+static WEBP_INLINE void LoadDispatchAndMult_AVX2(const rescaler_t* const src,
+                                                 const __m256i* const mult,
+                                                 __m256i* const out0,
+                                                 __m256i* const out1,
+                                                 __m256i* const out2,
+                                                 __m256i* const out3) {
+  const __m256i A0 = _mm256_loadu_si256((const __m256i*)(src + 0));
+  const __m256i A1 = _mm256_loadu_si256((const __m256i*)(src + 8));
+  const __m256i A2 = _mm256_srli_epi64(A0, 32);
+  const __m256i A3 = _mm256_srli_epi64(A1, 32);
+  if (mult != NULL) {
+    *out0 = _mm256_mul_epu32(A0, *mult);
+    *out1 = _mm256_mul_epu32(A1, *mult);
+    *out2 = _mm256_mul_epu32(A2, *mult);
+    *out3 = _mm256_mul_epu32(A3, *mult);
+  } else {
+    *out0 = A0;
+    *out1 = A1;
+    *out2 = A2;
+    *out3 = A3;
+  }
+}
+
+// Re-interleaves the even (B0, B1) and odd (B2, B3) 64b products, shifted
+// down by WEBP_RESCALER_RFIX, and stores them as 16 bytes.
+static WEBP_INLINE void PackAndStore16_AVX2(const __m256i* const B0,
+                                            const __m256i* const B1,
+                                            const __m256i* const B2,
+                                            const __m256i* const B3,
+                                            uint8_t* const dst) {
+  const __m256i mask = _mm256_set1_epi64x((int64_t)0xffffffff00000000ull);
+  // The per-lane packs leave groups of 4 values in the order 0 2 1 3.
+  const __m256i order = _mm256_set_epi32(7, 3, 6, 2, 5, 1, 4, 0);
+  const __m256i D0 = _mm256_srli_epi64(*B0, WEBP_RESCALER_RFIX);
+  const __m256i D1 = _mm256_srli_epi64(*B1, WEBP_RESCALER_RFIX);
+#if (WEBP_RESCALER_RFIX < 32)
+  const __m256i D2 =
+      _mm256_and_si256(_mm256_slli_epi64(*B2, 32 - WEBP_RESCALER_RFIX), mask);
+  const __m256i D3 =
+      _mm256_and_si256(_mm256_slli_epi64(*B3, 32 - WEBP_RESCALER_RFIX), mask);
+#else
+  const __m256i D2 = _mm256_and_si256(*B2, mask);
+  const __m256i D3 = _mm256_and_si256(*B3, mask);
+#endif
+  const __m256i E0 = _mm256_or_si256(D0, D2);
+  const __m256i E1 = _mm256_or_si256(D1, D3);
+  const __m256i F = _mm256_packs_epi32(E0, E1);
+  const __m256i G = _mm256_packus_epi16(F, F);
+  const __m256i H = _mm256_permutevar8x32_epi32(G, order);
+  _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(H));
+}
+
+static WEBP_INLINE void ProcessRow_AVX2(const __m256i* const A0,
+                                        const __m256i* const A1,
+                                        const __m256i* const A2,
+                                        const __m256i* const A3,
+                                        const __m256i* const mult,
+                                        uint8_t* const dst) {
+  const __m256i rounder = _mm256_set1_epi64x(ROUNDER);
+  const __m256i B0 = _mm256_mul_epu32(*A0, *mult);
+  const __m256i B1 = _mm256_mul_epu32(*A1, *mult);
+  const __m256i B2 = _mm256_mul_epu32(*A2, *mult);
+  const __m256i B3 = _mm256_mul_epu32(*A3, *mult);
+  const __m256i C0 = _mm256_add_epi64(B0, rounder);
+  const __m256i C1 = _mm256_add_epi64(B1, rounder);
+  const __m256i C2 = _mm256_add_epi64(B2, rounder);
+  const __m256i C3 = _mm256_add_epi64(B3, rounder);
+  PackAndStore16_AVX2(&C0, &C1, &C2, &C3, dst);
+}
+
+static WEBP_INLINE void ProcessRow_Floor_AVX2(const __m256i* const A0,
+                                              const __m256i* const A1,
+                                              const __m256i* const A2,
+                                              const __m256i* const A3,
+                                              const __m256i* const mult,
+                                              uint8_t* const dst) {
+  const __m256i B0 = _mm256_mul_epu32(*A0, *mult);
+  const __m256i B1 = _mm256_mul_epu32(*A1, *mult);
+  const __m256i B2 = _mm256_mul_epu32(*A2, *mult);
+  const __m256i B3 = _mm256_mul_epu32(*A3, *mult);
+  PackAndStore16_AVX2(&B0, &B1, &B2, &B3, dst);
+}
+
+static void RescalerExportRowExpand_AVX2(WebPRescaler* const wrk) {
+  int x_out;
+  uint8_t* const dst = wrk->dst;
+  rescaler_t* const irow = wrk->irow;
+  const int x_out_max = wrk->dst_width * wrk->num_channels;
+  const rescaler_t* const frow = wrk->frow;
+  const __m256i mult = _mm256_set1_epi64x(wrk->fy_scale);
+
+  assert(!WebPRescalerOutputDone(wrk));
+  assert(wrk->y_accum <= 0 && wrk->y_sub + wrk->y_accum >= 0);
+  assert(wrk->y_expand);
+  if (wrk->y_accum == 0) {
+    for (x_out = 0; x_out + 16 <= x_out_max; x_out += 16) {
+      __m256i A0, A1, A2, A3;
+      LoadDispatchAndMult_AVX2(frow + x_out, NULL, &A0, &A1, &A2, &A3);
+      ProcessRow_AVX2(&A0, &A1, &A2, &A3, &mult, dst + x_out);
+    }
+    for (; x_out < x_out_max; ++x_out) {
+      const uint32_t J = frow[x_out];
+      const int v = (int)MULT_FIX(J, wrk->fy_scale);
+      assert(v >= 0 && v <= 255);
+      dst[x_out] = v;
+    }
+  } else {
+    const uint32_t B = WEBP_RESCALER_FRAC(-wrk->y_accum, wrk->y_sub);
+    const uint32_t A = (uint32_t)(WEBP_RESCALER_ONE - B);
+    const __m256i mA = _mm256_set1_epi64x(A);
+    const __m256i mB = _mm256_set1_epi64x(B);
+    const __m256i rounder = _mm256_set1_epi64x(ROUNDER);
+    for (x_out = 0; x_out + 16 <= x_out_max; x_out += 16) {
+      __m256i A0, A1, A2, A3, B0, B1, B2, B3;
+      LoadDispatchAndMult_AVX2(frow + x_out, &mA, &A0, &A1, &A2, &A3);
+      LoadDispatchAndMult_AVX2(irow + x_out, &mB, &B0, &B1, &B2, &B3);
+      {
+        const __m256i C0 = _mm256_add_epi64(A0, B0);
+        const __m256i C1 = _mm256_add_epi64(A1, B1);
+        const __m256i C2 = _mm256_add_epi64(A2, B2);
+        const __m256i C3 = _mm256_add_epi64(A3, B3);
+        const __m256i D0 = _mm256_add_epi64(C0, rounder);
+        const __m256i D1 = _mm256_add_epi64(C1, rounder);
+        const __m256i D2 = _mm256_add_epi64(C2, rounder);
+        const __m256i D3 = _mm256_add_epi64(C3, rounder);
+        const __m256i E0 = _mm256_srli_epi64(D0, WEBP_RESCALER_RFIX);
+        const __m256i E1 = _mm256_srli_epi64(D1, WEBP_RESCALER_RFIX);
+        const __m256i E2 = _mm256_srli_epi64(D2, WEBP_RESCALER_RFIX);
+        const __m256i E3 = _mm256_srli_epi64(D3, WEBP_RESCALER_RFIX);
+        ProcessRow_AVX2(&E0, &E1, &E2, &E3, &mult, dst + x_out);
+      }
+    }
+    for (; x_out < x_out_max; ++x_out) {
+      const uint64_t I = (uint64_t)A * frow[x_out]
+                       + (uint64_t)B * irow[x_out];
+      const uint32_t J = (uint32_t)((I + ROUNDER) >> WEBP_RESCALER_RFIX);
+      const int v = (int)MULT_FIX(J, wrk->fy_scale);
+      assert(v >= 0 && v <= 255);
+      dst[x_out] = v;
+    }
+  }
+}
+
+static void RescalerExportRowShrink_AVX2(WebPRescaler* const wrk) {
+  int x_out;
+  uint8_t* const dst = wrk->dst;
+  rescaler_t* const irow = wrk->irow;
+  const int x_out_max = wrk->dst_width * wrk->num_channels;
+  const rescaler_t* const frow = wrk->frow;
+  const uint32_t yscale = wrk->fy_scale * (-wrk->y_accum);
+  assert(!WebPRescalerOutputDone(wrk));
+  assert(wrk->y_accum <= 0);
+  assert(!wrk->y_expand);
+  if (yscale) {
+    const int scale_xy = wrk->fxy_scale;
+    const __m256i mult_xy = _mm256_set1_epi64x((uint32_t)scale_xy);
+    const __m256i mult_y = _mm256_set1_epi64x(yscale);
+    const __m256i rounder = _mm256_set1_epi64x(ROUNDER);
+    for (x_out = 0; x_out + 16 <= x_out_max; x_out += 16) {
+      __m256i A0, A1, A2, A3, B0, B1, B2, B3;
+      LoadDispatchAndMult_AVX2(irow + x_out, NULL, &A0, &A1, &A2, &A3);
+      LoadDispatchAndMult_AVX2(frow + x_out, &mult_y, &B0, &B1, &B2, &B3);
+      {
+        const __m256i C0 = _mm256_add_epi64(B0, rounder);
+        const __m256i C1 = _mm256_add_epi64(B1, rounder);
+        const __m256i C2 = _mm256_add_epi64(B2, rounder);
+        const __m256i C3 = _mm256_add_epi64(B3, rounder);
+        const __m256i D0 = _mm256_srli_epi64(C0, WEBP_RESCALER_RFIX);  // frac
+        const __m256i D1 = _mm256_srli_epi64(C1, WEBP_RESCALER_RFIX);
+        const __m256i D2 = _mm256_srli_epi64(C2, WEBP_RESCALER_RFIX);
+        const __m256i D3 = _mm256_srli_epi64(C3, WEBP_RESCALER_RFIX);
+        const __m256i E0 = _mm256_sub_epi64(A0, D0);   // irow[x] - frac
+        const __m256i E1 = _mm256_sub_epi64(A1, D1);
+        const __m256i E2 = _mm256_sub_epi64(A2, D2);
+        const __m256i E3 = _mm256_sub_epi64(A3, D3);
+        const __m256i F2 = _mm256_slli_epi64(D2, 32);
+        const __m256i F3 = _mm256_slli_epi64(D3, 32);
+        const __m256i G0 = _mm256_or_si256(D0, F2);
+        const __m256i G1 = _mm256_or_si256(D1, F3);
+        _mm256_storeu_si256((__m256i*)(irow + x_out + 0), G0);
+        _mm256_storeu_si256((__m256i*)(irow + x_out + 8), G1);
+        ProcessRow_Floor_AVX2(&E0, &E1, &E2, &E3, &mult_xy, dst + x_out);
+      }
+    }
+    for (; x_out < x_out_max; ++x_out) {
+      const uint32_t frac = (int)MULT_FIX(frow[x_out], yscale);
+      const int v = (int)MULT_FIX_FLOOR(irow[x_out] - frac, wrk->fxy_scale);
+      assert(v >= 0 && v <= 255);
+      dst[x_out] = v;
+      irow[x_out] = frac;   // new fractional start
+    }
+  } else {
+    const uint32_t scale = wrk->fxy_scale;
+    const __m256i mult = _mm256_set1_epi64x(scale);
+    const __m256i zero = _mm256_setzero_si256();
+    for (x_out = 0; x_out + 16 <= x_out_max; x_out += 16) {
+      __m256i A0, A1, A2, A3;
+      LoadDispatchAndMult_AVX2(irow + x_out, NULL, &A0, &A1, &A2, &A3);
+      _mm256_storeu_si256((__m256i*)(irow + x_out + 0), zero);
+      _mm256_storeu_si256((__m256i*)(irow + x_out + 8), zero);
+      ProcessRow_AVX2(&A0, &A1, &A2, &A3, &mult, dst + x_out);
+    }
+    for (; x_out < x_out_max; ++x_out) {
+      const int v = (int)MULT_FIX(irow[x_out], scale);
+      assert(v >= 0 && v <= 255);
+      dst[x_out] = v;
+      irow[x_out] = 0;
+    }
+  }
+}
+
+#undef MULT_FIX_FLOOR
+#undef MULT_FIX
+#undef ROUNDER
+
+//------------------------------------------------------------------------------
+
+extern void WebPRescalerDspInitAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void WebPRescalerDspInitAVX2(void) {
+  WebPRescalerExportRowExpand = RescalerExportRowExpand_AVX2;
+  WebPRescalerExportRowShrink = RescalerExportRowShrink_AVX2;
+}
+
+#else  // !WEBP_USE_AVX2
+
+WEBP_DSP_INIT_STUB(WebPRescalerDspInitAVX2)
+
+#endif  // WEBP_USE_AVX2
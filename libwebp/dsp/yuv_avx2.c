@@ -0,0 +1,200 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// AVX2 YUV->RGB conversion functions, 16 pixels per register. Only the 32b
+// formats are here: the 24b and 16b ones keep their SSE2/SSE41 versions.
+
+#include "./yuv.h"
+
+#if defined(WEBP_USE_AVX2)
+
+#include <immintrin.h>
+
+//-----------------------------------------------------------------------------
+// Convert spans of 32 pixels to various RGB formats for the fancy upsampler.
+
+// Same 14b fixed-point arithmetic as ConvertYUV444ToRGB_SSE2().
+static void ConvertYUV444ToRGB_AVX2(const __m256i* const Y0,
+                                    const __m256i* const U0,
+                                    const __m256i* const V0,
+                                    __m256i* const R,
+                                    __m256i* const G,
+                                    __m256i* const B) {
+  const __m256i k19077 = _mm256_set1_epi16(19077);
+  const __m256i k26149 = _mm256_set1_epi16(26149);
+  const __m256i k14234 = _mm256_set1_epi16(14234);
+  // 33050 doesn't fit in a signed short: only use this with unsigned arithmetic
+  const __m256i k33050 = _mm256_set1_epi16((short)33050);
+  const __m256i k17685 = _mm256_set1_epi16(17685);
+  const __m256i k6419  = _mm256_set1_epi16(6419);
+  const __m256i k13320 = _mm256_set1_epi16(13320);
+  const __m256i k8708  = _mm256_set1_epi16(8708);
+
+  const __m256i Y1 = _mm256_mulhi_epu16(*Y0, k19077);
+
+  const __m256i R0 = _mm256_mulhi_epu16(*V0, k26149);
+  const __m256i R1 = _mm256_sub_epi16(Y1, k14234);
+  const __m256i R2 = _mm256_add_epi16(R1, R0);
+
+  const __m256i G0 = _mm256_mulhi_epu16(*U0, k6419);
+  const __m256i G1 = _mm256_mulhi_epu16(*V0, k13320);
+  const __m256i G2 = _mm256_add_epi16(Y1, k8708);
+  const __m256i G3 = _mm256_add_epi16(G0, G1);
+  const __m256i G4 = _mm256_sub_epi16(G2, G3);
+
+  // be careful with the saturated *unsigned* arithmetic here!
+  const __m256i B0 = _mm256_mulhi_epu16(*U0, k33050);
+  const __m256i B1 = _mm256_adds_epu16(B0, Y1);
+  const __m256i B2 = _mm256_subs_epu16(B1, k17685);
+
+  // use logical shift for B2, which can be larger than 32767
+  *R = _mm256_srai_epi16(R2, 6);   // range: [-14234, 30815]
+  *G = _mm256_srai_epi16(G4, 6);   // range: [-10953, 27710]
+  *B = _mm256_srli_epi16(B2, 6);   // range: [0, 34238]
+}
+
+// Load 16 bytes into the *upper* part of 16b words. That's "<< 8", basically.
+static WEBP_INLINE __m256i Load_HI_16_AVX2(const uint8_t* src) {
+  const __m128i A = _mm_loadu_si128((const __m128i*)src);
+  return _mm256_slli_epi16(_mm256_cvtepu8_epi16(A), 8);
+}
+
+// Load and replicate 8 U/V samples
+static WEBP_INLINE __m256i Load_UV_HI_8_AVX2(const uint8_t* src) {
+  const __m128i A = _mm_loadl_epi64((const __m128i*)src);
+  const __m128i B = _mm_unpacklo_epi8(A, A);   // replicate samples
+  return _mm256_slli_epi16(_mm256_cvtepu8_epi16(B), 8);
+}
+
+// Convert 16 samples of YUV444 to R/G/B
+static void YUV444ToRGB_AVX2(const uint8_t* const y,
+                             const uint8_t* const u,
+                             const uint8_t* const v,
+                             __m256i* const R, __m256i* const G,
+                             __m256i* const B) {
+  const __m256i Y0 = Load_HI_16_AVX2(y), U0 = Load_HI_16_AVX2(u),
+                V0 = Load_HI_16_AVX2(v);
+  ConvertYUV444ToRGB_AVX2(&Y0, &U0, &V0, R, G, B);
+}
+
+// Convert 16 samples of YUV420 to R/G/B
+static void YUV420ToRGB_AVX2(const uint8_t* const y,
+                             const uint8_t* const u,
+                             const uint8_t* const v,
+                             __m256i* const R, __m256i* const G,
+                             __m256i* const B) {
+  const __m256i Y0 = Load_HI_16_AVX2(y), U0 = Load_UV_HI_8_AVX2(u),
+                V0 = Load_UV_HI_8_AVX2(v);
+  ConvertYUV444ToRGB_AVX2(&Y0, &U0, &V0, R, G, B);
+}
+
+// Pack R/G/B/A results into 32b output. The unpacks work within each 128-bit
+// lane, leaving pixels 0-3 and 8-11 in 'lo', 4-7 and 12-15 in 'hi'.
+static WEBP_INLINE void PackAndStore4_AVX2(const __m256i* const R,
+                                           const __m256i* const G,
+                                           const __m256i* const B,
+                                           const __m256i* const A,
+                                           uint8_t* const dst) {
+  const __m256i rb = _mm256_packus_epi16(*R, *B);
+  const __m256i ga = _mm256_packus_epi16(*G, *A);
+  const __m256i rg = _mm256_unpacklo_epi8(rb, ga);
+  const __m256i ba = _mm256_unpackhi_epi8(rb, ga);
+  const __m256i lo = _mm256_unpacklo_epi16(rg, ba);
+  const __m256i hi = _mm256_unpackhi_epi16(rg, ba);
+  _mm256_storeu_si256((__m256i*)(dst +  0),
+                      _mm256_permute2x128_si256(lo, hi, 0x20));
+  _mm256_storeu_si256((__m256i*)(dst + 32),
+                      _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+void VP8YuvToRgba32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                         uint8_t* dst) {
+  const __m256i kAlpha = _mm256_set1_epi16(255);
+  int n;
+  for (n = 0; n < 32; n += 16, dst += 64) {
+    __m256i R, G, B;
+    YUV444ToRGB_AVX2(y + n, u + n, v + n, &R, &G, &B);
+    PackAndStore4_AVX2(&R, &G, &B, &kAlpha, dst);
+  }
+}
+
+void VP8YuvToBgra32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                         uint8_t* dst) {
+  const __m256i kAlpha = _mm256_set1_epi16(255);
+  int n;
+  for (n = 0; n < 32; n += 16, dst += 64) {
+    __m256i R, G, B;
+    YUV444ToRGB_AVX2(y + n, u + n, v + n, &R, &G, &B);
+    PackAndStore4_AVX2(&B, &G, &R, &kAlpha, dst);
+  }
+}
+
+void VP8YuvToArgb32_AVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v,
+                         uint8_t* dst) {
+  const __m256i kAlpha = _mm256_set1_epi16(255);
+  int n;
+  for (n = 0; n < 32; n += 16, dst += 64) {
+    __m256i R, G, B;
+    YUV444ToRGB_AVX2(y + n, u + n, v + n, &R, &G, &B);
+    PackAndStore4_AVX2(&kAlpha, &R, &G, &B, dst);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// Arbitrary-length row conversion functions
+
+// C0..C3 are R, G, B and kAlpha in output byte order.
+#define YUV_TO_32B_ROW(FUNC_NAME, FUNC, C0, C1, C2, C3)                        \
+static void FUNC_NAME(const uint8_t* y,                                        \
+                      const uint8_t* u, const uint8_t* v,                      \
+                      uint8_t* dst, int len) {                                 \
+  const __m256i kAlpha = _mm256_set1_epi16(255);                               \
+  int n;                                                                       \
+  for (n = 0; n + 16 <= len; n += 16, dst += 64) {                             \
+    __m256i R, G, B;                                                           \
+    YUV420ToRGB_AVX2(y, u, v, &R, &G, &B);                                     \
+    PackAndStore4_AVX2(&(C0), &(C1), &(C2), &(C3), dst);                       \
+    y += 16;                                                                   \
+    u += 8;                                                                    \
+    v += 8;                                                                    \
+  }                                                                            \
+  for (; n < len; ++n) {   /* Finish off */                                    \
+    FUNC(y[0], u[0], v[0], dst);                                               \
+    dst += 4;                                                                  \
+    y += 1;                                                                    \
+    u += (n & 1);                                                              \
+    v += (n & 1);                                                              \
+  }                                                                            \
+}
+
+YUV_TO_32B_ROW(YuvToRgbaRow_AVX2, VP8YuvToRgba, R, G, B, kAlpha)
+YUV_TO_32B_ROW(YuvToBgraRow_AVX2, VP8YuvToBgra, B, G, R, kAlpha)
+YUV_TO_32B_ROW(YuvToArgbRow_AVX2, VP8YuvToArgb, kAlpha, R, G, B)
+#undef YUV_TO_32B_ROW
+
+//------------------------------------------------------------------------------
+// Entry point
+
+extern void WebPInitSamplersAVX2(void);
+
+WEBP_TSAN_IGNORE_FUNCTION void WebPInitSamplersAVX2(void) {
+  WebPSamplers[MODE_RGBA] = YuvToRgbaRow_AVX2;
+  WebPSamplers[MODE_BGRA] = YuvToBgraRow_AVX2;
+  WebPSamplers[MODE_ARGB] = YuvToArgbRow_AVX2;
+  // Premultiplication happens after sampling, so these convert the same way.
+  WebPSamplers[MODE_rgbA] = YuvToRgbaRow_AVX2;
+  WebPSamplers[MODE_bgrA] = YuvToBgraRow_AVX2;
+  WebPSamplers[MODE_Argb] = YuvToArgbRow_AVX2;
+}
+
+#else  // !WEBP_USE_AVX2
+
+WEBP_DSP_INIT_STUB(WebPInitSamplersAVX2)
+
+#endif  // WEBP_USE_AVX2
@@ -371,8 +371,13 @@ static int CompressAlphaJob(void* arg1, void* dummy) {
       (config->alpha_filtering == 0) ? WEBP_FILTER_NONE :
       (config->alpha_filtering == 1) ? WEBP_FILTER_FAST :
                                        WEBP_FILTER_BEST;
-  if (!EncodeAlpha(enc, config->alpha_quality, config->alpha_compression,
-                   filter, effort_level, &alpha_data, &alpha_size)) {
+  int ok;
+  WebPStageMark mark;
+  WebPStageBegin(&mark, WEBP_STAGE_ENC_ALPHA);
+  ok = EncodeAlpha(enc, config->alpha_quality, config->alpha_compression,
+                   filter, effort_level, &alpha_data, &alpha_size);
+  WebPStageEnd(&mark);
+  if (!ok) {
     return 0;
   }
   if (alpha_size != (uint32_t)alpha_size) {  // Sanity check.
@@ -63,6 +63,19 @@ void WebPPictureResetBuffers(WebPPicture* const picture) {
   WebPPictureResetBufferYUVA(picture);
 }
 
+// Same as WebPSafeMalloc(), from the allocator of 'picture' if it has one.
+static void* PictureMalloc(const WebPPicture* const picture,
+                           uint64_t nmemb, size_t size) {
+  WebPAllocator* previous = NULL;
+  void* ptr;
+  if (picture->allocator != NULL) {
+    previous = WebPSetThreadAllocator(picture->allocator);
+  }
+  ptr = WebPSafeMalloc(nmemb, size);
+  if (picture->allocator != NULL) WebPSetThreadAllocator(previous);
+  return ptr;
+}
+
 int WebPPictureAllocARGB(WebPPicture* const picture, int width, int height) {
   void* memory;
   const uint64_t argb_size = (uint64_t)width * height;
@@ -76,7 +89,8 @@ int WebPPictureAllocARGB(WebPPicture* const picture, int width, int height) {
     return WebPEncodingSetError(picture, VP8_ENC_ERROR_BAD_DIMENSION);
   }
   // allocate a new buffer.
-  memory = WebPSafeMalloc(argb_size + WEBP_ALIGN_CST, sizeof(*picture->argb));
+  memory = PictureMalloc(picture, argb_size + WEBP_ALIGN_CST,
+                         sizeof(*picture->argb));
   if (memory == NULL) {
     return WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
   }
@@ -122,7 +136,7 @@ int WebPPictureAllocYUVA(WebPPicture* const picture, int width, int height) {
     return WebPEncodingSetError(picture, VP8_ENC_ERROR_BAD_DIMENSION);
   }
   // allocate a new buffer.
-  mem = (uint8_t*)WebPSafeMalloc(total_size, sizeof(*mem));
+  mem = (uint8_t*)PictureMalloc(picture, total_size, sizeof(*mem));
   if (mem == NULL) {
     return WebPEncodingSetError(picture, VP8_ENC_ERROR_OUT_OF_MEMORY);
   }
@@ -325,9 +325,8 @@ int WebPReportProgress(const WebPPicture* const pic,
 }
 //------------------------------------------------------------------------------
 
-int WebPEncode(const WebPConfig* config, WebPPicture* pic) {
+static int Encode(const WebPConfig* const config, WebPPicture* const pic) {
   int ok = 0;
-  if (pic == NULL) return 0;
 
   WebPEncodingSetError(pic, VP8_ENC_OK);  // all ok so far
   if (config == NULL) {  // bad params
@@ -347,13 +346,13 @@ int WebPEncode(const WebPConfig* config, WebPPicture* pic) {
 
   if (!config->lossless) {
     VP8Encoder* enc = NULL;
+    WebPStageMark mark;
 
     if (pic->use_argb || pic->y == NULL || pic->u == NULL || pic->v == NULL) {
       // Make sure we have YUVA samples.
+      WebPStageBegin(&mark, WEBP_STAGE_ENC_CONVERT);
       if (config->use_sharp_yuv || (config->preprocessing & 4)) {
-        if (!WebPPictureSharpARGBToYUVA(pic)) {
-          return 0;
-        }
+        ok = WebPPictureSharpARGBToYUVA(pic);
       } else {
         float dithering = 0.f;
         if (config->preprocessing & 2) {
@@ -363,10 +362,10 @@ int WebPEncode(const WebPConfig* config, WebPPicture* pic) {
           // to 0.5 dithering amplitude at high quality (q->100)
           dithering = 1.0f + (0.5f - 1.0f) * x2 * x2;
         }
-        if (!WebPPictureARGBToYUVADithered(pic, WEBP_YUV420, dithering)) {
-          return 0;
-        }
+        ok = WebPPictureARGBToYUVADithered(pic, WEBP_YUV420, dithering);
       }
+      WebPStageEnd(&mark);
+      if (!ok) return 0;
     }
 
     if (!config->exact) {
@@ -376,35 +375,60 @@ int WebPEncode(const WebPConfig* config, WebPPicture* pic) {
     enc = InitVP8Encoder(config, pic);
     if (enc == NULL) return 0;  // pic->error is already set.
     // Note: each of the tasks below account for 20% in the progress report.
+    WebPStageBegin(&mark, WEBP_STAGE_ENC_ANALYZE);
     ok = VP8EncAnalyze(enc);
+    WebPStageEnd(&mark);
 
     // Analysis is done, proceed to actual coding.
     ok = ok && VP8EncStartAlpha(enc);   // possibly done in parallel
-    if (!enc->use_tokens_) {
-      ok = ok && VP8EncLoop(enc);
-    } else {
-      ok = ok && VP8EncTokenLoop(enc);
+    if (ok) {
+      WebPStageBegin(&mark, WEBP_STAGE_ENC_CODE);
+      ok = !enc->use_tokens_ ? VP8EncLoop(enc) : VP8EncTokenLoop(enc);
+      WebPStageEnd(&mark);
     }
     ok = ok && VP8EncFinishAlpha(enc);
 
-    ok = ok && VP8EncWrite(enc);
+    if (ok) {
+      WebPStageBegin(&mark, WEBP_STAGE_ENC_WRITE);
+      ok = VP8EncWrite(enc);
+      WebPStageEnd(&mark);
+    }
     StoreStats(enc);
     if (!ok) {
       VP8EncFreeBitWriters(enc);
     }
     ok &= DeleteVP8Encoder(enc);  // must always be called, even if !ok
   } else {
+    WebPStageMark mark;
     // Make sure we have ARGB samples.
-    if (pic->argb == NULL && !WebPPictureYUVAToARGB(pic)) {
-      return 0;
+    if (pic->argb == NULL) {
+      WebPStageBegin(&mark, WEBP_STAGE_ENC_CONVERT);
+      ok = WebPPictureYUVAToARGB(pic);
+      WebPStageEnd(&mark);
+      if (!ok) return 0;
     }
 
     if (!config->exact) {
       WebPCleanupTransparentAreaLossless(pic);
     }
 
+    WebPStageBegin(&mark, WEBP_STAGE_ENC_LOSSLESS);
     ok = VP8LEncodeImage(config, pic);  // Sets pic->error in case of problem.
+    WebPStageEnd(&mark);
   }
 
   return ok;
 }
+
+int WebPEncode(const WebPConfig* config, WebPPicture* pic) {
+  WebPAllocator* previous = NULL;
+  int ok;
+  if (pic == NULL) return 0;
+
+  if (pic->allocator != NULL) {
+    previous = WebPSetThreadAllocator(pic->allocator);
+  }
+  ok = Encode(config, pic);
+  if (pic->allocator != NULL) WebPSetThreadAllocator(previous);
+  return ok;
+}
@@ -0,0 +1,70 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Arena allocator for the buffers of one decode.
+
+#include <string.h>
+#include "./arena_utils.h"
+#include "./utils.h"
+
+// Buffers are handed out with the alignment of WEBP_ALIGN().
+#define ARENA_ROUND(SIZE) \
+    (((SIZE) + WEBP_ALIGN_CST) & ~(uint64_t)WEBP_ALIGN_CST)
+
+void WebPArenaInit(WebPArena* const arena) {
+  assert(arena != NULL);
+  memset(arena, 0, sizeof(*arena));
+}
+
+void WebPArenaReset(WebPArena* const arena) {
+  assert(arena != NULL);
+  if (arena->demand_ > arena->size_) {
+    // One spare alignment step, as the block itself may not be aligned.
+    const uint64_t size = arena->demand_ + WEBP_ALIGN_CST;
+    WebPSafeFree(arena->mem_);
+    arena->size_ = 0;
+    arena->mem_ = (uint8_t*)WebPSafeMalloc(size, sizeof(*arena->mem_));
+    if (arena->mem_ != NULL) arena->size_ = (size_t)size;
+  }
+  arena->used_ = 0;
+  arena->demand_ = 0;
+}
+
+void WebPArenaClear(WebPArena* const arena) {
+  assert(arena != NULL);
+  WebPSafeFree(arena->mem_);
+  WebPArenaInit(arena);
+}
+
+void* WebPArenaMalloc(WebPArena* const arena, uint64_t nmemb, size_t size) {
+  const uint64_t total_size = nmemb * size;
+  if (arena != NULL && nmemb > 0 && size > 0 &&
+      nmemb <= WEBP_MAX_ALLOCABLE_MEMORY / size) {
+    arena->demand_ += ARENA_ROUND(total_size);
+    if (arena->mem_ != NULL) {
+      const size_t offset =
+          (size_t)(WEBP_ALIGN(arena->mem_ + arena->used_) -
+                   (uintptr_t)arena->mem_);
+      if (offset <= arena->size_ && total_size <= arena->size_ - offset) {
+        arena->used_ = offset + (size_t)total_size;
+        return arena->mem_ + offset;
+      }
+    }
+  }
+  return WebPSafeMalloc(nmemb, size);
+}
+
+void WebPArenaFree(WebPArena* const arena, void* const ptr) {
+  if (arena != NULL && arena->mem_ != NULL) {
+    const uintptr_t p = (uintptr_t)ptr;
+    const uintptr_t start = (uintptr_t)arena->mem_;
+    if (p >= start && p < start + arena->size_) return;
+  }
+  WebPSafeFree(ptr);
+}
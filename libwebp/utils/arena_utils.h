@@ -0,0 +1,56 @@
+// Copyright 2026 Google Inc. All Rights Reserved.
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the COPYING file in the root of the source
+// tree. An additional intellectual property rights grant can be found
+// in the file PATENTS. All contributing project authors may
+// be found in the AUTHORS file in the root of the source tree.
+// -----------------------------------------------------------------------------
+//
+// Arena allocator for the buffers of one decode.
+//
+// Buffers are carved out of a single block and only reclaimed all at once by
+// WebPArenaReset(). When the block runs out, allocations fall back to
+// WebPSafeMalloc(), and the next reset grows the block to what was asked for
+// in total, so that a run of similar decodes settles on one allocation.
+
+#ifndef WEBP_UTILS_ARENA_UTILS_H_
+#define WEBP_UTILS_ARENA_UTILS_H_
+
+#include <stddef.h>
+#include "../webp/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  uint8_t* mem_;       // the block
+  size_t size_;        // its size
+  size_t used_;        // bytes of the block handed out since the last reset
+  uint64_t demand_;    // bytes asked for since the last reset, block or not
+} WebPArena;
+
+// Initializes an empty arena.
+void WebPArenaInit(WebPArena* const arena);
+
+// Makes the whole block available again, first growing it to the demand since
+// the previous reset. None of the buffers handed out before may be in use.
+void WebPArenaReset(WebPArena* const arena);
+
+// Releases the block.
+void WebPArenaClear(WebPArena* const arena);
+
+// Same as WebPSafeMalloc(), from the block of 'arena' if there is room.
+// 'arena' can be NULL, in which case WebPSafeMalloc() is called.
+void* WebPArenaMalloc(WebPArena* const arena, uint64_t nmemb, size_t size);
+
+// Same as WebPSafeFree() for the buffers not taken from the block of 'arena';
+// the others are only reclaimed by WebPArenaReset(). 'arena' can be NULL.
+void WebPArenaFree(WebPArena* const arena, void* const ptr);
+
+#ifdef __cplusplus
+}    // extern "C"
+#endif
+
+#endif  // WEBP_UTILS_ARENA_UTILS_H_
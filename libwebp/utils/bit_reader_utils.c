@@ -40,6 +40,8 @@ void VP8InitBitReader(VP8BitReader* const br,
   br->value_   = 0;
   br->bits_    = -8;   // to load the very first 8bits
   br->eof_     = 0;
+  br->seg_     = NULL;
+  br->end_     = 0;
   VP8BitReaderSetBuffer(br, start, size);
   VP8LoadNewBytes(br);
 }
@@ -52,6 +54,41 @@ void VP8RemapBitReader(VP8BitReader* const br, ptrdiff_t offset) {
   }
 }
 
+// Reads the part of 'seg' from input position 'pos' on, up to br->end_.
+static void SetSegment(VP8BitReader* const br, const VP8Segment* const seg,
+                       size_t pos) {
+  const size_t seg_end = seg->offset_ + seg->size_;
+  const size_t end = (seg_end < br->end_) ? seg_end : br->end_;
+  assert(pos >= seg->offset_ && pos <= end);
+  br->seg_ = seg;
+  VP8BitReaderSetBuffer(br, seg->data_ + (pos - seg->offset_), end - pos);
+}
+
+void VP8BitReaderSetSegments(VP8BitReader* const br, const VP8Segment* seg,
+                             size_t pos, size_t end) {
+  assert(br != NULL && seg != NULL);
+  assert(pos <= end);
+  while (pos >= seg->offset_ + seg->size_ && seg->next_ != NULL) {
+    seg = seg->next_;
+  }
+  br->end_ = end;
+  SetSegment(br, seg, pos);
+}
+
+// Moves to the next segment once the current one is exhausted. Returns false
+// if the input isn't segmented, or if it has no more data to read so far.
+static int NextSegment(VP8BitReader* const br) {
+  const VP8Segment* const seg = br->seg_;
+  if (seg != NULL && seg->next_ != NULL) {
+    const size_t pos = seg->offset_ + seg->size_;
+    if (pos < br->end_) {
+      SetSegment(br, seg->next_, pos);
+      return 1;
+    }
+  }
+  return 0;
+}
+
 const uint8_t kVP8Log2Range[128] = {
      7, 6, 6, 5, 5, 5, 5, 4, 4, 4, 4, 4, 4, 4, 4,
   3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
@@ -87,7 +124,7 @@ const uint8_t kVP8NewRange[128] = {
 void VP8LoadFinalBytes(VP8BitReader* const br) {
   assert(br != NULL && br->buf_ != NULL);
   // Only read 8bits at a time
-  if (br->buf_ < br->buf_end_) {
+  if (br->buf_ < br->buf_end_ || NextSegment(br)) {
     br->bits_ += 8;
     br->value_ = (bit_t)(*br->buf_++) | (br->value_ << 8);
   } else if (!br->eof_) {
@@ -148,6 +185,7 @@ void VP8LInitBitReader(VP8LBitReader* const br, const uint8_t* const start,
   br->val_ = 0;
   br->bit_pos_ = 0;
   br->eos_ = 0;
+  br->seg_ = NULL;
 
   if (length > sizeof(br->val_)) {
     length = sizeof(br->val_);
@@ -176,9 +214,23 @@ static void VP8LSetEndOfStream(VP8LBitReader* const br) {
   br->bit_pos_ = 0;  // To avoid undefined behaviour with shifts.
 }
 
+// Moves to the next segment once the current one is exhausted. Returns false
+// if the input isn't segmented, or if it has no more data so far.
+static int NextLosslessSegment(VP8LBitReader* const br) {
+  if (br->seg_ != NULL && br->seg_->next_ != NULL) {
+    br->seg_ = br->seg_->next_;
+    br->buf_ = br->seg_->data_;
+    br->len_ = br->seg_->size_;
+    br->pos_ = 0;
+    return 1;
+  }
+  return 0;
+}
+
 // If not at EOS, reload up to VP8L_LBITS byte-by-byte
 static void ShiftBytes(VP8LBitReader* const br) {
-  while (br->bit_pos_ >= 8 && br->pos_ < br->len_) {
+  while (br->bit_pos_ >= 8 &&
+         (br->pos_ < br->len_ || NextLosslessSegment(br))) {
     br->val_ >>= 8;
     br->val_ |= ((vp8l_val_t)br->buf_[br->pos_]) << (VP8L_LBITS - 8);
     ++br->pos_;
@@ -189,6 +241,24 @@ static void ShiftBytes(VP8LBitReader* const br) {
   }
 }
 
+void VP8LInitBitReaderSegments(VP8LBitReader* const br, const VP8Segment* seg,
+                               size_t pos) {
+  assert(br != NULL && seg != NULL);
+  assert(pos >= seg->offset_);
+  while (pos >= seg->offset_ + seg->size_ && seg->next_ != NULL) {
+    seg = seg->next_;
+  }
+  assert(pos <= seg->offset_ + seg->size_);
+  br->seg_ = seg;
+  br->buf_ = seg->data_;
+  br->len_ = seg->size_;
+  br->pos_ = pos - seg->offset_;
+  br->val_ = 0;
+  br->bit_pos_ = VP8L_LBITS;   // empty: the bytes are shifted in from the top
+  br->eos_ = 0;
+  ShiftBytes(br);
+}
+
 void VP8LDoFillBitWindow(VP8LBitReader* const br) {
   assert(br->bit_pos_ >= VP8L_WBITS);
 #if defined(VP8L_USE_FAST_LOAD)
@@ -64,6 +64,20 @@ typedef uint32_t bit_t;
 
 typedef uint32_t range_t;
 
+//------------------------------------------------------------------------------
+// Segmented input
+
+// A piece of the input, in a chain of buffers that aren't contiguous. The
+// bit-readers set up on a chain read across its segments, including those
+// linked after the reading started.
+typedef struct VP8Segment VP8Segment;
+struct VP8Segment {
+  const uint8_t* data_;
+  size_t size_;               // never 0
+  size_t offset_;             // position of data_[0] in the whole input
+  VP8Segment* next_;          // NULL until more input arrives
+};
+
 //------------------------------------------------------------------------------
 // Bitreader
 
@@ -78,6 +92,9 @@ struct VP8BitReader {
   const uint8_t* buf_end_;    // end of read buffer
   const uint8_t* buf_max_;    // max packed-read position on buffer
   int eof_;                   // true if input is exhausted
+  // segmented input
+  const VP8Segment* seg_;     // segment holding buf_, or NULL
+  size_t end_;                // input position where the reading must stop
 };
 
 // Initialize the bit reader and the boolean decoder.
@@ -91,6 +108,12 @@ void VP8BitReaderSetBuffer(VP8BitReader* const br,
 // relative offset 'offset'.
 void VP8RemapBitReader(VP8BitReader* const br, ptrdiff_t offset);
 
+// Makes the reader go on from input position 'pos' up to position 'end'
+// (excluded), reading from the chain 'seg' is part of. The decoder state is
+// kept. 'seg' must not start after 'pos'.
+void VP8BitReaderSetSegments(VP8BitReader* const br, const VP8Segment* seg,
+                             size_t pos, size_t end);
+
 // return the next value made of 'num_bits' bits
 uint32_t VP8GetValue(VP8BitReader* const br, int num_bits);
 static WEBP_INLINE uint32_t VP8Get(VP8BitReader* const br) {
@@ -125,12 +148,18 @@ typedef struct {
   size_t         pos_;        // byte position in buf_
   int            bit_pos_;    // current bit-reading position in val_
   int            eos_;        // true if a bit was read past the end of buffer
+  const VP8Segment* seg_;     // segment holding buf_, or NULL
 } VP8LBitReader;
 
 void VP8LInitBitReader(VP8LBitReader* const br,
                        const uint8_t* const start,
                        size_t length);
 
+// Initializes the reader to read from input position 'pos' to the end of
+// the chain 'seg' is part of. 'seg' must not start after 'pos'.
+void VP8LInitBitReaderSegments(VP8LBitReader* const br, const VP8Segment* seg,
+                               size_t pos);
+
 //  Sets a new data buffer.
 void VP8LBitReaderSetBuffer(VP8LBitReader* const br,
                             const uint8_t* const buffer, size_t length);
@@ -18,6 +18,7 @@
 
 #include <string.h>   // for memset
 
+#include "./thread_utils.h"
 #include "./utils.h"
 
 // #define USE_DITHERING   // uncomment to enable ordered dithering (not vital)
@@ -25,6 +26,8 @@
 #define FIX 16     // fix-point precision for averaging
 #define LFIX 2     // extra precision for look-up table
 #define LUT_SIZE ((1 << (8 + LFIX)) - 1)  // look-up table size
+#define MIN_STRIP_ROWS 64    // smallest strip worth a thread of its own
+#define MAX_STRIPS 16
 
 #if defined(USE_DITHERING)
 
@@ -212,6 +215,23 @@ static void CountLevels(SmoothParams* const p) {
   }
 }
 
+// Point the scratch buffers of 'p' at 'mem', which must hold
+// (R + 1) rows of accumulators followed by one row of averages.
+static uint8_t* SetupScratch(SmoothParams* const p, uint8_t* mem) {
+  const int R = 2 * p->radius_ + 1;
+  const int width = p->width_;
+  p->mem_ = (void*)mem;
+  p->start_ = (uint16_t*)mem;
+  p->cur_ = p->start_;
+  p->end_ = p->start_ + R * width;
+  p->top_ = p->end_ - width;
+  memset(p->top_, 0, width * sizeof(*p->top_));
+  mem += (R + 1) * width * sizeof(*p->start_);
+  p->average_ = (uint16_t*)mem;
+  mem += width * sizeof(*p->average_);
+  return mem;
+}
+
 // Initialize all params.
 static int InitParams(uint8_t* const data, int width, int height, int stride,
                       int radius, SmoothParams* const p) {
@@ -224,17 +244,6 @@ static int InitParams(uint8_t* const data, int width, int height, int stride,
   uint8_t* mem = (uint8_t*)WebPSafeMalloc(1U, total_size);
 
   if (mem == NULL) return 0;
-  p->mem_ = (void*)mem;
-
-  p->start_ = (uint16_t*)mem;
-  p->cur_ = p->start_;
-  p->end_ = p->start_ + R * width;
-  p->top_ = p->end_ - width;
-  memset(p->top_, 0, width * sizeof(*p->top_));
-  mem += size_scratch_m;
-
-  p->average_ = (uint16_t*)mem;
-  mem += size_m;
 
   p->width_ = width;
   p->height_ = height;
@@ -244,6 +253,7 @@ static int InitParams(uint8_t* const data, int width, int height, int stride,
   p->radius_ = radius;
   p->scale_ = (1 << (FIX + LFIX)) / (R * R);  // normalization constant
   p->row_ = -radius;
+  mem = SetupScratch(p, mem);
 
   // analyze the input distribution so we can best-fit the threshold
   CountLevels(p);
@@ -255,12 +265,112 @@ static int InitParams(uint8_t* const data, int width, int height, int stride,
   return 1;
 }
 
+// Set up 'p' to smooth a strip of the plane of 'base', reading the input
+// from 'src'. The levels and the correction table are shared with 'base'.
+static int InitStripParams(const SmoothParams* const base, uint8_t* const src,
+                           SmoothParams* const p) {
+  const int R = 2 * base->radius_ + 1;
+  const size_t size_scratch_m = (R + 1) * base->width_ * sizeof(*p->start_);
+  const size_t size_m = base->width_ * sizeof(*p->average_);
+  uint8_t* const mem = (uint8_t*)WebPSafeMalloc(1U, size_scratch_m + size_m);
+  if (mem == NULL) return 0;
+  *p = *base;
+  SetupScratch(p, mem);
+  p->src_ = src;
+  return 1;
+}
+
 static void CleanupParams(SmoothParams* const p) {
   WebPSafeFree(p->mem_);
 }
 
+// Smooth the output rows [y_start, y_end). The filter is primed with the
+// 'radius_' input rows above 'y_start', so these must still be unfiltered in
+// 'src_'.
+static void SmoothRows(SmoothParams* const p, int y_start, int y_end) {
+  p->row_ = y_start - p->radius_;
+  if (p->row_ > 0) p->src_ += p->row_ * p->stride_;
+  p->dst_ += y_start * p->stride_;
+  for (; p->row_ < y_end + p->radius_; ++p->row_) {
+    VFilter(p);  // accumulate average of input
+    // Need to wait few rows in order to prime the filter,
+    // before emitting some output.
+    if (p->row_ >= y_start + p->radius_) {
+      HFilter(p);
+      ApplyFilter(p);
+    }
+  }
+}
+
+typedef struct {
+  SmoothParams p_;
+  int y_start_, y_end_;
+} SmoothStrip;
+
+static int SmoothStripHook(void* arg1, void* arg2) {
+  SmoothStrip* const strip = (SmoothStrip*)arg1;
+  (void)arg2;
+  SmoothRows(&strip->p_, strip->y_start_, strip->y_end_);
+  return 1;
+}
+
+// Smooth the rows [0, num_rows) of 'base' in 'num_strips' strips, one per
+// thread. The strips read their input from a copy of the plane, since their
+// neighbours overwrite the rows they are primed with. Returns false, before
+// touching the plane, if memory or threads are missing.
+static int SmoothStrips(const SmoothParams* const base, int num_rows,
+                        int num_strips) {
+  const WebPWorkerInterface* const worker_interface = WebPGetWorkerInterface();
+  const size_t src_size =
+      (size_t)base->stride_ * (base->height_ - 1) + base->width_;
+  uint8_t* const src = (uint8_t*)WebPSafeMalloc(1U, src_size);
+  SmoothStrip strips[MAX_STRIPS];
+  WebPWorker workers[MAX_STRIPS - 1];
+  int num_ready = 0;   // strips with their scratch and worker set up
+  int ok = (src != NULL);
+  int i;
+
+  assert(num_strips > 1 && num_strips <= MAX_STRIPS);
+  for (i = 0; i < num_strips - 1; ++i) worker_interface->Init(&workers[i]);
+  for (; ok && num_ready < num_strips; ++num_ready) {
+    SmoothStrip* const strip = &strips[num_ready];
+    if (!InitStripParams(base, src, &strip->p_)) {
+      ok = 0;
+      break;
+    }
+    strip->y_start_ = num_rows * num_ready / num_strips;
+    strip->y_end_ = num_rows * (num_ready + 1) / num_strips;
+    if (num_ready < num_strips - 1) {
+      WebPWorker* const worker = &workers[num_ready];
+      if (!worker_interface->Reset(worker)) {
+        CleanupParams(&strip->p_);
+        ok = 0;
+        break;
+      }
+      worker->hook = SmoothStripHook;
+      worker->data1 = strip;
+      worker->data2 = NULL;
+    }
+  }
+  if (ok) {
+    memcpy(src, base->dst_, src_size);
+    for (i = 0; i < num_strips - 1; ++i) worker_interface->Launch(&workers[i]);
+    SmoothStripHook(&strips[num_strips - 1], NULL);
+    for (i = 0; i < num_strips - 1; ++i) worker_interface->Sync(&workers[i]);
+  }
+  for (i = 0; i < num_strips - 1; ++i) worker_interface->End(&workers[i]);
+  for (i = 0; i < num_ready; ++i) CleanupParams(&strips[i].p_);
+  WebPSafeFree(src);
+  return ok;
+}
+
 int WebPDequantizeLevels(uint8_t* const data, int width, int height, int stride,
                          int strength) {
+  return WebPDequantizeLevelsMT(data, width, height, stride, strength, 1);
+}
+
+int WebPDequantizeLevelsMT(uint8_t* const data, int width, int height,
+                           int stride, int strength, int num_threads) {
   int radius = 4 * strength / 100;
 
   if (strength < 0 || strength > 100) return 0;
@@ -275,14 +385,13 @@ int WebPDequantizeLevels(uint8_t* const data, int width, int height, int stride,
     memset(&p, 0, sizeof(p));
     if (!InitParams(data, width, height, stride, radius, &p)) return 0;
     if (p.num_levels_ > 2) {
-      for (; p.row_ < p.height_; ++p.row_) {
-        VFilter(&p);  // accumulate average of input
-        // Need to wait few rows in order to prime the filter,
-        // before emitting some output.
-        if (p.row_ >= p.radius_) {
-          HFilter(&p);
-          ApplyFilter(&p);
-        }
+      // The last 'radius' rows are left as they are.
+      const int num_rows = p.height_ - p.radius_;
+      int num_strips = num_rows / MIN_STRIP_ROWS;
+      if (num_strips > num_threads) num_strips = num_threads;
+      if (num_strips > MAX_STRIPS) num_strips = MAX_STRIPS;
+      if (num_strips < 2 || !SmoothStrips(&p, num_rows, num_strips)) {
+        SmoothRows(&p, 0, num_rows);
       }
     }
     CleanupParams(&p);
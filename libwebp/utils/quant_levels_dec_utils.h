@@ -28,6 +28,11 @@ extern "C" {
 int WebPDequantizeLevels(uint8_t* const data, int width, int height, int stride,
                          int strength);
 
+// Same as WebPDequantizeLevels(), with the rows cut into strips smoothed on up
+// to 'num_threads' threads. The output doesn't depend on 'num_threads'.
+int WebPDequantizeLevelsMT(uint8_t* const data, int width, int height,
+                           int stride, int strength, int num_threads);
+
 #ifdef __cplusplus
 }    // extern "C"
 #endif
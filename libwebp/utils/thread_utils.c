@@ -211,7 +211,13 @@ static THREADFN ThreadLoop(void* ptr) {
       pthread_cond_wait(&impl->condition_, &impl->mutex_);
     }
     if (worker->status_ == WORK) {
+      WebPAllocator* const previous =
+          WebPSetThreadAllocator(worker->allocator_);
+      WebPProfile* const previous_profile =
+          WebPSetThreadProfile(worker->profile_);
       WebPGetWorkerInterface()->Execute(worker);
+      WebPSetThreadProfile(previous_profile);
+      WebPSetThreadAllocator(previous);
       worker->status_ = OK;
     } else if (worker->status_ == NOT_OK) {   // finish the worker
       done = 1;
@@ -311,6 +317,8 @@ static void Execute(WebPWorker* const worker) {
 
 static void Launch(WebPWorker* const worker) {
 #ifdef WEBP_USE_THREAD
+  worker->allocator_ = WebPGetThreadAllocator();
+  worker->profile_ = WebPGetThreadProfile();
   ChangeState(worker, WORK);
 #else
   Execute(worker);
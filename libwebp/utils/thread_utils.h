@@ -43,6 +43,8 @@ typedef struct {
   void* data1;            // first argument passed to 'hook'
   void* data2;            // second argument passed to 'hook'
   int had_error;          // return value of the last call to 'hook'
+  WebPAllocator* allocator_;  // allocator of the thread that called Launch()
+  WebPProfile* profile_;      // profile of the thread that called Launch()
 } WebPWorker;
 
 // The interface for all thread-worker related functions. All these functions
@@ -59,6 +61,10 @@ typedef struct {
   // Triggers the thread to call hook() with data1 and data2 arguments. These
   // hook/data1/data2 values can be changed at any time before calling this
   // function, but not be changed afterward until the next call to Sync().
+  // Implementations should record WebPGetThreadAllocator() in allocator_ and
+  // set it with WebPSetThreadAllocator() while hook() runs on another thread,
+  // so that the memory it allocates is accounted to the launching thread.
+  // The same goes for WebPGetThreadProfile() and profile_.
   void (*Launch)(WebPWorker* const worker);
   // This function is similar to Launch() except that it calls the
   // hook directly instead of using a thread. Convenient to bypass the thread
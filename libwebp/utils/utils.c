@@ -188,12 +188,283 @@ static int CheckSizeArgumentsOverflow(uint64_t nmemb, size_t size) {
   return 1;
 }
 
+//------------------------------------------------------------------------------
+// Allocators
+
+#if defined(WEBP_USE_THREAD) && defined(_WIN32)
+#include <windows.h>
+#define THREAD_LOCAL __declspec(thread)
+#define ATOMIC_LOAD(p) \
+    ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(p), 0, 0))
+#define ATOMIC_ADD(p, v) \
+    ((uint64_t)InterlockedExchangeAdd64((volatile LONG64*)(p), \
+                                        (LONG64)(v)) + (uint64_t)(v))
+#define ATOMIC_CAS(p, expected, desired) \
+    (InterlockedCompareExchange64((volatile LONG64*)(p), (LONG64)(desired), \
+                                  (LONG64)(expected)) == (LONG64)(expected))
+#elif defined(WEBP_USE_THREAD) && defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#define ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define ATOMIC_ADD(p, v) \
+    __atomic_add_fetch((p), (uint64_t)(v), __ATOMIC_RELAXED)
+#define ATOMIC_CAS(p, expected, desired) \
+    __sync_bool_compare_and_swap((p), (expected), (desired))
+#else
+#define THREAD_LOCAL
+#define ATOMIC_LOAD(p) (*(p))
+#define ATOMIC_ADD(p, v) (*(p) += (uint64_t)(v))
+#define ATOMIC_CAS(p, expected, desired) (*(p) = (desired), 1)
+#endif
+
+// Blocks of the built-in allocator are plain malloc() memory, so that callers
+// can keep releasing decoder outputs with free(). Blocks of other allocators
+// start with the allocator they came from and the size asked for, padded to
+// 16 bytes so that they keep malloc()'s alignment.
+typedef struct {
+  WebPAllocator* allocator_;
+  size_t size_;
+} BlockHeader;
+#define BLOCK_HEADER_SIZE 16
+
+static WebPAllocator builtin_allocator;   // malloc() and free(), no limit
+static WebPAllocator* default_allocator = &builtin_allocator;
+static THREAD_LOCAL WebPAllocator* thread_allocator = NULL;
+
+void WebPInitAllocator(WebPAllocator* allocator) {
+  if (allocator != NULL) memset(allocator, 0, sizeof(*allocator));
+}
+
+WebPAllocator* WebPSetThreadAllocator(WebPAllocator* allocator) {
+  WebPAllocator* const previous = thread_allocator;
+  thread_allocator = allocator;
+  return previous;
+}
+
+WebPAllocator* WebPGetThreadAllocator(void) {
+  return thread_allocator;
+}
+
+void WebPSetDefaultAllocator(WebPAllocator* allocator) {
+  default_allocator = (allocator != NULL) ? allocator : &builtin_allocator;
+}
+
+WebPAllocator* WebPGetDefaultAllocator(void) {
+  return default_allocator;
+}
+
+// Blocks with a header are recorded by the address returned to the caller, so
+// that a free can tell them from plain ones without reading before the latter.
+// The addresses are spread over hash sets by their hash, each behind a lock of
+// its own, and the sets are only searched while some block is recorded. A set
+// frees its table when it empties.
+#if defined(WEBP_USE_THREAD) && defined(_WIN32)
+typedef SRWLOCK RegistryLock;
+#define REGISTRY_LOCK_INIT SRWLOCK_INIT
+#define LockShard(s) AcquireSRWLockExclusive(&(s)->lock_)
+#define UnlockShard(s) ReleaseSRWLockExclusive(&(s)->lock_)
+#elif defined(WEBP_USE_THREAD)
+#include <pthread.h>
+typedef pthread_mutex_t RegistryLock;
+#define REGISTRY_LOCK_INIT PTHREAD_MUTEX_INITIALIZER
+#define LockShard(s) (void)pthread_mutex_lock(&(s)->lock_)
+#define UnlockShard(s) (void)pthread_mutex_unlock(&(s)->lock_)
+#else
+typedef int RegistryLock;
+#define REGISTRY_LOCK_INIT 0
+#define LockShard(s) (void)(s)
+#define UnlockShard(s) (void)(s)
+#endif
+
+typedef struct {
+  RegistryLock lock_;
+  void** table_;      // open addressing, NULL marks a free slot
+  size_t size_;       // power of 2, or 0 without a table
+  size_t used_;       // live and deleted slots
+  size_t num_live_;
+} RegistryShard;
+
+#define NUM_REGISTRY_SHARDS 16   // power of 2
+#define SHARD_INIT { REGISTRY_LOCK_INIT, NULL, 0, 0, 0 }
+static RegistryShard registry[NUM_REGISTRY_SHARDS] = {
+  SHARD_INIT, SHARD_INIT, SHARD_INIT, SHARD_INIT,
+  SHARD_INIT, SHARD_INIT, SHARD_INIT, SHARD_INIT,
+  SHARD_INIT, SHARD_INIT, SHARD_INIT, SHARD_INIT,
+  SHARD_INIT, SHARD_INIT, SHARD_INIT, SHARD_INIT,
+};
+static uint64_t num_headed_blocks = 0;
+static char registry_deleted;
+#define REGISTRY_DELETED ((void*)&registry_deleted)
+
+static uint64_t RegistryHash(const void* const ptr) {
+  return ((uint64_t)(uintptr_t)ptr >> 4) * 0x9e3779b97f4a7c15ull;
+}
+
+// The top bits of the hash pick the shard, and the middle ones the slot.
+static RegistryShard* ShardOf(const void* const ptr) {
+  return &registry[(RegistryHash(ptr) >> 60) & (NUM_REGISTRY_SHARDS - 1)];
+}
+
+static size_t RegistrySlot(const void* const ptr, size_t size) {
+  return (size_t)(RegistryHash(ptr) >> 32) & (size - 1);
+}
+
+// Rebuilds the set without its deleted slots, with room to grow.
+static int GrowShard(RegistryShard* const shard) {
+  size_t new_size = 64;
+  void** table;
+  size_t i;
+  while (new_size < 4 * (shard->num_live_ + 1)) new_size *= 2;
+  table = (void**)calloc(new_size, sizeof(*table));
+  if (table == NULL) return 0;
+  for (i = 0; i < shard->size_; ++i) {
+    void* const ptr = shard->table_[i];
+    if (ptr != NULL && ptr != REGISTRY_DELETED) {
+      size_t slot = RegistrySlot(ptr, new_size);
+      while (table[slot] != NULL) slot = (slot + 1) & (new_size - 1);
+      table[slot] = ptr;
+    }
+  }
+  free(shard->table_);
+  shard->table_ = table;
+  shard->size_ = new_size;
+  shard->used_ = shard->num_live_;
+  return 1;
+}
+
+// Both must be called with the shard locked.
+static int AddToShard(RegistryShard* const shard, void* const ptr) {
+  size_t slot;
+  if (4 * (shard->used_ + 1) > 3 * shard->size_ && !GrowShard(shard)) {
+    return 0;
+  }
+  slot = RegistrySlot(ptr, shard->size_);
+  while (shard->table_[slot] != NULL &&
+         shard->table_[slot] != REGISTRY_DELETED) {
+    slot = (slot + 1) & (shard->size_ - 1);
+  }
+  if (shard->table_[slot] == NULL) ++shard->used_;
+  shard->table_[slot] = ptr;
+  ++shard->num_live_;
+  ATOMIC_ADD(&num_headed_blocks, 1);
+  return 1;
+}
+
+static int RemoveFromShard(RegistryShard* const shard, void* const ptr) {
+  size_t slot;
+  if (shard->num_live_ == 0) return 0;
+  slot = RegistrySlot(ptr, shard->size_);
+  while (shard->table_[slot] != NULL) {
+    if (shard->table_[slot] == ptr) {
+      shard->table_[slot] = REGISTRY_DELETED;
+      ATOMIC_ADD(&num_headed_blocks, 0 - (uint64_t)1);
+      if (--shard->num_live_ == 0) {
+        free(shard->table_);
+        shard->table_ = NULL;
+        shard->size_ = 0;
+        shard->used_ = 0;
+      }
+      return 1;
+    }
+    slot = (slot + 1) & (shard->size_ - 1);
+  }
+  return 0;
+}
+
+// Accounts for 'size' more bytes, unless that would exceed the limit.
+static int Reserve(WebPAllocator* const allocator, size_t size) {
+  WebPMemoryStats* const stats = &allocator->stats;
+  const uint64_t current = ATOMIC_ADD(&stats->current_bytes, size);
+  uint64_t peak;
+  if (allocator->limit > 0 && current > allocator->limit) {
+    ATOMIC_ADD(&stats->current_bytes, 0 - (uint64_t)size);
+    return 0;
+  }
+  peak = ATOMIC_LOAD(&stats->peak_bytes);
+  while (current > peak && !ATOMIC_CAS(&stats->peak_bytes, peak, current)) {
+    peak = ATOMIC_LOAD(&stats->peak_bytes);
+  }
+  return 1;
+}
+
+static void Unreserve(WebPAllocator* const allocator, size_t size) {
+  ATOMIC_ADD(&allocator->stats.current_bytes, 0 - (uint64_t)size);
+}
+
+static void FreeBlock(WebPAllocator* const allocator, void* const block) {
+  if (allocator->free_func != NULL) {
+    allocator->free_func(block, allocator->opaque);
+  } else {
+    free(block);
+  }
+}
+
+static void* Allocate(size_t size, int zero) {
+  WebPAllocator* const allocator =
+      (thread_allocator != NULL) ? thread_allocator : default_allocator;
+  const size_t block_size = BLOCK_HEADER_SIZE + size;
+  BlockHeader* block = NULL;
+  RegistryShard* shard;
+  uint8_t* ptr;
+  int ok;
+  assert(sizeof(BlockHeader) <= BLOCK_HEADER_SIZE);
+  if (allocator == &builtin_allocator) {
+    return zero ? calloc(1, size) : malloc(size);
+  }
+  if (Reserve(allocator, size)) {
+    if (allocator->malloc_func != NULL) {
+      block = (BlockHeader*)allocator->malloc_func(block_size,
+                                                   allocator->opaque);
+      if (block != NULL && zero) memset(block, 0, block_size);
+    } else {
+      block = (BlockHeader*)(zero ? calloc(1, block_size) : malloc(block_size));
+    }
+    if (block == NULL) Unreserve(allocator, size);
+  }
+  if (block == NULL) {
+    ATOMIC_ADD(&allocator->stats.num_failures, 1);
+    return NULL;
+  }
+  ptr = (uint8_t*)block + BLOCK_HEADER_SIZE;
+  shard = ShardOf(ptr);
+  LockShard(shard);
+  ok = AddToShard(shard, ptr);
+  UnlockShard(shard);
+  if (!ok) {
+    FreeBlock(allocator, block);
+    Unreserve(allocator, size);
+    ATOMIC_ADD(&allocator->stats.num_failures, 1);
+    return NULL;
+  }
+  ATOMIC_ADD(&allocator->stats.num_allocs, 1);
+  block->allocator_ = allocator;
+  block->size_ = size;
+  return ptr;
+}
+
+static void Release(void* const ptr) {
+  BlockHeader* block;
+  int headed = 0;
+  if (ATOMIC_LOAD(&num_headed_blocks) > 0) {
+    RegistryShard* const shard = ShardOf(ptr);
+    LockShard(shard);
+    headed = RemoveFromShard(shard, ptr);
+    UnlockShard(shard);
+  }
+  if (!headed) {
+    free(ptr);
+    return;
+  }
+  block = (BlockHeader*)((uint8_t*)ptr - BLOCK_HEADER_SIZE);
+  Unreserve(block->allocator_, block->size_);
+  FreeBlock(block->allocator_, block);
+}
+
 void* WebPSafeMalloc(uint64_t nmemb, size_t size) {
   void* ptr;
   Increment(&num_malloc_calls);
   if (!CheckSizeArgumentsOverflow(nmemb, size)) return NULL;
   assert(nmemb * size > 0);
-  ptr = malloc((size_t)(nmemb * size));
+  ptr = Allocate((size_t)(nmemb * size), 0);
   AddMem(ptr, (size_t)(nmemb * size));
   return ptr;
 }
@@ -203,7 +474,7 @@ void* WebPSafeCalloc(uint64_t nmemb, size_t size) {
   Increment(&num_calloc_calls);
   if (!CheckSizeArgumentsOverflow(nmemb, size)) return NULL;
   assert(nmemb * size > 0);
-  ptr = calloc((size_t)nmemb, size);
+  ptr = Allocate((size_t)(nmemb * size), 1);
   AddMem(ptr, (size_t)(nmemb * size));
   return ptr;
 }
@@ -212,13 +483,119 @@ void WebPSafeFree(void* const ptr) {
   if (ptr != NULL) {
     Increment(&num_free_calls);
     SubMem(ptr);
+    Release(ptr);
   }
-  free(ptr);
 }
 
-// Public API function.
+// Public API functions.
+
+void* WebPMalloc(size_t size) {
+  return WebPSafeMalloc(1, size);
+}
+
 void WebPFree(void* ptr) {
-  free(ptr);
+  WebPSafeFree(ptr);
+}
+
+//------------------------------------------------------------------------------
+// Profiling
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Profile of the thread, and its innermost open stage with the profile that
+// stage counts towards. The stage restarts whenever it resumes after a nested
+// one, which may belong to another profile, e.g. in a hook run by Sync().
+static THREAD_LOCAL WebPProfile* thread_profile = NULL;
+static THREAD_LOCAL WebPProfile* thread_stage_profile = NULL;
+static THREAD_LOCAL int thread_stage = -1;
+static THREAD_LOCAL uint64_t thread_stage_start = 0;
+static THREAD_LOCAL uint32_t thread_id = 0;    // 0 until the first event
+static uint64_t num_profiled_threads = 0;
+
+static const char* const kStageNames[WEBP_STAGE_COUNT] = {
+  "headers", "parse", "reconstruct", "filter", "alpha", "entropy",
+  "transform", "output", "rescale", "enc-convert", "enc-analyze", "enc-code",
+  "enc-alpha", "enc-write", "enc-lossless"
+};
+
+uint64_t WebPProfileNow(void) {
+#if defined(_WIN32)
+  LARGE_INTEGER counter, frequency;
+  QueryPerformanceCounter(&counter);
+  QueryPerformanceFrequency(&frequency);
+  // Split to avoid overflowing on machines that have been up for long.
+  return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000u +
+         (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000u /
+         (uint64_t)frequency.QuadPart;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+const char* WebPProfileStageName(int stage) {
+  return (stage >= 0 && stage < WEBP_STAGE_COUNT) ? kStageNames[stage] : NULL;
+}
+
+void WebPInitProfile(WebPProfile* profile) {
+  if (profile != NULL) memset(profile, 0, sizeof(*profile));
+}
+
+WebPProfile* WebPSetThreadProfile(WebPProfile* profile) {
+  WebPProfile* const previous = thread_profile;
+  thread_profile = profile;
+  return previous;
+}
+
+WebPProfile* WebPGetThreadProfile(void) {
+  return thread_profile;
+}
+
+void WebPStageBegin(WebPStageMark* const mark, WebPProfileStage stage) {
+  uint64_t now;
+  mark->profile_ = thread_profile;
+  if (mark->profile_ == NULL) return;
+  now = WebPProfileNow();
+  if (thread_stage >= 0) {
+    ATOMIC_ADD(&thread_stage_profile->nanoseconds[thread_stage],
+               now - thread_stage_start);
+  }
+  mark->stage_ = (int)stage;
+  mark->outer_ = thread_stage;
+  mark->outer_profile_ = thread_stage_profile;
+  mark->start_ = now;
+  thread_stage = (int)stage;
+  thread_stage_profile = mark->profile_;
+  thread_stage_start = now;
+}
+
+void WebPStageEnd(const WebPStageMark* const mark) {
+  WebPProfile* const profile = mark->profile_;
+  uint64_t now, index;
+  if (profile == NULL) return;
+  assert(thread_stage == mark->stage_ && thread_stage_profile == profile);
+  now = WebPProfileNow();
+  ATOMIC_ADD(&profile->nanoseconds[mark->stage_], now - thread_stage_start);
+  ATOMIC_ADD(&profile->calls[mark->stage_], 1);
+  index = ATOMIC_ADD(&profile->num_events, 1) - 1;
+  if (profile->events != NULL && index < profile->max_events) {
+    WebPProfileEvent* const event = &profile->events[index];
+    if (thread_id == 0) {
+      thread_id = (uint32_t)ATOMIC_ADD(&num_profiled_threads, 1);
+    }
+    event->start = mark->start_;
+    event->duration = now - mark->start_;
+    event->thread = thread_id;
+    event->stage = (uint32_t)mark->stage_;
+  }
+  thread_stage = mark->outer_;
+  thread_stage_profile = mark->outer_profile_;
+  thread_stage_start = now;
 }
 
 //------------------------------------------------------------------------------
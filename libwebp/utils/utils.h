@@ -56,6 +56,25 @@ WEBP_EXTERN void* WebPSafeCalloc(uint64_t nmemb, size_t size);
 // Companion deallocation function to the above allocations.
 WEBP_EXTERN void WebPSafeFree(void* const ptr);
 
+//------------------------------------------------------------------------------
+// Profiling
+
+// A stage opened by WebPStageBegin().
+typedef struct {
+  WebPProfile* profile_;   // NULL if the thread isn't profiled
+  int stage_;
+  int outer_;              // stage it interrupts, or -1
+  WebPProfile* outer_profile_;
+  uint64_t start_;
+} WebPStageMark;
+
+// Times 'stage' on the calling thread until the matching WebPStageEnd(),
+// if the thread has a WebPProfile. Marks must be ended on the same thread,
+// innermost first, whatever the outcome of the stage.
+WEBP_EXTERN void WebPStageBegin(WebPStageMark* const mark,
+                                WebPProfileStage stage);
+WEBP_EXTERN void WebPStageEnd(const WebPStageMark* const mark);
+
 //------------------------------------------------------------------------------
 // Alignment
 
@@ -20,7 +20,7 @@
 extern "C" {
 #endif
 
-#define WEBP_DECODER_ABI_VERSION 0x0208    // MAJOR(8b) + MINOR(8b)
+#define WEBP_DECODER_ABI_VERSION 0x020a    // MAJOR(8b) + MINOR(8b)
 
 // Note: forward declaring enumerations is not allowed in (strict) C and C++,
 // the types are left here for reference.
@@ -33,6 +33,7 @@ typedef struct WebPIDecoder WebPIDecoder;
 typedef struct WebPBitstreamFeatures WebPBitstreamFeatures;
 typedef struct WebPDecoderOptions WebPDecoderOptions;
 typedef struct WebPDecoderConfig WebPDecoderConfig;
+typedef struct WebPDecoderContext WebPDecoderContext;
 
 // Return the decoder's version number, packed in hexadecimal using 8bits for
 // each of major/minor/revision. E.g: v2.5.7 is 0x020507.
@@ -341,6 +342,14 @@ WEBP_EXTERN VP8StatusCode WebPIAppend(
 WEBP_EXTERN VP8StatusCode WebPIUpdate(
     WebPIDecoder* idec, const uint8_t* data, size_t data_size);
 
+// A variant of WebPIAppend() for data arriving in separate buffers, such as
+// network packets. The next 'data_size' bytes are read from 'data' in place:
+// the buffer is not copied, and must stay valid and unchanged until
+// WebPIDelete() is called. Only headers that straddle buffers are copied.
+// Can't be mixed with WebPIAppend() or WebPIUpdate() on the same decoder.
+WEBP_EXTERN VP8StatusCode WebPIAppendSegment(
+    WebPIDecoder* idec, const uint8_t* data, size_t data_size);
+
 // Returns the RGB/A image decoded so far. Returns NULL if output params
 // are not initialized yet. The RGB/A output type corresponds to the colorspace
 // specified during call to WebPINewDecoder() or WebPINewRGB().
@@ -454,12 +463,36 @@ struct WebPDecoderOptions {
   int crop_width, crop_height;        // dimension of the cropping area
   int use_scaling;                    // if true, scaling is applied _afterward_
   int scaled_width, scaled_height;    // final resolution
-  int use_threads;                    // if true, use multi-threaded decoding
+  int use_threads;                    // if true, use multi-threaded decoding.
+                                      // Values above 2 are the number of
+                                      // threads lossy images may use, shared
+                                      // between parsing token partitions in
+                                      // parallel and reconstructing rows in a
+                                      // wavefront.
   int dithering_strength;             // dithering strength (0=Off, 100=full)
   int flip;                           // flip output vertically
   int alpha_dithering_strength;       // alpha dithering strength in [0..100]
-
-  uint32_t pad[5];                    // padding for later use
+  int use_preview;                    // if true, decode a preview at a quarter
+                                      // of the width and height (rounded up)
+                                      // instead of the picture: every 4x4
+                                      // square is averaged, channel by
+                                      // channel before any premultiplying
+                                      // of the output, and lossy images
+                                      // skip loop filtering and full-size
+                                      // output. Cropping and scaling apply to
+                                      // the preview. Ignored by the
+                                      // incremental decoder.
+  int use_reduced_scaling;            // if true, uncropped lossy pictures
+                                      // are averaged down by 2 or 4 while
+                                      // decoding, before scaling, when that
+                                      // divides both dimensions of their
+                                      // chroma, which stays at least as large
+                                      // as the output. Only the output of
+                                      // the full-size rows is saved; parsing
+                                      // and reconstruction cost the same.
+                                      // Ignored by the incremental decoder.
+
+  uint32_t pad[3];                    // padding for later use
 };
 
 // Main object storing the configuration for advanced decoding.
@@ -499,6 +532,37 @@ WEBP_EXTERN WebPIDecoder* WebPIDecode(const uint8_t* data, size_t data_size,
 WEBP_EXTERN VP8StatusCode WebPDecode(const uint8_t* data, size_t data_size,
                                      WebPDecoderConfig* config);
 
+//------------------------------------------------------------------------------
+// Reusable decoding context
+//
+// A WebPDecoderContext keeps the decoder objects and their scratch memory
+// from one WebPDecodeWithContext() call to the next. The scratch buffers of
+// a decode are carved out of a single block, which grows to fit the largest
+// decode seen so far. From the second picture of similar dimensions on (the
+// frames of an animation, for instance), lossy pictures without alpha then
+// decode without allocating anything but the output. Alpha planes and
+// lossless pictures still allocate their Huffman tables on each decode. A
+// context must not be used by two decodes at once.
+
+// Returns NULL in case of memory error.
+WEBP_EXTERN WebPDecoderContext* WebPNewDecoderContext(void);
+
+// Makes 'allocator' serve the decodes that use 'context', in place of the
+// allocator of the calling thread. NULL reverts to the latter. Memory the
+// context already kept stays with the allocator it came from.
+WEBP_EXTERN void WebPSetDecoderContextAllocator(WebPDecoderContext* context,
+                                               WebPAllocator* allocator);
+
+// Releases the context and all the memory it kept.
+WEBP_EXTERN void WebPDeleteDecoderContext(WebPDecoderContext* context);
+
+// Same as WebPDecode(), reusing the memory of 'context'. 'context' can be
+// NULL, in which case this is WebPDecode().
+WEBP_EXTERN VP8StatusCode WebPDecodeWithContext(WebPDecoderContext* context,
+                                                const uint8_t* data,
+                                                size_t data_size,
+                                                WebPDecoderConfig* config);
+
 #ifdef __cplusplus
 }    // extern "C"
 #endif
@@ -20,7 +20,7 @@
 extern "C" {
 #endif
 
-#define WEBP_ENCODER_ABI_VERSION 0x020e    // MAJOR(8b) + MINOR(8b)
+#define WEBP_ENCODER_ABI_VERSION 0x020f    // MAJOR(8b) + MINOR(8b)
 
 // Note: forward declaring enumerations is not allowed in (strict) C and C++,
 // the types are left here for reference.
@@ -345,8 +345,12 @@ struct WebPPicture {
 
   uint32_t pad3[3];       // padding for later use
 
+  // If not NULL, serves WebPEncode() and the picture's own buffers in place
+  // of the allocator of the calling thread (see WebPSetThreadAllocator()).
+  WebPAllocator* allocator;
+
   // Unused for now
-  uint8_t *pad4, *pad5;
+  uint8_t* pad5;
   uint32_t pad6[8];       // padding for later use
 
   // PRIVATE FIELDS
@@ -49,4 +49,141 @@ typedef long long int int64_t;
 // Macro to check ABI compatibility (same major revision number)
 #define WEBP_ABI_IS_INCOMPATIBLE(a, b) (((a) >> 8) != ((b) >> 8))
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//------------------------------------------------------------------------------
+// Memory allocation
+
+// Allocates 'size' bytes of memory the same way libwebp does internally.
+// Returns NULL upon error. Memory must be deallocated by calling WebPFree().
+WEBP_EXTERN void* WebPMalloc(size_t size);
+
+// Releases memory allocated by the functions of libwebp. Also accepts memory
+// from malloc().
+WEBP_EXTERN void WebPFree(void* ptr);
+
+// Counters kept by libwebp for each allocator. Bytes are those asked for,
+// without the allocator's own overhead.
+typedef struct WebPMemoryStats {
+  uint64_t current_bytes;   // bytes allocated and not yet freed
+  uint64_t peak_bytes;      // highest value of 'current_bytes'
+  uint64_t num_allocs;      // number of allocations that succeeded
+  uint64_t num_failures;    // number of allocations that failed
+} WebPMemoryStats;
+
+// Allocator that libwebp routes its memory through.
+//
+// The built-in allocator hands out plain malloc() memory, which callers may
+// release with free() as before, and keeps no statistics.
+//
+// Blocks from any other allocator carry a hidden header and must be released
+// with WebPFree(), or with the free functions of libwebp such as
+// WebPFreeDecBuffer() and WebPDataClear(). Each such block remembers the
+// allocator it came from and is returned to it, whichever thread frees it,
+// so an allocator must outlive all the blocks it handed out, including those
+// kept by long-lived objects like a WebPDecoderContext.
+typedef struct WebPAllocator WebPAllocator;
+struct WebPAllocator {
+  // Returns 'size' bytes, or NULL. If NULL, malloc() is used.
+  void* (*malloc_func)(size_t size, void* opaque);
+  // Releases memory from 'malloc_func'. If NULL, free() is used.
+  void (*free_func)(void* ptr, void* opaque);
+  void* opaque;             // passed to the functions above
+  // If not 0, allocations that would take 'stats.current_bytes' over this
+  // many bytes fail, and the decode or encode reports an out-of-memory error.
+  uint64_t limit;
+  // Maintained by libwebp, atomically when threads are enabled. They can be
+  // read at any time, and are exact once the users of the allocator are
+  // done. 'peak_bytes' can be set to 'current_bytes' to start a new window.
+  WebPMemoryStats stats;
+};
+
+// Clears 'allocator', making it a malloc()/free() allocator without limit.
+WEBP_EXTERN void WebPInitAllocator(WebPAllocator* allocator);
+
+// Makes 'allocator' serve the allocations of the calling thread, and of the
+// WebPWorker hooks it launches, in place of the default one. NULL restores
+// the default. Returns the allocator previously set for the thread, or NULL.
+WEBP_EXTERN WebPAllocator* WebPSetThreadAllocator(WebPAllocator* allocator);
+
+// Returns the allocator set for the calling thread, or NULL.
+WEBP_EXTERN WebPAllocator* WebPGetThreadAllocator(void);
+
+// Makes 'allocator' serve the threads that did not set their own. NULL
+// restores the built-in one. Like WebPSetWorkerInterface() this should be
+// done before any decoding or encoding starts.
+WEBP_EXTERN void WebPSetDefaultAllocator(WebPAllocator* allocator);
+
+// Returns the default allocator. This is the built-in one, whose statistics
+// stay at 0, unless WebPSetDefaultAllocator() installed another.
+WEBP_EXTERN WebPAllocator* WebPGetDefaultAllocator(void);
+
+//------------------------------------------------------------------------------
+// Profiling
+
+// Stages of decoding and encoding timed by a WebPProfile.
+typedef enum WebPProfileStage {
+  WEBP_STAGE_HEADERS = 0,     // container and bitstream headers
+  WEBP_STAGE_PARSE,           // lossy: modes and tokens
+  WEBP_STAGE_RECONSTRUCT,     // lossy: prediction and inverse DCT
+  WEBP_STAGE_FILTER,          // lossy: loop filtering
+  WEBP_STAGE_ALPHA,           // alpha plane: unfiltering, dequantizing...
+  WEBP_STAGE_ENTROPY,         // lossless: entropy and LZ77 decoding
+  WEBP_STAGE_TRANSFORM,       // lossless: inverse transforms
+  WEBP_STAGE_OUTPUT,          // upsampling and colour conversion
+  WEBP_STAGE_RESCALE,         // rescaling, with its colour conversion
+  WEBP_STAGE_ENC_CONVERT,     // encoder: RGB to YUV or YUV to RGB import
+  WEBP_STAGE_ENC_ANALYZE,     // encoder: lossy analysis
+  WEBP_STAGE_ENC_CODE,        // encoder: lossy coding
+  WEBP_STAGE_ENC_ALPHA,       // encoder: alpha plane
+  WEBP_STAGE_ENC_WRITE,       // encoder: lossy bitstream assembly
+  WEBP_STAGE_ENC_LOSSLESS,    // encoder: lossless coding
+  WEBP_STAGE_COUNT
+} WebPProfileStage;
+
+// One run of a stage on one thread.
+typedef struct WebPProfileEvent {
+  uint64_t start;        // nanoseconds, on the clock of WebPProfileNow()
+  uint64_t duration;     // nanoseconds, nested stages included
+  uint32_t thread;       // 1 for the first thread to be profiled, 2 next...
+  uint32_t stage;        // a WebPProfileStage
+} WebPProfileEvent;
+
+// Time spent in each stage by the threads it is set for. A thread's time is
+// charged to its innermost stage only, so the stages add up to no more than
+// the time spent in libwebp. Updated atomically when threads are enabled,
+// and exact once the profiled calls have returned.
+typedef struct WebPProfile {
+  uint64_t nanoseconds[WEBP_STAGE_COUNT];
+  uint64_t calls[WEBP_STAGE_COUNT];    // completed runs of each stage
+  // If not NULL, the first 'max_events' runs are also recorded there, in
+  // the order they finish. 'num_events' counts them all, recorded or not.
+  WebPProfileEvent* events;
+  size_t max_events;
+  uint64_t num_events;
+} WebPProfile;
+
+// Clears 'profile', leaving it without an event buffer.
+WEBP_EXTERN void WebPInitProfile(WebPProfile* profile);
+
+// Makes the stages run by the calling thread, and by the WebPWorker hooks it
+// launches, count towards 'profile'. NULL stops profiling, which is then
+// close to free. Returns the profile previously set for the thread, or NULL.
+WEBP_EXTERN WebPProfile* WebPSetThreadProfile(WebPProfile* profile);
+
+// Returns the profile set for the calling thread, or NULL.
+WEBP_EXTERN WebPProfile* WebPGetThreadProfile(void);
+
+// Current time of the monotonic clock behind the profiles, in nanoseconds.
+WEBP_EXTERN uint64_t WebPProfileNow(void);
+
+// Returns a short name for 'stage', like "filter", or NULL if out of range.
+WEBP_EXTERN const char* WebPProfileStageName(int stage);
+
+#ifdef __cplusplus
+}    // extern "C"
+#endif
+
 #endif  // WEBP_WEBP_TYPES_H_